@@ -31,5 +31,15 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
         benchmark::do_not_optimize(res);
       };
     };
+
+    benchmark::benchmark("dispatcher local depth 4 / " + std::to_string(i)) =
+        [&](auto body)
+    {
+      body = [&]
+      {
+        auto res = fib(dispatcher_args {.n = i, .local_depth = 4});
+        benchmark::do_not_optimize(res);
+      };
+    };
   }
 }
\ No newline at end of file
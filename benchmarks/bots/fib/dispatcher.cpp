@@ -8,32 +8,42 @@
 #include <cppless/dispatcher/aws-lambda.hpp>
 #include <cppless/dispatcher/common.hpp>
 
-using dispatcher = cppless::aws_lambda_beast_dispatcher<>::from_env;
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>::from_env;
 
-auto dispatcher_fib(int i) -> int
+auto dispatcher_fib(int i) -> int;
+
+/**
+ * @brief Computes `fib(i)` with the two subproblems in flight at once. The
+ * first `local_depth` levels are expanded in place, below them every
+ * subproblem is an invocation of its own.
+ */
+static auto fib_coroutine(int i, int local_depth) -> cppless::coroutine<int>
 {
   if (i <= 1) {
-    return i;
+    co_return i;
+  }
+  if (local_depth > 0) {
+    auto a = cppless::spawn(fib_coroutine(i - 1, local_depth - 1));
+    auto b = cppless::spawn(fib_coroutine(i - 2, local_depth - 1));
+    co_return co_await a + co_await b;
   }
-  {
-    dispatcher aws;
-
-    int a, b;
-
-    {
-      auto instance = aws.create_instance();
 
-      auto t = [=](int i) { return dispatcher_fib(i); };
-      cppless::dispatch(instance, t, a, {i - 1});
-      cppless::dispatch(instance, t, b, {i - 2});
-      cppless::wait(instance, 2);
-    }
+  auto& instance = cppless::shared_instance<dispatcher>();
+  auto t = [](int i) { return dispatcher_fib(i); };
+  auto a = cppless::dispatch_async(instance, t, {i - 1});
+  auto b = cppless::dispatch_async(instance, t, {i - 2});
+  co_return co_await a + co_await b;
+}
 
-    return a + b;
-  }
+auto dispatcher_fib(int i) -> int
+{
+  // Warm invocations reuse the connections of the previous ones
+  return cppless::sync_wait(cppless::shared_instance<dispatcher>(),
+                            fib_coroutine(i, 0));
 }
 
 auto fib(dispatcher_args args) -> int
 {
-  return dispatcher_fib(args.n);
+  return cppless::sync_wait(cppless::shared_instance<dispatcher>(),
+                            fib_coroutine(args.n, args.local_depth));
 }
\ No newline at end of file
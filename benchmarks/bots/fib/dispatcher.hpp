@@ -6,6 +6,11 @@ class dispatcher_args
 {
 public:
   int n;
+  /**
+   * @brief Levels of the recursion expanded on the host, whose subtrees are
+   * all in flight at once.
+   */
+  int local_depth = 0;
 };
 
 auto fib(dispatcher_args args) -> int;
\ No newline at end of file
@@ -11,6 +11,11 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
       .help("Use dispatcher")
       .default_value(false)
       .implicit_value(true);
+  program.add_argument("--dispatcher-local-depth")
+      .help("Levels of the recursion expanded on the host when using the "
+            "dispatcher implementation")
+      .default_value(0)
+      .scan<'i', int>();
   program.add_argument("--serial")
       .help("Use serial implementation")
       .default_value(false)
@@ -33,7 +38,8 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
     int r = fib(serial_args {.n = n});
     std::cout << r << std::endl;
   } else if (program["--dispatcher"] == true) {
-    int r = fib(dispatcher_args {.n = n});
+    auto local_depth = program.get<int>("--dispatcher-local-depth");
+    int r = fib(dispatcher_args {.n = n, .local_depth = local_depth});
     std::cout << r << std::endl;
   }
 
@@ -35,7 +35,7 @@
 
 template<class Dispatcher>
 auto add_cell_dispatcher(typename Dispatcher::instance& instance,
-                         std::vector<std::unique_ptr<result_data>>& futures,
+                         std::vector<cppless::task_future<result_data>>& futures,
                          int cutoff,
                          result_data& result,
                          int id,
@@ -100,9 +100,8 @@ auto add_cell_dispatcher(typename Dispatcher::instance& instance,
             add_cell(result, cells[id].next, footprint, board, cells);
             return result;
           };
-          auto& future = *futures.emplace_back(std::make_unique<result_data>());
-          cppless::dispatch(
-              instance, task, future, {{cells.begin(), cells.end()}});
+          futures.push_back(cppless::dispatch_async(
+              instance, task, {{cells.begin(), cells.end()}}));
           // future = task({cells.begin(), cells.end()});
         } else {
           add_cell_dispatcher<Dispatcher>(instance,
@@ -124,12 +123,24 @@ auto add_cell_dispatcher(typename Dispatcher::instance& instance,
 
 using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>::from_env;
 
+/**
+ * @brief Combines the results of `futures` with `result` as they arrive.
+ */
+static auto combine_all(result_data result,
+                        std::vector<cppless::task_future<result_data>>& futures)
+    -> cppless::coroutine<result_data>
+{
+  for (auto& future : futures) {
+    result = combine(result, co_await future);
+  }
+  co_return result;
+}
+
 auto floorplan(dispatcher_args args) -> std::tuple<int, result_data>
 {
-  dispatcher aws;
-  dispatcher::instance instance = aws.create_instance();
+  auto& instance = cppless::shared_instance<dispatcher>();
 
-  std::vector<std::unique_ptr<result_data>> futures;
+  std::vector<cppless::task_future<result_data>> futures;
 
   coord footprint;
   /* footprint of initial board is zero */
@@ -152,10 +163,7 @@ auto floorplan(dispatcher_args args) -> std::tuple<int, result_data>
                                   footprint,
                                   board,
                                   std::span<cell> {args.fp.cells});
-  cppless::wait(instance, futures.size());
-  for (auto& future : futures) {
-    result = combine(result, *future);
-  }
+  result = cppless::sync_wait(instance, combine_all(result, futures));
 
   return {futures.size(), result};
 }
\ No newline at end of file
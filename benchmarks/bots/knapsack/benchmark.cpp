@@ -13,6 +13,7 @@
 
 #include "./common.hpp"
 #include "./dispatcher.hpp"
+#include "./graph.hpp"
 #include "./serial.hpp"
 
 const auto inputs = {12, 16, 20, 24, 32, 36, 40, 44, 48, 64, 96, 128};
@@ -53,5 +54,22 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
         benchmark::do_not_optimize(res);
       };
     };
+
+    benchmark::benchmark("graph / " + std::to_string(input_size)) =
+        [&](auto body)
+    {
+      auto input = load_input("benchmarks/bots/knapsack/inputs/knapsack-"
+                              + input_file_number(input_size) + ".input");
+      body = [&]
+      {
+        auto res = knapsack(graph_args {
+            .items = std::get<0>(input),
+            .capacity = std::get<1>(input),
+            .prefix_length = 6,
+            .window = 16,
+        });
+        benchmark::do_not_optimize(res.best);
+      };
+    };
   }
 }
\ No newline at end of file
@@ -37,7 +37,7 @@ public:
  * capacity c. Value so far is v.
  */
 auto knapsack_serial(int& best_so_far,  // NOLINT
-                     std::span<knapsack_item> items,
+                     std::span<const knapsack_item> items,
                      int c,
                      int v) -> int;
 
@@ -30,6 +30,7 @@
 #include <cereal/types/vector.hpp>
 #include <cppless/dispatcher/aws-lambda.hpp>
 #include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/shared.hpp>
 
 #include "./common.hpp"
 
@@ -43,12 +44,15 @@ inline auto knapsack_dispatcher(unsigned int split,
 {
   if (items.size() == split) {
     auto child_items = items.subspan(1);
-    std::vector<knapsack_item> items_vector(child_items.begin(),
-                                            child_items.end());
-    auto task = [](std::vector<knapsack_item> items, int c, int v) mutable
+    // Every leaf passes the same items, above the remote threshold they are
+    // stored once, keyed by their contents
+    cppless::shared<std::vector<knapsack_item>> items_vector {
+        std::vector<knapsack_item>(child_items.begin(), child_items.end())};
+    auto task =
+        [](cppless::shared<std::vector<knapsack_item>> items, int c, int v)
     {
       int best_so_far = std::numeric_limits<int>::min();
-      return knapsack_serial(best_so_far, items, c, v);
+      return knapsack_serial(best_so_far, items.get(), c, v);
     };
 
     auto& without_future = *futures.emplace_back(std::make_unique<int>());
@@ -76,6 +80,9 @@ using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>::from_env;
 
 auto knapsack(dispatcher_args args) -> int
 {
+  if (args.shared_threshold) {
+    cppless::set_remote_threshold(*args.shared_threshold);
+  }
   dispatcher aws;
   dispatcher::instance instance = aws.create_instance();
 
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <optional>
 #include <vector>
 
 #include "./common.hpp"
@@ -8,6 +10,7 @@ public:
   std::vector<knapsack_item> items;
   int capacity;
   int split;
+  std::optional<std::size_t> shared_threshold;
 };
 
 auto knapsack(dispatcher_args args) -> int;
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "./graph.hpp"
+
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+#include "./common.hpp"
+
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+
+/*
+ * The items from index on, with capacity c left and value v so far.
+ */
+class subproblem
+{
+public:
+  std::size_t index;
+  int c;
+  int v;
+};
+
+/**
+ * @brief Walks the decisions on the first `prefix_length` items depth-first,
+ * taking an item before leaving it out, thus only the open branches of the
+ * current path are held. Branches whose upper bound is below the best value
+ * known when they are reached are pruned. On the host the bound is the
+ * fractional relaxation over all remaining items, which is tighter than the
+ * bound of `knapsack_serial` and worth an invocation saved.
+ */
+class prefix_tree
+{
+public:
+  prefix_tree(std::vector<knapsack_item> items,
+              int capacity,
+              std::size_t prefix_length)
+      : m_items(std::move(items))
+      , m_prefix_length(std::min(prefix_length, m_items.size()))
+      , m_open {{0, capacity, 0}}
+  {
+  }
+
+  /**
+   * @brief The next leaf which may improve on `best`.
+   */
+  auto next(int best) -> std::optional<subproblem>
+  {
+    while (!m_open.empty()) {
+      auto node = m_open.back();
+      m_open.pop_back();
+      if (node.c < 0) {
+        continue;
+      }
+      if (node.index == m_prefix_length) {
+        return node;
+      }
+      if (upper_bound(node) < best) {
+        continue;
+      }
+      const auto& item = m_items[node.index];
+      m_open.push_back({node.index + 1, node.c, node.v});
+      m_open.push_back(
+          {node.index + 1, node.c - item.weight, node.v + item.value});
+    }
+    return std::nullopt;
+  }
+
+  auto remaining_items(const subproblem& leaf) const
+      -> std::vector<knapsack_item>
+  {
+    return {m_items.begin() + static_cast<long>(leaf.index), m_items.end()};
+  }
+
+private:
+  // Fills the capacity with the remaining items by unit value, the last one
+  // in part
+  [[nodiscard]] auto upper_bound(const subproblem& node) const -> double
+  {
+    double bound = node.v;
+    int c = node.c;
+    for (auto i = node.index; i < m_items.size() && c > 0; i++) {
+      const auto& item = m_items[i];
+      if (item.weight <= c) {
+        c -= item.weight;
+        bound += item.value;
+      } else {
+        bound += static_cast<double>(c) * item.unit_value();
+        c = 0;
+      }
+    }
+    return bound;
+  }
+
+  std::vector<knapsack_item> m_items;
+  std::size_t m_prefix_length;
+  std::vector<subproblem> m_open;
+};
+
+auto knapsack(graph_args args) -> graph_result
+{
+  using cppless::execution::expand, cppless::execution::schedule,
+      cppless::execution::then;
+
+  cppless::aws::lambda::client lambda_client;
+  auto key = lambda_client.create_derived_key_from_env();
+  auto aws = std::make_shared<dispatcher>(lambda_client, key);
+  cppless::graph::builder<executor> builder {std::nullopt, aws};
+
+  prefix_tree tree {args.items,
+                    args.capacity,
+                    static_cast<std::size_t>(args.prefix_length)};
+  int best = std::numeric_limits<int>::min();
+  std::size_t invocations = 0;
+
+  // Every leaf spawns the next one once its result raised the best value,
+  // which prunes the tree on the host and bounds the search in the function
+  auto spawn = [&](auto& spawn_next, auto parent) -> void
+  {
+    auto leaf = tree.next(best);
+    if (!leaf) {
+      return;
+    }
+    invocations++;
+    auto task = [items = tree.remaining_items(*leaf),
+                 c = leaf->c,
+                 v = leaf->v,
+                 bound = best]() mutable
+    {
+      int best_so_far = bound;
+      return knapsack_serial(best_so_far, items, c, v);
+    };
+    expand(then(parent, task),
+           [&best, &spawn_next](auto node, const int& value)
+           {
+             best = std::max(best, value);
+             spawn_next(spawn_next, node);
+           });
+  };
+
+  auto start = schedule(builder);
+  for (int i = 0; i < args.window; i++) {
+    spawn(spawn, start);
+  }
+  builder.await_all();
+
+  return {.best = best, .invocations = invocations};
+}
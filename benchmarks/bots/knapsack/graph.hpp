@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "./common.hpp"
+
+class graph_args
+{
+public:
+  std::vector<knapsack_item> items;
+  int capacity;
+  // Decisions taken on the host before the remaining items are solved in a
+  // function
+  int prefix_length;
+  // Leaves in flight at a time
+  int window;
+};
+
+class graph_result
+{
+public:
+  int best;
+  std::size_t invocations;
+};
+
+auto knapsack(graph_args args) -> graph_result;
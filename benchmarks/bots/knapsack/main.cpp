@@ -2,6 +2,7 @@
 
 #include "./common.hpp"
 #include "./dispatcher.hpp"
+#include "./graph.hpp"
 #include "./serial.hpp"
 #include "threads.hpp"
 
@@ -17,6 +18,22 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
       .help("Split value when using the dispatcher implementation")
       .default_value(2)
       .scan<'i', int>();
+  program.add_argument("--dispatcher-shared-threshold")
+      .help("Store the items once above this size in bytes, functions need "
+            "CPPLESS_OBJECT_STORE")
+      .scan<'i', std::size_t>();
+  program.add_argument("--graph")
+      .help("Use graph with dynamic expansion")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--graph-prefix-length")
+      .help("Decisions taken on the host when using the graph implementation")
+      .default_value(6)
+      .scan<'i', int>();
+  program.add_argument("--graph-window")
+      .help("Functions in flight when using the graph implementation")
+      .default_value(16)
+      .scan<'i', int>();
   program.add_argument("--threads")
       .help("Use threads")
       .default_value(false)
@@ -54,8 +71,18 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
     int res = knapsack(dispatcher_args {
         .items = items,
         .capacity = capacity,
-        .split = static_cast<int>(items.size() - prefix_length)});
+        .split = static_cast<int>(items.size() - prefix_length),
+        .shared_threshold =
+            program.present<std::size_t>("--dispatcher-shared-threshold")});
     std::cout << res << std::endl;
+  } else if (program["--graph"] == true) {
+    auto res = knapsack(
+        graph_args {.items = items,
+                    .capacity = capacity,
+                    .prefix_length = program.get<int>("--graph-prefix-length"),
+                    .window = program.get<int>("--graph-window")});
+    std::cout << "number_of_tasks: " << res.invocations << std::endl;
+    std::cout << res.best << std::endl;
   } else if (program["--threads"] == true) {
     auto prefix_length = program.get<int>("--threads-prefix-length");
     int res = knapsack(
@@ -1,6 +1,8 @@
 
 #include "../../include/benchmark.hpp"
 
+#include <algorithm>
+
 #include <argparse/argparse.hpp>
 #include <boost/ut.hpp>
 
@@ -56,5 +58,18 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
         benchmark::do_not_optimize(res);
       };
     };
+
+    // Tens of thousands of nodes for the larger sizes
+    benchmark::benchmark("graph threads 8 / " + std::to_string(i)) =
+        [&, size = i](auto body)
+    {
+      body = [&]
+      {
+        auto prefix_length = std::clamp(size, 1U, 4U);
+        auto res = nqueens(graph_args {
+            .size = size, .prefix_length = prefix_length, .threads = 8});
+        benchmark::do_not_optimize(res);
+      };
+    };
   }
 }
\ No newline at end of file
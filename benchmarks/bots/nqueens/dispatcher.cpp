@@ -1,5 +1,6 @@
 #include <atomic>
 #include <cstddef>
+#include <functional>
 #include <numeric>
 #include <span>
 #include <thread>
@@ -12,6 +13,7 @@
 #include <cereal/types/vector.hpp>
 #include <cppless/dispatcher/aws-lambda.hpp>
 #include <cppless/dispatcher/common.hpp>
+#include <cppless/utils/thread_pool.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <nlohmann/json.hpp>
 
@@ -26,6 +28,13 @@ using cpu_intensive =
     lambda::config<lambda::with_timeout<timeout>,
                    lambda::with_memory<memory_limit>,
                    lambda::with_ephemeral_storage<ephemeral_storage>>;
+// 10 GB functions get six vCPUs
+constexpr unsigned int parallel_memory_limit = 10240;
+using cpu_parallel =
+    lambda::config<lambda::with_timeout<timeout>,
+                   lambda::with_memory<parallel_memory_limit>,
+                   lambda::with_ephemeral_storage<ephemeral_storage>,
+                   lambda::with_threads<0>>;
 
 auto nqueens(dispatcher_args args) -> unsigned long
 {
@@ -79,19 +88,31 @@ auto nqueens(dispatcher_args args) -> unsigned long
 
       auto task = [prefix_length, size](std::vector<unsigned char> prefix)
       {
-        unsigned long res = 0;
-        for (unsigned int i = 0; i < prefix.size(); i += prefix_length) {
-          std::vector<unsigned char> subprefix(prefix.begin() + i,
-                                            prefix.begin() + i + prefix_length);
-          res += nqueens_serial_prefix(size, subprefix); 
-        }
-        return res;
+        // Serial unless the function is configured with threads
+        return cppless::parallel_reduce(
+            0,
+            prefix.size() / prefix_length,
+            0UL,
+            [&](std::size_t i)
+            {
+              std::span<unsigned char> subprefix(
+                  prefix.data() + i * prefix_length, prefix_length);
+              return nqueens_serial_prefix(size, subprefix);
+            },
+            std::plus<>());
       };
 
       auto start_func = std::chrono::high_resolution_clock::now();
-      auto id = cppless::dispatch<cpu_intensive>(
-        instance, task, results[t], {prefix}
-      );
+      int id = 0;
+      if (args.function_threads) {
+        id = cppless::dispatch<cpu_parallel>(
+          instance, task, results[t], {prefix}
+        );
+      } else {
+        id = cppless::dispatch<cpu_intensive>(
+          instance, task, results[t], {prefix}
+        );
+      }
 
       benchmarker.add_function_start(id, start_func);
     }
@@ -6,6 +6,8 @@ public:
   unsigned int size;
   unsigned int prefix_length;
   int threads;
+  // Run each invocation on all vCPUs of a larger function
+  bool function_threads;
   int repetitions;
   std::string output_location;
 };
@@ -27,6 +27,8 @@ class graph_args
 public:
   unsigned int size;
   unsigned int prefix_length;
+  // Threads of the host controller executor
+  unsigned int threads = 1;
 };
 
 auto nqueens(graph_args args) -> unsigned int
@@ -39,7 +41,10 @@ auto nqueens(graph_args args) -> unsigned int
   cppless::aws::lambda::client lambda_client;
   auto key = lambda_client.create_derived_key_from_env();
   auto aws = std::make_shared<dispatcher>(lambda_client, key);
-  cppless::graph::builder<executor> builder {std::nullopt, aws};
+  cppless::graph::builder<executor> builder {
+      std::nullopt,
+      aws,
+      cppless::executor::host_controller_options {.threads = args.threads}};
 
   auto prefixes = std::vector<unsigned char>();
   prefixes.reserve(pow(size, prefix_length));
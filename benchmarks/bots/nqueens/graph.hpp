@@ -5,6 +5,8 @@ class graph_args
 public:
   unsigned int size;
   unsigned int prefix_length;
+  // Threads of the host controller executor
+  unsigned int threads = 1;
 };
 
 auto nqueens(graph_args args) -> unsigned int;
\ No newline at end of file
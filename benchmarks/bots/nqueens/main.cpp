@@ -18,6 +18,10 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
       .help("Prefix length value when using the dispatcher implementation")
       .default_value(2)
       .scan<'i', unsigned int>();
+  program.add_argument("--dispatcher-function-threads")
+      .help("Run each invocation on all vCPUs of a 10 GB function")
+      .default_value(false)
+      .implicit_value(true);
   program.add_argument("--graph")
       .help("Use graph")
       .default_value(false)
@@ -76,6 +80,8 @@ __attribute((weak)) auto main(int argc, char* argv[]) -> int
           .size = size,
           .prefix_length = prefix_length,
           .threads = threads,
+          .function_threads =
+              program["--dispatcher-function-threads"] == true,
           .repetitions = repetitions,
           .output_location = output_location
         });
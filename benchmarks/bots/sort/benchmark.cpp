@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../include/benchmark.hpp"
+
+#include <argparse/argparse.hpp>
+#include <boost/ut.hpp>
+
+#include "./dispatcher.hpp"
+#include "./graph.hpp"
+
+const auto inputs = {1UL << 16, 1UL << 20, 1UL << 22};
+constexpr std::size_t leaf_size = 1UL << 14;
+
+static auto random_input(std::size_t size) -> std::vector<int>
+{
+  std::mt19937 generator(static_cast<std::mt19937::result_type>(size));
+  std::uniform_int_distribution<int> distribution;
+  std::vector<int> input(size);
+  std::generate(
+      input.begin(), input.end(), [&] { return distribution(generator); });
+  return input;
+}
+
+static auto check_sorted(const std::vector<int>& v, std::size_t size) -> void
+{
+  if (v.size() != size || !std::is_sorted(v.begin(), v.end())) {
+    throw std::runtime_error("The result is not sorted");
+  }
+}
+
+__attribute((weak)) auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("sort_bench");
+  benchmark::parse_args(program, argc, argv);
+
+  for (auto input_size : inputs) {
+    auto input = random_input(input_size);
+
+    benchmark::benchmark("dispatcher / " + std::to_string(input_size)) =
+        [&](auto body)
+    {
+      body = [&]
+      {
+        auto res = sort(dispatcher_args {.input = input});
+        check_sorted(res, input_size);
+        benchmark::do_not_optimize(res);
+      };
+    };
+
+    // Inline runs pass through the host on every level of the merge tree,
+    // runs kept in the object store only pass their keys
+    for (bool by_reference : {false, true}) {
+      std::string name = by_reference ? "graph remote / " : "graph inline / ";
+      benchmark::benchmark(name + std::to_string(input_size)) =
+          [&, name, by_reference](auto body)
+      {
+        cppless::transfer_statistics traffic;
+        body = [&]
+        {
+          auto res = graph_sort(graph_args {.input = input,
+                                            .leaf_size = leaf_size,
+                                            .by_reference = by_reference});
+          check_sorted(res.sorted, input_size);
+          traffic = res.host_traffic;
+          benchmark::do_not_optimize(res);
+        };
+        std::cout << name << input_size << ": host sent " << traffic.sent
+                  << " bytes, received " << traffic.received << " bytes"
+                  << std::endl;
+      };
+    }
+  }
+}
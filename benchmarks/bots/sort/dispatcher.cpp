@@ -1,14 +1,14 @@
 #include <algorithm>
-#include <span>
-#include <thread>
+#include <iterator>
 #include <vector>
 
-#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
 #include <cppless/dispatcher/aws-lambda.hpp>
 #include <cppless/dispatcher/common.hpp>
 
-using dispatcher = cppless::aws_lambda_beast_dispatcher<>::from_env;
-using task = cppless::task<dispatcher>;
+#include "./dispatcher.hpp"
+
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>::from_env;
 
 constexpr auto cutoff = 1024;
 
@@ -16,60 +16,10 @@ static auto seq_merge(const std::vector<int>& a,
                       const std::vector<int>& b,
                       std::vector<int>& dest)
 {
-  auto low1 = a.begin();
-  auto high1 = a.end();
-  auto low2 = b.begin();
-  auto high2 = b.end();
-  auto lowdest = dest.begin();
-
-  int a1 = 0;
-  int a2 = 0;
-
-  if (low1 < high1 && low2 < high2) {
-    a1 = *low1;
-    a2 = *low2;
-    for (;;) {
-      if (a1 < a2) {
-        *lowdest++ = a1;
-        a1 = *++low1;
-        if (low1 >= high1) {
-          break;
-        }
-      } else {
-        *lowdest++ = a2;
-        a2 = *++low2;
-        if (low2 >= high2) {
-          break;
-        }
-      }
-    }
-  }
-  if (low1 <= high1 && low2 <= high2) {
-    a1 = *low1;
-    a2 = *low2;
-    for (;;) {
-      if (a1 < a2) {
-        *lowdest++ = a1;
-        ++low1;
-        if (low1 > high1) {
-          break;
-        }
-        a1 = *low1;
-      } else {
-        *lowdest++ = a2;
-        ++low2;
-        if (low2 > high2) {
-          break;
-        }
-        a2 = *low2;
-      }
-    }
-  }
-  if (low1 > high1) {
-    dest.insert(dest.end(), low2, high2);
-  } else {
-    dest.insert(dest.end(), low1, high1);
-  }
+  dest.clear();
+  dest.reserve(a.size() + b.size());
+  std::merge(
+      a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(dest));
 }
 
 static auto cilk_sort(std::vector<int>& v) -> void
@@ -81,41 +31,36 @@ static auto cilk_sort(std::vector<int>& v) -> void
     std::sort(v.begin(), v.end());
     return;
   }
-  std::vector<int> a = {&v[0], &v[quarter]};
-  std::vector<int> b = {&v[quarter], &v[quarter * 2]};
-  std::vector<int> c = {&v[quarter * 2], &v[quarter * 3]};
-  std::vector<int> d = {&v[quarter * 3], &v[v.size()]};
+  auto at = [&v](unsigned long i) { return v.begin() + static_cast<long>(i); };
+  std::vector<int> a(at(0), at(quarter));
+  std::vector<int> b(at(quarter), at(quarter * 2));
+  std::vector<int> c(at(quarter * 2), at(quarter * 3));
+  std::vector<int> d(at(quarter * 3), v.end());
 
-  cppless::shared_future<std::vector<int>> a_future;
-  cppless::shared_future<std::vector<int>> b_future;
-  cppless::shared_future<std::vector<int>> c_future;
-
-  task::sendable t = [](std::vector<int> v)
+  auto t = [](std::vector<int> v)
   {
     cilk_sort(v);
     return v;
   };
 
+  // The invocations progress on the IO thread of the instance while the
+  // last quarter is sorted here
   dispatcher aws;
-  auto instance = aws.create_instance();
-  instance.dispatch(t, a_future, {a});
-  instance.dispatch(t, b_future, {b});
-  instance.dispatch(t, c_future, {c});
-  // WIP: Wait only for the tasks we need?
-  // WIP: Handle network overhead in separate thread automatically?
-  auto thread = std::thread(
-      [&]()
-      {
-        for (int i = 0; i < 3; ++i) {
-          instance.wait_one();
-        }
-      });
+  auto instance = aws.create_instance(cppless::io_mode::background);
+  auto a_future = cppless::dispatch_async(instance, t, {a});
+  auto b_future = cppless::dispatch_async(instance, t, {b});
+  auto c_future = cppless::dispatch_async(instance, t, {c});
   cilk_sort(d);
-  thread.join();
 
-  std::vector<int> left_half(quarter * 2);
-  seq_merge(a_future.value(), b_future.value(), left_half);
-  std::vector<int> right_half(v.size() - quarter * 2);
-  seq_merge(c_future.value(), d, right_half);
+  std::vector<int> left_half;
+  seq_merge(a_future.get(), b_future.get(), left_half);
+  std::vector<int> right_half;
+  seq_merge(c_future.get(), d, right_half);
   seq_merge(left_half, right_half, v);
-}
\ No newline at end of file
+}
+
+auto sort(dispatcher_args args) -> std::vector<int>
+{
+  cilk_sort(args.input);
+  return std::move(args.input);
+}
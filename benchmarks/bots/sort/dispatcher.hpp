@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+class dispatcher_args
+{
+public:
+  std::vector<int> input;
+};
+
+auto sort(dispatcher_args args) -> std::vector<int>;
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/remote.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+#include "./graph.hpp"
+
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+namespace lambda = cppless::aws;
+
+constexpr unsigned int memory_limit = 2048;
+constexpr std::size_t remote_threshold = 64 * 1024;
+
+using inline_config = lambda::config<lambda::with_memory<memory_limit>>;
+using by_reference_config =
+    lambda::config<lambda::with_memory<memory_limit>,
+                   lambda::with_remote_threshold<remote_threshold>>;
+
+using run = cppless::remote<std::vector<int>>;
+using run_sender = cppless::graph::sender<executor, run>;
+
+/**
+ * @brief Sorts the leaves of a binary merge tree in functions and merges the
+ * runs level by level. Every merge reads two runs and writes one, thus with
+ * inline runs every element passes through the host twice per level, while
+ * runs kept in the object store only pass their keys.
+ */
+template<class Config>
+static auto sort_tree(cppless::graph::builder<executor>& builder,
+                      const std::vector<int>& input,
+                      std::size_t leaf_size) -> std::shared_ptr<run_sender>
+{
+  using cppless::execution::schedule, cppless::execution::then;
+
+  auto start = schedule(builder);
+  std::vector<std::shared_ptr<run_sender>> level;
+  for (std::size_t i = 0; i < input.size(); i += leaf_size) {
+    auto end = std::min(input.size(), i + leaf_size);
+    std::vector<int> leaf(input.begin() + static_cast<long>(i),
+                          input.begin() + static_cast<long>(end));
+    auto task = [leaf]() mutable -> run
+    {
+      std::sort(leaf.begin(), leaf.end());
+      return leaf;
+    };
+    level.push_back(then<Config>(start, task));
+  }
+
+  while (level.size() > 1) {
+    std::vector<std::shared_ptr<run_sender>> next;
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+      auto merge = [](run a, run b) -> run
+      {
+        std::vector<int> merged;
+        merged.reserve(a.get().size() + b.get().size());
+        std::merge(a.get().begin(),
+                   a.get().end(),
+                   b.get().begin(),
+                   b.get().end(),
+                   std::back_inserter(merged));
+        return merged;
+      };
+      next.push_back(then<Config>(level[i], level[i + 1], merge));
+    }
+    if (level.size() % 2 == 1) {
+      next.push_back(level.back());
+    }
+    level = std::move(next);
+  }
+  return level.front();
+}
+
+auto graph_sort(graph_args args) -> graph_result
+{
+  cppless::aws::lambda::client lambda_client;
+  auto key = lambda_client.create_derived_key_from_env();
+  auto aws = std::make_shared<dispatcher>(lambda_client, key);
+  cppless::graph::builder<executor> builder {std::nullopt, aws};
+
+  auto root = args.by_reference
+      ? sort_tree<by_reference_config>(builder, args.input, args.leaf_size)
+      : sort_tree<inline_config>(builder, args.input, args.leaf_size);
+  builder.await_all();
+
+  return {
+      .sorted = root->future().value().get(),
+      .host_traffic = builder.core()->executor()->instance().transferred(),
+  };
+}
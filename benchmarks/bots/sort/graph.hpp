@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <cppless/dispatcher/common.hpp>
+
+class graph_args
+{
+public:
+  std::vector<int> input;
+  std::size_t leaf_size;
+  // Keep the runs merged by functions in the object store
+  bool by_reference;
+};
+
+class graph_result
+{
+public:
+  std::vector<int> sorted;
+  // Payload bytes the host sent and received
+  cppless::transfer_statistics host_traffic;
+};
+
+auto graph_sort(graph_args args) -> graph_result;
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/utils/cereal.hpp>
+
+#include "../../include/benchmark.hpp"
+
+template<class F>
+auto payloads_per_second(int n, F&& f) -> double
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    f(i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto seconds = std::chrono::duration<double>(end - start).count();
+  return n / seconds;
+}
+
+/**
+ * @brief Prepares `n` dispatches of the same task with distinct arguments,
+ * i.e. everything `dispatch` does on the dispatching thread before handing
+ * the request on: creating the task, serializing the payload and naming the
+ * function. Returns the unbound and the bound rate.
+ */
+template<class RequestArchive>
+auto run(int n, std::size_t capture_size) -> std::tuple<double, double>
+{
+  using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<RequestArchive>;
+  using factory =
+      cppless::lambda_task_factory<dispatcher,
+                                   typename dispatcher::default_config>;
+
+  std::vector<double> weights(capture_size);
+  for (std::size_t i = 0; i < capture_size; i++) {
+    weights[i] = static_cast<double>(i);
+  }
+  auto fn = [weights](int i) -> double
+  { return weights[static_cast<std::size_t>(i) % weights.size()]; };
+
+  auto unbound = payloads_per_second(
+      n,
+      [&](int i)
+      {
+        auto task = factory::create(fn);
+        std::tuple<int> args {i};
+        cppless::invocation_payload data {task, args};
+        auto payload = RequestArchive::serialize_chain(data);
+        auto name = cppless::task_function_name(task);
+        benchmark::do_not_optimize(payload);
+        benchmark::do_not_optimize(name);
+      });
+
+  auto task = cppless::bind_task(factory::create(fn));
+  auto bound = payloads_per_second(
+      n,
+      [&](int i)
+      {
+        std::tuple<int> args {i};
+        cppless::invocation_payload data {task, args};
+        auto payload = RequestArchive::serialize_chain(data);
+        auto name = cppless::task_function_name(task);
+        benchmark::do_not_optimize(payload);
+        benchmark::do_not_optimize(name);
+      });
+
+  return {unbound, bound};
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("dispatch_benchmark");
+
+  program.add_argument("-n")
+      .help("number of dispatches per scenario")
+      .default_value(10000)
+      .scan<'i', int>();
+  program.add_argument("-s")
+      .help("number of doubles captured by the task")
+      .default_value(16384)
+      .scan<'i', int>();
+  program.add_argument("-o")
+      .default_value(std::string(""))
+      .help("location to write output statistics");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  int n = program.get<int>("-n");
+  auto capture_size = static_cast<std::size_t>(program.get<int>("-s"));
+  std::string output_location = program.get("-o");
+
+  auto [binary_unbound, binary_bound] =
+      run<cppless::binary_archive>(n, capture_size);
+  auto [json_unbound, json_bound] =
+      run<cppless::json_binary_archive>(n, capture_size);
+
+  std::cout << "binary_archive unbound: " << binary_unbound << " payloads/s"
+            << std::endl;
+  std::cout << "binary_archive bound: " << binary_bound << " payloads/s"
+            << std::endl;
+  std::cout << "json_binary_archive unbound: " << json_unbound
+            << " payloads/s" << std::endl;
+  std::cout << "json_binary_archive bound: " << json_bound << " payloads/s"
+            << std::endl;
+
+  if (!output_location.empty()) {
+    std::ofstream output_file {output_location, std::ios::out};
+    output_file << "scenario,payloads_per_second" << std::endl;
+    output_file << "binary_unbound," << binary_unbound << std::endl;
+    output_file << "binary_bound," << binary_bound << std::endl;
+    output_file << "json_binary_unbound," << json_unbound << std::endl;
+    output_file << "json_binary_bound," << json_bound << std::endl;
+  }
+
+  return 0;
+}
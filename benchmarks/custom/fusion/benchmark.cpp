@@ -0,0 +1,126 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+using fusable = cppless::aws::config<cppless::aws::with_fusion>;
+
+class run_result
+{
+public:
+  std::size_t invocations;
+  double makespan;
+  long sum;
+};
+
+/**
+ * @brief Runs `pairs` pairs of chains of three small tasks, each pair joined
+ * by a fan-in, optionally fusing the graph beforehand. Without fusion every
+ * task is an invocation, with fusion every pair is a single one.
+ */
+auto run(int pairs, bool fuse) -> run_result
+{
+  using cppless::execution::schedule, cppless::execution::then;
+
+  cppless::aws::lambda::client lambda_client;
+  auto key = lambda_client.create_derived_key_from_env();
+  auto aws = std::make_shared<dispatcher>(lambda_client, key);
+  cppless::graph::builder<executor> builder {std::nullopt, aws};
+
+  auto chain = [](auto start, long seed)
+  {
+    auto generate = then<fusable>(start, [seed]() { return seed; });
+    auto square = then<fusable>(generate, [](long x) { return x * x; });
+    return then<fusable>(square, [](long x) { return x % 1000; });
+  };
+
+  auto start = schedule(builder);
+  std::vector<cppless::shared_future<long>> futures;
+  std::size_t tasks = 0;
+  for (int i = 0; i < pairs; i++) {
+    auto left = chain(start, 2L * i);
+    auto right = chain(start, 2L * i + 1);
+    futures.push_back(
+        then<fusable>(left, right, [](long a, long b) { return a + b; })
+            ->future());
+    tasks += 7;
+  }
+
+  std::size_t saved = fuse ? builder.fuse() : 0;
+  auto begin = std::chrono::high_resolution_clock::now();
+  builder.await_all();
+  auto end = std::chrono::high_resolution_clock::now();
+
+  long sum = 0;
+  for (auto& f : futures) {
+    sum += f.value();
+  }
+  return {
+      .invocations = tasks - saved,
+      .makespan =
+          std::chrono::duration<double, std::milli>(end - begin).count(),
+      .sum = sum,
+  };
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("fusion_bench");
+
+  program.add_argument("pairs")
+      .help("number of pairs of chains")
+      .scan<'i', int>();
+  program.add_argument("-r")
+      .help("number of repetitions")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("-o")
+      .default_value(std::string(""))
+      .help("location to write output statistics");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  int pairs = program.get<int>("pairs");
+  int repetitions = program.get<int>("-r");
+  std::string output_location = program.get("-o");
+
+  // repetition, fused, invocations, makespan
+  std::vector<std::tuple<int, bool, std::size_t, double>> results;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    for (bool fuse : {false, true}) {
+      auto res = run(pairs, fuse);
+      std::cout << (fuse ? "fused" : "unfused") << " invocations "
+                << res.invocations << " makespan " << res.makespan << " ms"
+                << " sum " << res.sum << std::endl;
+      results.emplace_back(rep, fuse, res.invocations, res.makespan);
+    }
+  }
+
+  if (!output_location.empty()) {
+    std::ofstream output_file {output_location, std::ios::out};
+    output_file << "repetition,fused,invocations,makespan" << std::endl;
+    for (auto& [rep, fused, invocations, makespan] : results) {
+      output_file << rep << "," << fused << "," << invocations << ","
+                  << makespan << std::endl;
+    }
+  }
+
+  return 0;
+}
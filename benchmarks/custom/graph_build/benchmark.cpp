@@ -0,0 +1,165 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+using dispatcher = cppless::aws_lambda_nghttp2_dispatcher<>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+using value_sender = cppless::graph::sender<executor, long>;
+
+// Heap allocations made through the global allocation functions
+static std::atomic<std::size_t> heap_bytes = 0;  // NOLINT
+static std::atomic<std::size_t> heap_allocations = 0;  // NOLINT
+
+auto operator new(std::size_t size) -> void*
+{
+  heap_bytes += size;
+  heap_allocations++;
+  if (void* p = std::malloc(size)) {  // NOLINT
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);  // NOLINT
+}
+
+void operator delete(void* p, std::size_t /*size*/) noexcept
+{
+  std::free(p);  // NOLINT
+}
+
+class run_result
+{
+public:
+  double build_time;
+  double adjacency_time;
+  double bytes_per_node;
+  double allocations_per_node;
+  double arena_bytes_per_node;
+};
+
+/**
+ * @brief Builds a graph of `nodes` tasks, each depending on its predecessor
+ * and on the node halfway back, i.e. two edges per node. The graph is only
+ * built, not run.
+ */
+auto run(std::size_t nodes) -> run_result
+{
+  using cppless::execution::schedule, cppless::execution::then;
+
+  cppless::aws::lambda::client lambda_client;
+  auto key = lambda_client.create_derived_key_from_env();
+  auto aws = std::make_shared<dispatcher>(lambda_client, key);
+  cppless::graph::builder<executor> builder {std::nullopt, aws};
+
+  std::vector<std::shared_ptr<value_sender>> senders;
+  senders.reserve(nodes);
+
+  auto bytes_before = heap_bytes.load();
+  auto allocations_before = heap_allocations.load();
+  auto begin = std::chrono::high_resolution_clock::now();
+
+  auto start = schedule(builder);
+  senders.push_back(then(start, []() { return 1L; }));
+  for (std::size_t i = 1; i < nodes; i++) {
+    senders.push_back(then(senders[i - 1],
+                           senders[i / 2],
+                           [](long a, long b) { return a + b; }));
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+  auto bytes = heap_bytes.load() - bytes_before;
+  auto allocations = heap_allocations.load() - allocations_before;
+
+  auto adjacency_begin = std::chrono::high_resolution_clock::now();
+  auto edges = builder.core()->adjacency();
+  auto adjacency_end = std::chrono::high_resolution_clock::now();
+  if (edges.edge_count() != 2 * nodes - 1) {
+    throw std::runtime_error("Unexpected number of edges");
+  }
+
+  auto per_node = [nodes](std::size_t total)
+  { return static_cast<double>(total) / static_cast<double>(nodes); };
+  return {
+      .build_time =
+          std::chrono::duration<double, std::milli>(end - begin).count(),
+      .adjacency_time = std::chrono::duration<double, std::milli>(
+                            adjacency_end - adjacency_begin)
+                            .count(),
+      .bytes_per_node = per_node(bytes),
+      .allocations_per_node = per_node(allocations),
+      .arena_bytes_per_node = per_node(builder.core()->memory()->allocated()),
+  };
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("graph_build_bench");
+
+  program.add_argument("-n")
+      .help("number of nodes")
+      .default_value(1000000)
+      .scan<'i', int>();
+  program.add_argument("-r")
+      .help("number of repetitions")
+      .default_value(1)
+      .scan<'i', int>();
+  program.add_argument("-o")
+      .default_value(std::string(""))
+      .help("location to write output statistics");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  auto nodes = static_cast<std::size_t>(program.get<int>("-n"));
+  int repetitions = program.get<int>("-r");
+  std::string output_location = program.get("-o");
+
+  std::vector<std::tuple<int, run_result>> results;
+  for (int rep = 0; rep < repetitions; ++rep) {
+    auto res = run(nodes);
+    std::cout << "nodes " << nodes << " build " << res.build_time << " ms"
+              << " adjacency " << res.adjacency_time << " ms"
+              << " heap bytes/node " << res.bytes_per_node
+              << " allocations/node " << res.allocations_per_node
+              << " arena bytes/node " << res.arena_bytes_per_node
+              << std::endl;
+    results.emplace_back(rep, res);
+  }
+
+  if (!output_location.empty()) {
+    std::ofstream output_file {output_location, std::ios::out};
+    output_file << "repetition,nodes,build_time,adjacency_time,bytes_per_node,"
+                   "allocations_per_node,arena_bytes_per_node"
+                << std::endl;
+    for (auto& [rep, res] : results) {
+      output_file << rep << "," << nodes << "," << res.build_time << ","
+                  << res.adjacency_time << "," << res.bytes_per_node << ","
+                  << res.allocations_per_node << ","
+                  << res.arena_bytes_per_node << std::endl;
+    }
+  }
+
+  return 0;
+}
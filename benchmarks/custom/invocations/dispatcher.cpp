@@ -1,4 +1,5 @@
 #include <fstream>
+#include <optional>
 #include <random>
 #include <vector>
 
@@ -11,7 +12,7 @@ auto no_op(int dummy) -> int
 }
 
 template<typename Dispatcher>
-void benchmark(Dispatcher && instance, int repetitions, int np, const std::string& output_location)
+void benchmark(Dispatcher && instance, int repetitions, int np, bool bind, const std::string& output_location)
 {
   // repetition, sample id, time, request id, is_cold
   std::vector<std::tuple<int, int, uint64_t, std::string, bool>> time_results;
@@ -24,10 +25,15 @@ void benchmark(Dispatcher && instance, int repetitions, int np, const std::strin
     std::vector<int> results(np);
     
     auto fn = [=](int dummy) { return no_op(dummy); };
+    // Serializes the task once instead of on every dispatch
+    std::optional<decltype(cppless::bind_task(instance, fn))> bound;
+    if(bind)
+      bound.emplace(cppless::bind_task(instance, fn));
     auto start = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < np; i++) {
       auto start_func = std::chrono::high_resolution_clock::now();
-      auto id = cppless::dispatch(instance,
+      auto id = bound ? cppless::dispatch(instance, *bound, results[i], {42})
+                      : cppless::dispatch(instance,
                         fn,
                         results[i],
                         {42});
@@ -91,6 +97,10 @@ auto main(int argc, char* argv[]) -> int
   program.add_argument("-d")
       .default_value(std::string(""))
       .help("location to write output statistics");
+  program.add_argument("-b")
+      .help("bind the task once instead of serializing it on every dispatch")
+      .default_value(false)
+      .implicit_value(true);
 
   try {
     program.parse_args(argc, argv);
@@ -104,13 +114,14 @@ auto main(int argc, char* argv[]) -> int
   int repetitions = program.get<int>("-r");
   std::string output_location = program.get("-o");
   std::string dispatcher = program.get("-d");
+  bool bind = program.get<bool>("-b");
 
   if(dispatcher == "nghttp2") {
     dispatcher_nghttp2 aws;
-    benchmark(aws.create_instance(), repetitions, np, output_location);
+    benchmark(aws.create_instance(), repetitions, np, bind, output_location);
   } else if(dispatcher == "beast") {
     dispatcher_beast aws;
-    benchmark(aws.create_instance(), repetitions, np, output_location);
+    benchmark(aws.create_instance(), repetitions, np, bind, output_location);
   } else {
     exit(1);
   }
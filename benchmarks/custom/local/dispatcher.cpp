@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cppless/dispatcher/local.hpp>
+
+using dispatcher = cppless::local_dispatcher<cereal::BinaryInputArchive,
+                                             cereal::BinaryOutputArchive>;
+
+auto no_op(int dummy) -> int
+{
+  return dummy + 1;
+}
+
+// Dispatches `np` no-op invocations per repetition and reports the
+// invocations per second
+auto benchmark(dispatcher& local, int repetitions, int np) -> void
+{
+  for (int rep = 0; rep < repetitions + 1; ++rep) {
+    auto instance = local.create_instance();
+    std::vector<int> results(np);
+
+    auto fn = [=](int dummy) { return no_op(dummy); };
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < np; i++) {
+      cppless::dispatch(instance, fn, results[i], {i});
+    }
+    for (int i = 0; i < np; i++) {
+      instance.wait_one();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+            .count();
+
+    // The first repetition starts the workers of the pooled mode
+    std::cout << (rep == 0 ? "Warmup " : "Repetition ") << rep << " "
+              << duration / 1000.0 << " ms, "
+              << np / (static_cast<double>(duration) / 1e6)
+              << " invocations/s" << std::endl;
+  }
+}
+
+__attribute((weak)) auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("local_bench_dispatcher");
+
+  program.add_argument("-p")
+      .help("number of invocations per repetition")
+      .default_value(1000)
+      .scan<'i', int>();
+  program.add_argument("-r")
+      .help("number of repetitions")
+      .default_value(5)
+      .scan<'i', int>();
+  program.add_argument("-m")
+      .help("execution mode: fork (a process per invocation) or pooled")
+      .default_value(std::string {"pooled"});
+  program.add_argument("-w")
+      .help("resident workers in pooled mode")
+      .default_value(static_cast<int>(std::thread::hardware_concurrency()))
+      .scan<'i', int>();
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  auto np = program.get<int>("-p");
+  auto repetitions = program.get<int>("-r");
+  auto mode = program.get<std::string>("-m");
+  if (mode != "fork" && mode != "pooled") {
+    std::cerr << "Unknown mode " << mode << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  cppless::local_dispatcher_options options;
+  options.pooled = mode == "pooled";
+  options.pool.max_workers =
+      static_cast<std::size_t>(std::max(1, program.get<int>("-w")));
+  dispatcher local {argv[0], options};  // NOLINT
+
+  benchmark(local, repetitions, np);
+  return 0;
+}
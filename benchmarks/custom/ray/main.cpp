@@ -10,6 +10,7 @@
 #include <thread>
 
 #include <argparse/argparse.hpp>
+#include <cppless/dispatcher/remote.hpp>
 
 #include "bvh.hpp"
 #include "camera.hpp"
@@ -103,6 +104,14 @@ __attribute((weak)) int main(int argc, char* argv[])
       .help("Prefix length value when using the dispatcher implementation")
       .default_value(64)
       .scan<'i', unsigned int>();
+  program.add_argument("--dispatcher-function-threads")
+      .help("Render each tile on all vCPUs of a 10 GB function")
+      .default_value(false)
+      .implicit_value(true);
+  program.add_argument("--dispatcher-shared-threshold")
+      .help("Store the scene once above this size in bytes, functions need "
+            "CPPLESS_OBJECT_STORE")
+      .scan<'i', std::size_t>();
   program.add_argument("--dispatcher-trace-output")
       .default_value(std::string {""});
   program.add_argument("--path")
@@ -167,9 +176,14 @@ __attribute((weak)) int main(int argc, char* argv[])
   //cppless::tracing_span_container spans;
   //auto root = spans.create_root("root").start();
   if (program["--dispatcher"] == true) {
+    if (auto threshold =
+            program.present<std::size_t>("--dispatcher-shared-threshold"))
+    {
+      cppless::set_remote_threshold(*threshold);
+    }
     auto tile_width = program.get<unsigned int>("--dispatcher-tile-width");
     auto tile_height = program.get<unsigned int>("--dispatcher-tile-height");
-    r = std::make_unique<aws_lambda_renderer>(tile_width, tile_height, repetitions, output_location, img_location);
+    r = std::make_unique<aws_lambda_renderer>(tile_width, tile_height, repetitions, output_location, img_location, program["--dispatcher-function-threads"] == true);
   } else if (program["--serial"] == true) {
     r = std::make_unique<single_threaded_renderer>(repetitions, output_location, img_location);
   } else if (program["--threads"] != -1) {
@@ -1,5 +1,6 @@
 #include <mutex>
 #include <random>
+#include <utility>
 #include <vector>
 
 #include "renderer.hpp"
@@ -8,6 +9,8 @@
 #include "camera.hpp"
 #include "common.hpp"
 #include "cppless/dispatcher/common.hpp"
+#include "cppless/dispatcher/shared.hpp"
+#include "cppless/utils/thread_pool.hpp"
 #include "hittable.hpp"
 #include "image.hpp"
 #include "material.hpp"
@@ -218,15 +221,19 @@ void aws_lambda_renderer::start(scene sc,
       std::mt19937 generator(42);
       auto bvh_root = bvh_node(sc.world, generator);
       auto bhv_end = std::chrono::high_resolution_clock::now();
+      // Every tile is rendered from the same tree, above the remote threshold
+      // it is stored once and fetched once per function container
+      cppless::shared<bvh_node> shared_root {std::move(bvh_root)};
 
       camera cam = sc.cam;
       unsigned int width = target.width();
       unsigned int height = target.height();
       int samples_per_pixel = sc.samples_per_pixel;
       int max_depth = sc.max_depth;
-      auto t = [cam, width, height, samples_per_pixel, max_depth](tile t,
-                                                                  bvh_node world)
+      auto t = [cam, width, height, samples_per_pixel, max_depth](
+                   tile t, cppless::shared<bvh_node> shared_world)
       {
+        const bvh_node& world = shared_world.get();
         std::mt19937 generator(42);
         std::uniform_real_distribution<double> distribution(0.0, 1.0);
         image tile_img(t.width, t.height, samples_per_pixel);
@@ -243,6 +250,33 @@ void aws_lambda_renderer::start(scene sc,
         }
         return tile_img;
       };
+      // Renders the columns of the tile on the threads of the function, each
+      // column from its own generator
+      auto t_parallel = [cam, width, height, samples_per_pixel, max_depth](
+                            tile t, cppless::shared<bvh_node> shared_world)
+      {
+        const bvh_node& world = shared_world.get();
+        image tile_img(t.width, t.height, samples_per_pixel);
+        cppless::parallel_for(
+            0,
+            t.width,
+            [&](std::size_t column)
+            {
+              int x = t.x + static_cast<int>(column);
+              std::mt19937 generator(42 + x);
+              std::uniform_real_distribution<double> distribution(0.0, 1.0);
+              for (int y = t.y; y < t.height + t.y; y++) {
+                for (int s = 0; s < samples_per_pixel; ++s) {
+                  auto u = (x + distribution(generator)) / (width - 1);
+                  auto v = (y + distribution(generator)) / (height - 1);
+                  ray r = cam.get_ray(u, v, generator);
+                  tile_img(x - t.x, y - t.y) +=
+                      ray_color(r, world, max_depth, generator);
+                }
+              }
+            });
+        return tile_img;
+      };
 
       std::vector<image> images(tiles.size());
       int start_position_vec = time_results.size();
@@ -251,11 +285,19 @@ void aws_lambda_renderer::start(scene sc,
       auto start = std::chrono::high_resolution_clock::now();
       for (int i = 0; i < tiles.size(); i++) {
         auto start_func = std::chrono::high_resolution_clock::now();
-        auto id = cppless::dispatch(instance,
-                          t,
-                          images[i],
-                          {tiles[i], bvh_root});
-                          //m_span_ref.create_child("lambda_invocation"));
+        int id = 0;
+        if (m_function_threads) {
+          id = cppless::dispatch<parallel_config>(instance,
+                            t_parallel,
+                            images[i],
+                            {tiles[i], shared_root});
+        } else {
+          id = cppless::dispatch(instance,
+                            t,
+                            images[i],
+                            {tiles[i], shared_root});
+                            //m_span_ref.create_child("lambda_invocation"));
+        }
         if(first_id == -1)
           first_id = id;
         auto ts = std::chrono::time_point_cast<std::chrono::microseconds>(start_func).time_since_epoch().count();
@@ -114,6 +114,12 @@ namespace lambda = cppless::aws;
 using task =
     dispatcher::task<lambda::with_memory<memory_limit>,
                      lambda::with_ephemeral_storage<ephemeral_storage>>;
+// 10 GB functions get six vCPUs, which render the columns of a tile
+constexpr unsigned int parallel_memory_limit = 10240;
+using parallel_config =
+    lambda::config<lambda::with_memory<parallel_memory_limit>,
+                   lambda::with_ephemeral_storage<ephemeral_storage>,
+                   lambda::with_threads<0>>;
 
 class aws_lambda_renderer : public renderer
 {
@@ -122,13 +128,15 @@ public:
                       unsigned int tile_height,
                       int repetitions,
                       std::string output_location,
-                      std::string img_location)
+                      std::string img_location,
+                      bool function_threads = false)
                       //cppless::tracing_span_ref span_ref)
       : m_tile_width(tile_width),
         m_tile_height(tile_height),
         m_repetitions(repetitions),
         m_output_location(output_location),
-        m_img_location(img_location)
+        m_img_location(img_location),
+        m_function_threads(function_threads)
       {};
       //, m_span_ref(span_ref) {};
   void start(scene sc,
@@ -149,6 +157,7 @@ private:
 
   unsigned int m_tile_width;
   unsigned int m_tile_height;
+  bool m_function_threads;
   //cppless::tracing_span_ref m_span_ref;
   std::optional<std::thread> m_worker;
 };
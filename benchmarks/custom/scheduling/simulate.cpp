@@ -0,0 +1,78 @@
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cppless/graph/scheduling.hpp>
+#include <nlohmann/json.hpp>
+
+using cppless::executor::recorded_graph;
+using cppless::executor::scheduling_policy;
+
+/**
+ * @brief Replays a graph recorded with `host_controller_executor::record`
+ * under every scheduling policy and concurrency cap and prints the simulated
+ * makespans.
+ */
+auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("scheduling_simulate");
+
+  program.add_argument("graph").help("location of the recorded graph (json)");
+  program.add_argument("-c")
+      .default_value(std::string("0,1,2,4,8,16,32,64"))
+      .help("comma separated caps on the invocations in flight, 0 for none");
+  program.add_argument("-o")
+      .default_value(std::string(""))
+      .help("location to write output statistics");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  std::ifstream input {program.get("graph")};
+  recorded_graph graph = nlohmann::json::parse(input).get<recorded_graph>();
+
+  std::vector<std::size_t> caps;
+  std::stringstream caps_stream {program.get("-c")};
+  for (std::string cap; std::getline(caps_stream, cap, ',');) {
+    caps.push_back(std::stoul(cap));
+  }
+
+  std::vector<std::pair<std::string, scheduling_policy>> policies {
+      {"lifo", scheduling_policy::lifo},
+      {"fifo", scheduling_policy::fifo},
+      {"critical_path", scheduling_policy::critical_path},
+  };
+
+  // policy, cap, makespan
+  std::vector<std::tuple<std::string, std::size_t, double>> results;
+  for (auto cap : caps) {
+    for (auto& [name, policy] : policies) {
+      double makespan = cppless::executor::simulate(graph, policy, cap);
+      std::cout << name << " cap " << cap << " makespan " << makespan << " ms"
+                << std::endl;
+      results.emplace_back(name, cap, makespan);
+    }
+  }
+
+  std::string output_location = program.get("-o");
+  if (!output_location.empty()) {
+    std::ofstream output_file {output_location, std::ios::out};
+    output_file << "policy,cap,makespan" << std::endl;
+    for (auto& [policy, cap, makespan] : results) {
+      output_file << policy << "," << cap << "," << makespan << std::endl;
+    }
+  }
+
+  return 0;
+}
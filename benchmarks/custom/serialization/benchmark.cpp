@@ -88,6 +88,44 @@ auto main(int argc, char* argv[]) -> int
     };
   };
 
+  benchmark::benchmark("encode / fast_binary") = [&](auto body)
+  {
+    body = [&]
+    {
+      auto encoded = cppless::fast_binary_archive::serialize(something);
+      benchmark::do_not_optimize(encoded);
+    };
+  };
+  benchmark::benchmark("decode / fast_binary") = [&](auto body)
+  {
+    auto encoded = cppless::fast_binary_archive::serialize(something);
+    body = [&]
+    {
+      std::vector<some_data> decoded;
+      cppless::fast_binary_archive::deserialize(encoded, decoded);
+      benchmark::do_not_optimize(decoded);
+    };
+  };
+
+  benchmark::benchmark("encode / fast_binary_json") = [&](auto body)
+  {
+    body = [&]
+    {
+      auto encoded = cppless::json_fast_binary_archive::serialize(something);
+      benchmark::do_not_optimize(encoded);
+    };
+  };
+  benchmark::benchmark("decode / fast_binary_json") = [&](auto body)
+  {
+    auto encoded = cppless::json_fast_binary_archive::serialize(something);
+    body = [&]
+    {
+      std::vector<some_data> decoded;
+      cppless::json_fast_binary_archive::deserialize(encoded, decoded);
+      benchmark::do_not_optimize(decoded);
+    };
+  };
+
   benchmark::benchmark("encode / json") = [&](auto body)
   {
     body = [&]
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <optional>
 #include <sstream>
 #include <vector>
 #include <fstream>
@@ -11,6 +15,7 @@
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
 
+#include <boost/beast/core/detail/base64.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <boost/iostreams/device/array.hpp>
 #include <boost/iostreams/stream.hpp>
@@ -279,6 +284,381 @@ std::vector<double> benchmark_json_decode(int repetitions, bool flush_cache, std
   return times;
 }
 
+// json_binary_archive, encoding incrementally while cereal emits bytes
+template<typename T>
+std::vector<double> benchmark_binary_json_stream_encode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::json_binary_archive::serialize(input);
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      encoded = cppless::json_binary_archive::serialize(input);
+      benchmark::do_not_optimize(encoded);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size()
+  );
+
+  return times;
+}
+
+template<typename T>
+std::vector<double> benchmark_binary_json_stream_decode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::json_binary_archive::serialize(input);
+
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::json_binary_archive::deserialize(encoded, deserialized);
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of binary decode!" << std::endl;
+  }
+
+  return times;
+}
+
+// fast_binary_archive, appending to a contiguous buffer with varint sizes
+template<typename T>
+std::vector<double> benchmark_fast_binary_encode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::fast_binary_archive::serialize(input);
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      encoded = cppless::fast_binary_archive::serialize(input);
+      benchmark::do_not_optimize(encoded);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size()
+  );
+
+  return times;
+}
+
+template<typename T>
+std::vector<double> benchmark_fast_binary_decode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::fast_binary_archive::serialize(input);
+
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::fast_binary_archive::deserialize(encoded, deserialized);
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of fast binary decode!" << std::endl;
+  }
+
+  return times;
+}
+
+// json_fast_binary_archive, base64 encoding the buffer in one pass
+template<typename T>
+std::vector<double> benchmark_fast_binary_json_encode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::json_fast_binary_archive::serialize(input);
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      encoded = cppless::json_fast_binary_archive::serialize(input);
+      benchmark::do_not_optimize(encoded);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size()
+  );
+
+  return times;
+}
+
+template<typename T>
+std::vector<double> benchmark_fast_binary_json_decode(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::string encoded = cppless::json_fast_binary_archive::serialize(input);
+
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::json_fast_binary_archive::deserialize(encoded, deserialized);
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of fast binary decode!" << std::endl;
+  }
+
+  return times;
+}
+
+// Raw base64 throughput of a single kernel on the serialized input
+template<typename T>
+std::vector<double> benchmark_base64_encode(int repetitions, bool flush_cache, std::vector<T>& input, cppless::base64::kernel kernel)
+{
+  std::string serialized = cppless::binary_archive::serialize(input);
+  std::string encoded;
+  encoded.resize(cppless::base64::encoded_size(serialized.size()));
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::base64::encoder encoder {kernel};
+      auto written = encoder.update(serialized.data(), serialized.size(), encoded.data());
+      encoder.finish(encoded.data() + written);
+      benchmark::do_not_optimize(encoded);
+    },
+    reinterpret_cast<char*>(serialized.data()),
+    sizeof(char)*serialized.size(),
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size()
+  );
+
+  return times;
+}
+
+template<typename T>
+std::vector<double> benchmark_base64_decode(int repetitions, bool flush_cache, std::vector<T>& input, cppless::base64::kernel kernel)
+{
+  std::string serialized = cppless::binary_archive::serialize(input);
+  std::string encoded = cppless::json_binary_archive::serialize(input);
+  encoded = encoded.substr(1, encoded.size() - 2);
+  std::string decoded;
+  decoded.resize(cppless::base64::decoded_size(encoded.size()));
+  std::size_t written = 0;
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::base64::decoder decoder {kernel};
+      written = decoder.update(encoded.data(), encoded.size(), decoded.data());
+      benchmark::do_not_optimize(decoded);
+    },
+    reinterpret_cast<char*>(encoded.data()),
+    sizeof(char)*encoded.size(),
+    reinterpret_cast<char*>(decoded.data()),
+    sizeof(char)*decoded.size()
+  );
+
+  if(decoded.compare(0, written, serialized) != 0 || written != serialized.size()) {
+    std::cerr << "Incorrect result of base64 decode!" << std::endl;
+  }
+
+  return times;
+}
+
+// Bytes copied per repetition by the payload scenarios, reported by main.
+std::size_t copied_bytes_per_repetition = 0;
+
+// Models the invocation path before buffer chains: every stage hands the
+// payload on as a contiguous string.
+template<typename T>
+std::vector<double> benchmark_payload_string(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      std::size_t copied = 0;
+      // Binary archive into a stringstream, then ss.str() and base64
+      std::stringstream bs;
+      {
+        cereal::BinaryOutputArchive oar(bs);
+        oar(input);
+      }
+      std::string binary = bs.str();
+      copied += 2 * binary.size();
+      auto encoded_size = boost::beast::detail::base64::encoded_size(binary.size());
+      std::string encoded;
+      encoded.resize(encoded_size + 2);
+      encoded[0] = '"';
+      boost::beast::detail::base64::encode(encoded.data() + 1, binary.data(), binary.size());
+      encoded[encoded_size + 1] = '"';
+      copied += encoded.size();
+      // Request payload, then the copy into DATA frames
+      std::string payload = encoded;
+      copied += payload.size();
+      std::string frames;
+      frames.resize(payload.size());
+      std::memcpy(frames.data(), payload.data(), payload.size());
+      copied += frames.size();
+      // Response chunks accumulated into a vector, then into a string
+      std::vector<char> chunks;
+      constexpr std::size_t chunk_size = 16384;
+      for (std::size_t offset = 0; offset < frames.size(); offset += chunk_size) {
+        auto n = std::min(chunk_size, frames.size() - offset);
+        std::copy(frames.data() + offset, frames.data() + offset + n, std::back_inserter(chunks));
+      }
+      std::string body {chunks.begin(), chunks.end()};
+      copied += 2 * body.size();
+      // Decoded string and the stringstream copy of it
+      cppless::json_binary_archive::deserialize(body, deserialized);
+      copied += 2 * binary.size();
+      copied_bytes_per_repetition = copied;
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of payload roundtrip!" << std::endl;
+  }
+
+  return times;
+}
+
+// The same path with buffer chains, counting copies through
+// `buffer_chain::copied_bytes`.
+template<typename T>
+std::vector<double> benchmark_payload_chain(int repetitions, bool flush_cache, std::vector<T>& input)
+{
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      auto before = cppless::buffer_chain::copied_bytes();
+      auto payload = cppless::json_binary_archive::serialize_chain(input);
+      // The generator callback copies the chain into DATA frames
+      std::string frames;
+      frames.resize(payload.size());
+      cppless::buffer_chain_reader reader {payload};
+      constexpr std::size_t chunk_size = 16384;
+      std::size_t offset = 0;
+      while (!reader.done()) {
+        offset += reader.read(frames.data() + offset, std::min(chunk_size, frames.size() - offset));
+      }
+      // Response chunks appended to the result chain
+      cppless::buffer_chain body;
+      for (std::size_t offset = 0; offset < frames.size(); offset += chunk_size) {
+        body.append(frames.data() + offset, std::min(chunk_size, frames.size() - offset));
+      }
+      cppless::json_binary_archive::deserialize(body, deserialized);
+      copied_bytes_per_repetition = cppless::buffer_chain::copied_bytes() - before;
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of payload roundtrip!" << std::endl;
+  }
+
+  return times;
+}
+
+// Bytes sent per repetition by the compression scenarios, reported by main.
+std::size_t wire_bytes_per_repetition = 0;
+
+// Compresses the fast binary encoding with a fixed codec, or the adaptive
+// choice if none is given, to weigh compression time against bytes on wire.
+template<typename T>
+std::vector<double> benchmark_compressed_encode(int repetitions, bool flush_cache, std::vector<T>& input, std::optional<cppless::compression::codec> codec)
+{
+  auto compress = [&]() {
+    auto serialized = cppless::fast_binary_archive::serialize(input);
+    return codec ? cppless::compression::compress(serialized, *codec)
+                 : cppless::compression::compress(serialized);
+  };
+  std::string compressed = compress();
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      compressed = compress();
+      benchmark::do_not_optimize(compressed);
+    },
+    reinterpret_cast<char*>(input.data()),
+    sizeof(T)*input.size(),
+    reinterpret_cast<char*>(compressed.data()),
+    sizeof(char)*compressed.size()
+  );
+
+  wire_bytes_per_repetition = compressed.size();
+  return times;
+}
+
+template<typename T>
+std::vector<double> benchmark_compressed_decode(int repetitions, bool flush_cache, std::vector<T>& input, std::optional<cppless::compression::codec> codec)
+{
+  auto serialized = cppless::fast_binary_archive::serialize(input);
+  std::string compressed = codec ? cppless::compression::compress(serialized, *codec)
+                                 : cppless::compression::compress(serialized);
+
+  std::vector<T> deserialized;
+  deserialized.reserve(input.size());
+
+  auto times = benchmark::microbenchmark(
+    repetitions, flush_cache,
+    [&]() {
+      cppless::fast_binary_archive::deserialize(cppless::compression::decompress(compressed), deserialized);
+      benchmark::do_not_optimize(deserialized);
+    },
+    reinterpret_cast<char*>(compressed.data()),
+    sizeof(char)*compressed.size(),
+    reinterpret_cast<char*>(deserialized.data()),
+    sizeof(T)*input.size()
+  );
+
+  bool equal = std::equal(input.begin(), input.end(), deserialized.begin());
+  if(!equal) {
+    std::cerr << "Incorrect result of compressed decode!" << std::endl;
+  }
+
+  wire_bytes_per_repetition = compressed.size();
+  return times;
+}
+
 template<typename T>
 std::vector<double> run_benchmark(
   int repetitions, bool flush_cache,
@@ -315,6 +695,95 @@ std::vector<double> run_benchmark(
       repetitions, flush_cache,
       std::forward<T>(t)
     );
+  } else if(scenario == "binary-json-stream-encode") {
+    return benchmark_binary_json_stream_encode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "binary-json-stream-decode") {
+    return benchmark_binary_json_stream_decode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "fast-binary-encode") {
+    return benchmark_fast_binary_encode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "fast-binary-decode") {
+    return benchmark_fast_binary_decode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "fast-binary-json-encode") {
+    return benchmark_fast_binary_json_encode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "fast-binary-json-decode") {
+    return benchmark_fast_binary_json_decode(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario.rfind("base64-", 0) == 0) {
+    // base64-{encode,decode}-{scalar,sse41,avx2}
+    auto kernel = cppless::base64::kernel::automatic;
+    if(scenario.ends_with("-scalar")) {
+      kernel = cppless::base64::kernel::scalar;
+    } else if(scenario.ends_with("-sse41")) {
+      kernel = cppless::base64::kernel::sse41;
+    } else if(scenario.ends_with("-avx2")) {
+      kernel = cppless::base64::kernel::avx2;
+    }
+    if(scenario.rfind("base64-encode", 0) == 0) {
+      return benchmark_base64_encode(
+        repetitions, flush_cache,
+        std::forward<T>(t), kernel
+      );
+    } else if(scenario.rfind("base64-decode", 0) == 0) {
+      return benchmark_base64_decode(
+        repetitions, flush_cache,
+        std::forward<T>(t), kernel
+      );
+    }
+    std::cerr << "Unknown scenario " << scenario << std::endl;
+    exit(1);
+  } else if(scenario.rfind("compressed-", 0) == 0) {
+    // compressed-{none,lz4,zstd,adaptive}-{encode,decode}
+    std::optional<cppless::compression::codec> codec;
+    if(scenario.rfind("compressed-none-", 0) == 0) {
+      codec = cppless::compression::codec::none;
+    } else if(scenario.rfind("compressed-lz4-", 0) == 0) {
+      codec = cppless::compression::codec::lz4;
+    } else if(scenario.rfind("compressed-zstd-", 0) == 0) {
+      codec = cppless::compression::codec::zstd;
+    } else if(scenario.rfind("compressed-adaptive-", 0) != 0) {
+      std::cerr << "Unknown scenario " << scenario << std::endl;
+      exit(1);
+    }
+    if(scenario.ends_with("-encode")) {
+      return benchmark_compressed_encode(
+        repetitions, flush_cache,
+        std::forward<T>(t), codec
+      );
+    } else if(scenario.ends_with("-decode")) {
+      return benchmark_compressed_decode(
+        repetitions, flush_cache,
+        std::forward<T>(t), codec
+      );
+    }
+    std::cerr << "Unknown scenario " << scenario << std::endl;
+    exit(1);
+  } else if(scenario == "payload-string") {
+    return benchmark_payload_string(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
+  } else if(scenario == "payload-chain") {
+    return benchmark_payload_chain(
+      repetitions, flush_cache,
+      std::forward<T>(t)
+    );
   } else {
     std::cerr << "Unknown scenario " << scenario << std::endl;
     exit(1);
@@ -378,6 +847,14 @@ auto main(int argc, char* argv[]) -> int
   auto total_size = data_size * input_size / 1000.0 / 1000.0;
   std::clog << "Average BW: " << total_size / (avg / 1000.0 / 1000.0) << " [MB/s]" << std::endl;
 
+  if(copied_bytes_per_repetition > 0) {
+    std::clog << "Bytes copied: " << copied_bytes_per_repetition << " [B/repetition]" << std::endl;
+  }
+
+  if(wire_bytes_per_repetition > 0) {
+    std::clog << "Bytes on wire: " << wire_bytes_per_repetition << " [B/repetition]" << std::endl;
+  }
+
   //benchmark::benchmark("encode / binary_json") = [&](auto body)
   //{
   //  body = [&]
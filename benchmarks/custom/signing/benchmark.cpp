@@ -0,0 +1,129 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <cppless/provider/aws/lambda.hpp>
+#include <cppless/provider/aws/signing.hpp>
+#include <cppless/utils/crypto/hex.hpp>
+
+#include "../../include/benchmark.hpp"
+
+using cppless::aws::aws_v4_request_signer;
+using cppless::aws::lambda::nghttp2_invocation_request;
+
+template<class F>
+auto signatures_per_second(int n, F&& f) -> double
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    f(i);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto seconds = std::chrono::duration<double>(end - start).count();
+  return n / seconds;
+}
+
+auto main(int argc, char* argv[]) -> int
+{
+  argparse::ArgumentParser program("signing_benchmark");
+
+  program.add_argument("-n")
+      .help("number of signatures per scenario")
+      .default_value(100000)
+      .scan<'i', int>();
+  program.add_argument("-o")
+      .default_value(std::string(""))
+      .help("location to write output statistics");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    std::exit(1);
+  }
+
+  int n = program.get<int>("-n");
+  std::string output_location = program.get("-o");
+
+  cppless::aws::lambda::client lambda_client {"us-east-1"};
+  auto key = lambda_client.create_derived_key(
+      "AKIDEXAMPLE", "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY");
+
+  const std::string function_name = "cppless-0123abcd";
+  nghttp2_invocation_request prototype {function_name, "$LATEST"};
+
+  // Distinct payload hashes, as produced by distinct task arguments.
+  std::vector<std::string> payload_hashes;
+  payload_hashes.reserve(n);
+  for (int i = 0; i < n; i++) {
+    nghttp2_invocation_request request {
+        function_name, "$LATEST", "\"payload-" + std::to_string(i) + "\""};
+    payload_hashes.push_back(cppless::hex_lower(request.payload_hash()));
+  }
+
+  // Both paths have to agree on the signature.
+  {
+    aws_v4_request_signer signer =
+        aws_v4_request_signer::for_request(prototype, lambda_client, key);
+    const auto& date = signer.date();
+    nghttp2_invocation_request request {function_name, "$LATEST", "", date};
+    auto expected = request.compute_authorization_header(
+        payload_hashes[0], lambda_client, key);
+    if (signer.authorization_header(date, payload_hashes[0]) != expected) {
+      std::cerr << "Signatures differ" << std::endl;
+      return 1;
+    }
+  }
+
+  auto baseline = signatures_per_second(
+      n,
+      [&](int i)
+      {
+        auto date = format_aws_date(std::chrono::system_clock::now());
+        nghttp2_invocation_request request {function_name, "$LATEST", "", date};
+        auto header = request.compute_authorization_header(
+            payload_hashes[i], lambda_client, key);
+        benchmark::do_not_optimize(header);
+      });
+
+  aws_v4_request_signer signer =
+      aws_v4_request_signer::for_request(prototype, lambda_client, key);
+  auto presigned = signatures_per_second(
+      n,
+      [&](int i)
+      {
+        const auto& header =
+            signer.authorization_header(signer.date(), payload_hashes[i]);
+        benchmark::do_not_optimize(header);
+      });
+
+  // Identical payloads, e.g. the same task dispatched in a loop.
+  auto presigned_repeated = signatures_per_second(
+      n,
+      [&](int)
+      {
+        const auto& header =
+            signer.authorization_header(signer.date(), payload_hashes[0]);
+        benchmark::do_not_optimize(header);
+      });
+
+  std::cout << "base_request: " << baseline << " signatures/s" << std::endl;
+  std::cout << "aws_v4_request_signer: " << presigned << " signatures/s"
+            << std::endl;
+  std::cout << "aws_v4_request_signer (repeated payload): "
+            << presigned_repeated << " signatures/s" << std::endl;
+
+  if (!output_location.empty()) {
+    std::ofstream output_file {output_location, std::ios::out};
+    output_file << "scenario,signatures_per_second" << std::endl;
+    output_file << "base_request," << baseline << std::endl;
+    output_file << "signer," << presigned << std::endl;
+    output_file << "signer_repeated," << presigned_repeated << std::endl;
+  }
+
+  return 0;
+}
@@ -156,7 +156,7 @@ make -j$CORES
 make install
 echo "argparse installed successfully"
 
-7. Install Boost with specified components
+# 6. Install Boost with specified components
 echo "=== Building Boost 1.78.0 ==="
 download_and_extract "boost" "1.78.0" "https://archives.boost.io/release/1.78.0/source/boost_1_78_0.tar.gz" "boost_1_78_0"
 cd "$SOURCE_DIR/boost_1_78_0"
@@ -241,6 +241,28 @@ make -j$CORES
 make install
 echo "boost-ext installed successfully"
 
+# 10. Install zstd
+echo "=== Building zstd 1.5.2 ==="
+download_and_extract "zstd" "1.5.2" "https://github.com/facebook/zstd/releases/download/v1.5.2/zstd-1.5.2.tar.gz"
+mkdir -p "$BUILD_DIR/zstd"
+configure_cmake "$SOURCE_DIR/zstd-1.5.2/build/cmake" "$BUILD_DIR/zstd" \
+  "-DZSTD_BUILD_PROGRAMS=OFF -DZSTD_BUILD_TESTS=OFF -DZSTD_BUILD_STATIC=OFF -DCMAKE_INSTALL_LIBDIR=lib"
+cd "$BUILD_DIR/zstd"
+make -j$CORES
+make install
+echo "zstd installed successfully"
+
+# 11. Install lz4
+echo "=== Building lz4 1.9.3 ==="
+download_and_extract "lz4" "1.9.3" "https://github.com/lz4/lz4/archive/v1.9.3.tar.gz" "lz4-1.9.3"
+mkdir -p "$BUILD_DIR/lz4"
+configure_cmake "$SOURCE_DIR/lz4-1.9.3/build/cmake" "$BUILD_DIR/lz4" \
+  "-DLZ4_BUILD_CLI=OFF -DLZ4_BUILD_LEGACY_LZ4C=OFF -DBUILD_STATIC_LIBS=OFF -DCMAKE_INSTALL_LIBDIR=lib"
+cd "$BUILD_DIR/lz4"
+make -j$CORES
+make install
+echo "lz4 installed successfully"
+
 echo "=== All dependencies built and installed successfully ==="
 echo "Installation prefix: $INSTALL_PREFIX"
 echo
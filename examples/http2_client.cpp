@@ -90,11 +90,11 @@ auto main(int argc, char* argv[]) -> int
 
     auto cb = [&, n](const cppless::aws::lambda::invocation_response& res)
     {
-      if (res.body != "\"value1\"") {
+      if (res.body.str() != "\"value1\"") {
         throw std::runtime_error(
             "Unexpected response, expected \"value1\", "
             "got: "
-            + res.body);
+            + res.body.str());
       }
 
       completed++;
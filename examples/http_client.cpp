@@ -36,7 +36,7 @@ auto main(int argc, char* argv[]) -> int
   auto cb = [](const cppless::aws::lambda::invocation_response& res)
   {
     std::cout << "request_id: " << res.request_id << std::endl;
-    std::cout << res.body << std::endl;
+    std::cout << res.body.str() << std::endl;
   };
   req.on_result(cb);
 
@@ -1,11 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <fstream>
 #include <memory>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_set>
 #include <vector>
 
 #include <aws/lambda-runtime/runtime.h>
@@ -14,13 +26,19 @@
 #include <cereal/cereal.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/tuple.hpp>
+#include <cereal/types/vector.hpp>
 #include <cppless/dispatcher/common.hpp>
 #include <cppless/dispatcher/sendable.hpp>
+#include <cppless/dispatcher/task_future.hpp>
 #include <cppless/provider/aws/auth.hpp>
 #include <cppless/provider/aws/lambda.hpp>
+#include <cppless/provider/aws/signing.hpp>
 #include <cppless/utils/crypto/wrappers.hpp>
 #include <cppless/utils/fixed_string.hpp>
 #include <cppless/utils/fixed_string_serialization.hpp>
+#include <cppless/utils/http2/session_pool.hpp>
+#include <cppless/utils/result_cache.hpp>
+#include <cppless/utils/retry.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <cppless/utils/uninitialized.hpp>
 #include <nlohmann/json.hpp>
@@ -91,6 +109,124 @@ struct with_timeout
   };
 };
 
+/**
+ * @brief Retries of a throttled or failed invocation before it fails
+ * terminally, overriding the retry options of the dispatcher instance.
+ */
+template<unsigned int MaxRetries>
+struct with_max_retries
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static unsigned int max_retries = MaxRetries;
+  };
+};
+
+/**
+ * @brief Threads available to the task within one invocation: they run
+ * `parallel_for` and `parallel_reduce` in the task body, and the calls of a
+ * batch dispatched with `dispatch_batch`, which must then be safe to run
+ * concurrently. Zero uses all vCPUs of the function, which Lambda allocates
+ * in proportion to its memory.
+ */
+template<unsigned int Threads>
+struct with_threads
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static unsigned int threads = Threads;
+  };
+};
+
+/**
+ * @brief Results of type `remote` whose encoding exceeds `Bytes` are put into
+ * the object store, and only their key is returned, see `remote`.
+ */
+template<std::size_t Bytes>
+struct with_remote_threshold
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static std::size_t remote_threshold = Bytes;
+  };
+};
+
+/**
+ * @brief The expected duration of the task in milliseconds, which graph
+ * executors use to prioritize the tasks on the critical path, see
+ * `executor::scheduling_policy`.
+ */
+template<unsigned int Milliseconds>
+struct with_cost
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static unsigned int cost = Milliseconds;
+  };
+};
+
+/**
+ * @brief Allows graph executors to back up a straggling invocation of the
+ * task by a second one and to take the result of whichever finishes first,
+ * see `executor::speculation_options`. The task must be idempotent.
+ */
+struct with_speculation
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static bool speculative = true;
+  };
+};
+
+/**
+ * @brief Allows dispatcher instances with a `result_cache` to deliver a stored
+ * result instead of invoking the task again with the same captures and
+ * arguments. The task must be deterministic.
+ */
+struct with_memoization
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static bool memoized = true;
+  };
+};
+
+/**
+ * @brief Keeps the captures of the last `Entries` distinct contexts a
+ * container received deserialized, so that warm invocations with the same
+ * captures reuse them, see `cached_receivable`. The task must not modify its
+ * captures, i.e. must not be a mutable lambda.
+ */
+template<std::size_t Entries = 4>
+struct with_context_cache
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static std::size_t context_cache = Entries;
+  };
+};
+
+/**
+ * @brief Allows `graph::builder_core::fuse` to run graph nodes of the task in
+ * one invocation with their fusable predecessors. Each fused tree is a
+ * function of its own, thus is only worth it for chains run often enough.
+ */
+struct with_fusion
+{
+  template<class Base>
+  struct apply : public Base
+  {
+    constexpr static bool fusable = true;
+  };
+};
+
 template<class... Modifiers>
 class config;
 
@@ -107,16 +243,16 @@ class config<> : public default_config
 
 }  // namespace aws
 
-template<class T>
-auto task_function_name(const T& task) -> std::string
+/**
+ * @brief The name of the function a task with `identifier` is deployed as.
+ */
+inline auto lambda_function_name(const std::string& identifier) -> std::string
 {
-  auto raw_function_name = task.identifier();
-
   std::string function_name = TARGET_NAME;
   function_name += "-";
 
   evp_md_ctx ctx;
-  ctx.update(raw_function_name);
+  ctx.update(identifier);
   auto binary_digest = ctx.final();
 
   std::string function_hex;
@@ -128,6 +264,18 @@ auto task_function_name(const T& task) -> std::string
   return function_name;
 }
 
+template<class T>
+auto task_function_name(const T& task) -> std::string
+{
+  // Bound tasks computed it when they were bound
+  if constexpr (requires { task.function_name(); }) {
+    if (const auto& name = task.function_name()) {
+      return *name;
+    }
+  }
+  return lambda_function_name(task.identifier());
+}
+
 template<class RequestArchive, class ResponseArchive>
 class base_aws_lambda_dispatcher;
 
@@ -142,59 +290,53 @@ public:
   using id_type = int;
   using dispatcher_type =
       aws_lambda_nghttp2_dispatcher<RequestArchive, ResponseArchive>;
-
-  static auto create_sessions(boost::asio::io_service& io_service,
-                              const cppless::aws::lambda::client& lambda_client,
-                              int num_conns)
-      -> std::vector<nghttp2::asio_http2::client::session>
-  {
-    boost::system::error_code ec;
-
-    boost::asio::ssl::context tls(boost::asio::ssl::context::sslv23);
-    tls.set_default_verify_paths();
-    nghttp2::asio_http2::client::configure_tls_context(ec, tls);
-
-    std::vector<nghttp2::asio_http2::client::session> sessions;
-    sessions.reserve(num_conns);
-    for (int i = 0; i < num_conns; ++i) {
-      sessions.emplace_back(io_service, tls, lambda_client.hostname(), "443");
-    }
-
-    return sessions;
-  }
-
-  constexpr static int num_conns = 16;
+  using clock = std::chrono::steady_clock;
+  /**
+   * @brief Receives the error of a task, or null if it succeeded.
+   */
+  using completion_cb = std::function<void(std::exception_ptr)>;
+
+  /**
+   * @brief Creates an instance sending its requests over `pool`, by default
+   * the connection pool shared by all instances of the calling thread.
+   *
+   * Invocations are admitted and retried according to `admission` and
+   * `retry`. In `io_mode::background`, the pool is driven by a thread of the
+   * instance, started by the first dispatch, and must not be used by anyone
+   * else; without a `pool`, the instance opens its own connections. Such an
+   * instance must not be moved once it has dispatched a task.
+   */
   explicit aws_lambda_nghttp2_dispatcher_instance(
-      base_aws_lambda_dispatcher<RequestArchive, ResponseArchive>& dispatcher)
+      base_aws_lambda_dispatcher<RequestArchive, ResponseArchive>& dispatcher,
+      std::shared_ptr<http2::session_pool> pool = nullptr,
+      admission_options admission = {},
+      retry_options retry = {},
+      io_mode mode = io_mode::foreground)
       : m_lambda_client(dispatcher.lambda_client())
       , m_key(dispatcher.key())
-      , m_sessions(create_sessions(m_io_service, m_lambda_client, num_conns))
+      , m_pool(pool ? std::move(pool) : make_pool(m_lambda_client, mode))
+      , m_scheduler(std::make_unique<retry_scheduler>(
+            m_pool->io_service(), admission, retry))
+      , m_mode(mode)
       , m_dispatcher(dispatcher)
   {
-    int connected = 0;
-    bool error = false;
-
-    for (auto& session : m_sessions) {
-      session.on_connect([&connected](const auto&) { connected++; });
-      session.on_error(
-          [&error](const boost::system::error_code& ec)
-          {
-            error = true;
-            std::cerr << "Error: " << ec.message() << std::endl;
-          });
-    }
-    while (connected < num_conns && !error) {
-      m_io_service.run_one();
-    }
+    handle_failures();
   }
 
   // Destructor
   ~aws_lambda_nghttp2_dispatcher_instance()
   {
-    for (auto& session : m_sessions) {
-      session.shutdown();
+    if (m_io_thread.joinable()) {
+      boost::asio::post(m_pool->io_service(), [this] { m_stopping = true; });
+      m_io_thread.join();
+      m_work.reset();
+      return;
+    }
+    // The pool may outlive this instance, but not the callbacks of its
+    // requests and retry timers
+    while (m_pool && (m_outstanding > 0 || m_scheduler->active() > 0)) {
+      m_pool->run_one();
     }
-    m_io_service.run();
   }
 
   // Delete copy constructor
@@ -209,14 +351,30 @@ public:
       aws_lambda_nghttp2_dispatcher_instance&& other) noexcept
       : m_lambda_client(std::move(other.m_lambda_client))
       , m_key(std::move(other.m_key))
-      , m_sessions(std::move(other.m_sessions))
+      , m_signers(std::move(other.m_signers))
+      , m_pool(std::move(other.m_pool))
+      , m_scheduler(std::move(other.m_scheduler))
+      , m_mode(other.m_mode)
+      , m_outstanding(std::exchange(other.m_outstanding, 0))
       , m_requests(std::move(other.m_requests))
       , m_spans(std::move(other.m_spans))
+      , m_attempts(std::move(other.m_attempts))
+      , m_batch_sizes(std::move(other.m_batch_sizes))
+      , m_completions(std::move(other.m_completions))
+      , m_unreported(std::move(other.m_unreported))
       , m_finished(std::move(other.m_finished))
+      , m_failed(std::move(other.m_failed))
       , m_started(std::move(other.m_started))
       , m_completed(other.m_completed)
+      , m_bytes_sent(other.m_bytes_sent.load())
+      , m_bytes_received(other.m_bytes_received.load())
+      , m_cache(std::move(other.m_cache))
       , m_dispatcher(other.m_dispatcher)
   {
+    // The callback of the scheduler refers to the instance it was moved from
+    if (m_scheduler) {
+      handle_failures();
+    }
   }
 
   // Delete move assignment
@@ -229,94 +387,731 @@ public:
                      typename TaskType::args args,
                      std::optional<tracing_span_ref> span = std::nullopt) -> int
   {
-    std::string payload;
+    return dispatch_single(t, result_target, std::move(args), span, {});
+  }
+
+  /**
+   * @brief Like `dispatch_impl`, but the outcome goes to `completion` rather
+   * than to `wait_one`. A background instance calls it on its IO thread.
+   */
+  template<class TaskType>
+  auto dispatch_impl(TaskType& t,
+                     typename TaskType::res& result_target,
+                     typename TaskType::args args,
+                     std::optional<tracing_span_ref> span,
+                     completion_cb completion) -> int
+  {
+    return dispatch_single(
+        t, result_target, std::move(args), span, std::move(completion));
+  }
+
+  /**
+   * @brief Dispatches `t` with `args`, the result is delivered through the
+   * returned future instead of `wait_one`.
+   */
+  template<class TaskType>
+  auto dispatch_async_impl(TaskType& t,
+                           typename TaskType::args args,
+                           std::optional<tracing_span_ref> span = std::nullopt)
+      -> task_future<typename TaskType::res>
+  {
+    auto state =
+        std::make_shared<detail::future_state<typename TaskType::res>>();
+    state->drive = driver();
+    dispatch_single(t,
+                    state->value,
+                    std::move(args),
+                    span,
+                    [state](std::exception_ptr error)
+                    { state->complete(std::move(error)); });
+    return task_future<typename TaskType::res> {std::move(state)};
+  }
+
+  /**
+   * @brief Delivers the results of memoized tasks, see `aws::with_memoization`,
+   * from `cache` when they were invoked with the same payload before, and
+   * stores the results of their invocations in it. Call before dispatching.
+   * Hits and misses are tagged on the span of a dispatch as `cache`.
+   */
+  auto memoize(std::shared_ptr<result_cache> cache) -> void
+  {
+    m_cache = std::move(cache);
+  }
+
+  /**
+   * @brief The cache passed to `memoize`, null if tasks are not memoized.
+   */
+  [[nodiscard]] auto cache() const -> const std::shared_ptr<result_cache>&
+  {
+    return m_cache;
+  }
+
+  /**
+   * @brief The payload bytes of all invocations so far, retries not counted.
+   */
+  [[nodiscard]] auto transferred() const -> transfer_statistics
+  {
+    return {.sent = m_bytes_sent.load(), .received = m_bytes_received.load()};
+  }
+
+  /**
+   * @brief Drives the pool of a foreground instance for the futures waiting
+   * on it, empty for a background instance.
+   */
+  auto driver() -> future_driver
+  {
+    if (m_mode == io_mode::background) {
+      return {};
+    }
+    return [this](clock::time_point deadline)
+    { m_pool->run_one_until(deadline); };
+  }
+
+  /**
+   * @brief Dispatches the calls of `t` with `args` as a single invocation,
+   * which runs them on `t.threads()` threads. Every call is reported by
+   * `wait_one` on its own, under consecutive ids.
+   *
+   * @return The id of the first call
+   */
+  template<class TaskType>
+  auto dispatch_batch_impl(TaskType& t,
+                           std::span<typename TaskType::res> results,
+                           std::span<const typename TaskType::args> args,
+                           std::optional<tracing_span_ref> span = std::nullopt)
+      -> int
+  {
+    buffer_chain payload;
 
     {
       scoped_tracing_span serialization_span(span, "serialization");
 
-      task_data data {t, args};
-      payload = RequestArchive::serialize(data);
+      std::vector<typename TaskType::args> batch(args.begin(), args.end());
+      std::uint32_t threads = t.threads();
+      invocation_payload data {t, batch, threads};
+      payload = RequestArchive::serialize_chain(data);
+    }
+    auto payload_hash =
+        cppless::aws::lambda::nghttp2_invocation_request::hash(payload);
+
+    return start_invocation(
+        t,
+        std::move(payload),
+        std::move(payload_hash),
+        static_cast<int>(args.size()),
+        span,
+        [results, span](const cppless::aws::lambda::invocation_response& res)
+        {
+          scoped_tracing_span deserialization_span(span, "deserialization");
+
+          std::tuple<std::vector<typename TaskType::res>, execution_statistics>
+              result;
+          ResponseArchive::deserialize(res.body, result);
+          auto& values = std::get<0>(result);
+          if (values.size() != results.size()) {
+            throw std::runtime_error(
+                "Batch of " + std::to_string(results.size())
+                + " tasks returned " + std::to_string(values.size())
+                + " results");
+          }
+          std::move(values.begin(), values.end(), results.begin());
+          return std::get<1>(result);
+        });
+  }
+
+  /**
+   * @brief Waits for the next task to finish. Throws `invocation_failed` for
+   * tasks which failed terminally instead.
+   */
+  auto wait_one() -> std::tuple<int, execution_statistics>
+  {
+    return *wait_next(clock::time_point::max());
+  }
+
+  /**
+   * @brief Like `wait_one`, but gives up after `timeout`.
+   */
+  template<class Rep, class Period>
+  auto wait_for(std::chrono::duration<Rep, Period> timeout)
+      -> std::optional<std::tuple<int, execution_statistics>>
+  {
+    return wait_next(clock::now()
+                     + std::chrono::ceil<clock::duration>(timeout));
+  }
+
+  /**
+   * @brief Waits for the first of the tasks `ids` to finish, the others are
+   * left to later waits. Throws `invocation_failed` if it failed.
+   */
+  auto wait_any(std::span<const int> ids)
+      -> std::tuple<int, execution_statistics>
+  {
+    std::unique_lock lock {m_mutex};
+    std::optional<int> found;
+    wait_until(
+        lock,
+        [&]
+        {
+          auto reported = std::find_if(ids.begin(),
+                                       ids.end(),
+                                       [this](int id)
+                                       {
+                                         return m_finished.contains(id)
+                                             || failure_of(id) != m_failed.end();
+                                       });
+          if (reported != ids.end()) {
+            found = *reported;
+            return true;
+          }
+          return !any_unreported(ids);
+        },
+        clock::time_point::max());
+    if (!found) {
+      throw std::runtime_error("None of the invocations is left to wait for");
+    }
+    auto it = m_finished.find(*found);
+    if (it == m_finished.end()) {
+      auto failure = failure_of(*found);
+      invocation_failed error {failure->first, failure->second};
+      m_failed.erase(failure);
+      throw error;
+    }
+    std::tuple<int, execution_statistics> ret {it->first, it->second};
+    m_finished.erase(it);
+    return ret;
+  }
+
+  /**
+   * @brief Waits for all of the tasks `ids` to finish. If any of them failed,
+   * throws `invocation_failed` for the first one after all have finished.
+   *
+   * @return The statistics of the tasks, in the order of `ids`
+   */
+  auto wait_all(std::span<const int> ids) -> std::vector<execution_statistics>
+  {
+    std::unique_lock lock {m_mutex};
+    wait_until(
+        lock, [&] { return !any_unreported(ids); }, clock::time_point::max());
+    for (int id : ids) {
+      if (!m_finished.contains(id) && failure_of(id) == m_failed.end()) {
+        throw std::runtime_error("Invocation " + std::to_string(id)
+                                 + " is not left to wait for");
+      }
     }
 
+    std::vector<execution_statistics> statistics;
+    statistics.reserve(ids.size());
+    std::optional<invocation_failed> error;
+    for (int id : ids) {
+      auto it = m_finished.find(id);
+      if (it != m_finished.end()) {
+        statistics.push_back(std::move(it->second));
+        m_finished.erase(it);
+        continue;
+      }
+      auto failure = failure_of(id);
+      if (!error) {
+        error.emplace(failure->first, failure->second);
+      }
+      m_failed.erase(failure);
+      statistics.emplace_back();
+    }
+    if (error) {
+      throw *error;
+    }
+    return statistics;
+  }
+
+private:
+  auto handle_failures() -> void
+  {
+    m_scheduler->on_failure(
+        [this](int id, const std::string& message)
+        {
+          // A failed batch fails all of its tasks
+          auto batch = m_batch_sizes.find(id);
+          int count = batch == m_batch_sizes.end() ? 1 : batch->second;
+          report(id, count, execution_statistics {}, &message);
+        });
+  }
+
+  static auto make_pool(const cppless::aws::lambda::client& client,
+                        io_mode mode) -> std::shared_ptr<http2::session_pool>
+  {
+    // A shared pool is driven by whichever instance waits
+    if (mode == io_mode::background) {
+      return std::make_shared<http2::session_pool>(
+          client.hostname(),
+          client.port(),
+          http2::session_pool_options {.tls = client.secure()});
+    }
+    return http2::session_pool::shared(
+        client.hostname(), client.port(), {.tls = client.secure()});
+  }
+
+  template<class TaskType>
+  auto dispatch_single(TaskType& t,
+                       typename TaskType::res& result_target,
+                       typename TaskType::args args,
+                       std::optional<tracing_span_ref> span,
+                       completion_cb completion) -> int
+  {
+    buffer_chain payload;
+
+    {
+      scoped_tracing_span serialization_span(span, "serialization");
+
+      invocation_payload data {t, args};
+      payload = RequestArchive::serialize_chain(data);
+    }
+    // Hashed by the dispatching thread, the IO thread only signs the hash
+    auto payload_hash =
+        cppless::aws::lambda::nghttp2_invocation_request::hash(payload);
+
     //std::cout << "payload size: " << payload.size() << std::endl;
 
-    int id = m_started++;
-    auto req =
-        std::make_unique<cppless::aws::lambda::nghttp2_invocation_request>(
-            task_function_name(t), "$LATEST", payload);
-    m_requests.push_back(std::move(req));
-    m_spans.push_back(span);
-
-    auto submit_req =
-        [this](
-            std::unique_ptr<cppless::aws::lambda::nghttp2_invocation_request>&
-                req,
-            std::optional<tracing_span_ref> span)
+    std::optional<std::string> cache_key;
+    if constexpr (requires { t.memoized(); }) {
+      if (m_cache && t.memoized()) {
+        cache_key = result_cache::key(t.identifier(), payload_hash);
+        if (auto id = deliver_cached(
+                *cache_key, result_target, span, std::move(completion)))
+        {
+          return *id;
+        }
+      }
+    }
+
+    return start_invocation(
+        t,
+        std::move(payload),
+        std::move(payload_hash),
+        1,
+        span,
+        [this, &result_target, span, cache_key = std::move(cache_key)](
+            const cppless::aws::lambda::invocation_response& res)
+        {
+          scoped_tracing_span deserialization_span(span, "deserialization");
+
+          std::tuple<typename TaskType::res&, execution_statistics> result {
+              result_target, execution_statistics {"", false}};
+          ResponseArchive::deserialize(res.body, result);
+          if (cache_key) {
+            m_cache->put(*cache_key, res.body.str());
+          }
+          return std::get<1>(result);
+        },
+        std::move(completion));
+  }
+
+  /**
+   * @brief Delivers the result stored under `key` as a task which finished
+   * right away, if there is one. The result is decoded by the dispatching
+   * thread, thus an entry which cannot be decoded is invoked anew.
+   *
+   * @return The id of the task, or nothing on a miss
+   */
+  template<class Res>
+  auto deliver_cached(const std::string& key,
+                      Res& result_target,
+                      std::optional<tracing_span_ref> span,
+                      completion_cb& completion) -> std::optional<int>
+  {
+    auto cached = m_cache->get(key);
+    if (span) {
+      span->set_tag("cache", cached ? "hit" : "miss");
+    }
+    if (!cached) {
+      return std::nullopt;
+    }
+    try {
+      scoped_tracing_span deserialization_span(span, "deserialization");
+
+      std::tuple<Res&, execution_statistics> result {
+          result_target, execution_statistics {"", false}};
+      ResponseArchive::deserialize(*cached, result);
+    } catch (const std::exception&) {
+      return std::nullopt;
+    }
+
+    int id = 0;
+    {
+      std::scoped_lock lock {m_mutex};
+      id = m_started++;
+      if (!completion) {
+        m_unreported.insert(id);
+      }
+    }
+    // Reported like an invocation, e.g. completions run on the IO thread
+    run_on_io(
+        [this, id, completion = std::move(completion)]() mutable
+        {
+          if (completion) {
+            m_completions[id] = std::move(completion);
+          }
+          m_completed++;
+          report(id, 1, execution_statistics {"", false}, nullptr);
+        });
+    return id;
+  }
+
+  /**
+   * @brief Sends `payload`, hashing to `payload_hash`, as one invocation
+   * carrying the `count` tasks starting at the returned id. `decode` writes
+   * the results of a response to their targets and returns its statistics.
+   * The outcome goes to `completion` if given, to the `wait_*` functions
+   * otherwise.
+   *
+   * Only the id is assigned on the calling thread, the request is built and
+   * submitted on the IO thread.
+   */
+  template<class TaskType, class Decode>
+  auto start_invocation(TaskType& t,
+                        buffer_chain payload,
+                        std::vector<unsigned char> payload_hash,
+                        int count,
+                        std::optional<tracing_span_ref> span,
+                        Decode decode,
+                        completion_cb completion = {}) -> int
+  {
+    auto function_name = task_function_name(t);
+    auto max_retries = t.max_retries();
+    m_bytes_sent += payload.size();
+    int id = 0;
     {
-      auto& session = m_sessions[m_next_session];
-      m_next_session = (m_next_session + 1) % num_conns;
-      req->submit(session, m_lambda_client, m_key, span);
+      std::scoped_lock lock {m_mutex};
+      id = m_started;
+      m_started += count;
+      if (!completion) {
+        for (int i = 0; i < count; i++) {
+          m_unreported.insert(id + i);
+        }
+      }
+    }
+
+    run_on_io(
+        [this,
+         id,
+         count,
+         span,
+         max_retries,
+         function_name = std::move(function_name),
+         payload = std::move(payload),
+         payload_hash = std::move(payload_hash),
+         decode = std::move(decode),
+         completion = std::move(completion)]() mutable
+        {
+          auto& signer = signer_for(function_name);
+          // The invocation is tracked under the id of its first task, the
+          // slots of the other tasks of a batch stay empty. Tasks may be
+          // started out of order if several threads dispatch.
+          auto slots = static_cast<std::size_t>(id + count);
+          if (m_requests.size() < slots) {
+            m_requests.resize(slots);
+            m_spans.resize(slots);
+            m_attempts.resize(slots, 0);
+          }
+          m_requests[id] =
+              std::make_unique<cppless::aws::lambda::nghttp2_invocation_request>(
+                  function_name, "$LATEST", std::move(payload), signer.date());
+          m_requests[id]->set_payload_hash(std::move(payload_hash));
+          if (span) {
+            m_spans[id].emplace(*span);
+          }
+          if (count > 1) {
+            m_batch_sizes[id] = count;
+          }
+          if (completion) {
+            m_completions[id] = std::move(completion);
+          }
+          start_request(id, count, signer, std::move(decode), max_retries);
+        });
+
+    return id;
+  }
+
+  template<class Decode>
+  auto start_request(int id,
+                     int count,
+                     cppless::aws::aws_v4_request_signer& signer,
+                     Decode decode,
+                     std::optional<unsigned int> max_retries) -> void
+  {
+    auto submit_req = [this, &signer, id]()
+    {
+      auto* req = m_requests[id].get();
+      auto span = m_spans[id];
+      auto attempt = ++m_attempts[id];
+      m_outstanding++;
+      m_pool->submit(
+          [this, &signer, req, span](http2::session_pool::session& session)
+          {
+            // Retries are signed anew, the signature is only valid for a
+            // limited time
+            req->set_date(signer.date());
+            return req->submit(session, m_lambda_client, signer, span);
+          },
+          [this, id, attempt](uint32_t error_code)
+          {
+            m_outstanding--;
+            // The response was handled already and the task may be retried
+            // by now
+            if (attempt != m_attempts[id]) {
+              return;
+            }
+            if (error_code != NGHTTP2_NO_ERROR) {
+              m_scheduler->failed(id,
+                                  "Stream closed with error "
+                                      + std::to_string(error_code),
+                                  error_code != NGHTTP2_CONNECT_ERROR);
+            } else {
+              m_scheduler->failed(
+                  id, "Stream closed without a response", true);
+            }
+          });
     };
 
-    auto cb = [this, id, &result_target, span](
+    auto cb = [this, id, count, decode = std::move(decode)](
                   const cppless::aws::lambda::invocation_response& res) mutable
     {
-      scoped_tracing_span deserialization_span(span, "deserialization");
-
-      std::tuple<typename TaskType::res&, execution_statistics> result{result_target, execution_statistics{"", false}};
-      ResponseArchive::deserialize(res.body, result);
+      m_bytes_received += res.body.size();
+      execution_statistics statistics;
+      try {
+        statistics = decode(res);
+      } catch (const std::exception& e) {
+        m_scheduler->failed(
+            id, std::string("Invalid response: ") + e.what(), false);
+        return;
+      }
 
-      m_finished[id] = std::get<1>(result);
-      m_completed++;
+      m_completed += count;
+      m_scheduler->succeeded(id);
+      report(id, count, statistics, nullptr);
     };
 
-    auto err_cb = [this, submit_req, id](
-                      const cppless::aws::lambda::invocation_error& err)
+    auto err_cb = [this, id](const cppless::aws::lambda::invocation_error& err)
     {
-      if (std::holds_alternative<
-              cppless::aws::lambda::invocation_error_too_many_requests>(err))
+      using cppless::aws::lambda::invocation_error_status;
+      using cppless::aws::lambda::invocation_error_too_many_requests;
+      if (std::holds_alternative<invocation_error_too_many_requests>(err)) {
+        m_scheduler->throttled(id);
+      } else if (const auto* status =
+                     std::get_if<invocation_error_status>(&err))
       {
-        submit_req(m_requests[id], m_spans[id]);
+        // Server errors are transient, errors of the function itself and
+        // rejected requests are not
+        bool retryable = !status->function_error && status->status_code >= 500;
+        m_scheduler->failed(id,
+                            "Invocation failed with status "
+                                + std::to_string(status->status_code) + ": "
+                                + status->body,
+                            retryable);
       } else {
-        std::cerr << "Error." << std::endl;
+        m_scheduler->failed(
+            id,
+            "Invocation failed with error " + std::to_string(std::get<int>(err)),
+            true);
       }
     };
 
-    auto& req_ref = m_requests.back();
+    auto& req_ref = m_requests[id];
     req_ref->on_result(cb);
     req_ref->on_error(err_cb);
 
-    submit_req(req_ref, span);
+    m_scheduler->submit(id, submit_req, max_retries);
+  }
 
-    return id;
+  /**
+   * @brief Hands the outcome of the `count` tasks starting at `id` to their
+   * future, or to the `wait_*` functions. `error` is null for tasks which
+   * succeeded.
+   */
+  auto report(int id,
+              int count,
+              const execution_statistics& statistics,
+              const std::string* error) -> void
+  {
+    std::vector<std::pair<int, completion_cb>> completions;
+    {
+      std::scoped_lock lock {m_mutex};
+      for (int i = 0; i < count; i++) {
+        auto completion = m_completions.find(id + i);
+        if (completion != m_completions.end()) {
+          completions.emplace_back(id + i, std::move(completion->second));
+          m_completions.erase(completion);
+          continue;
+        }
+        m_unreported.erase(id + i);
+        if (error != nullptr) {
+          m_failed.emplace_back(id + i, *error);
+        } else {
+          m_finished[id + i] = statistics;
+        }
+      }
+    }
+    m_cv.notify_all();
+    // Continuations of the futures may dispatch again
+    for (auto& [task_id, completion] : completions) {
+      completion(error != nullptr ? std::make_exception_ptr(
+                     invocation_failed(task_id, *error))
+                                  : nullptr);
+    }
   }
 
-  auto wait_one() -> std::tuple<int, execution_statistics>
+  /**
+   * @brief Runs `fn` on the thread driving the pool, starting the IO thread
+   * of a background instance on first use.
+   */
+  auto run_on_io(std::function<void()> fn) -> void
   {
-    while (m_finished.empty()) {
-      m_io_service.run_one();
+    if (m_mode == io_mode::foreground) {
+      fn();
+      return;
+    }
+    {
+      std::scoped_lock lock {m_mutex};
+      if (!m_io_thread.joinable()) {
+        m_work.emplace(m_pool->io_service());
+        m_io_thread = std::thread([this] { run_io(); });
+      }
+    }
+    boost::asio::post(m_pool->io_service(), std::move(fn));
+  }
+
+  auto run_io() -> void
+  {
+    while (!m_stopping || m_outstanding > 0 || m_scheduler->active() > 0) {
+      m_pool->run_one();
+    }
+  }
+
+  auto wait_next(clock::time_point deadline)
+      -> std::optional<std::tuple<int, execution_statistics>>
+  {
+    std::unique_lock lock {m_mutex};
+    bool done = wait_until(
+        lock,
+        [this]
+        {
+          return !m_finished.empty() || !m_failed.empty()
+              || m_unreported.empty();
+        },
+        deadline);
+    if (!done) {
+      return std::nullopt;
+    }
+    if (m_finished.empty() && m_failed.empty()) {
+      throw std::runtime_error("No invocations left to wait for");
+    }
+    if (m_finished.empty()) {
+      auto [id, message] = std::move(m_failed.front());
+      m_failed.pop_front();
+      throw invocation_failed(id, message);
     }
     auto it = m_finished.begin();
-    auto ret = *it;
+    std::tuple<int, execution_statistics> ret {it->first, it->second};
     m_finished.erase(it);
     return ret;
   }
 
-private:
-  boost::asio::io_service m_io_service;
+  /**
+   * @brief Waits until `done()` holds or `deadline` has passed. `done` is
+   * evaluated with `m_mutex` held by `lock`; a foreground instance drives
+   * the pool with the mutex released.
+   *
+   * @return Whether `done()` holds
+   */
+  template<class Done>
+  auto wait_until(std::unique_lock<std::mutex>& lock,
+                  Done done,
+                  clock::time_point deadline) -> bool
+  {
+    while (!done()) {
+      if (clock::now() >= deadline) {
+        return false;
+      }
+      if (m_mode == io_mode::background) {
+        if (deadline == clock::time_point::max()) {
+          m_cv.wait(lock);
+        } else {
+          m_cv.wait_until(lock, deadline);
+        }
+      } else {
+        lock.unlock();
+        m_pool->run_one_until(deadline);
+        lock.lock();
+      }
+    }
+    return true;
+  }
+
+  auto failure_of(int id) -> std::deque<std::pair<int, std::string>>::iterator
+  {
+    return std::find_if(m_failed.begin(),
+                        m_failed.end(),
+                        [id](const auto& failure) { return failure.first == id; });
+  }
+
+  auto any_unreported(std::span<const int> ids) const -> bool
+  {
+    return std::any_of(ids.begin(),
+                       ids.end(),
+                       [this](int id) { return m_unreported.contains(id); });
+  }
+
+  auto signer_for(const std::string& function_name)
+      -> cppless::aws::aws_v4_request_signer&
+  {
+    auto it = m_signers.find(function_name);
+    if (it == m_signers.end()) {
+      cppless::aws::lambda::nghttp2_invocation_request prototype {
+          function_name, "$LATEST"};
+      it = m_signers
+               .emplace(function_name,
+                        cppless::aws::aws_v4_request_signer::for_request(
+                            prototype, m_lambda_client, m_key))
+               .first;
+    }
+    return it->second;
+  }
+
   cppless::aws::lambda::client m_lambda_client;
   cppless::aws::aws_v4_derived_key m_key;
-  int m_next_session = 0;
-  std::vector<nghttp2::asio_http2::client::session> m_sessions;
-
+  std::unordered_map<std::string, cppless::aws::aws_v4_request_signer>
+      m_signers;
+  std::shared_ptr<http2::session_pool> m_pool;
+  std::unique_ptr<retry_scheduler> m_scheduler;
+  io_mode m_mode;
+  // Requests submitted to the pool whose streams have not been closed yet
+  int m_outstanding = 0;
+
+  // Only touched by the thread driving the pool
   std::vector<std::unique_ptr<cppless::aws::lambda::nghttp2_invocation_request>>
       m_requests;
   std::vector<std::optional<tracing_span_ref>> m_spans;
+  std::vector<unsigned int> m_attempts;
+  // First id -> number of tasks, for invocations carrying a batch
+  std::unordered_map<int, int> m_batch_sizes;
+  std::unordered_map<int, completion_cb> m_completions;
+
+  // Guards the ids and the outcomes handed to the `wait_*` functions
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::unordered_set<int> m_unreported;
   std::unordered_map<int, execution_statistics> m_finished;
+  std::deque<std::pair<int, std::string>> m_failed;
 
-  std::vector<int> m_retry_queue;
   int m_started = 0;
   int m_completed = 0;
+  std::atomic<std::size_t> m_bytes_sent = 0;
+  std::atomic<std::size_t> m_bytes_received = 0;
+
+  std::shared_ptr<result_cache> m_cache;
+
+  // The IO thread of a background instance
+  std::optional<boost::asio::io_service::work> m_work;
+  std::thread m_io_thread;
+  bool m_stopping = false;
 
   base_aws_lambda_dispatcher<RequestArchive, ResponseArchive>& m_dispatcher;
 };
@@ -341,7 +1136,7 @@ public:
       , m_key(dispatcher.key())
       , m_dispatcher(dispatcher)
   {
-    m_resolver.run(m_lambda_client.hostname(), "443");
+    m_resolver.run(m_lambda_client.hostname(), m_lambda_client.port());
     m_tls.set_default_verify_paths();
   }
 
@@ -386,13 +1181,13 @@ public:
     {
       scoped_tracing_span serialization_span(span, "serialization");
 
-      task_data data {t, args};
+      invocation_payload data {t, args};
       payload = RequestArchive::serialize(data);
     }
 
     std::shared_ptr<cppless::aws::lambda::beast_invocation_request> req =
         std::make_shared<cppless::aws::lambda::beast_invocation_request>(
-            task_function_name(t), "$LATEST", payload);
+            task_function_name(t), "$LATEST", std::move(payload));
 
     //m_requests.push_back(req);
     m_requests[id] = req;
@@ -462,6 +1257,15 @@ public:
   {
   }
 
+  /**
+   * @brief The name of the function a task with `identifier` is deployed as,
+   * which bound tasks compute once, see `bound_task`.
+   */
+  static auto function_name(const std::string& identifier) -> std::string
+  {
+    return lambda_function_name(identifier);
+  }
+
   template<class Config>
   struct meta_serializer
   {
@@ -473,7 +1277,8 @@ public:
           map(kv("ephemeral_storage", Config::ephemeral_storage),
               kv("memory", Config::memory),
               kv("timeout", Config::timeout),
-              kv("identifier", identifier))));
+              kv("identifier", identifier))
+          + variant()));
     }
 
     static auto identifier(const std::string& identifier) -> std::string
@@ -481,8 +1286,53 @@ public:
       std::stringstream ss;
       ss << identifier << "#" << Config::ephemeral_storage << "#"
          << Config::memory << "#" << Config::timeout;
+      if constexpr (requires { Config::threads; }) {
+        ss << "#threads=" << Config::threads;
+      }
+      if constexpr (requires { Config::context_cache; }) {
+        ss << "#context_cache=" << Config::context_cache;
+      }
+      if constexpr (requires { Config::remote_threshold; }) {
+        ss << "#remote_threshold=" << Config::remote_threshold;
+      }
       return ss.str();
     }
+
+    /**
+     * @brief The modifiers which change what a function does with its
+     * payload, thus a task is deployed as one function per combination of
+     * them. They are appended to the identifier in this order, as the
+     * packager does.
+     */
+    constexpr static auto variant()
+    {
+      using namespace cppless;  // NOLINT
+      auto threads = []
+      {
+        if constexpr (requires { Config::threads; }) {
+          return map(kv("threads", Config::threads));
+        } else {
+          return map();
+        }
+      };
+      auto context_cache = []
+      {
+        if constexpr (requires { Config::context_cache; }) {
+          return map(kv("context_cache", Config::context_cache));
+        } else {
+          return map();
+        }
+      };
+      auto remote_threshold = []
+      {
+        if constexpr (requires { Config::remote_threshold; }) {
+          return map(kv("remote_threshold", Config::remote_threshold));
+        } else {
+          return map();
+        }
+      };
+      return threads() + context_cache() + remote_threshold();
+    }
   };
 
   template<class Receivable, class Res, class... Args>
@@ -500,18 +1350,39 @@ public:
           //auto start = std::chrono::high_resolution_clock::now();
           uninitialized_recv u;
           std::tuple<Args...> s_args;
-          // task_data takes both of its constructor arguments by reference,
-          // thus deserializing into `t_data` will populate the context into
-          // `m_self` and the arguments into `s_args`.
-          task_data<Receivable, Args...> t_data {u.m_self, s_args};
-          RequestArchive::deserialize(request.payload, t_data);
+          std::vector<std::tuple<Args...>> batch_args;
+          std::uint32_t threads = 1;
+          // invocation_payload takes its constructor arguments by reference,
+          // thus deserializing into `payload` will populate the context into
+          // `m_self` and the arguments into `s_args`, or `batch_args` for a
+          // batch.
+          invocation_payload<Receivable, Args...> payload {
+              u.m_self, s_args, batch_args, threads};
+          RequestArchive::deserialize(request.payload, payload);
           //auto end = std::chrono::high_resolution_clock::now();
 
+          execution_statistics statistics {request.request_id, is_cold};
+          if constexpr (requires { u.m_self.cache_hit(); }) {
+            statistics.context_cache_hits = u.m_self.cache_hit() ? 1 : 0;
+            statistics.context_time_saved_us =
+                static_cast<std::uint64_t>(u.m_self.time_saved().count());
+          }
+
+          if (payload.batched()) {
+            std::tuple<std::vector<Res>, execution_statistics> res;
+            std::get<0>(res) =
+                apply_batch<Res>(u.m_self, batch_args, threads);
+            std::get<1>(res) = statistics;
+            is_cold = false;
+            return invocation_response::success(
+                ResponseArchive::serialize(res), "application/json");
+          }
+
           //auto start2 = std::chrono::high_resolution_clock::now();
           std::tuple<Res, execution_statistics> res;
           std::get<0>(res) = std::apply(u.m_self, s_args);
           //auto end2 = std::chrono::high_resolution_clock::now();
-          std::get<1>(res) = {request.request_id, is_cold};
+          std::get<1>(res) = statistics;
           if (is_cold)
             is_cold = false;
 
@@ -596,6 +1467,11 @@ class aws_lambda_env_dispatcher : public Base
     }
 
     cppless::aws::lambda::client lambda_client(aws_region);
+    // Same variable as the AWS SDKs, e.g. to invoke a local emulator
+    auto* endpoint_env = std::getenv("AWS_ENDPOINT_URL_LAMBDA");  // NOLINT
+    if (endpoint_env != nullptr) {
+      lambda_client.set_endpoint(endpoint_env);
+    }
 
     auto* session_token_env = std::getenv("AWS_SESSION_TOKEN");  // NOLINT
     std::optional<std::string> session_token;
@@ -637,6 +1513,33 @@ public:
                                                   ResponseArchive> {*this};
   }
 
+  /**
+   * @brief Creates an instance sending its requests over `pool`, e.g. a pool
+   * with custom options shared between several instances, and admitting and
+   * retrying them according to `admission` and `retry`.
+   */
+  auto create_instance(std::shared_ptr<http2::session_pool> pool,
+                       admission_options admission = {},
+                       retry_options retry = {},
+                       io_mode mode = io_mode::foreground)
+      -> aws_lambda_nghttp2_dispatcher_instance<RequestArchive, ResponseArchive>
+  {
+    return aws_lambda_nghttp2_dispatcher_instance<RequestArchive,
+                                                  ResponseArchive> {
+        *this, std::move(pool), admission, retry, mode};
+  }
+
+  /**
+   * @brief Creates an instance whose IO is driven by `mode`, see `io_mode`.
+   */
+  auto create_instance(io_mode mode)
+      -> aws_lambda_nghttp2_dispatcher_instance<RequestArchive, ResponseArchive>
+  {
+    return aws_lambda_nghttp2_dispatcher_instance<RequestArchive,
+                                                  ResponseArchive> {
+        *this, nullptr, {}, {}, mode};
+  }
+
   using from_env = aws_lambda_env_dispatcher<
       aws_lambda_nghttp2_dispatcher<RequestArchive, ResponseArchive>>;
 };
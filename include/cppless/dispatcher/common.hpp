@@ -1,31 +1,42 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <condition_variable>
+#include <cstdint>
 #include <future>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
-#include <boost/beast/core/detail/base64.hpp>
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/json.hpp>
 #include <cereal/cereal.hpp>
 #include <cppless/detail/deduction.hpp>
+#include <cppless/utils/base64.hpp>
+#include <cppless/utils/buffer_chain.hpp>
+#include <cppless/utils/fast_archive.hpp>
 #include <cppless/utils/fdstream.hpp>
+#include <cppless/utils/thread_pool.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "cppless/dispatcher/coroutine.hpp"
 #include "cppless/dispatcher/sendable.hpp"
+#include "cppless/dispatcher/task_future.hpp"
 
 namespace cppless
 {
@@ -34,14 +45,69 @@ struct execution_statistics
 {
   std::string invocation_id;
   bool is_cold;
+  // Contexts reused by the function rather than deserialized, see
+  // `aws::with_context_cache`, and the deserialization time this saved
+  std::uint32_t context_cache_hits = 0;
+  std::uint64_t context_time_saved_us = 0;
 
   template<class Archive>
   void serialize(Archive & archive)
   {
-    archive(invocation_id, is_cold); 
+    archive(invocation_id,
+            is_cold,
+            context_cache_hits,
+            context_time_saved_us);
   }
 };
 
+/**
+ * @brief Payload bytes a dispatcher instance has sent and received, e.g. to
+ * measure the traffic through the host.
+ */
+struct transfer_statistics
+{
+  std::size_t sent = 0;
+  std::size_t received = 0;
+};
+
+/**
+ * @brief Thrown by `wait_one` for a task which failed terminally, e.g. because
+ * it ran out of retries.
+ */
+class invocation_failed : public std::runtime_error
+{
+public:
+  invocation_failed(int id, const std::string& message)
+      : std::runtime_error(message)
+      , m_id(id)
+  {
+  }
+
+  [[nodiscard]] auto id() const -> int
+  {
+    return m_id;
+  }
+
+private:
+  int m_id;
+};
+
+/**
+ * @brief Which thread drives the network IO of a dispatcher instance.
+ */
+enum class io_mode
+{
+  /**
+   * @brief The thread waiting for results, e.g. in `wait_one`.
+   */
+  foreground,
+  /**
+   * @brief A thread of the instance, so the host can compute while its
+   * invocations are in flight.
+   */
+  background,
+};
+
 /**
  * @brief Represents a value which will be set in the future
  *
@@ -70,6 +136,18 @@ public:
     m_res = res;
   }
 
+  /**
+   * @brief The storage of the value, e.g. for a dispatcher to write the
+   * result of a task into.
+   */
+  auto target() -> Res&
+  {
+    if (!m_res) {
+      m_res.emplace();
+    }
+    return *m_res;
+  }
+
   auto value() -> Res&
   {
     return m_res.value();
@@ -98,11 +176,26 @@ public:
   {
   }
 
+  /**
+   * @brief Allocates the shared state with `allocator`, e.g. next to the
+   * graph node producing the value.
+   */
+  template<class Allocator>
+  shared_future(std::allocator_arg_t /*tag*/, const Allocator& allocator)
+      : m_future(std::allocate_shared<future<Res>>(allocator))
+  {
+  }
+
   auto set_value(const Res& res) -> void
   {
     m_future->set_value(res);
   }
 
+  auto target() -> Res&
+  {
+    return m_future->target();
+  }
+
   auto value() -> Res&
   {
     return m_future->value();
@@ -113,6 +206,14 @@ public:
     return m_future->value();
   }
 
+  /**
+   * @brief The number of `shared_future`s sharing this state.
+   */
+  [[nodiscard]] auto use_count() const -> long
+  {
+    return m_future.use_count();
+  }
+
 private:
   std::shared_ptr<future<Res>> m_future;
 };
@@ -261,6 +362,19 @@ public:
     return ss.str();
   }
 
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    buffer_chain chain;
+    {
+      buffer_chain_ostreambuf buf(chain);
+      std::ostream ss(&buf);
+      output_archive oar(ss, output_archive::Options::NoIndent());
+      oar(t);
+    }
+    return chain;
+  }
+
   template<class T>
   static inline auto deserialize(const std::string& s, T& t)
   {
@@ -270,6 +384,17 @@ public:
       iar(t);
     }
   }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    buffer_chain_istreambuf buf(c);
+    std::istream ss(&buf);
+    {
+      input_archive iar(ss);
+      iar(t);
+    }
+  }
 };
 
 class json_binary_archive
@@ -278,40 +403,76 @@ public:
   using input_archive = cereal::BinaryInputArchive;
   using output_archive = cereal::BinaryOutputArchive;
 
+  /**
+   * @brief Serializes `t` into a quoted base64 string. The binary
+   * representation is encoded as the archive produces it and never
+   * materialized as a whole.
+   */
   template<class T>
-  static inline auto serialize(T t) -> std::string
+  static inline auto serialize(const T& t) -> std::string
   {
-    // Binary stream
-    std::stringstream bs;
+    std::string encoded = "\"";
     {
-      output_archive oar(bs);
-      oar(t);
+      base64::string_sink sink(encoded);
+      encode(sink, t);
+      sink.finish();
     }
-    std::string s = bs.str();
-    unsigned int size = s.size();
-    auto encoded_size = boost::beast::detail::base64::encoded_size(size);
-
-    std::string encoded;
-    encoded.resize(encoded_size + 2);
-    encoded[0] = '"';
-    boost::beast::detail::base64::encode(encoded.data() + 1, s.data(), size);
-    encoded[encoded_size + 1] = '"';
+    encoded += '"';
+    return encoded;
+  }
+
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    buffer_chain encoded;
+    encoded.append("\"", 1);
+    encode(encoded, t);
+    encoded.append("\"", 1);
     return encoded;
   }
 
   template<class T>
   static inline auto deserialize(const std::string& s, T& t) -> void
   {
-    unsigned int size = s.size();
-    auto decoded_size = boost::beast::detail::base64::decoded_size(size - 2);
-    std::string decoded;
-    decoded.resize(decoded_size);
-    boost::beast::detail::base64::decode(
-        decoded.data(), s.data() + 1, size - 2);
+    if (s.size() < 2) {
+      throw std::runtime_error("Invalid json_binary_archive payload");
+    }
+    base64::istreambuf buf(std::string_view(s).substr(1, s.size() - 2));
+    decode(buf, t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    if (c.size() < 2) {
+      throw std::runtime_error("Invalid json_binary_archive payload");
+    }
+    auto encoded = c.subchain(1, c.size() - 2);
+    base64::istreambuf buf(encoded);
+    decode(buf, t);
+  }
 
-    std::stringstream os(decoded);
+private:
+  template<class Sink, class T>
+  static inline auto encode(Sink& sink, const T& t) -> void
+  {
+    base64::ostreambuf<Sink> buf(sink);
     {
-      input_archive iar(os);
+      std::ostream bs(&buf);
+      output_archive oar(bs);
+      oar(t);
+    }
+    buf.finish();
+  }
+
+  template<class T>
+  static inline auto decode(base64::istreambuf& buf, T& t) -> void
+  {
+    std::istream is(&buf);
+    // Surface decoding errors instead of a truncated read
+    is.exceptions(std::ios::badbit);
+    {
+      input_archive iar(is);
       iar(t);
     }
   }
@@ -324,7 +485,7 @@ public:
   using output_archive = cereal::BinaryOutputArchive;
 
   template<class T>
-  static inline auto serialize(T t) -> std::string
+  static inline auto serialize(const T& t) -> std::string
   {
     // Binary stream
     std::stringstream bs;
@@ -335,6 +496,19 @@ public:
     return bs.str();
   }
 
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    buffer_chain chain;
+    {
+      buffer_chain_ostreambuf buf(chain);
+      std::ostream bs(&buf);
+      output_archive oar(bs);
+      oar(t);
+    }
+    return chain;
+  }
+
   template<class T>
   static inline auto deserialize(const std::string& s, T& t) -> void
   {
@@ -344,6 +518,153 @@ public:
       iar(t);
     }
   }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    buffer_chain_istreambuf buf(c);
+    std::istream is(&buf);
+    {
+      input_archive iar(is);
+      iar(t);
+    }
+  }
+};
+
+namespace detail
+{
+/**
+ * @brief Calls `f` with the contents of `c` as one view, copying them only if
+ * they span several segments.
+ */
+template<class F>
+inline auto with_contiguous(const buffer_chain& c, F&& f) -> void
+{
+  const auto& segments = c.segments();
+  if (segments.size() == 1) {
+    f(std::string_view {segments[0].data, segments[0].size});
+    return;
+  }
+  auto s = c.str();
+  f(std::string_view {s});
+}
+
+/**
+ * @brief Encodes `binary` as a quoted base64 string, in one pass.
+ */
+inline auto quote_base64(std::string_view binary) -> std::string
+{
+  std::string encoded;
+  encoded.resize(base64::encoded_size(binary.size()) + 2);
+  encoded[0] = '"';
+  base64::encoder encoder;
+  auto size = encoder.update(binary.data(), binary.size(), &encoded[1]);
+  size += encoder.finish(&encoded[1 + size]);
+  encoded[1 + size] = '"';
+  encoded.resize(size + 2);
+  return encoded;
+}
+
+/**
+ * @brief Decodes what `quote_base64` encoded.
+ */
+inline auto unquote_base64(std::string_view s) -> std::string
+{
+  if (s.size() < 2) {
+    throw std::runtime_error("Invalid base64 payload");
+  }
+  auto encoded = s.substr(1, s.size() - 2);
+  std::string binary;
+  binary.resize(base64::decoded_size(encoded.size()));
+  base64::decoder decoder;
+  auto size = decoder.update(encoded.data(), encoded.size(), binary.data());
+  size += decoder.finish(binary.data() + size);
+  binary.resize(size);
+  return binary;
+}
+}  // namespace detail
+
+/**
+ * @brief Like `binary_archive`, but with `fast_binary_output_archive`, which
+ * writes into a contiguous buffer instead of a stream.
+ */
+class fast_binary_archive
+{
+public:
+  using input_archive = fast_binary_input_archive;
+  using output_archive = fast_binary_output_archive;
+
+  template<class T>
+  static inline auto serialize(const T& t) -> std::string
+  {
+    output_archive oar;
+    oar(t);
+    return oar.take();
+  }
+
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    // Adopts the buffer without copying it
+    return buffer_chain {serialize(t)};
+  }
+
+  template<class T>
+  static inline auto deserialize(std::string_view s, T& t) -> void
+  {
+    input_archive iar(s);
+    iar(t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const std::string& s, T& t) -> void
+  {
+    deserialize(std::string_view {s}, t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    detail::with_contiguous(c, [&](std::string_view s) { deserialize(s, t); });
+  }
+};
+
+/**
+ * @brief Like `json_binary_archive`, but with `fast_binary_output_archive`.
+ * The buffer is encoded in one pass once it is complete.
+ */
+class json_fast_binary_archive
+{
+public:
+  using input_archive = fast_binary_input_archive;
+  using output_archive = fast_binary_output_archive;
+
+  template<class T>
+  static inline auto serialize(const T& t) -> std::string
+  {
+    return detail::quote_base64(fast_binary_archive::serialize(t));
+  }
+
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    return buffer_chain {serialize(t)};
+  }
+
+  template<class T>
+  static inline auto deserialize(const std::string& s, T& t) -> void
+  {
+    fast_binary_archive::deserialize(detail::unquote_base64(s), t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    detail::with_contiguous(
+        c,
+        [&](std::string_view s)
+        { fast_binary_archive::deserialize(detail::unquote_base64(s), t); });
+  }
 };
 
 template<class Task, class DispatcherInstance>
@@ -386,6 +707,217 @@ inline auto dispatch(DispatcherInstance& instance,
       instance, fn, result_target, args, span);
 }
 
+/**
+ * @brief Binds `task` for repeated dispatches: its captures are serialized
+ * once, and every dispatch of the bound task only serializes its arguments,
+ * see `bound_task`.
+ */
+template<class Dispatcher, class Res, class... Args>
+inline auto bind_task(task<Dispatcher, Res(Args...)> task)
+    -> bound_task<Dispatcher, Res(Args...)>
+{
+  return bound_task<Dispatcher, Res(Args...)> {std::move(task)};
+}
+
+template<class Config,
+         class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto bind_task(DispatcherInstance& /*instance*/, Fn& fn)
+{
+  return bind_task(
+      lambda_task_factory<typename DispatcherInstance::dispatcher_type,
+                          Config>::create(fn));
+}
+
+template<class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto bind_task(DispatcherInstance& instance, Fn& fn)
+{
+  return bind_task<
+      typename DispatcherInstance::dispatcher_type::default_config>(instance,
+                                                                     fn);
+}
+
+/**
+ * @brief Dispatches `task` with `args`. The result is delivered through the
+ * returned future, which can be waited for, chained with `then` or awaited
+ * with `co_await`, rather than through `wait_one`.
+ */
+template<class Task, class DispatcherInstance>
+inline auto dispatch_async(DispatcherInstance& instance,
+                           Task& task,
+                           typename Task::args args = {},
+                           std::optional<tracing_span_ref> span = std::nullopt)
+    -> task_future<typename Task::res>
+{
+  return instance.dispatch_async_impl(task, args, span);
+}
+
+template<class Config,
+         class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto dispatch_async(
+    DispatcherInstance& instance,
+    Fn& fn,
+    typename detail::function_args<FnType>::type args = {},
+    std::optional<tracing_span_ref> span = std::nullopt)
+    -> task_future<typename detail::function_res<FnType>::type>
+{
+  auto task = lambda_task_factory<typename DispatcherInstance::dispatcher_type,
+                                  Config>::create(fn);
+  return instance.dispatch_async_impl(task, args, span);
+}
+
+template<class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto dispatch_async(
+    DispatcherInstance& instance,
+    Fn& fn,
+    typename detail::function_args<FnType>::type args = {},
+    std::optional<tracing_span_ref> span = std::nullopt)
+    -> task_future<typename detail::function_res<FnType>::type>
+{
+  return dispatch_async<
+      typename DispatcherInstance::dispatcher_type::default_config>(
+      instance, fn, args, span);
+}
+
+/**
+ * @brief Calls `fn` with every argument tuple of `batch`. Unless `threads` is
+ * one, the calls run on the default thread pool.
+ *
+ * @return The results, in the order of `batch`
+ */
+template<class Res, class Fn, class... Args>
+auto apply_batch(Fn& fn,
+                 std::vector<std::tuple<Args...>>& batch,
+                 unsigned int threads) -> std::vector<Res>
+{
+  std::vector<Res> results(batch.size());
+  auto apply_one = [&](std::size_t i)
+  { results[i] = std::apply(fn, batch[i]); };
+  // The elements of a std::vector<bool> cannot be written concurrently
+  if (threads == 1 || std::is_same_v<Res, bool>) {
+    for (std::size_t i = 0; i < batch.size(); i++) {
+      apply_one(i);
+    }
+  } else {
+    thread_pool::default_pool().parallel_for(0, batch.size(), apply_one);
+  }
+  return results;
+}
+
+/**
+ * @brief Dispatches `task` once for every argument tuple in `args`, the result
+ * for `args[i]` is written to `results[i]`.
+ *
+ * Dispatcher instances providing `dispatch_batch_impl` send up to
+ * `batch_size` calls, all of them if it is zero, in a single invocation.
+ * Other instances dispatch every call on its own. Either way, `wait_one`
+ * reports every call separately.
+ *
+ * @return The ids of the calls, in the order of `args`
+ */
+template<class Task, class DispatcherInstance>
+inline auto dispatch_batch(DispatcherInstance& instance,
+                           Task& task,
+                           std::span<typename Task::res> results,
+                           std::span<const typename Task::args> args,
+                           std::size_t batch_size = 0,
+                           std::optional<tracing_span_ref> span = std::nullopt)
+    -> std::vector<int>
+{
+  if (results.size() != args.size()) {
+    throw std::runtime_error(
+        "dispatch_batch: results and args differ in size");
+  }
+  if (batch_size == 0) {
+    batch_size = args.size();
+  }
+
+  std::vector<int> ids;
+  ids.reserve(args.size());
+  for (std::size_t offset = 0; offset < args.size(); offset += batch_size) {
+    auto count = std::min(batch_size, args.size() - offset);
+    auto batch_results = results.subspan(offset, count);
+    auto batch_args = args.subspan(offset, count);
+    if constexpr (requires {
+                    instance.dispatch_batch_impl(
+                        task, batch_results, batch_args, span);
+                  })
+    {
+      int first =
+          instance.dispatch_batch_impl(task, batch_results, batch_args, span);
+      for (std::size_t i = 0; i < count; i++) {
+        ids.push_back(first + static_cast<int>(i));
+      }
+    } else {
+      for (std::size_t i = 0; i < count; i++) {
+        ids.push_back(instance.dispatch_impl(
+            task, batch_results[i], batch_args[i], span));
+      }
+    }
+  }
+  return ids;
+}
+
+template<class Config,
+         class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto dispatch_batch(
+    DispatcherInstance& instance,
+    Fn& fn,
+    std::span<typename detail::function_res<FnType>::type> results,
+    std::span<const typename detail::function_args<FnType>::type> args,
+    std::size_t batch_size = 0,
+    std::optional<tracing_span_ref> span = std::nullopt) -> std::vector<int>
+{
+  auto task = lambda_task_factory<typename DispatcherInstance::dispatcher_type,
+                                  Config>::create(fn);
+  return dispatch_batch(instance, task, results, args, batch_size, span);
+}
+
+template<class Fn,
+         class DispatcherInstance,
+         class FnType =
+             typename detail::deduce_function<decltype(&Fn::operator())>::type>
+inline auto dispatch_batch(
+    DispatcherInstance& instance,
+    Fn& fn,
+    std::span<typename detail::function_res<FnType>::type> results,
+    std::span<const typename detail::function_args<FnType>::type> args,
+    std::size_t batch_size = 0,
+    std::optional<tracing_span_ref> span = std::nullopt) -> std::vector<int>
+{
+  return dispatch_batch<
+      typename DispatcherInstance::dispatcher_type::default_config>(
+      instance, fn, results, args, batch_size, span);
+}
+
+/**
+ * @brief An instance of a default constructed `Dispatcher`, shared by all
+ * callers on the calling thread until it exits. Recursive tasks use it to
+ * keep their connections across recursion levels and warm invocations.
+ */
+template<class Dispatcher>
+auto shared_instance()
+    -> decltype(std::declval<Dispatcher&>().create_instance())&
+{
+  thread_local Dispatcher dispatcher;
+  thread_local auto instance = dispatcher.create_instance();
+  return instance;
+}
+
 template<class DispatcherInstance>
 inline auto wait(DispatcherInstance& instance, int n)
 {
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/utils/buffer_chain.hpp>
+#include <cppless/utils/compression.hpp>
+
+namespace cppless
+{
+
+/**
+ * @brief Compresses what the binary `Archive` produces, e.g. `binary_archive`
+ * or `fast_binary_archive`, with the codec `compression::choose` picks for
+ * it. The codec is recorded in a header, thus the receiving end reads any
+ * payload regardless of its options.
+ */
+template<class Archive = fast_binary_archive,
+         class Options = compression::default_options>
+class compressed_archive
+{
+public:
+  using input_archive = typename Archive::input_archive;
+  using output_archive = typename Archive::output_archive;
+
+  template<class T>
+  static inline auto serialize(const T& t) -> std::string
+  {
+    return compression::compress<Options>(Archive::serialize(t));
+  }
+
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    return buffer_chain {serialize(t)};
+  }
+
+  template<class T>
+  static inline auto deserialize(const std::string& s, T& t) -> void
+  {
+    Archive::deserialize(compression::decompress<Options>(s), t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    detail::with_contiguous(
+        c,
+        [&](std::string_view s)
+        { Archive::deserialize(compression::decompress<Options>(s), t); });
+  }
+};
+
+/**
+ * @brief Like `compressed_archive`, encoded as a quoted base64 string for
+ * JSON payloads, e.g. the requests to Lambda. Compressing first makes up for
+ * some of the size base64 adds.
+ */
+template<class Archive = fast_binary_archive,
+         class Options = compression::default_options>
+class json_compressed_archive
+{
+public:
+  using input_archive = typename Archive::input_archive;
+  using output_archive = typename Archive::output_archive;
+
+  template<class T>
+  static inline auto serialize(const T& t) -> std::string
+  {
+    return detail::quote_base64(
+        compressed_archive<Archive, Options>::serialize(t));
+  }
+
+  template<class T>
+  static inline auto serialize_chain(const T& t) -> buffer_chain
+  {
+    return buffer_chain {serialize(t)};
+  }
+
+  template<class T>
+  static inline auto deserialize(const std::string& s, T& t) -> void
+  {
+    compressed_archive<Archive, Options>::deserialize(
+        detail::unquote_base64(s), t);
+  }
+
+  template<class T>
+  static inline auto deserialize(const buffer_chain& c, T& t) -> void
+  {
+    detail::with_contiguous(c,
+                            [&](std::string_view s)
+                            {
+                              compressed_archive<Archive, Options>::deserialize(
+                                  detail::unquote_base64(s), t);
+                            });
+  }
+};
+
+}  // namespace cppless
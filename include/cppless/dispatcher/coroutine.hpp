@@ -0,0 +1,267 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <cppless/dispatcher/task_future.hpp>
+
+namespace cppless
+{
+
+template<class T = void>
+class coroutine;
+
+namespace detail
+{
+
+template<class T>
+class coroutine_result
+{
+public:
+  auto return_value(T value) -> void
+  {
+    m_value.emplace(std::move(value));
+  }
+
+  auto result() -> T
+  {
+    rethrow();
+    return std::move(*m_value);
+  }
+
+  auto unhandled_exception() -> void
+  {
+    m_error = std::current_exception();
+  }
+
+protected:
+  auto rethrow() -> void
+  {
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+private:
+  std::optional<T> m_value;
+  std::exception_ptr m_error;
+};
+
+template<>
+class coroutine_result<void>
+{
+public:
+  auto return_void() -> void {}
+
+  auto result() -> void
+  {
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+  auto unhandled_exception() -> void
+  {
+    m_error = std::current_exception();
+  }
+
+private:
+  std::exception_ptr m_error;
+};
+
+/**
+ * @brief A coroutine nobody waits for, it starts right away and destroys
+ * itself once it has finished.
+ */
+struct detached_coroutine
+{
+  struct promise_type
+  {
+    auto get_return_object() -> detached_coroutine
+    {
+      return {};
+    }
+    auto initial_suspend() noexcept -> std::suspend_never
+    {
+      return {};
+    }
+    auto final_suspend() noexcept -> std::suspend_never
+    {
+      return {};
+    }
+    auto return_void() -> void {}
+    auto unhandled_exception() -> void
+    {
+      std::terminate();
+    }
+  };
+};
+
+template<class T>
+auto complete_from(coroutine<T> c, std::shared_ptr<future_state<T>> state)
+    -> detached_coroutine
+{
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await std::move(c);
+    } else {
+      state->value = co_await std::move(c);
+    }
+  } catch (...) {
+    state->complete(std::current_exception());
+    co_return;
+  }
+  state->complete();
+}
+
+}  // namespace detail
+
+/**
+ * @brief A lazily started coroutine returning `T`. It runs once it is awaited
+ * with `co_await`, or passed to `spawn` or `sync_wait`.
+ *
+ * Coroutines awaiting the futures of `dispatch_async` are resumed by the
+ * thread driving the dispatcher instance, thus a single thread can keep the
+ * invocations of many coroutines in flight.
+ */
+template<class T>
+class [[nodiscard]] coroutine
+{
+public:
+  struct promise_type : detail::coroutine_result<T>
+  {
+    auto get_return_object() -> coroutine
+    {
+      return coroutine {handle::from_promise(*this)};
+    }
+
+    auto initial_suspend() noexcept -> std::suspend_always
+    {
+      return {};
+    }
+
+    auto final_suspend() noexcept
+    {
+      struct final_awaiter
+      {
+        [[nodiscard]] auto await_ready() const noexcept -> bool
+        {
+          return false;
+        }
+        // Resumes the awaiting coroutine without growing the stack
+        auto await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            -> std::coroutine_handle<>
+        {
+          return h.promise().continuation;
+        }
+        auto await_resume() noexcept -> void {}
+      };
+      return final_awaiter {};
+    }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+  };
+
+  using handle = std::coroutine_handle<promise_type>;
+
+  coroutine(const coroutine&) = delete;
+  auto operator=(const coroutine&) -> coroutine& = delete;
+
+  coroutine(coroutine&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr))
+  {
+  }
+
+  auto operator=(coroutine&& other) noexcept -> coroutine&
+  {
+    if (this != &other) {
+      destroy();
+      m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+  }
+
+  ~coroutine()
+  {
+    destroy();
+  }
+
+  auto operator co_await() && noexcept
+  {
+    struct awaiter
+    {
+      handle h;
+
+      [[nodiscard]] auto await_ready() const noexcept -> bool
+      {
+        return h.done();
+      }
+
+      auto await_suspend(std::coroutine_handle<> awaiting) noexcept
+          -> std::coroutine_handle<>
+      {
+        h.promise().continuation = awaiting;
+        return h;
+      }
+
+      auto await_resume() -> T
+      {
+        return h.promise().result();
+      }
+    };
+    return awaiter {m_handle};
+  }
+
+private:
+  explicit coroutine(handle h)
+      : m_handle(h)
+  {
+  }
+
+  auto destroy() -> void
+  {
+    if (m_handle) {
+      m_handle.destroy();
+      m_handle = nullptr;
+    }
+  }
+
+  handle m_handle;
+};
+
+/**
+ * @brief Starts `c` right away, e.g. to run a subtree of a recursion
+ * concurrently with its siblings.
+ *
+ * @param drive Completes the futures `c` awaits, see `future_driver`
+ * @return A future for the result of `c`
+ */
+template<class T>
+auto spawn(coroutine<T> c, future_driver drive = {}) -> task_future<T>
+{
+  auto state = std::make_shared<detail::future_state<T>>();
+  state->drive = std::move(drive);
+  detail::complete_from(std::move(c), state);
+  return task_future<T> {std::move(state)};
+}
+
+/**
+ * @brief Runs `c` to completion, driving `instance` on the calling thread
+ * unless it has an IO thread of its own.
+ */
+template<class T, class DispatcherInstance>
+auto sync_wait(DispatcherInstance& instance, coroutine<T> c) -> T
+{
+  auto future = spawn(std::move(c), instance.driver());
+  if constexpr (std::is_void_v<T>) {
+    future.get();
+  } else {
+    return std::move(future.get());
+  }
+}
+
+}  // namespace cppless
@@ -1,16 +1,25 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <ostream>
+#include <sstream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <vector>
 
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
@@ -22,6 +31,7 @@
 #include <cppless/dispatcher/common.hpp>
 #include <cppless/dispatcher/sendable.hpp>
 #include <cppless/utils/cereal.hpp>
+#include <cppless/utils/process_pool.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <cppless/utils/uninitialized.hpp>
 #include <nlohmann/json.hpp>
@@ -69,6 +79,22 @@ inline void from_json(const json& j, runtime_cppless_meta& p)
   j.at("entry_points").get_to(p.entry_points);
 }
 
+struct local_dispatcher_options
+{
+  /**
+   * @brief Keep the entry point processes resident and stream invocations to
+   * them, instead of starting a process per invocation.
+   */
+  bool pooled = false;
+  process_pool_options pool = {};
+};
+
+/**
+ * @brief Passed to entry points started by a pooled local dispatcher, which
+ * then serve invocations until their stdin is closed.
+ */
+constexpr std::string_view pooled_worker_flag = "--cppless-pooled";
+
 /**
  * @brief A dispatcher which runs functions locally in new processes
  *
@@ -110,8 +136,10 @@ public:
    * points can be found. The extension is changed to `.json`, thus this should
    * normally be `argv[0]`, assuming that `argv[0]´ contains the executable
    * name.
+   * @param options Whether invocations are run in resident worker processes.
    */
-  explicit local_dispatcher(std::string base_path)
+  explicit local_dispatcher(std::string base_path,
+                            local_dispatcher_options options = {})
       : m_base_path(std::move(base_path))
   {
     // Read the meta file
@@ -135,11 +163,21 @@ public:
     for (auto& entry : runtime_meta.entry_points) {
       m_function_map[entry.user_meta] = entry.filename;
     }
+
+    if (options.pooled) {
+      m_pool = std::make_shared<process_pool>(
+          std::vector<std::string> {std::string {pooled_worker_flag}},
+          options.pool);
+    }
   }
 
   template<class Receivable, class Res, class... Args>
-  static auto main(int /*argc*/, char* /*argv*/[]) -> int  // NOLINT
+  static auto main(int argc, char* argv[]) -> int  // NOLINT
   {
+    std::span<char*> arguments {argv, static_cast<std::size_t>(argc)};
+    if (arguments.size() > 1 && arguments[1] == pooled_worker_flag) {
+      return serve<Receivable, Res, Args...>();
+    }
     using uninitialized_recv = cppless::uninitialized_data<Receivable>;
     request_input_archive iar(std::cin);
     uninitialized_recv u;
@@ -163,11 +201,53 @@ public:
     return 0;
   }
 
+  /**
+   * @brief Runs invocations read as frames from stdin until it is closed,
+   * writing the result of each as a frame to stdout.
+   */
+  template<class Receivable, class Res, class... Args>
+  static auto serve() -> int
+  {
+    using uninitialized_recv = cppless::uninitialized_data<Receivable>;
+    // Anything the task itself writes to stdout is redirected to stderr, so
+    // that it cannot corrupt the responses.
+    int response_fd = ::dup(STDOUT_FILENO);
+    ::dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    boost::uuids::random_generator generator;
+    std::string request;
+    while (read_frame(STDIN_FILENO, request)) {
+      std::istringstream request_stream(request);
+      uninitialized_recv u;
+      std::tuple<Args...> s_args;
+      task_data<Receivable, Args...> t_data {u.m_self, s_args};
+      {
+        request_input_archive iar(request_stream);
+        iar(t_data);
+      }
+
+      std::tuple<Res, std::string> res;
+      std::get<0>(res) = std::apply(u.m_self, s_args);
+      std::get<1>(res) = boost::uuids::to_string(generator());
+      std::ostringstream response_stream;
+      {
+        response_output_archive oar(response_stream);
+        oar(res);
+      }
+      write_frame(response_fd, response_stream.view());
+    }
+    return 0;
+  }
+
   class instance
   {
   public:
     using id_type = int;
     using dispatcher_type = local_dispatcher;
+    /**
+     * @brief Receives the error of a task, or null if it succeeded.
+     */
+    using completion_cb = std::function<void(std::exception_ptr)>;
 
     explicit instance(local_dispatcher<InputArchive, OutputArchive>& dispatcher)
         : m_dispatcher(dispatcher)
@@ -185,6 +265,8 @@ public:
         , m_mutex(std::move(other.m_mutex))
         , m_cv(std::move(other.m_cv))
         , m_finished(std::move(other.m_finished))
+        , m_failed(std::move(other.m_failed))
+        , m_outstanding(other.m_outstanding)
         , m_threads(std::move(other.m_threads))
         , m_dispatcher(other.m_dispatcher)
     {
@@ -196,6 +278,8 @@ public:
       m_mutex = std::move(other.m_mutex);
       m_cv = std::move(other.m_cv);
       m_finished = std::move(other.m_finished);
+      m_failed = std::move(other.m_failed);
+      m_outstanding = other.m_outstanding;
       m_threads = std::move(other.m_threads);
       m_dispatcher = other.m_dispatcher;
       return *this;
@@ -203,6 +287,11 @@ public:
 
     ~instance()
     {
+      {
+        // Pooled invocations hold a reference to this instance
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_outstanding == 0; });
+      }
       for (auto& thread : m_threads) {
         thread.join();
       }
@@ -225,16 +314,46 @@ public:
                        typename TaskType::args args,
                        std::optional<tracing_span_ref> span = std::nullopt)
         -> int
+    {
+      return dispatch_impl(t, result_target, std::move(args), span, {});
+    }
+
+    /**
+     * @brief Like `dispatch_impl`, but the outcome goes to `completion` rather
+     * than to `wait_one`. It is called on the thread waiting for the process
+     * of the invocation, or on an IO thread of the pool.
+     */
+    template<class TaskType>
+    auto dispatch_impl(TaskType& t,
+                       typename TaskType::res& result_target,
+                       typename TaskType::args args,
+                       std::optional<tracing_span_ref> /*span*/,
+                       completion_cb completion) -> int
     {
       // Get the function name
       auto function_name = t.identifier();
 
       task_data data {t, args};
       std::string location = m_dispatcher.m_function_map[function_name];
-      int id = m_next_id++;
-      auto cb = [this, &result_target, id](const typename TaskType::res& result,
-                                           const std::string& request_id)
+      int id = 0;
+      {
+        std::scoped_lock lock(m_mutex);
+        id = m_next_id++;
+      }
+      if (m_dispatcher.m_pool) {
+        dispatch_pooled<TaskType>(
+            location, data, result_target, id, std::move(completion));
+        return id;
+      }
+      auto cb = [this, &result_target, id, completion = std::move(completion)](
+                    const typename TaskType::res& result,
+                    const std::string& request_id)
       {
+        if (completion) {
+          result_target = result;
+          completion(nullptr);
+          return;
+        }
         std::lock_guard<std::mutex> lock(m_mutex);
         result_target = result;
         m_finished.push_back(std::make_tuple(id, request_id));
@@ -263,18 +382,121 @@ public:
     auto wait_one() -> std::tuple<int, std::string>
     {
       std::unique_lock lock(m_mutex);
-      if (!m_finished.empty()) {
-        auto finished = m_finished.back();
-        m_finished.pop_back();
-        return finished;
+      m_cv.wait(lock, [this] { return reported(); });
+      return take_reported();
+    }
+
+    /**
+     * @brief Like `wait_one`, but gives up after `timeout`.
+     */
+    template<class Rep, class Period>
+    auto wait_for(std::chrono::duration<Rep, Period> timeout)
+        -> std::optional<std::tuple<int, std::string>>
+    {
+      std::unique_lock lock(m_mutex);
+      if (!m_cv.wait_for(lock, timeout, [this] { return reported(); })) {
+        return std::nullopt;
+      }
+      return take_reported();
+    }
+
+  private:
+    [[nodiscard]] auto reported() const -> bool
+    {
+      return !m_finished.empty() || !m_failed.empty();
+    }
+
+    auto take_reported() -> std::tuple<int, std::string>
+    {
+      if (!m_failed.empty()) {
+        auto [id, message] = std::move(m_failed.front());
+        m_failed.pop_front();
+        throw invocation_failed(id, message);
       }
-      m_cv.wait(lock, [this] { return !m_finished.empty(); });
       auto finished = m_finished.back();
       m_finished.pop_back();
       return finished;
     }
 
-  private:
+    template<class TaskType, class Data>
+    auto dispatch_pooled(const std::string& location,
+                         Data& data,
+                         typename TaskType::res& result_target,
+                         int id,
+                         completion_cb completion) -> void
+    {
+      std::ostringstream request_stream;
+      {
+        OutputArchive oar(request_stream);
+        oar(data);
+      }
+      {
+        std::scoped_lock lock(m_mutex);
+        m_outstanding++;
+      }
+      // Both callbacks share the completion, only one of them is called
+      auto shared_completion =
+          std::make_shared<completion_cb>(std::move(completion));
+      m_dispatcher.m_pool->submit(
+          location,
+          std::move(request_stream).str(),
+          [this, &result_target, id, shared_completion](std::string response)
+          {
+            std::tuple<typename TaskType::res, std::string> result;
+            std::optional<std::string> error;
+            try {
+              std::istringstream response_stream(std::move(response));
+              InputArchive iar(response_stream);
+              iar(result);
+            } catch (const std::exception& e) {
+              error = e.what();
+            }
+            if (*shared_completion) {
+              if (!error) {
+                result_target = std::move(std::get<0>(result));
+              }
+              complete(id, *shared_completion, error ? &*error : nullptr);
+              return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error) {
+              m_failed.emplace_back(id, *error);
+            } else {
+              result_target = std::move(std::get<0>(result));
+              m_finished.emplace_back(id, std::move(std::get<1>(result)));
+            }
+            m_outstanding--;
+            m_cv.notify_all();
+          },
+          [this, id, shared_completion](const std::string& message)
+          {
+            if (*shared_completion) {
+              complete(id, *shared_completion, &message);
+              return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_failed.emplace_back(id, message);
+            m_outstanding--;
+            m_cv.notify_all();
+          });
+    }
+
+    /**
+     * @brief Hands the outcome of the pooled invocation `id` to `completion`,
+     * `error` is null if it succeeded.
+     */
+    auto complete(int id, completion_cb& completion, const std::string* error)
+        -> void
+    {
+      completion(error != nullptr
+                     ? std::make_exception_ptr(invocation_failed(id, *error))
+                     : nullptr);
+      // The instance may be destroyed once nothing is outstanding
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_outstanding--;
+      m_cv.notify_all();
+    }
+
     int m_next_id = 0;
     /**
      * Acts as a mutual exclusion guard for `m_finished`
@@ -289,6 +511,16 @@ public:
      * notified when changes were made. A lock on `m_mutex` is required.
      */
     std::vector<std::tuple<int, std::string>> m_finished;
+    /**
+     * Pooled invocations which failed, with the reason. A lock on `m_mutex`
+     * is required.
+     */
+    std::deque<std::pair<int, std::string>> m_failed;
+    /**
+     * Pooled invocations which have not completed yet. A lock on `m_mutex`
+     * is required.
+     */
+    std::size_t m_outstanding = 0;
     /**
      * List of threads spawned by this instance. The destructor will ensure that
      * all threads are joined when the instance goes out of scope.
@@ -300,17 +532,29 @@ public:
   /**
    * @brief Create a instance of the local dispatcher. The local dispatcher
    * instance will create a new process for each invocation and waits for the
-   * process to finish on another thread. The lifetime of the dispatcher must
-   * outlife the instance, as it might hold a reference to the dispatcher from
-   * which it was created.
+   * process to finish on another thread, unless the dispatcher is pooled, in
+   * which case invocations are sent to resident workers. The lifetime of the
+   * dispatcher must outlife the instance, as it might hold a reference to the
+   * dispatcher from which it was created.
    *
    * @return A fresh instance
    */
   auto create_instance() -> instance { return instance(*this); }
 
+  /**
+   * @brief Like `create_instance`, as invocations always finish on threads
+   * of the instance or of the pool, which also call the completions passed to
+   * `dispatch_impl`. Thus both modes are alike.
+   */
+  auto create_instance(io_mode /*mode*/) -> instance
+  {
+    return instance(*this);
+  }
+
 private:
   std::string m_base_path;
   std::map<std::string, std::string> m_function_map;
+  std::shared_ptr<process_pool> m_pool;
 };
 
 }  // namespace cppless
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cppless/utils/object_store.hpp>
+
+namespace cppless
+{
+
+namespace detail
+{
+
+inline auto default_remote_threshold() -> std::size_t&
+{
+  static std::size_t threshold = std::numeric_limits<std::size_t>::max();
+  return threshold;
+}
+
+inline auto thread_remote_threshold() -> std::optional<std::size_t>&
+{
+  thread_local std::optional<std::size_t> threshold;
+  return threshold;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Sets the size in bytes above which `remote` values are serialized
+ * by reference. By default, they are always serialized inline.
+ */
+inline auto set_remote_threshold(std::size_t bytes) -> void
+{
+  detail::default_remote_threshold() = bytes;
+}
+
+/**
+ * @brief The threshold of the calling thread, see `scoped_remote_threshold`.
+ */
+inline auto remote_threshold() -> std::size_t
+{
+  auto& threshold = detail::thread_remote_threshold();
+  return threshold ? *threshold : detail::default_remote_threshold();
+}
+
+/**
+ * @brief Overrides the remote threshold of the calling thread for its
+ * lifetime.
+ */
+class scoped_remote_threshold
+{
+public:
+  explicit scoped_remote_threshold(std::size_t bytes)
+      : m_previous(std::exchange(detail::thread_remote_threshold(), bytes))
+  {
+  }
+
+  scoped_remote_threshold(const scoped_remote_threshold&) = delete;
+  auto operator=(const scoped_remote_threshold&)
+      -> scoped_remote_threshold& = delete;
+  scoped_remote_threshold(scoped_remote_threshold&&) = delete;
+  auto operator=(scoped_remote_threshold&&)
+      -> scoped_remote_threshold& = delete;
+
+  ~scoped_remote_threshold()
+  {
+    detail::thread_remote_threshold() = m_previous;
+  }
+
+private:
+  std::optional<std::size_t> m_previous;
+};
+
+/**
+ * @brief A value which is either passed inline or, once its encoding exceeds
+ * the remote threshold, kept in the default object store and passed as its
+ * key only.
+ *
+ * A task returning a `remote` value of which the host only hands on the key
+ * to its successors never moves the value itself through the host. The value
+ * is fetched by the first call to `get`, and uploaded at most once: copies
+ * refer to the same value.
+ *
+ * @tparam T A type serializable with cereal
+ */
+template<class T>
+class remote
+{
+public:
+  remote()
+      : m_state(std::make_shared<state>())
+  {
+    m_state->value.emplace();
+  }
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  remote(T value)
+      : m_state(std::make_shared<state>())
+  {
+    m_state->value.emplace(std::move(value));
+  }
+
+  /**
+   * @brief The value, fetched from the object store unless it is present.
+   */
+  auto get() const -> T&
+  {
+    std::scoped_lock lock {m_state->mutex};
+    if (!m_state->value) {
+      std::stringstream ss {default_object_store().get(*m_state->key)};
+      cereal::BinaryInputArchive iar(ss);
+      iar(m_state->value.emplace());
+    }
+    return *m_state->value;
+  }
+
+  /**
+   * @brief Whether the value was stored, e.g. to tell whether it was passed
+   * by reference.
+   */
+  [[nodiscard]] auto stored() const -> bool
+  {
+    std::scoped_lock lock {m_state->mutex};
+    return m_state->key.has_value();
+  }
+
+  template<class Archive>
+  void save(Archive& ar) const
+  {
+    std::scoped_lock lock {m_state->mutex};
+    auto threshold = remote_threshold();
+    if (!m_state->key && threshold != std::numeric_limits<std::size_t>::max())
+    {
+      std::stringstream ss;
+      {
+        cereal::BinaryOutputArchive oar(ss);
+        oar(*m_state->value);
+      }
+      auto encoded = ss.str();
+      if (encoded.size() > threshold) {
+        auto key = object_store::unique_key();
+        default_object_store().put(key, encoded);
+        m_state->key = std::move(key);
+      }
+    }
+    bool by_reference = m_state->key.has_value();
+    ar(cereal::make_nvp("by_reference", by_reference));
+    if (by_reference) {
+      ar(cereal::make_nvp("key", *m_state->key));
+    } else {
+      ar(cereal::make_nvp("value", *m_state->value));
+    }
+  }
+
+  template<class Archive>
+  void load(Archive& ar)
+  {
+    auto loaded = std::make_shared<state>();
+    bool by_reference = false;
+    ar(cereal::make_nvp("by_reference", by_reference));
+    if (by_reference) {
+      ar(cereal::make_nvp("key", loaded->key.emplace()));
+    } else {
+      ar(cereal::make_nvp("value", loaded->value.emplace()));
+    }
+    m_state = std::move(loaded);
+  }
+
+private:
+  struct state
+  {
+    std::mutex mutex;
+    std::optional<T> value;
+    std::optional<std::string> key;
+  };
+
+  std::shared_ptr<state> m_state;
+};
+
+}  // namespace cppless
@@ -1,16 +1,31 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <utility>
 
 #include <cereal/archives/json.hpp>
 #include <cereal/cereal.hpp>
 #include <cppless/detail/deduction.hpp>
+#include <cppless/dispatcher/remote.hpp>
 #include <cppless/utils/cereal.hpp>
+#include <cppless/utils/fast_archive.hpp>
 #include <cppless/utils/fixed_string.hpp>
+#include <cppless/utils/thread_pool.hpp>
+#include <cppless/utils/uninitialized.hpp>
 
 namespace cppless
 {
@@ -94,6 +109,121 @@ private:
   Lambda m_lambda;
 };
 
+/**
+ * @brief The receivable of tasks caching their context, see
+ * `aws::with_context_cache`: the captures arrive encoded as one string, which
+ * is deserialized into a `Receivable` only if none of the last `Entries`
+ * contexts the process received had the same encoding. Reused contexts are
+ * looked up by the hash of the encoding, then compared byte by byte.
+ *
+ * Like `receivable_lambda`, it is built from uninitialized data by
+ * deserialization.
+ *
+ * @tparam Receivable - The receivable the captures are deserialized into
+ * @tparam Entries - The contexts kept by the process
+ */
+template<class Receivable, std::size_t Entries>
+class cached_receivable
+{
+public:
+  template<class Archive>
+  auto load(Archive& ar) -> void
+  {
+    std::string encoded;
+    ar(encoded);
+    std::construct_at(&m_context, lookup(std::move(encoded)));
+  }
+
+  template<class... Args>
+  auto operator()(Args&&... args) -> decltype(auto)
+  {
+    return m_context->m_self(std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief Whether the context was reused rather than deserialized.
+   */
+  [[nodiscard]] auto cache_hit() const -> bool
+  {
+    return m_cache_hit;
+  }
+
+  /**
+   * @brief The time deserializing the reused context took when it was first
+   * received, zero unless it was reused.
+   */
+  [[nodiscard]] auto time_saved() const -> std::chrono::microseconds
+  {
+    return m_time_saved;
+  }
+
+private:
+  using context = uninitialized_data<Receivable>;
+
+  struct entry
+  {
+    std::size_t hash;
+    std::string encoded;
+    std::shared_ptr<context> value;
+    std::chrono::microseconds deserialization;
+  };
+
+  struct context_cache
+  {
+    std::mutex mutex;
+    // Most recently used first
+    std::list<entry> entries;
+  };
+
+  static auto cache() -> context_cache&
+  {
+    static context_cache c;
+    return c;
+  }
+
+  auto lookup(std::string encoded) -> std::shared_ptr<context>
+  {
+    auto hash = std::hash<std::string_view> {}(encoded);
+    auto& c = cache();
+    {
+      std::scoped_lock lock {c.mutex};
+      auto it = std::find_if(c.entries.begin(),
+                             c.entries.end(),
+                             [&](const entry& e)
+                             { return e.hash == hash && e.encoded == encoded; });
+      if (it != c.entries.end()) {
+        c.entries.splice(c.entries.begin(), c.entries, it);
+        m_cache_hit = true;
+        m_time_saved = it->deserialization;
+        return it->value;
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto value = std::make_shared<context>();
+    {
+      fast_binary_input_archive iar(std::string_view {encoded});
+      iar(value->m_self);
+    }
+    auto deserialization =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+    m_cache_hit = false;
+    m_time_saved = std::chrono::microseconds {0};
+
+    std::scoped_lock lock {c.mutex};
+    c.entries.push_front({hash, std::move(encoded), value, deserialization});
+    if (c.entries.size() > Entries) {
+      c.entries.pop_back();
+    }
+    return value;
+  }
+
+  std::shared_ptr<context> m_context;
+  bool m_cache_hit;
+  std::chrono::microseconds m_time_saved;
+};
+
 /**
  * @brief An abstract base class for a task implementation.
  *
@@ -108,6 +238,49 @@ class task_base
 public:
   virtual auto serialize(output_archive& ar) -> void = 0;
   virtual auto identifier() -> std::string = 0;
+  /**
+   * @brief The retry budget configured for the task, if any.
+   */
+  virtual auto max_retries() -> std::optional<unsigned int>
+  {
+    return std::nullopt;
+  }
+  /**
+   * @brief The threads available to the task within one invocation.
+   */
+  virtual auto threads() -> unsigned int
+  {
+    return 1;
+  }
+  /**
+   * @brief The expected duration of the task in milliseconds, if configured.
+   */
+  virtual auto cost() -> std::optional<unsigned int>
+  {
+    return std::nullopt;
+  }
+  /**
+   * @brief Whether invocations of the task may be backed up by a second one.
+   */
+  virtual auto speculative() -> bool
+  {
+    return false;
+  }
+  /**
+   * @brief Whether results of the task may be reused for equal payloads.
+   */
+  virtual auto memoized() -> bool
+  {
+    return false;
+  }
+  /**
+   * @brief The type of the invocable run by the task, see `target`.
+   */
+  virtual auto target_type() const -> const std::type_info& = 0;
+  /**
+   * @brief A pointer to the invocable run by the task.
+   */
+  virtual auto target() -> void* = 0;
   virtual ~task_base() = default;
 };
 
@@ -139,10 +312,149 @@ public:
     return m_base->identifier();
   }
 
+  [[nodiscard]] auto max_retries() const -> std::optional<unsigned int>
+  {
+    return m_base->max_retries();
+  }
+
+  [[nodiscard]] auto threads() const -> unsigned int
+  {
+    return m_base->threads();
+  }
+
+  [[nodiscard]] auto cost() const -> std::optional<unsigned int>
+  {
+    return m_base->cost();
+  }
+
+  [[nodiscard]] auto speculative() const -> bool
+  {
+    return m_base->speculative();
+  }
+
+  [[nodiscard]] auto memoized() const -> bool
+  {
+    return m_base->memoized();
+  }
+
+  /**
+   * @brief The invocable run by the task if it is of type `T`, otherwise a
+   * null pointer, like `std::function::target`.
+   */
+  template<class T>
+  auto target() -> T*
+  {
+    if (m_base->target_type() != typeid(T)) {
+      return nullptr;
+    }
+    return static_cast<T*>(m_base->target());
+  }
+
 private:
   std::unique_ptr<task_base<Dispatcher>> m_base;
 };
 
+template<class Dispatcher, class T>
+class bound_task;
+
+/**
+ * @brief A task whose captures are serialized once, when it is bound, see
+ * `bind_task`. Dispatching it copies the serialized captures into the payload
+ * and only serializes the arguments, and its identifier and function name
+ * are computed once as well. The captures are sent as they were when the task
+ * was bound.
+ *
+ * Binary request archives take the captures as they are, others serialize
+ * them on every dispatch like any task. So do binary archives if encoding the
+ * captures leaves state in the archive, i.e. registers class versions,
+ * shared pointers or polymorphic types, as the encoding of the arguments
+ * would depend on it.
+ */
+template<class Dispatcher, class Res, class... Args>
+class bound_task<Dispatcher, Res(Args...)>
+    : public task<Dispatcher, Res(Args...)>
+{
+  using base = task<Dispatcher, Res(Args...)>;
+  using output_archive = typename Dispatcher::request_output_archive;
+
+  constexpr static bool cereal_binary =
+      requires(output_archive& ar, const char* data, std::streamsize size) {
+        ar.saveBinary(data, size);
+      };
+  constexpr static bool fast_binary =
+      requires(output_archive& ar, const char* data, std::size_t size) {
+        ar.save_binary(data, size);
+      };
+
+public:
+  explicit bound_task(base t)
+      : base(std::move(t))
+      , m_identifier(base::identifier())
+  {
+    if constexpr (requires { Dispatcher::function_name(m_identifier); }) {
+      m_function_name = Dispatcher::function_name(m_identifier);
+    }
+    if constexpr (cereal_binary || fast_binary) {
+      auto encode = [this](int times)
+      {
+        std::ostringstream ss;
+        {
+          output_archive oar(ss);
+          for (int i = 0; i < times; i++) {
+            base::serialize(oar);
+          }
+        }
+        return std::move(ss).str();
+      };
+      // Stateless captures encode the same way once the archive saw them
+      auto once = encode(1);
+      if (encode(2) == once + once) {
+        m_captures = std::move(once);
+      }
+    }
+  }
+
+  inline void serialize(output_archive& ar)
+  {
+    if (!m_captures) {
+      base::serialize(ar);
+    } else if constexpr (cereal_binary) {
+      ar.saveBinary(m_captures->data(),
+                    static_cast<std::streamsize>(m_captures->size()));
+    } else if constexpr (fast_binary) {
+      ar.save_binary(m_captures->data(), m_captures->size());
+    }
+  }
+
+  /**
+   * @brief Whether the captures serialized when the task was bound are
+   * copied into the payloads.
+   */
+  [[nodiscard]] auto replays_captures() const -> bool
+  {
+    return m_captures.has_value();
+  }
+
+  [[nodiscard]] auto identifier() const -> std::string
+  {
+    return m_identifier;
+  }
+
+  /**
+   * @brief The name of the function the task is deployed as, if the
+   * dispatcher names its functions, see `task_function_name`.
+   */
+  [[nodiscard]] auto function_name() const -> const std::optional<std::string>&
+  {
+    return m_function_name;
+  }
+
+private:
+  std::string m_identifier;
+  std::optional<std::string> m_function_name;
+  std::optional<std::string> m_captures;
+};
+
 template<class Dispatcher, class Config, class Lambda, class T>
 class lambda_task;
 
@@ -162,7 +474,19 @@ public:
   auto serialize(output_archive& ar) -> void override
   {
     constexpr int capture_count = Lambda::capture_count();
-    if constexpr (capture_count > 0) {
+    if constexpr (requires { Config::context_cache; }) {
+      static_assert(std::is_invocable_v<const Lambda&, Args...>,
+                    "Tasks caching their context must not modify their "
+                    "captures");
+      // Encoded on their own, thus a function can tell equal contexts apart
+      // without deserializing them, see `cached_receivable`
+      fast_binary_output_archive oar;
+      if constexpr (capture_count > 0) {
+        serialize_helper<fast_binary_output_archive, Lambda, 0, capture_count>(
+            oar, m_lambda);
+      }
+      ar(oar.take());
+    } else if constexpr (capture_count > 0) {
       serialize_helper<output_archive, Lambda, 0, capture_count>(ar, m_lambda);
     }
   }
@@ -173,15 +497,82 @@ public:
         function_identifier<Lambda, Args...>().str());
   }
 
+  auto max_retries() -> std::optional<unsigned int> override
+  {
+    if constexpr (requires { Config::max_retries; }) {
+      return Config::max_retries;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  auto threads() -> unsigned int override
+  {
+    if constexpr (requires { Config::threads; }) {
+      return Config::threads;
+    } else {
+      return 1;
+    }
+  }
+
+  auto cost() -> std::optional<unsigned int> override
+  {
+    if constexpr (requires { Config::cost; }) {
+      return Config::cost;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  auto speculative() -> bool override
+  {
+    if constexpr (requires { Config::speculative; }) {
+      return Config::speculative;
+    } else {
+      return false;
+    }
+  }
+
+  auto memoized() -> bool override
+  {
+    if constexpr (requires { Config::memoized; }) {
+      return Config::memoized;
+    } else {
+      return false;
+    }
+  }
+
+  auto target_type() const -> const std::type_info& override
+  {
+    return typeid(Lambda);
+  }
+
+  auto target() -> void* override
+  {
+    return &m_lambda;
+  }
+
   __attribute((entry)) __attribute((
       meta(Dispatcher::template meta_serializer<Config>::template serialize<
            function_identifier<Lambda, Args...>().size() + 1>(
           function_identifier<Lambda, Args...>())))) static auto
   main(int argc, char* argv[]) -> int
   {
-    return Dispatcher::template main<receivable_lambda<Lambda, Res, Args...>,
-                                     Res,
-                                     Args...>(argc, argv);
+    if constexpr (requires { Config::threads; }) {
+      thread_pool::set_default_threads(Config::threads);
+    }
+    if constexpr (requires { Config::remote_threshold; }) {
+      set_remote_threshold(Config::remote_threshold);
+    }
+    using receivable = receivable_lambda<Lambda, Res, Args...>;
+    if constexpr (requires { Config::context_cache; }) {
+      return Dispatcher::template main<
+          cached_receivable<receivable, Config::context_cache>,
+          Res,
+          Args...>(argc, argv);
+    } else {
+      return Dispatcher::template main<receivable, Res, Args...>(argc, argv);
+    }
   }
 
 private:
@@ -191,6 +582,12 @@ private:
 template<class Dispatcher, class Config = typename Dispatcher::default_config>
 struct lambda_task_factory
 {
+  /**
+   * @brief Whether graph nodes of the tasks may be fused, see
+   * `aws::with_fusion`.
+   */
+  constexpr static bool fusable = requires { requires Config::fusable; };
+
   template<class Lambda>
   static auto create(Lambda l)
   {
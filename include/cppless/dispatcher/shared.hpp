@@ -0,0 +1,342 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <typeindex>
+#include <utility>
+
+#include <boost/algorithm/hex.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/cereal.hpp>
+#include <cereal/types/string.hpp>
+#include <cppless/dispatcher/remote.hpp>
+#include <cppless/utils/crypto/wrappers.hpp>
+#include <cppless/utils/object_store.hpp>
+
+namespace cppless
+{
+
+namespace detail
+{
+
+/**
+ * @brief The keys this process stored already, by the generation of the
+ * default store they were stored in. Keys address contents, thus an object
+ * is never stored twice in the same store.
+ */
+class stored_blobs
+{
+public:
+  /**
+   * @brief Stores `encoded` under `key` unless it was stored already. Keys are
+   * only handed on once this returned, thus no function looks up an object
+   * before it is stored. Calls storing the same key wait for the first one,
+   * calls storing other keys upload concurrently.
+   */
+  auto store(const std::string& key, const std::string& encoded) -> void
+  {
+    auto [store, generation] = current_object_store();
+    std::pair<std::uint64_t, std::string> entry {generation, key};
+    std::unique_lock lock {m_mutex};
+    for (auto it = m_keys.find(entry); it != m_keys.end();
+         it = m_keys.find(entry))
+    {
+      if (it->second) {
+        return;
+      }
+      m_stored.wait(lock);
+    }
+    m_keys.emplace(entry, false);
+    lock.unlock();
+
+    try {
+      store->put(key, encoded);
+    } catch (...) {
+      // Another call may try again
+      lock.lock();
+      m_keys.erase(entry);
+      m_stored.notify_all();
+      throw;
+    }
+    lock.lock();
+    m_keys[entry] = true;
+    m_stored.notify_all();
+  }
+
+  /**
+   * @brief Whether `key` was stored in the current default store.
+   */
+  auto stored(const std::string& key) -> bool
+  {
+    auto generation = current_object_store().second;
+    std::scoped_lock lock {m_mutex};
+    auto it = m_keys.find({generation, key});
+    return it != m_keys.end() && it->second;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_stored;
+  // Whether the upload of a key finished, in flight otherwise
+  std::map<std::pair<std::uint64_t, std::string>, bool> m_keys;
+};
+
+inline auto stored_blobs_instance() -> stored_blobs&
+{
+  static stored_blobs blobs;
+  return blobs;
+}
+
+/**
+ * @brief The values fetched by this process, deserialized, by key and type.
+ * A function keeps them while its container is warm, the least recently
+ * used ones are evicted beyond the capacity, counted in encoded bytes.
+ */
+class blob_cache
+{
+public:
+  using key_type = std::pair<std::string, std::type_index>;
+
+  auto get(const key_type& key) -> std::shared_ptr<const void>
+  {
+    std::scoped_lock lock {m_mutex};
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+      return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->value;
+  }
+
+  auto put(const key_type& key,
+           std::shared_ptr<const void> value,
+           std::size_t size) -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    if (size > m_capacity || m_index.contains(key)) {
+      return;
+    }
+    m_entries.push_front({key, std::move(value), size});
+    m_index.emplace(key, m_entries.begin());
+    m_size += size;
+    evict();
+  }
+
+  auto set_capacity(std::size_t bytes) -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    m_capacity = bytes;
+    evict();
+  }
+
+private:
+  struct entry
+  {
+    key_type key;
+    std::shared_ptr<const void> value;
+    std::size_t size;
+  };
+
+  // Called with the mutex held
+  auto evict() -> void
+  {
+    while (m_size > m_capacity) {
+      auto& last = m_entries.back();
+      m_size -= last.size;
+      m_index.erase(last.key);
+      m_entries.pop_back();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::size_t m_capacity = 256UL << 20U;
+  std::size_t m_size = 0;
+  // Most recently used first
+  std::list<entry> m_entries;
+  std::map<key_type, std::list<entry>::iterator> m_index;
+};
+
+inline auto blob_cache_instance() -> blob_cache&
+{
+  static blob_cache cache;
+  return cache;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Sets the encoded bytes of `shared` values a process keeps after
+ * fetching them, 256 MiB by default.
+ */
+inline auto set_shared_cache_capacity(std::size_t bytes) -> void
+{
+  detail::blob_cache_instance().set_capacity(bytes);
+}
+
+/**
+ * @brief An immutable value passed to many invocations, e.g. a scene every
+ * tile of an image is rendered from. Like `remote`, it is serialized inline
+ * unless its encoding exceeds the remote threshold, but it is keyed by the
+ * hash of its encoding instead:
+ *
+ * - the host stores equal values once per store, however many copies or
+ *   instances it serializes, and encodes and hashes each instance once;
+ * - functions keep the values they fetched, deserialized, for the lifetime
+ *   of their container, thus warm invocations neither fetch nor deserialize
+ *   them again, see `set_shared_cache_capacity`.
+ *
+ * Objects are never removed from the store by the host, which assumes that
+ * an object it stored once is still there.
+ *
+ * @tparam T A type serializable with cereal
+ */
+template<class T>
+class shared
+{
+public:
+  shared()
+      : m_state(std::make_shared<state>())
+  {
+    m_state->value = std::make_shared<const T>();
+  }
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  shared(T value)
+      : m_state(std::make_shared<state>())
+  {
+    m_state->value = std::make_shared<const T>(std::move(value));
+  }
+
+  /**
+   * @brief The value, taken from the cache of the process or fetched from the
+   * object store unless it is present.
+   */
+  auto get() const -> const T&
+  {
+    std::scoped_lock lock {m_state->mutex};
+    if (!m_state->value) {
+      detail::blob_cache::key_type key {*m_state->key, typeid(T)};
+      auto& cache = detail::blob_cache_instance();
+      if (auto cached = cache.get(key)) {
+        m_state->value = std::static_pointer_cast<const T>(std::move(cached));
+      } else {
+        auto encoded = default_object_store().get(*m_state->key);
+        auto value = std::make_shared<T>();
+        {
+          std::stringstream ss {encoded};
+          cereal::BinaryInputArchive iar(ss);
+          iar(*value);
+        }
+        m_state->value = std::move(value);
+        cache.put(key, m_state->value, encoded.size());
+      }
+    }
+    return *m_state->value;
+  }
+
+  /**
+   * @brief Whether the value is passed by reference, i.e. has a key.
+   */
+  [[nodiscard]] auto stored() const -> bool
+  {
+    std::scoped_lock lock {m_state->mutex};
+    return m_state->key.has_value();
+  }
+
+  /**
+   * @brief The key of the value, the hex encoded SHA-256 of its encoding.
+   */
+  static auto key(const std::string& encoded) -> std::string
+  {
+    evp_md_ctx ctx;
+    ctx.update(encoded);
+    auto digest = ctx.final();
+
+    std::string key = "cppless-blob-";
+    boost::algorithm::hex_lower(digest, std::back_inserter(key));
+    return key;
+  }
+
+  template<class Archive>
+  void save(Archive& ar) const
+  {
+    std::scoped_lock lock {m_state->mutex};
+    auto threshold = remote_threshold();
+    bool below = m_state->encoded_size && *m_state->encoded_size <= threshold;
+    auto& blobs = detail::stored_blobs_instance();
+    if (m_state->key) {
+      // The default store may have changed since the key was stored. Values
+      // received by reference are left to the store they came from.
+      if (m_state->value && !blobs.stored(*m_state->key)) {
+        blobs.store(*m_state->key, encode());
+      }
+    } else if (!below && threshold != std::numeric_limits<std::size_t>::max())
+    {
+      auto encoded = encode();
+      m_state->encoded_size = encoded.size();
+      if (encoded.size() > threshold) {
+        auto key = shared::key(encoded);
+        blobs.store(key, encoded);
+        m_state->key = std::move(key);
+      }
+    }
+    bool by_reference = m_state->key.has_value();
+    ar(cereal::make_nvp("by_reference", by_reference));
+    if (by_reference) {
+      ar(cereal::make_nvp("key", *m_state->key));
+    } else {
+      ar(cereal::make_nvp("value", *m_state->value));
+    }
+  }
+
+  template<class Archive>
+  void load(Archive& ar)
+  {
+    auto loaded = std::make_shared<state>();
+    bool by_reference = false;
+    ar(cereal::make_nvp("by_reference", by_reference));
+    if (by_reference) {
+      ar(cereal::make_nvp("key", loaded->key.emplace()));
+    } else {
+      auto value = std::make_shared<T>();
+      ar(cereal::make_nvp("value", *value));
+      loaded->value = std::move(value);
+    }
+    m_state = std::move(loaded);
+  }
+
+private:
+  // Called with the mutex of the state held
+  auto encode() const -> std::string
+  {
+    std::stringstream ss;
+    {
+      cereal::BinaryOutputArchive oar(ss);
+      oar(*m_state->value);
+    }
+    return ss.str();
+  }
+
+  struct state
+  {
+    std::mutex mutex;
+    std::shared_ptr<const T> value;
+    std::optional<std::string> key;
+    // Known once the value was encoded, values are immutable
+    std::optional<std::size_t> encoded_size;
+  };
+
+  std::shared_ptr<state> m_state;
+};
+
+}  // namespace cppless
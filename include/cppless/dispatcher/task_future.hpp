@@ -0,0 +1,284 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cppless/utils/empty.hpp>
+
+namespace cppless
+{
+
+template<class Res>
+class task_future;
+
+/**
+ * @brief Runs at most one handler of a dispatcher instance, waiting no longer
+ * than the deadline for one to become ready. Futures of instances without an
+ * IO thread of their own are completed by calling it.
+ */
+using future_driver =
+    std::function<void(std::chrono::steady_clock::time_point)>;
+
+namespace detail
+{
+
+/**
+ * @brief The state shared by the futures of a task and the dispatcher
+ * instance completing it.
+ */
+template<class Res>
+struct future_state
+{
+  using value_type = std::conditional_t<std::is_void_v<Res>, empty, Res>;
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Marks the state as ready, `value` has to be written beforehand.
+   * Continuations run on the calling thread.
+   */
+  auto complete(std::exception_ptr e = nullptr) -> void
+  {
+    std::vector<std::function<void()>> ready_continuations;
+    {
+      std::scoped_lock lock(mutex);
+      error = std::move(e);
+      ready = true;
+      ready_continuations.swap(continuations);
+    }
+    cv.notify_all();
+    for (auto& continuation : ready_continuations) {
+      continuation();
+    }
+  }
+
+  /**
+   * @brief Registers `continuation` unless the state is ready already.
+   *
+   * @return Whether the continuation was registered
+   */
+  auto try_on_ready(std::function<void()>& continuation) -> bool
+  {
+    std::scoped_lock lock(mutex);
+    if (ready) {
+      return false;
+    }
+    continuations.push_back(std::move(continuation));
+    return true;
+  }
+
+  auto on_ready(std::function<void()> continuation) -> void
+  {
+    if (!try_on_ready(continuation)) {
+      continuation();
+    }
+  }
+
+  /**
+   * @brief Waits until the state is ready or `deadline` has passed. Without
+   * a `drive` function, another thread has to complete the state.
+   */
+  auto wait_until(clock::time_point deadline) -> bool
+  {
+    std::unique_lock lock(mutex);
+    while (!ready && clock::now() < deadline) {
+      if (drive) {
+        lock.unlock();
+        drive(deadline);
+        lock.lock();
+      } else if (deadline == clock::time_point::max()) {
+        cv.wait(lock);
+      } else {
+        cv.wait_until(lock, deadline);
+      }
+    }
+    return ready;
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool ready = false;
+  value_type value {};
+  std::exception_ptr error;
+  std::vector<std::function<void()>> continuations;
+  future_driver drive;
+};
+
+template<class Fn, class Res>
+struct continuation_result
+{
+  using type = std::invoke_result_t<Fn, Res&>;
+};
+
+template<class Fn>
+struct continuation_result<Fn, void>
+{
+  using type = std::invoke_result_t<Fn>;
+};
+
+}  // namespace detail
+
+/**
+ * @brief The result of a task dispatched with `dispatch_async`. Copies refer
+ * to the same result.
+ *
+ * Dispatcher instances running their own IO thread complete the future on
+ * that thread, any thread may wait for it. Other instances are driven by the
+ * thread waiting for the future, which must not outlive the instance.
+ *
+ * @tparam Res The return type of the task
+ */
+template<class Res>
+class task_future
+{
+public:
+  using state_type = detail::future_state<Res>;
+
+  task_future() = default;
+
+  explicit task_future(std::shared_ptr<state_type> state)
+      : m_state(std::move(state))
+  {
+  }
+
+  [[nodiscard]] auto valid() const -> bool
+  {
+    return m_state != nullptr;
+  }
+
+  [[nodiscard]] auto ready() const -> bool
+  {
+    std::scoped_lock lock(state().mutex);
+    return state().ready;
+  }
+
+  auto wait() const -> void
+  {
+    state().wait_until(state_type::clock::time_point::max());
+  }
+
+  /**
+   * @brief Waits for at most `timeout`.
+   *
+   * @return Whether the future is ready
+   */
+  template<class Rep, class Period>
+  auto wait_for(std::chrono::duration<Rep, Period> timeout) const -> bool
+  {
+    return state().wait_until(
+        state_type::clock::now()
+        + std::chrono::ceil<typename state_type::clock::duration>(timeout));
+  }
+
+  /**
+   * @brief Waits for the task and returns its result, or rethrows its error,
+   * e.g. `invocation_failed`.
+   */
+  auto get() const -> std::add_lvalue_reference_t<Res>
+  {
+    wait();
+    if (state().error) {
+      std::rethrow_exception(state().error);
+    }
+    if constexpr (!std::is_void_v<Res>) {
+      return state().value;
+    }
+  }
+
+  /**
+   * @brief Calls `fn` with the result once the task has finished. Errors skip
+   * `fn` and are passed on to the returned future, as are exceptions thrown
+   * by `fn`.
+   *
+   * @return A future for the result of `fn`
+   */
+  template<class Fn>
+  auto then(Fn fn) const
+      -> task_future<typename detail::continuation_result<Fn, Res>::type>
+  {
+    using next_res = typename detail::continuation_result<Fn, Res>::type;
+    auto next = std::make_shared<detail::future_state<next_res>>();
+    next->drive = state().drive;
+    state().on_ready(
+        [prev = m_state, next, fn = std::move(fn)]() mutable
+        {
+          if (prev->error) {
+            next->complete(prev->error);
+            return;
+          }
+          try {
+            if constexpr (std::is_void_v<next_res>) {
+              invoke(fn, *prev);
+            } else {
+              next->value = invoke(fn, *prev);
+            }
+          } catch (...) {
+            next->complete(std::current_exception());
+            return;
+          }
+          next->complete();
+        });
+    return task_future<next_res> {std::move(next)};
+  }
+
+  /**
+   * @brief Suspends the awaiting coroutine until the task has finished. It is
+   * resumed on the thread completing the future.
+   */
+  auto operator co_await() const
+  {
+    struct awaiter
+    {
+      std::shared_ptr<state_type> state;
+
+      [[nodiscard]] auto await_ready() const -> bool
+      {
+        std::scoped_lock lock(state->mutex);
+        return state->ready;
+      }
+
+      auto await_suspend(std::coroutine_handle<> handle) -> bool
+      {
+        std::function<void()> resume = [handle] { handle.resume(); };
+        return state->try_on_ready(resume);
+      }
+
+      auto await_resume() -> std::add_lvalue_reference_t<Res>
+      {
+        return task_future {state}.get();
+      }
+    };
+    return awaiter {m_state};
+  }
+
+private:
+  template<class Fn>
+  static auto invoke(Fn& fn, state_type& state)
+  {
+    if constexpr (std::is_void_v<Res>) {
+      return fn();
+    } else {
+      return fn(state.value);
+    }
+  }
+
+  auto state() const -> state_type&
+  {
+    if (!m_state) {
+      throw std::runtime_error("task_future has no state");
+    }
+    return *m_state;
+  }
+
+  std::shared_ptr<state_type> m_state;
+};
+
+}  // namespace cppless
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace cppless::graph
+{
+
+/**
+ * @brief The edges of a graph in compressed sparse row form: the successors
+ * of node `id` are stored contiguously in `targets`, from `offsets[id]` up to
+ * `offsets[id + 1]`.
+ */
+class adjacency
+{
+public:
+  adjacency()
+      : m_offsets {0}
+  {
+  }
+
+  /**
+   * @brief Builds the adjacency of a graph given as the successors of every
+   * node.
+   */
+  explicit adjacency(const std::vector<std::vector<std::size_t>>& successors)
+      : adjacency()
+  {
+    reserve(successors.size(), 0);
+    for (const auto& node_successors : successors) {
+      for (auto successor : node_successors) {
+        targets().push_back(successor);
+      }
+      close_node();
+    }
+  }
+
+  auto reserve(std::size_t nodes, std::size_t edges) -> void
+  {
+    m_offsets.reserve(nodes + 1);
+    m_targets.reserve(edges);
+  }
+
+  /**
+   * @brief The targets, to which the successors of the next node are
+   * appended before it is closed.
+   */
+  auto targets() -> std::vector<std::size_t>&
+  {
+    return m_targets;
+  }
+
+  /**
+   * @brief Ends the successors of the next node.
+   */
+  auto close_node() -> void
+  {
+    m_offsets.push_back(m_targets.size());
+  }
+
+  [[nodiscard]] auto successors(std::size_t id) const
+      -> std::span<const std::size_t>
+  {
+    return {m_targets.data() + m_offsets[id],
+            m_targets.data() + m_offsets[id + 1]};
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_offsets.size() - 1;
+  }
+
+  [[nodiscard]] auto edge_count() const -> std::size_t
+  {
+    return m_targets.size();
+  }
+
+private:
+  std::vector<std::size_t> m_offsets;
+  std::vector<std::size_t> m_targets;
+};
+
+}  // namespace cppless::graph
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cppless::executor
+{
+
+/**
+ * @brief An append-only log of the results of finished graph nodes, from
+ * which a host resumes a graph after it crashed, see
+ * `host_controller_options::checkpoint`.
+ *
+ * The log starts with a magic number, followed by records of a node id, the
+ * size of the result, a checksum and the serialized result. Existing records
+ * are read through a memory mapping when the log is opened. A record torn by
+ * a crash, and anything after it, is dropped. Appended records are buffered
+ * and written out by a background thread once `flush_interval` has passed
+ * since the last write, thus a crash loses at most the results of that
+ * interval, even if no further record is appended.
+ */
+class checkpoint_log
+{
+public:
+  explicit checkpoint_log(
+      const std::filesystem::path& path,
+      std::chrono::milliseconds flush_interval = std::chrono::seconds(1))
+      : m_flush_interval(flush_interval)
+      , m_last_flush(std::chrono::steady_clock::now())
+  {
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);  // NOLINT
+    if (m_fd < 0) {
+      throw std::runtime_error("Could not open checkpoint log at "
+                               + path.string());
+    }
+    try {
+      load();
+    } catch (...) {
+      close();
+      throw;
+    }
+    if (m_flush_interval.count() > 0) {
+      m_flusher = std::thread([this] { flush_periodically(); });
+    }
+  }
+
+  checkpoint_log(const checkpoint_log&) = delete;
+  auto operator=(const checkpoint_log&) -> checkpoint_log& = delete;
+  checkpoint_log(checkpoint_log&&) = delete;
+  auto operator=(checkpoint_log&&) -> checkpoint_log& = delete;
+
+  ~checkpoint_log()
+  {
+    if (m_flusher.joinable()) {
+      {
+        std::scoped_lock lock {m_mutex};
+        m_stopping = true;
+      }
+      m_flush_cv.notify_one();
+      m_flusher.join();
+    }
+    try {
+      flush();
+    } catch (...) {  // NOLINT
+      // The buffered records are lost, as if the host crashed
+    }
+    close();
+  }
+
+  /**
+   * @brief Associates the log with a graph of `node_count` nodes. A log
+   * written for a graph of a different size is rejected, as its node ids
+   * would refer to other nodes.
+   */
+  auto begin(std::size_t node_count) -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    if (m_node_count) {
+      if (*m_node_count != node_count) {
+        throw std::runtime_error(
+            "The checkpoint log was written for a different graph");
+      }
+      return;
+    }
+    m_node_count = node_count;
+    std::string count(sizeof(std::uint64_t), '\0');
+    auto value = static_cast<std::uint64_t>(node_count);
+    std::memcpy(count.data(), &value, sizeof(value));
+    append_record(graph_record, count);
+    write_buffer();
+  }
+
+  /**
+   * @brief The serialized result of the node `id`, if the log holds it. The
+   * view stays valid as long as the log.
+   */
+  [[nodiscard]] auto result(std::size_t id) const
+      -> std::optional<std::string_view>
+  {
+    auto it = m_results.find(id);
+    if (it == m_results.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  /**
+   * @brief The number of results read when the log was opened.
+   */
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_results.size();
+  }
+
+  /**
+   * @brief Appends the serialized result of the node `id`. May be called
+   * from multiple threads.
+   */
+  auto append(std::size_t id, std::string_view result) -> void
+  {
+    std::unique_lock lock {m_mutex};
+    bool was_empty = m_buffer.empty();
+    append_record(id, result);
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_last_flush >= m_flush_interval) {
+      write_buffer();
+    } else if (was_empty) {
+      // The flusher sleeps until records are buffered
+      lock.unlock();
+      m_flush_cv.notify_one();
+    }
+  }
+
+  /**
+   * @brief Writes the buffered records and waits until they are on disk.
+   */
+  auto flush() -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    write_buffer();
+    ::fdatasync(m_fd);
+  }
+
+private:
+  // Holds the number of nodes of the graph instead of a result
+  static constexpr std::uint64_t graph_record =
+      std::numeric_limits<std::uint64_t>::max();
+  static constexpr std::array<char, 8> magic = {
+      'c', 'p', 'l', 's', 'c', 'k', 'p', '1'};
+
+  struct record_header
+  {
+    std::uint64_t id;
+    std::uint64_t size;
+    std::uint32_t checksum;
+  };
+  static constexpr std::size_t header_size = 2 * sizeof(std::uint64_t)
+      + sizeof(std::uint32_t);
+
+  // FNV-1a, detects records which were only partly written
+  static auto checksum(std::uint64_t id, std::string_view data)
+      -> std::uint32_t
+  {
+    std::uint32_t hash = 2166136261U;
+    auto add = [&hash](const char* bytes, std::size_t size)
+    {
+      for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(bytes[i]);  // NOLINT
+        hash *= 16777619U;
+      }
+    };
+    add(reinterpret_cast<const char*>(&id), sizeof(id));  // NOLINT
+    add(data.data(), data.size());
+    return hash;
+  }
+
+  auto load() -> void
+  {
+    struct stat info
+    {
+    };
+    if (::fstat(m_fd, &info) != 0) {
+      throw std::runtime_error("Could not read checkpoint log");
+    }
+    auto size = static_cast<std::size_t>(info.st_size);
+    if (size < magic.size()) {
+      // New, or torn before the magic number was complete
+      if (::ftruncate(m_fd, 0) != 0) {
+        throw std::runtime_error("Could not truncate checkpoint log");
+      }
+      m_buffer.assign(magic.begin(), magic.end());
+      write_buffer();
+      return;
+    }
+
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (mapping == MAP_FAILED) {  // NOLINT
+      throw std::runtime_error("Could not map checkpoint log");
+    }
+    m_mapping = static_cast<const char*>(mapping);
+    m_mapping_size = size;
+    if (std::memcmp(m_mapping, magic.data(), magic.size()) != 0) {
+      throw std::runtime_error("Not a checkpoint log");
+    }
+
+    std::size_t offset = magic.size();
+    while (size - offset >= header_size) {
+      record_header header {};
+      std::memcpy(&header.id, m_mapping + offset, sizeof(header.id));
+      std::memcpy(&header.size,
+                  m_mapping + offset + sizeof(header.id),
+                  sizeof(header.size));
+      std::memcpy(&header.checksum,
+                  m_mapping + offset + 2 * sizeof(std::uint64_t),
+                  sizeof(header.checksum));
+      if (header.size > size - offset - header_size) {
+        break;
+      }
+      std::string_view data {m_mapping + offset + header_size, header.size};
+      if (checksum(header.id, data) != header.checksum) {
+        break;
+      }
+      if (header.id == graph_record) {
+        std::uint64_t count = 0;
+        if (data.size() == sizeof(count)) {
+          std::memcpy(&count, data.data(), sizeof(count));
+          m_node_count = count;
+        }
+      } else {
+        m_results[header.id] = data;
+      }
+      offset += header_size + header.size;
+    }
+
+    // Records appended from now on follow the last complete one
+    if (offset != size && ::ftruncate(m_fd, static_cast<off_t>(offset)) != 0)
+    {
+      throw std::runtime_error("Could not truncate checkpoint log");
+    }
+    ::lseek(m_fd, static_cast<off_t>(offset), SEEK_SET);
+  }
+
+  auto append_record(std::uint64_t id, std::string_view data) -> void
+  {
+    std::uint64_t size = data.size();
+    std::uint32_t sum = checksum(id, data);
+    auto at = m_buffer.size();
+    m_buffer.resize(at + header_size);
+    std::memcpy(m_buffer.data() + at, &id, sizeof(id));
+    std::memcpy(m_buffer.data() + at + sizeof(id), &size, sizeof(size));
+    std::memcpy(m_buffer.data() + at + 2 * sizeof(std::uint64_t),
+                &sum,
+                sizeof(sum));
+    m_buffer.append(data);
+  }
+
+  auto write_buffer() -> void
+  {
+    std::size_t done = 0;
+    while (done < m_buffer.size()) {
+      auto n = ::write(m_fd,
+                       m_buffer.data() + done,  // NOLINT
+                       m_buffer.size() - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::runtime_error("Failed to write checkpoint log");
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    m_buffer.clear();
+    m_last_flush = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * @brief Runs on `m_flusher`, writes the buffered records once they are
+   * `m_flush_interval` old.
+   */
+  auto flush_periodically() -> void
+  {
+    std::unique_lock lock {m_mutex};
+    while (!m_stopping) {
+      if (m_buffer.empty()) {
+        m_flush_cv.wait(lock);
+        continue;
+      }
+      auto deadline = m_last_flush + m_flush_interval;
+      if (std::chrono::steady_clock::now() < deadline) {
+        m_flush_cv.wait_until(lock, deadline);
+        continue;
+      }
+      try {
+        write_buffer();
+      } catch (...) {  // NOLINT
+        // Retried after another interval, the next `flush` reports it
+        m_last_flush = std::chrono::steady_clock::now();
+      }
+    }
+  }
+
+  auto close() -> void
+  {
+    if (m_mapping) {
+      ::munmap(const_cast<char*>(m_mapping), m_mapping_size);  // NOLINT
+    }
+    ::close(m_fd);
+  }
+
+  int m_fd = -1;
+  const char* m_mapping = nullptr;
+  std::size_t m_mapping_size = 0;
+  std::unordered_map<std::size_t, std::string_view> m_results;
+  std::optional<std::size_t> m_node_count;
+
+  std::mutex m_mutex;
+  std::string m_buffer;
+  std::chrono::milliseconds m_flush_interval;
+  std::chrono::steady_clock::time_point m_last_flush;
+  std::condition_variable m_flush_cv;
+  bool m_stopping = false;
+  std::thread m_flusher;
+};
+
+}  // namespace cppless::executor
@@ -2,6 +2,7 @@
 
 #include <type_traits>
 
+#include <cppless/graph/fusion.hpp>
 #include <cppless/graph/graph.hpp>
 #include <cppless/utils/apply.hpp>
 #include <cppless/utils/tuple.hpp>
@@ -95,6 +96,49 @@ auto then_connect(
   }
 }
 
+/**
+ * @brief Creates the node running the task created by `Factory` from the
+ * lambda passed last, connected to the senders passed before it. If the
+ * factory is fusable, e.g. for tasks configured `with_fusion`, the node knows
+ * the tasks of its fusable senders, see `graph::builder_core::fuse`.
+ */
+template<class Factory, class... Args>
+auto then_with_factory(Args... args)
+{
+  return tail_apply(
+      []<class InputTask, class FirstSenderType, class... RestSenderTypes>(
+          InputTask input_thing,
+          std::shared_ptr<FirstSenderType> first_sender,
+          RestSenderTypes... rest_senders) {
+        using executor = typename FirstSenderType::executor;
+        auto task = Factory::create(input_thing);
+        auto builder = first_sender->builder();
+        if constexpr (requires { requires Factory::fusable; }) {
+          using node_type = graph::fusable_task_node<
+              executor,
+              decltype(task),
+              typename graph::fusion_tree<
+                  Factory,
+                  InputTask,
+                  FirstSenderType,
+                  typename RestSenderTypes::element_type...>::type>;
+          auto input_node =
+              builder->template create_node<decltype(task), node_type>(task);
+          input_node->set_predecessors(
+              {first_sender->id(), rest_senders->id()...});
+          std::shared_ptr<graph::task_node<executor, decltype(task)>>
+              connected = input_node;
+          then_connect<0, executor>(connected, first_sender, rest_senders...);
+          return input_node;
+        } else {
+          auto input_node = builder->create_node(task);
+          then_connect<0, executor>(input_node, first_sender, rest_senders...);
+          return input_node;
+        }
+      },
+      std::forward<Args>(args)...);
+}
+
 template<class Config, class... Args>
 auto then(Args... args)
 {
@@ -104,13 +148,9 @@ auto then(Args... args)
           std::shared_ptr<FirstSenderType> first_sender,
           RestSenderTypes... rest_senders) {
         using executor = typename FirstSenderType::executor;
-        auto task =
-            executor::template lambda_factory<Config>::create(input_thing);
-
-        auto builder = first_sender->builder();
-        auto input_node = builder->create_node(task);
-        then_connect<0, executor>(input_node, first_sender, rest_senders...);
-        return input_node;
+        return then_with_factory<
+            typename executor::template lambda_factory<Config>>(
+            first_sender, rest_senders..., input_thing);
       },
       std::forward<Args>(args)...);
 }
@@ -124,14 +164,33 @@ auto then(Args... args)
           std::shared_ptr<FirstSenderType> first_sender,
           RestSenderTypes... rest_senders) {
         using executor = typename FirstSenderType::executor;
-        auto task = executor::default_lambda_factory::create(input_thing);
-
-        auto builder = first_sender->builder();
-        auto input_node = builder->create_node(task);
-        then_connect<0, executor>(input_node, first_sender, rest_senders...);
-        return input_node;
+        return then_with_factory<typename executor::default_lambda_factory>(
+            first_sender, rest_senders..., input_thing);
       },
       std::forward<Args>(args)...);
 }
 
+/**
+ * @brief Creates a node which calls `callback` on the host with the result of
+ * `sender` once it arrived, see `graph::basic_expansion_node`. The callback
+ * receives the expansion node, which nodes spawned by it depend on, e.g.
+ * `then(node, child_task)`, and may expand the spawned nodes in turn. Thus the
+ * graph only holds the part expanded so far, and branches the callback
+ * decides against are never created.
+ */
+template<class SenderType, class Callback>
+auto expand(std::shared_ptr<SenderType> sender, Callback callback)
+{
+  using arg_type = typename SenderType::sending_type;
+  static_assert(!std::is_void_v<arg_type>,
+                "Only the results of senders can be expanded");
+
+  auto builder = sender->builder();
+  auto node =
+      builder->template create_expansion_node<arg_type>(std::move(callback));
+  node->increment_dependency_count();
+  sender->add_successor(node->template slot<0>());
+  return node;
+}
+
 }  // namespace cppless::execution
\ No newline at end of file
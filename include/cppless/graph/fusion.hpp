@@ -0,0 +1,584 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cppless/detail/deduction.hpp>
+#include <cppless/dispatcher/sendable.hpp>
+#include <cppless/graph/graph.hpp>
+
+namespace cppless::graph
+{
+
+/**
+ * @brief The maximum number of tasks fused into one invocation along a chain.
+ * Every node whose fusion tree is smaller than this extends the trees of its
+ * predecessors, otherwise it only fuses with its direct predecessors.
+ */
+constexpr std::size_t max_fused_stages = 8;
+
+/**
+ * @brief An input of a fusion tree which is received from outside of the tree,
+ * thus becomes an argument of the fused task.
+ *
+ * @tparam T - The type of the input, void for inputs which only order tasks
+ */
+template<class T>
+struct fused_input
+{
+};
+
+/**
+ * @brief A task of a fusion tree: the task created by `Factory` from `Lambda`,
+ * whose arguments are the results of `Inputs`, in the order of the senders of
+ * its node. Every input is either a `fused_input` or a `fused_stage` itself.
+ */
+template<class Factory, class Lambda, class... Inputs>
+struct fused_stage
+{
+};
+
+/**
+ * @brief Holds a lambda of a fused task and serializes its captures.
+ */
+template<class Lambda>
+class fused_lambda
+{
+public:
+  explicit fused_lambda(const Lambda& l)
+      : m_lambda(l)
+  {
+  }
+
+  template<class Archive>
+  auto serialize(Archive& ar) -> void
+  {
+    constexpr int capture_count = Lambda::capture_count();
+    if constexpr (capture_count > 0) {
+      serialize_helper<Archive, Lambda, 0, capture_count>(ar, m_lambda);
+    }
+  }
+
+  template<class... Args>
+  auto operator()(Args&&... args)
+  {
+    return m_lambda(std::forward<Args>(args)...);
+  }
+
+private:
+  Lambda m_lambda;
+};
+
+namespace detail
+{
+
+template<class Signature>
+struct signature_traits;
+
+template<class Res, class... Args>
+struct signature_traits<Res(Args...)>
+{
+  using res = Res;
+};
+
+template<class Stage>
+struct stage_traits;
+
+template<class T>
+struct stage_traits<fused_input<T>>
+{
+  using res = T;
+  // The arguments of the fused task this input becomes
+  using args =
+      std::conditional_t<std::is_void_v<T>, std::tuple<>, std::tuple<T>>;
+  using storage = std::tuple<>;
+  using shallow = fused_input<T>;
+  static constexpr std::size_t stages = 0;
+};
+
+template<class Factory, class Lambda, class... Inputs>
+struct stage_traits<fused_stage<Factory, Lambda, Inputs...>>
+{
+  using signature = typename cppless::detail::deduce_function<decltype(
+      &Lambda::operator())>::type;
+  using res = typename signature_traits<signature>::res;
+  using args = decltype(std::tuple_cat(
+      std::declval<typename stage_traits<Inputs>::args>()...));
+  using storage = std::tuple<fused_lambda<Lambda>,
+                             typename stage_traits<Inputs>::storage...>;
+  // The stage without any of its predecessors
+  using shallow =
+      fused_stage<Factory,
+                  Lambda,
+                  fused_input<typename stage_traits<Inputs>::res>...>;
+  // The stage with its direct predecessors only
+  using direct =
+      fused_stage<Factory, Lambda, typename stage_traits<Inputs>::shallow...>;
+  static constexpr std::size_t stages =
+      1 + (stage_traits<Inputs>::stages + ... + 0);
+};
+
+/**
+ * @brief The position of the `I`-th input among the arguments of the fused
+ * task, relative to the first argument of its stage.
+ */
+template<std::size_t I, class... Inputs>
+constexpr auto input_offset() -> std::size_t
+{
+  constexpr std::array<std::size_t, sizeof...(Inputs)> sizes {
+      std::tuple_size_v<typename stage_traits<Inputs>::args>...};
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < I; i++) {
+    offset += sizes[i];
+  }
+  return offset;
+}
+
+/**
+ * @brief The number of inputs before the `I`-th one whose type is void if
+ * `Void`, respectively not void otherwise, thus the index of its slot among
+ * the empty respectively the typed slots of the node.
+ */
+template<std::size_t I, bool Void, class... Inputs>
+constexpr auto slot_index() -> std::size_t
+{
+  constexpr std::array<bool, sizeof...(Inputs)> is_void {
+      std::is_void_v<typename stage_traits<Inputs>::res>...};
+  std::size_t index = 0;
+  for (std::size_t i = 0; i < I; i++) {
+    if (is_void[i] == Void) {
+      index++;
+    }
+  }
+  return index;
+}
+
+/**
+ * @brief Evaluates a stage within the fused task, `Offset` is the position of
+ * its first argument. The result is wrapped in a tuple, empty if it is void.
+ */
+template<class Stage, std::size_t Offset>
+struct stage_evaluator;
+
+template<class T, std::size_t Offset>
+struct stage_evaluator<fused_input<T>, Offset>
+{
+  template<class Args>
+  static auto evaluate(std::tuple<>& /*storage*/, Args& args)
+      -> std::conditional_t<std::is_void_v<T>, std::tuple<>, std::tuple<T>>
+  {
+    if constexpr (std::is_void_v<T>) {
+      return {};
+    } else {
+      return std::tuple<T> {std::move(std::get<Offset>(args))};
+    }
+  }
+};
+
+template<class Factory, class Lambda, class... Inputs, std::size_t Offset>
+struct stage_evaluator<fused_stage<Factory, Lambda, Inputs...>, Offset>
+{
+  using traits = stage_traits<fused_stage<Factory, Lambda, Inputs...>>;
+  using res = typename traits::res;
+
+  template<class Args>
+  static auto evaluate(typename traits::storage& storage, Args& args)
+      -> std::conditional_t<std::is_void_v<res>, std::tuple<>, std::tuple<res>>
+  {
+    return evaluate(storage, args, std::index_sequence_for<Inputs...> {});
+  }
+
+private:
+  template<class Args, std::size_t... Is>
+  static auto evaluate(typename traits::storage& storage,
+                       Args& args,
+                       std::index_sequence<Is...> /*unused*/)
+      -> std::conditional_t<std::is_void_v<res>, std::tuple<>, std::tuple<res>>
+  {
+    // The predecessors run in the order of the senders, which braced
+    // initialization guarantees
+    std::tuple<decltype(stage_evaluator<
+                        Inputs,
+                        Offset + input_offset<Is, Inputs...>()>::
+                            evaluate(std::get<Is + 1>(storage), args))...>
+        results {stage_evaluator<Inputs,
+                                 Offset + input_offset<Is, Inputs...>()>::
+                     evaluate(std::get<Is + 1>(storage), args)...};
+    auto stage_args = std::apply([](auto&... r)
+                                 { return std::tuple_cat(std::move(r)...); },
+                                 results);
+    auto& lambda = std::get<0>(storage);
+    if constexpr (std::is_void_v<res>) {
+      std::apply(lambda, std::move(stage_args));
+      return {};
+    } else {
+      return std::tuple<res> {std::apply(lambda, std::move(stage_args))};
+    }
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief The task of a fused node, runs all tasks of the fusion tree `Stage`
+ * and returns the result of its root. Like a lambda expression, it exposes its
+ * captures to be serialized, which are the captures of all fused lambdas.
+ */
+template<class Stage, class Args = typename detail::stage_traits<Stage>::args>
+class fused_task;
+
+template<class Stage, class... Args>
+class fused_task<Stage, std::tuple<Args...>>
+{
+  using traits = detail::stage_traits<Stage>;
+
+public:
+  using storage = typename traits::storage;
+  using res = typename traits::res;
+
+  explicit fused_task(storage stages)
+      : m_stages(std::move(stages))
+  {
+  }
+
+  static constexpr auto capture_count() -> int
+  {
+    return 1;
+  }
+
+  template<int I>
+  auto capture() -> storage&
+  {
+    return m_stages;
+  }
+
+  auto operator()(Args... args) -> res
+  {
+    auto arg_values = std::forward_as_tuple(args...);
+    if constexpr (std::is_void_v<res>) {
+      detail::stage_evaluator<Stage, 0>::evaluate(m_stages, arg_values);
+    } else {
+      return std::get<0>(
+          detail::stage_evaluator<Stage, 0>::evaluate(m_stages, arg_values));
+    }
+  }
+
+private:
+  storage m_stages;
+};
+
+/**
+ * @brief A task node which remembers the nodes it is connected to, thus can
+ * be replaced together with them, see `fusable_task_node`.
+ */
+template<class Executor, class Task>
+class basic_fusable_task_node : public task_node<Executor, Task>
+{
+public:
+  basic_fusable_task_node(std::size_t id,
+                          std::weak_ptr<builder_core<Executor>> builder,
+                          std::optional<tracing_span_ref> span,
+                          Task& task)
+      : node_core<Executor>(id, builder, span)
+      , task_node<Executor, Task>(id, builder, span, task)
+  {
+  }
+
+  /**
+   * @brief The ids of the senders of the node, in the order they were passed
+   * to `then`.
+   */
+  [[nodiscard]] auto predecessors() const -> const std::vector<std::size_t>&
+  {
+    return m_predecessors;
+  }
+
+  auto set_predecessors(std::vector<std::size_t> predecessors) -> void
+  {
+    m_predecessors = std::move(predecessors);
+  }
+
+private:
+  std::vector<std::size_t> m_predecessors;
+};
+
+namespace detail
+{
+
+/**
+ * @brief Applies the fusion tree `Stage` rooted at a node to the graph.
+ */
+template<class Executor, class Stage>
+struct stage_fusion;
+
+template<class Executor, class T>
+struct stage_fusion<Executor, fused_input<T>>
+{
+};
+
+template<class Executor, class Factory, class Lambda, class... Inputs>
+struct stage_fusion<Executor, fused_stage<Factory, Lambda, Inputs...>>
+{
+  using stage = fused_stage<Factory, Lambda, Inputs...>;
+  using traits = stage_traits<stage>;
+  using node_type = basic_fusable_task_node<
+      Executor,
+      decltype(Factory::create(std::declval<Lambda>()))>;
+
+  /**
+   * @brief Whether the nodes of all fused predecessors of `node` can be
+   * replaced, their ids are appended to `ids`.
+   */
+  static auto collect(builder_core<Executor>& builder,
+                      const std::vector<std::size_t>& predecessors,
+                      std::vector<std::size_t>& ids) -> bool
+  {
+    return collect(
+        builder, predecessors, ids, std::index_sequence_for<Inputs...> {});
+  }
+
+  /**
+   * @brief Copies the lambdas of the tree rooted at `node`.
+   */
+  static auto stages(builder_core<Executor>& builder, node_type& node) ->
+      typename traits::storage
+  {
+    return stages(builder, node, std::index_sequence_for<Inputs...> {});
+  }
+
+  /**
+   * @brief Moves the slots receiving the inputs of the tree rooted at `node`
+   * to `fused`, `Offset` is the position of the first argument of the stage.
+   * The edges within the tree are removed.
+   */
+  template<std::size_t Offset, class Fused>
+  static auto adopt_inputs(builder_core<Executor>& builder,
+                           node_type& node,
+                           Fused& fused) -> void
+  {
+    adopt_inputs<Offset>(
+        builder, node, fused, std::index_sequence_for<Inputs...> {});
+  }
+
+  /**
+   * @brief Replaces the tree rooted at `node` by a single node.
+   *
+   * @return The ids of the replaced nodes, or nothing if a predecessor is
+   * observed
+   */
+  static auto apply(builder_core<Executor>& builder, node_type& node)
+      -> std::vector<std::size_t>
+  {
+    std::vector<std::size_t> ids {node.id()};
+    if (!collect(builder, node.predecessors(), ids)) {
+      return {};
+    }
+
+    fused_task<stage> composite {stages(builder, node)};
+    auto task = Factory::create(composite);
+    auto fused = builder.create_node(task);
+    adopt_inputs<0>(builder, node, *fused);
+    fused->successors() = std::move(node.successors());
+    node.successors().clear();
+    if constexpr (!std::is_void_v<typename traits::res>) {
+      fused->future() = node.future();
+    }
+    return ids;
+  }
+
+private:
+  template<class Input>
+  static auto node_of(builder_core<Executor>& builder, std::size_t id)
+      -> std::shared_ptr<typename stage_fusion<Executor, Input>::node_type>
+  {
+    return std::dynamic_pointer_cast<
+        typename stage_fusion<Executor, Input>::node_type>(builder.node(id));
+  }
+
+  template<std::size_t... Is>
+  static auto collect(builder_core<Executor>& builder,
+                      const std::vector<std::size_t>& predecessors,
+                      std::vector<std::size_t>& ids,
+                      std::index_sequence<Is...> /*unused*/) -> bool
+  {
+    return (collect_input<Is, Inputs>(builder, predecessors, ids) && ...);
+  }
+
+  template<std::size_t I, class Input>
+  static auto collect_input(builder_core<Executor>& builder,
+                            const std::vector<std::size_t>& predecessors,
+                            std::vector<std::size_t>& ids) -> bool
+  {
+    if constexpr (stage_traits<Input>::stages == 0) {
+      return true;
+    } else {
+      auto id = predecessors[I];
+      auto predecessor = node_of<Input>(builder, id);
+      if (!predecessor || builder.is_fused(id)
+          || predecessor->successors().size() != 1)
+      {
+        return false;
+      }
+      // Only the graph and this function may refer to the node
+      if (predecessor.use_count() != 2) {
+        return false;
+      }
+      if constexpr (!std::is_void_v<typename stage_traits<Input>::res>) {
+        if (predecessor->future().use_count() != 1) {
+          return false;
+        }
+      }
+      ids.push_back(id);
+      return stage_fusion<Executor, Input>::collect(
+          builder, predecessor->predecessors(), ids);
+    }
+  }
+
+  template<std::size_t... Is>
+  static auto stages(builder_core<Executor>& builder,
+                     node_type& node,
+                     std::index_sequence<Is...> /*unused*/) ->
+      typename traits::storage
+  {
+    return {fused_lambda<Lambda> {*node.task().template target<Lambda>()},
+            stages_of_input<Is, Inputs>(builder, node)...};
+  }
+
+  template<std::size_t I, class Input>
+  static auto stages_of_input(builder_core<Executor>& builder,
+                              node_type& node) ->
+      typename stage_traits<Input>::storage
+  {
+    if constexpr (stage_traits<Input>::stages == 0) {
+      return {};
+    } else {
+      auto predecessor = node_of<Input>(builder, node.predecessors()[I]);
+      return stage_fusion<Executor, Input>::stages(builder, *predecessor);
+    }
+  }
+
+  template<std::size_t Offset, class Fused, std::size_t... Is>
+  static auto adopt_inputs(builder_core<Executor>& builder,
+                           node_type& node,
+                           Fused& fused,
+                           std::index_sequence<Is...> /*unused*/) -> void
+  {
+    (adopt_input<Offset + input_offset<Is, Inputs...>(), Is, Inputs>(
+         builder, node, fused),
+     ...);
+  }
+
+  template<std::size_t Offset, std::size_t I, class Input, class Fused>
+  static auto adopt_input(builder_core<Executor>& builder,
+                          node_type& node,
+                          Fused& fused) -> void
+  {
+    using input_res = typename stage_traits<Input>::res;
+    if constexpr (stage_traits<Input>::stages > 0) {
+      auto predecessor = node_of<Input>(builder, node.predecessors()[I]);
+      stage_fusion<Executor, Input>::template adopt_inputs<Offset>(
+          builder, *predecessor, fused);
+      predecessor->successors().clear();
+    } else if constexpr (std::is_void_v<input_res>) {
+      auto slot = node.empty_slots()[slot_index<I, true, Inputs...>()];
+      slot->reassign(fused.id());
+      fused.adopt_empty_slot(slot);
+      fused.increment_dependency_count();
+    } else {
+      constexpr auto index = slot_index<I, false, Inputs...>();
+      auto slot = node.template slot<static_cast<int>(index)>();
+      slot->reassign(fused.id());
+      fused.template replace_slot<static_cast<int>(Offset)>(slot);
+      fused.increment_dependency_count();
+    }
+  }
+};
+
+}  // namespace detail
+
+/**
+ * @brief A task node which knows the tasks of its predecessors, thus can be
+ * fused with them by `builder_core::fuse`. Only created for fusable factories,
+ * see `aws::with_fusion`.
+ *
+ * @tparam Stage - The fusion tree rooted at the node, see `fused_stage`
+ */
+template<class Executor, class Task, class Stage>
+class fusable_task_node : public basic_fusable_task_node<Executor, Task>
+{
+  using traits = detail::stage_traits<Stage>;
+
+public:
+  using fusion_stage = Stage;
+
+  fusable_task_node(std::size_t id,
+                    std::weak_ptr<builder_core<Executor>> builder,
+                    std::optional<tracing_span_ref> span,
+                    Task& task)
+      : node_core<Executor>(id, builder, span)
+      , basic_fusable_task_node<Executor, Task>(id, builder, span, task)
+  {
+  }
+
+  auto fuse() -> std::vector<std::size_t> override
+  {
+    // Trees of a single stage fuse nothing, others instantiate the fused
+    // tasks of `Stage` and of its direct part, each a function of its own
+    if constexpr (traits::stages <= 1) {
+      return {};
+    } else {
+      auto builder = this->builder();
+      auto ids = detail::stage_fusion<Executor, Stage>::apply(*builder, *this);
+      if (!ids.empty()) {
+        return ids;
+      }
+      // Some transitive predecessor is observed, try the direct ones only
+      using direct = typename traits::direct;
+      if constexpr (!std::is_same_v<direct, Stage>
+                    && detail::stage_traits<direct>::stages > 1)
+      {
+        return detail::stage_fusion<Executor, direct>::apply(*builder, *this);
+      }
+      return {};
+    }
+  }
+};
+
+/**
+ * @brief The input of the fusion tree of a node which `Sender` is connected
+ * to: the tree of `Sender` if it is fusable, otherwise a `fused_input`.
+ */
+template<class Sender>
+struct fusion_input
+{
+  using type = fused_input<typename Sender::sending_type>;
+};
+
+template<class Sender>
+  requires requires { typename Sender::fusion_stage; }
+struct fusion_input<Sender>
+{
+  using type = typename Sender::fusion_stage;
+};
+
+/**
+ * @brief The fusion tree of a node running `Lambda` connected to `Senders`,
+ * limited to `max_fused_stages`.
+ */
+template<class Factory, class Lambda, class... Senders>
+struct fusion_tree
+{
+  using full =
+      fused_stage<Factory, Lambda, typename fusion_input<Senders>::type...>;
+  using type =
+      std::conditional_t<detail::stage_traits<full>::stages <= max_fused_stages,
+                         full,
+                         typename detail::stage_traits<full>::direct>;
+};
+
+}  // namespace cppless::graph
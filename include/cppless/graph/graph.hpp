@@ -1,15 +1,21 @@
 #pragma once
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/detail/adjacency_list.hpp>
 #include <boost/graph/graphviz.hpp>
 #include <cppless/dispatcher/common.hpp>
+#include <cppless/graph/adjacency.hpp>
+#include <cppless/utils/arena.hpp>
 #include <cppless/utils/json.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <cppless/utils/tuple.hpp>
@@ -59,7 +65,29 @@ public:
     return {m_span, operation_name};
   }
 
-  virtual auto successor_ids() -> std::vector<std::size_t> = 0;
+  /**
+   * @brief Appends the ids of the successors to `ids`.
+   */
+  virtual auto append_successor_ids(std::vector<std::size_t>& ids) -> void = 0;
+
+  auto successor_ids() -> std::vector<std::size_t>
+  {
+    std::vector<std::size_t> ids;
+    append_successor_ids(ids);
+    return ids;
+  }
+
+  /**
+   * @brief Replaces the node and some of its predecessors by a single node
+   * running all of their tasks in one invocation, see `builder_core::fuse`.
+   *
+   * @return The ids of the replaced nodes, this node included, or nothing if
+   * the node was not fused
+   */
+  virtual auto fuse() -> std::vector<std::size_t>
+  {
+    return {};
+  }
 
   [[nodiscard]] auto id() const -> std::size_t
   {
@@ -110,6 +138,15 @@ public:
     return m_owning_node_id;
   }
 
+  /**
+   * @brief Moves the slot to another node, e.g. to the node a fusion replaced
+   * its owner with. Senders keep delivering to the slot.
+   */
+  auto reassign(std::size_t owning_node_id) -> void
+  {
+    m_owning_node_id = owning_node_id;
+  }
+
 private:
   bool m_is_connected = false;
   std::size_t m_owning_node_id = 0UL;
@@ -140,9 +177,13 @@ public:
       , m_slots()
 
   {
-    fill_tuple(m_slots,
-               [id]<class T>(std::shared_ptr<receiver_slot<Executor, T>>& slot)
-               { slot = std::make_shared<receiver_slot<Executor, T>>(id); });
+    // The slots are placed next to the node in the arena of the builder
+    const auto& memory = this->builder()->memory();
+    fill_tuple(
+        m_slots,
+        [id, &memory]<class T>(
+            std::shared_ptr<receiver_slot<Executor, T>>& slot)
+        { slot = make_shared_in<receiver_slot<Executor, T>>(memory, id); });
   }
 
   template<int I>
@@ -154,7 +195,8 @@ public:
 
   auto create_empty_slot() -> std::shared_ptr<receiver_slot<Executor, void>>
   {
-    auto slot = std::make_shared<receiver_slot<Executor, void>>(this->id());
+    auto slot = make_shared_in<receiver_slot<Executor, void>>(
+        this->builder()->memory(), this->id());
     m_empty_slots.push_back(slot);
     return slot;
   }
@@ -164,6 +206,29 @@ public:
     return m_slots;
   }
 
+  /**
+   * @brief Replaces the `I`-th slot, whose owner has to be reassigned to this
+   * node.
+   */
+  template<int I>
+  auto replace_slot(
+      std::shared_ptr<
+          receiver_slot<Executor, std::tuple_element_t<I, std::tuple<Args...>>>>
+          slot) -> void
+  {
+    std::get<I>(m_slots) = std::move(slot);
+  }
+
+  /**
+   * @brief Adds an empty slot of another node, whose owner has to be
+   * reassigned to this node.
+   */
+  auto adopt_empty_slot(std::shared_ptr<receiver_slot<Executor, void>> slot)
+      -> void
+  {
+    m_empty_slots.push_back(std::move(slot));
+  }
+
   auto empty_slots()
       -> std::vector<std::shared_ptr<receiver_slot<Executor, void>>>
   {
@@ -220,14 +285,11 @@ public:
     return m_successors;
   }
 
-  auto successor_ids() -> std::vector<std::size_t> override
+  auto append_successor_ids(std::vector<std::size_t>& ids) -> void override
   {
-    std::vector<std::size_t> ids;
-
     for (auto& successor : m_successors) {
       ids.push_back(successor->owning_node_id());
     }
-    return ids;
   }
 
 private:
@@ -260,14 +322,11 @@ public:
     return m_successors;
   }
 
-  auto successor_ids() -> std::vector<std::size_t> override
+  auto append_successor_ids(std::vector<std::size_t>& ids) -> void override
   {
-    std::vector<std::size_t> ids;
-
     for (auto& successor : m_successors) {
       ids.push_back(successor->owning_node_id());
     }
-    return ids;
   }
 
 private:
@@ -374,6 +433,66 @@ public:
   }
 };
 
+template<class Executor, class Arg>
+class expansion_node;
+
+/**
+ * @brief A node which runs a callback on the host once the result of its
+ * predecessor arrived, without an invocation. The callback may add nodes to
+ * the running graph, e.g. to spawn a number of children depending on the
+ * result. Nodes added by the callback have to depend on the expansion node
+ * passed to it, or on other nodes added by the same callback, and nodes
+ * without dependencies are started right away. Its successors are notified
+ * once the callback returned.
+ */
+template<class Executor, class Arg>
+class basic_expansion_node
+    : virtual public node_core<Executor>
+    , public receiver<Executor, std::tuple<Arg>>
+    , public sender<Executor, void>
+{
+public:
+  using executor = Executor;
+  using sending_type = void;
+  using callback_type = std::function<void(
+      std::shared_ptr<expansion_node<Executor, Arg>>, const Arg&)>;
+
+  basic_expansion_node(std::size_t id,
+                       std::weak_ptr<builder_core<Executor>> builder,
+                       std::optional<tracing_span_ref> span,
+                       callback_type callback)
+      : node_core<Executor>(id, builder, span)
+      , receiver<Executor, std::tuple<Arg>>(id, builder, span)
+      , sender<Executor, void>(id, builder, span)
+      , m_callback(std::move(callback))
+  {
+  }
+
+  auto callback() -> callback_type&
+  {
+    return m_callback;
+  }
+
+private:
+  callback_type m_callback;
+};
+
+template<class Executor, class Arg>
+class expansion_node : public Executor::template expansion_node<Arg>
+{
+public:
+  expansion_node(std::size_t id,
+                 std::weak_ptr<builder_core<Executor>> builder,
+                 std::optional<tracing_span_ref> span,
+                 typename basic_expansion_node<Executor, Arg>::callback_type
+                     callback)
+      : node_core<Executor>(id, builder, span)
+      , Executor::template expansion_node<Arg>(
+            id, builder, span, std::move(callback))
+  {
+  }
+};
+
 template<class Executor>
 class builder_core : public std::enable_shared_from_this<builder_core<Executor>>
 {
@@ -387,50 +506,165 @@ public:
 
   using executor_type = Executor;
 
-  template<class Task>
-  auto create_node(Task& task) -> std::shared_ptr<task_node<Executor, Task>>
+  template<class Task, class Node = task_node<Executor, Task>>
+  auto create_node(Task& task) -> std::shared_ptr<Node>
+  {
+    std::scoped_lock lock {m_nodes_mutex};
+    int next_id = static_cast<int>(m_nodes.size());
+    auto self = this->shared_from_this();
+    std::optional<tracing_span_ref> child_span;
+    if (m_span) {
+      child_span.emplace(m_span->create_child("node"));
+    }
+    auto new_node =
+        make_shared_in<Node>(m_memory, next_id, self, child_span, task);
+    m_nodes.push_back(new_node);
+    return new_node;
+  }
+
+  template<class Arg>
+  auto create_expansion_node(
+      typename basic_expansion_node<Executor, Arg>::callback_type callback)
+      -> std::shared_ptr<expansion_node<Executor, Arg>>
   {
+    std::scoped_lock lock {m_nodes_mutex};
     int next_id = static_cast<int>(m_nodes.size());
     auto self = this->shared_from_this();
     std::optional<tracing_span_ref> child_span;
     if (m_span) {
       child_span.emplace(m_span->create_child("node"));
     }
-    auto new_node = std::make_shared<task_node<Executor, Task>>(
-        next_id, self, child_span, task);
+    auto new_node = make_shared_in<expansion_node<Executor, Arg>>(
+        m_memory, next_id, self, child_span, std::move(callback));
     m_nodes.push_back(new_node);
     return new_node;
   }
 
   auto create_source_node() -> std::shared_ptr<source_node<Executor>>
   {
+    std::scoped_lock lock {m_nodes_mutex};
     int next_id = static_cast<int>(m_nodes.size());
     auto self = this->shared_from_this();
     std::optional<tracing_span_ref> child_span;
     if (m_span) {
       child_span.emplace(m_span->create_child("node"));
     }
-    auto new_node =
-        std::make_shared<source_node<Executor>>(next_id, self, child_span);
+    auto new_node = make_shared_in<source_node<Executor>>(
+        m_memory, next_id, self, child_span);
     m_nodes.push_back(new_node);
     return new_node;
   }
 
+  /**
+   * @brief All nodes, which must not be used while nodes are added, e.g. by
+   * expansion nodes of a running graph.
+   */
   auto nodes() -> std::vector<std::shared_ptr<node_core<Executor>>>&
   {
     return m_nodes;
   }
 
+  [[nodiscard]] auto node_count() -> std::size_t
+  {
+    std::scoped_lock lock {m_nodes_mutex};
+    return m_nodes.size();
+  }
+
   auto executor() -> std::shared_ptr<Executor>&
   {
     return m_executor;
   }
 
+  /**
+   * @brief The root span of the graph, whose children are the spans of the
+   * nodes.
+   */
+  auto span() -> const std::optional<tracing_span_ref>&
+  {
+    return m_span;
+  }
+
   auto node(std::size_t id) -> std::shared_ptr<node_core<Executor>>
   {
+    std::scoped_lock lock {m_nodes_mutex};
     return m_nodes[id];
   }
 
+  /**
+   * @brief The node with the id `id`, which lives as long as the builder.
+   * Cheaper than `node` as the reference count is left alone.
+   */
+  auto at(std::size_t id) -> node_core<Executor>&
+  {
+    std::scoped_lock lock {m_nodes_mutex};
+    return *m_nodes[id];
+  }
+
+  /**
+   * @brief The arena the nodes and their slots are allocated in.
+   */
+  auto memory() -> const std::shared_ptr<arena>&
+  {
+    return m_memory;
+  }
+
+  /**
+   * @brief The edges of the graph, collected in a single pass.
+   */
+  auto adjacency() -> graph::adjacency
+  {
+    graph::adjacency edges;
+    edges.reserve(m_nodes.size(), m_nodes.size());
+    for (auto& node : m_nodes) {
+      node->append_successor_ids(edges.targets());
+      edges.close_node();
+    }
+    return edges;
+  }
+
+  /**
+   * @brief Fuses linear chains and fan-ins of task nodes into single nodes,
+   * thus running each of them in one invocation without round trips through
+   * the host for the intermediate results. Has to be called once the graph is
+   * complete and before `await_all`.
+   *
+   * Only nodes of tasks configured `with_fusion` take part. Starting from
+   * the sinks, every node is fused with as many of its transitive
+   * predecessors as its type allows, see `fusion_stage`. A
+   * predecessor is only fused if its result is not observed: it has a single
+   * successor, and neither the node nor its future are referenced outside of
+   * the graph. The futures of the fused nodes deliver the results of the
+   * nodes they replaced.
+   *
+   * @return The number of invocations saved
+   */
+  auto fuse() -> std::size_t
+  {
+    std::size_t saved = 0;
+    for (auto id = m_nodes.size(); id-- > 0;) {
+      if (is_fused(id)) {
+        continue;
+      }
+      auto node = m_nodes[id];
+      auto replaced = node->fuse();
+      for (auto replaced_id : replaced) {
+        m_fused_into[replaced_id] = m_nodes.size() - 1;
+      }
+      if (!replaced.empty()) {
+        saved += replaced.size() - 1;
+      }
+    }
+    return saved;
+  }
+
+  /**
+   * @brief Whether the node was replaced by a fused node.
+   */
+  [[nodiscard]] auto is_fused(std::size_t id) const -> bool
+  {
+    return m_fused_into.contains(id);
+  }
+
   auto write_graphviz(std::ostream& out)
   {
     using digraph = boost::adjacency_list<
@@ -439,12 +673,19 @@ public:
         boost::directedS,
         boost::property<boost::vertex_name_t, std::string>>;
     digraph d(m_nodes.size());
-    for (auto& node : m_nodes) {
-      for (auto& successor : node->successor_ids()) {
-        boost::add_edge(node->id(), successor, d);
+    std::vector<std::string> labels(m_nodes.size());
+    auto edges = adjacency();
+    for (std::size_t id = 0; id < edges.size(); id++) {
+      labels[id] = std::to_string(id);
+      for (auto successor : edges.successors(id)) {
+        boost::add_edge(id, successor, d);
       }
     }
-    boost::write_graphviz(out, d);
+    // Replaced nodes are left without edges
+    for (auto [replaced, fused] : m_fused_into) {
+      labels[replaced] += " (fused into " + std::to_string(fused) + ")";
+    }
+    boost::write_graphviz(out, d, boost::make_label_writer(labels.data()));
   }
 
   auto await_all() -> void
@@ -453,9 +694,15 @@ public:
   }
 
 private:
+  std::shared_ptr<arena> m_memory = std::make_shared<arena>();
   std::vector<std::shared_ptr<node_core<Executor>>> m_nodes {};
+  // Guards the nodes against expansion nodes adding nodes while others are
+  // looked up
+  std::mutex m_nodes_mutex;
   std::optional<tracing_span_ref> m_span;
   std::shared_ptr<Executor> m_executor;
+  // Replaced node id -> id of the fused node replacing it
+  std::unordered_map<std::size_t, std::size_t> m_fused_into {};
 };
 
 // Serializer for std::shared_ptr<node_core<Executor>>
@@ -512,6 +759,14 @@ public:
     m_core->write_graphviz(out);
   }
 
+  /**
+   * @brief Fuses chains and fan-ins of nodes, see `builder_core::fuse`.
+   */
+  auto fuse() -> std::size_t
+  {
+    return m_core->fuse();
+  }
+
   auto await_all() -> void
   {
     m_core->await_all();
@@ -1,18 +1,78 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/remote.hpp>
 #include <cppless/dispatcher/sendable.hpp>
+#include <cppless/graph/checkpoint.hpp>
 #include <cppless/graph/graph.hpp>
+#include <cppless/graph/scheduling.hpp>
+#include <cppless/graph/speculation.hpp>
+#include <cppless/utils/thread_pool.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <cppless/utils/tuple.hpp>
 
 namespace cppless::executor
 {
 
+struct host_controller_options
+{
+  /**
+   * @brief Threads serializing and dispatching ready nodes and propagating
+   * their results, zero for all hardware threads. With more than one, the
+   * invocations complete on the IO thread of a background instance, which
+   * the dispatcher has to support, and nodes are not traced.
+   */
+  unsigned int threads = 1;
+  /**
+   * @brief Overrides the remote threshold while the arguments of nodes are
+   * serialized, thus `remote` arguments larger than this are put into the
+   * object store once and all successors receive their key, see `remote`.
+   */
+  std::optional<std::size_t> remote_threshold;
+  /**
+   * @brief The order in which ready nodes are started.
+   */
+  scheduling_policy policy = scheduling_policy::lifo;
+  /**
+   * @brief The maximum number of invocations in flight, zero for no limit.
+   */
+  std::size_t max_in_flight = 0;
+  /**
+   * @brief Persists the results of finished nodes. Nodes whose results the
+   * log holds from an earlier run of the same graph are not invoked again,
+   * but deliver the logged results. Only the nodes built before `await_all`
+   * is called are logged, nodes added by expansion nodes are run again.
+   */
+  std::shared_ptr<checkpoint_log> checkpoint;
+  /**
+   * @brief When straggling invocations of speculative tasks are backed up.
+   * In a serial run, the dispatcher needs to support `wait_for` for backups
+   * to start on time, otherwise they start once another invocation finishes,
+   * and discarded invocations are only seen to finish by later runs.
+   */
+  speculation_options speculation;
+};
+
 template<class Dispatcher>
 class host_controller_executor
     : public std::enable_shared_from_this<host_controller_executor<Dispatcher>>
@@ -36,12 +96,124 @@ public:
     {
     }
 
+    using completion_cb = std::function<void(std::exception_ptr)>;
+
     virtual auto propagate_value() -> void = 0;
     virtual auto run(typename Dispatcher::instance& dispatcher) -> int = 0;
+    /**
+     * @brief Starts the node without tracing it, `done` is called once its
+     * invocation has finished.
+     *
+     * @return Whether an invocation was started, otherwise the node has
+     * finished already and `done` is not called
+     */
+    virtual auto start(typename Dispatcher::instance& dispatcher,
+                       completion_cb done) -> bool = 0;
+    /**
+     * @brief The expected duration of the node in milliseconds, see
+     * `aws::with_cost`.
+     */
+    virtual auto cost() -> double = 0;
+    /**
+     * @brief Serializes the result of the node into `out`, see
+     * `host_controller_options::checkpoint`.
+     *
+     * @return Whether the node has a result to be logged
+     */
+    virtual auto checkpoint(std::string& /*out*/) -> bool
+    {
+      return false;
+    }
+    /**
+     * @brief Sets the result of the node to a result serialized by
+     * `checkpoint`, the node is then not invoked.
+     */
+    virtual auto restore(std::string_view /*data*/) -> void {}
+    /**
+     * @brief Prepares the node to be backed up if its task is speculative,
+     * see `aws::with_speculation`: its invocations then write their results
+     * to storage of their own, until `accept` delivers one of them.
+     *
+     * @return The identifier of the task, or nothing if the node cannot be
+     * backed up
+     */
+    virtual auto prepare_speculation() -> std::optional<std::string>
+    {
+      return std::nullopt;
+    }
+    /**
+     * @brief Like `run`, but starts the backup invocation.
+     */
+    virtual auto run_backup(typename Dispatcher::instance& /*dispatcher*/)
+        -> int
+    {
+      throw std::runtime_error("The node cannot be backed up");
+    }
+    /**
+     * @brief Like `start`, but starts the backup invocation.
+     */
+    virtual auto start_backup(typename Dispatcher::instance& /*dispatcher*/,
+                              completion_cb /*done*/) -> void
+    {
+      throw std::runtime_error("The node cannot be backed up");
+    }
+    /**
+     * @brief Delivers the result of the first invocation, `attempt` zero, or
+     * of the backup invocation, `attempt` one.
+     */
+    virtual auto accept(int /*attempt*/) -> void {}
+    /**
+     * @brief The storage the invocations of a node prepared by
+     * `prepare_speculation` write their results to, which whoever waits for
+     * an invocation keeps alive, as a discarded one may outlive the graph.
+     */
+    virtual auto retain() -> std::shared_ptr<void>
+    {
+      return nullptr;
+    }
+
+    auto enable_speculation() -> void
+    {
+      if (m_speculation) {
+        return;
+      }
+      if (auto task = prepare_speculation()) {
+        m_speculation = std::make_shared<speculative_invocation>();
+        m_speculation->task = std::move(*task);
+      }
+    }
+
+    /**
+     * @brief The state of the invocations of the node if it may be backed
+     * up, otherwise null.
+     */
+    auto speculation() -> speculative_invocation*
+    {
+      return m_speculation.get();
+    }
+
+    /**
+     * @brief Like `speculation`, shared with invocations which may finish
+     * after the graph is gone.
+     */
+    auto shared_speculation() -> std::shared_ptr<speculative_invocation>
+    {
+      return m_speculation;
+    }
+
+    auto mark_restored() -> void
+    {
+      m_restored = true;
+    }
+
+    [[nodiscard]] auto restored() const -> bool
+    {
+      return m_restored;
+    }
 
     [[nodiscard]] auto dependency_count() const -> int
     {
-      return m_dependency_count;
+      return m_dependency_count.load();
     }
 
     auto increment_dependency_count() -> void
@@ -49,13 +221,47 @@ public:
       ++m_dependency_count;
     }
 
-    auto decrement_dependency_count() -> void
+    /**
+     * @brief Returns the remaining count, exactly one caller sees zero.
+     */
+    auto decrement_dependency_count() -> int
+    {
+      return --m_dependency_count;
+    }
+
+    auto mark_started() -> void
+    {
+      m_started = std::chrono::steady_clock::now();
+      m_duration.reset();
+    }
+
+    auto mark_finished() -> void
+    {
+      std::chrono::duration<double, std::milli> duration =
+          std::chrono::steady_clock::now() - m_started;
+      m_duration = duration.count();
+    }
+
+    /**
+     * @brief The time from starting the invocation of the node until its
+     * result arrived in milliseconds, if it was invoked.
+     */
+    [[nodiscard]] auto duration() const -> std::optional<double>
+    {
+      return m_duration;
+    }
+
+    [[nodiscard]] auto started() const -> std::chrono::steady_clock::time_point
     {
-      --m_dependency_count;
+      return m_started;
     }
 
   private:
-    int m_dependency_count = 0;
+    std::atomic<int> m_dependency_count = 0;
+    std::chrono::steady_clock::time_point m_started;
+    std::optional<double> m_duration;
+    bool m_restored = false;
+    std::shared_ptr<speculative_invocation> m_speculation;
   };
 
   template<class Arg>
@@ -133,6 +339,8 @@ public:
            std::optional<tracing_span_ref> span)
         : graph::node_core<executor_type>(id, builder, span)
         , graph::basic_sender<executor_type, Res>(id, builder, span)
+        , m_future(std::allocator_arg,
+                   arena_allocator<Res>(builder.lock()->memory()))
     {
     }
 
@@ -194,10 +402,75 @@ public:
         m_dispatch_span->start();
       }
       int fut_id = dispatcher.dispatch_impl(
-          this->task(), this->future().value(), arg_values, m_dispatch_span);
+          this->task(), target(0), arg_values, m_dispatch_span);
 
       return fut_id;
     }
+
+    auto run_backup(typename Dispatcher::instance& dispatcher) -> int override
+    {
+      return dispatcher.dispatch_impl(this->task(), target(1), this->args());
+    }
+
+    auto start(typename Dispatcher::instance& dispatcher,
+               typename node_core::completion_cb done) -> bool override
+    {
+      dispatch(dispatcher, target(0), std::move(done));
+      return true;
+    }
+    auto start_backup(typename Dispatcher::instance& dispatcher,
+                      typename node_core::completion_cb done) -> void override
+    {
+      dispatch(dispatcher, target(1), std::move(done));
+    }
+    auto prepare_speculation() -> std::optional<std::string> override
+    {
+      if constexpr (requires { this->task().speculative(); }) {
+        if (this->task().speculative()) {
+          m_attempts =
+              std::make_shared<std::array<typename Task::res, 2>>();
+          return this->task().identifier();
+        }
+      }
+      return std::nullopt;
+    }
+    auto accept(int attempt) -> void override
+    {
+      if (m_attempts) {
+        this->future().target() =
+            std::move((*m_attempts)[static_cast<std::size_t>(attempt)]);
+      }
+    }
+    auto retain() -> std::shared_ptr<void> override
+    {
+      return m_attempts;
+    }
+    auto cost() -> double override
+    {
+      if constexpr (requires { this->task().cost(); }) {
+        auto hint = this->task().cost();
+        if (hint) {
+          return *hint;
+        }
+      }
+      return default_task_cost;
+    }
+    auto checkpoint(std::string& out) -> bool override
+    {
+      std::ostringstream stream;
+      {
+        typename Dispatcher::response_output_archive oar(stream);
+        oar(this->result());
+      }
+      out = std::move(stream).str();
+      return true;
+    }
+    auto restore(std::string_view data) -> void override
+    {
+      std::istringstream stream {std::string {data}};
+      typename Dispatcher::response_input_archive iar(stream);
+      iar(this->future().target());
+    }
     auto propagate_value() -> void override
     {
       if (m_dispatch_span) {
@@ -207,7 +480,7 @@ public:
       typename Task::res& res_value = this->result();
       std::shared_ptr<graph::builder_core<host_controller_executor<Dispatcher>>>
           builder = this->builder();
-      std::shared_ptr<executor_type> exec = builder->executor();
+      const std::shared_ptr<executor_type>& exec = builder->executor();
       for (auto& successor : graph::sender<host_controller_executor<Dispatcher>,
                                            typename Task::res>::successors())
       {
@@ -217,7 +490,45 @@ public:
     }
 
   private:
+    /**
+     * @brief Where the invocation `attempt` writes its result: the future,
+     * unless the node may be backed up.
+     */
+    auto target(int attempt) -> typename Task::res&
+    {
+      if (m_attempts) {
+        return (*m_attempts)[static_cast<std::size_t>(attempt)];
+      }
+      return this->future().target();
+    }
+
+    auto dispatch(typename Dispatcher::instance& dispatcher,
+                  typename Task::res& result_target,
+                  typename node_core::completion_cb done) -> void
+    {
+      typename Task::args arg_values = this->args();
+      if constexpr (requires {
+                      dispatcher.dispatch_impl(this->task(),
+                                               result_target,
+                                               arg_values,
+                                               std::nullopt,
+                                               std::move(done));
+                    })
+      {
+        dispatcher.dispatch_impl(this->task(),
+                                 result_target,
+                                 arg_values,
+                                 std::nullopt,
+                                 std::move(done));
+      } else {
+        throw std::runtime_error(
+            "The dispatcher does not support completion callbacks");
+      }
+    }
+
     std::optional<tracing_span_ref> m_dispatch_span;
+    // The results of both invocations of a node which may be backed up
+    std::shared_ptr<std::array<typename Task::res, 2>> m_attempts;
   };
 
   class source_node
@@ -242,11 +553,20 @@ public:
       }
       return -1;
     }
+    auto start(typename Dispatcher::instance& /*dispatcher*/,
+               typename node_core::completion_cb /*done*/) -> bool override
+    {
+      return false;
+    }
+    auto cost() -> double override
+    {
+      return 0;
+    }
     auto propagate_value() -> void override
     {
       std::shared_ptr<graph::builder_core<host_controller_executor<Dispatcher>>>
           builder = this->builder();
-      std::shared_ptr<executor_type> exec = builder->executor();
+      const std::shared_ptr<executor_type>& exec = builder->executor();
       for (auto& successor : graph::sender<host_controller_executor<Dispatcher>,
                                            void>::successors())
       {
@@ -255,10 +575,85 @@ public:
     }
   };
 
-  explicit host_controller_executor(std::shared_ptr<Dispatcher> dispatcher)
-      : m_instance(dispatcher->create_instance())
+  template<class Arg>
+  class expansion_node
+      : virtual public graph::node_core<executor_type>
+      , public graph::basic_expansion_node<executor_type, Arg>
+  {
+  public:
+    expansion_node(
+        std::size_t id,
+        std::weak_ptr<graph::builder_core<executor_type>> builder,
+        std::optional<tracing_span_ref> span,
+        typename graph::basic_expansion_node<executor_type,
+                                             Arg>::callback_type callback)
+        : graph::node_core<executor_type>(id, builder, span)
+        , graph::basic_expansion_node<executor_type, Arg>(
+              id, builder, span, std::move(callback))
+    {
+    }
+
+    auto run(typename Dispatcher::instance& /*dispatcher*/) -> int override
+    {
+      return -1;
+    }
+    auto start(typename Dispatcher::instance& /*dispatcher*/,
+               typename node_core::completion_cb /*done*/) -> bool override
+    {
+      return false;
+    }
+    auto cost() -> double override
+    {
+      return 0;
+    }
+    auto propagate_value() -> void override
+    {
+      std::shared_ptr<graph::builder_core<host_controller_executor<Dispatcher>>>
+          builder = this->builder();
+      const std::shared_ptr<executor_type>& exec = builder->executor();
+      auto self = std::dynamic_pointer_cast<
+          graph::expansion_node<executor_type, Arg>>(builder->node(this->id()));
+      const Arg& value = this->template slot<0>()->get().value();
+      exec->expand(*builder, [&] { this->callback()(self, value); });
+      for (auto& successor : graph::sender<host_controller_executor<Dispatcher>,
+                                           void>::successors())
+      {
+        exec->notify(successor->owning_node_id());
+      }
+    }
+  };
+
+  explicit host_controller_executor(std::shared_ptr<Dispatcher> dispatcher,
+                                    host_controller_options options = {})
+      : m_options(options)
+      , m_instance(create_instance(*dispatcher, options))
       , m_dispatcher(dispatcher)
   {
+    if (options.threads != 1) {
+      // The thread calling `await_all` only waits
+      auto threads = options.threads == 0
+          ? std::max(1U, std::thread::hardware_concurrency())
+          : options.threads;
+      m_pool = std::make_unique<thread_pool>(threads + 1);
+    }
+  }
+
+  host_controller_executor(const host_controller_executor&) = delete;
+  auto operator=(const host_controller_executor&)
+      -> host_controller_executor& = delete;
+  host_controller_executor(host_controller_executor&&) = delete;
+  auto operator=(host_controller_executor&&)
+      -> host_controller_executor& = delete;
+
+  ~host_controller_executor()
+  {
+    // Invocations still in flight, e.g. after a failure or discarded by
+    // speculation, submit their continuations to the pool
+    if (m_pool) {
+      std::unique_lock lock {m_mutex};
+      m_idle.wait(lock,
+                  [this] { return m_active.load() == 0 && m_discarded == 0; });
+    }
   }
 
   auto set_builder(std::weak_ptr<graph::builder_core<executor_type>> builder)
@@ -267,63 +662,176 @@ public:
     m_builder = builder;
   }
 
+  [[nodiscard]] auto options() const -> const host_controller_options&
+  {
+    return m_options;
+  }
+
+  /**
+   * @brief The instance nodes are dispatched with, e.g. to read its
+   * statistics.
+   */
+  auto instance() -> typename Dispatcher::instance&
+  {
+    return m_instance;
+  }
+
+  /**
+   * @brief The graph of the last call to `await_all` together with the
+   * durations of its invocations, e.g. to replay it with `simulate`.
+   */
+  auto record() -> recorded_graph
+  {
+    recorded_graph graph;
+    auto builder = m_builder.lock();
+    if (!builder) {
+      return graph;
+    }
+    auto edges = builder->adjacency();
+    for (auto& node : builder->nodes()) {
+      recorded_node recorded;
+      recorded.id = node->id();
+      auto successors = edges.successors(recorded.id);
+      recorded.successors.assign(successors.begin(), successors.end());
+      recorded.cost = node->cost();
+      if (auto duration = node->duration()) {
+        recorded.invoked = true;
+        recorded.duration = *duration;
+      }
+      graph.push_back(std::move(recorded));
+    }
+    return graph;
+  }
+
   auto await_all() -> void
   {
     auto builder = m_builder.lock();
     if (!builder) {
       return;
     }
+    prepare(*builder);
+    m_finished_nodes = 0;
+    if (m_pool) {
+      await_all_parallel(*builder);
+      return;
+    }
 
-    std::unordered_set<std::size_t> running_nodes;
-
-    int finished_nodes = 0;
+    // Invocations in flight, and nodes waiting for one of them
+    std::size_t running_nodes = 0;
+    std::size_t waiting_nodes = 0;
 
-    // Populate the m_ready_nodes vector with all nodes that don't have any
+    // Populate the m_ready_nodes queue with all nodes that don't have any
     // dependencies
 
     for (auto& node : builder->nodes()) {
       if (node->dependency_count() == 0) {
-        m_ready_nodes.push_back(node->id());
+        m_ready_nodes.push(node->id());
       }
     }
 
     do {
-      // Run all ready nodes
-      while (!m_ready_nodes.empty()) {
-        std::size_t node_id = m_ready_nodes.back();
-        auto node = builder->node(node_id);
-        m_ready_nodes.pop_back();
+      // Run ready nodes while further invocations may be started
+      while (!m_ready_nodes.empty() && may_start(running_nodes)) {
+        std::size_t node_id = m_ready_nodes.pop();
+        auto& node = builder->at(node_id);
 
-        int future_id = node->run(m_instance);
+        int future_id = -1;
+        if (!node.restored()) {
+          std::optional<scoped_remote_threshold> threshold;
+          if (m_options.remote_threshold) {
+            threshold.emplace(*m_options.remote_threshold);
+          }
+          node.mark_started();
+          track(node);
+          future_id = node.run(m_instance);
+        }
 
         if (future_id == -1) {
           m_finished_nodes++;
-          finished_nodes++;
 
-          node->propagate_value();
+          node.propagate_value();
         } else {
-          running_nodes.insert(node_id);
-          m_future_node_map[future_id] = node->id();
+          running_nodes++;
+          waiting_nodes++;
+          m_future_node_map[future_id] = {node_id, 0, node.retain()};
         }
       }
 
-      if (running_nodes.empty()) {
+      // Invocations discarded by speculation are not waited for
+      if (waiting_nodes == 0) {
         break;
       }
 
-      auto res = m_instance.wait_one();
-      int finished = std::get<0>(res);
+      std::optional<int> finished;
+      try {
+        finished = wait_next(*builder, running_nodes);
+      } catch (const invocation_failed& error) {
+        // The other invocation of the node may still succeed
+        if (!discard_failure(*builder, error.id())) {
+          throw;
+        }
+        running_nodes--;
+        continue;
+      }
+      if (!finished) {
+        continue;
+      }
 
-      std::size_t finished_node_id = m_future_node_map[finished];
-      auto node = builder->node(finished_node_id);
+      auto [finished_node_id, attempt, storage] =
+          std::move(m_future_node_map[*finished]);
+      m_future_node_map.erase(*finished);
+      running_nodes--;
+      auto& node = builder->at(finished_node_id);
+      if (!settle(node, attempt, false)) {
+        continue;
+      }
+      node.mark_finished();
+      save(node);
 
       m_finished_nodes++;
-      finished_nodes++;
-      running_nodes.erase(node->id());
+      waiting_nodes--;
       // Propagate the value
-      node->propagate_value();
+      node.propagate_value();
       // This also adds the node to the ready nodes
     } while (true);
+    if (m_options.checkpoint) {
+      m_options.checkpoint->flush();
+    }
+    annotate(*builder);
+    m_finished = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * @brief The backups started by the last call to `await_all`, see
+   * `host_controller_options::speculation`.
+   */
+  auto speculation() -> speculation_statistics
+  {
+    auto builder = m_builder.lock();
+    std::scoped_lock lock {m_speculation_mutex};
+    auto statistics = m_speculation_statistics;
+    if (builder && statistics.backups_won > 0) {
+      statistics.makespan_saved = estimate_savings(*builder);
+    }
+    return statistics;
+  }
+
+  /**
+   * @brief The number of nodes finished by the last call to `await_all`,
+   * including those which were not invoked.
+   */
+  [[nodiscard]] auto finished_nodes() const -> std::size_t
+  {
+    return m_finished_nodes.load();
+  }
+
+  /**
+   * @brief The number of nodes of the last call to `await_all` which were not
+   * invoked, as their results were restored from the checkpoint log.
+   */
+  [[nodiscard]] auto restored_nodes() const -> std::size_t
+  {
+    return m_restored_nodes;
   }
 
   auto notify(std::size_t id) -> void
@@ -334,19 +842,717 @@ public:
     }
 
     // Decrease dependency count
-    auto node = builder->node(id);
-    node->decrement_dependency_count();
-    if (node->dependency_count() == 0) {
-      m_ready_nodes.push_back(node->id());
+    if (builder->at(id).decrement_dependency_count() == 0) {
+      make_ready(id);
+    }
+  }
+
+  /**
+   * @brief Runs the callback of an expansion node, which adds nodes to the
+   * running graph. Callbacks run one at a time, thus they may share state.
+   */
+  template<class Callback>
+  auto expand(graph::builder_core<executor_type>& builder, Callback&& callback)
+      -> void
+  {
+    std::scoped_lock lock {m_expansion_mutex};
+    auto first = builder.node_count();
+    std::forward<Callback>(callback)();
+    auto count = builder.node_count();
+
+    if (m_options.policy == scheduling_policy::critical_path) {
+      // Added nodes only precede nodes added after them, the ranks of the
+      // nodes already in the graph do not include their new descendants
+      std::scoped_lock ready_lock {m_ready_mutex};
+      std::vector<std::size_t> successors;
+      for (auto id = count; id-- > first;) {
+        auto& node = builder.at(id);
+        successors.clear();
+        node.append_successor_ids(successors);
+        double highest = 0;
+        for (auto successor : successors) {
+          highest = std::max(highest, m_ready_nodes.rank(successor));
+        }
+        m_ready_nodes.set_rank(id, node.cost() + highest);
+      }
+    }
+    for (auto id = first; id < count; id++) {
+      auto& node = builder.at(id);
+      if (speculating()) {
+        node.enable_speculation();
+      }
+      if (node.dependency_count() == 0) {
+        make_ready(id);
+      }
     }
   }
 
 private:
+  auto make_ready(std::size_t id) -> void
+  {
+    if (m_pool) {
+      schedule(id);
+    } else {
+      m_ready_nodes.push(id);
+    }
+  }
+
+  static auto create_instance(Dispatcher& dispatcher,
+                              const host_controller_options& options) ->
+      typename Dispatcher::instance
+  {
+    if (options.threads == 1) {
+      return dispatcher.create_instance();
+    }
+    if constexpr (requires { dispatcher.create_instance(io_mode::background); })
+    {
+      return dispatcher.create_instance(io_mode::background);
+    } else {
+      throw std::runtime_error(
+          "The dispatcher does not support a background IO thread");
+    }
+  }
+
+  /**
+   * @brief Orders the ready nodes by the scheduling policy.
+   */
+  auto prepare(graph::builder_core<executor_type>& builder) -> void
+  {
+    std::vector<double> ranks;
+    if (m_options.policy == scheduling_policy::critical_path) {
+      std::vector<double> costs;
+      costs.reserve(builder.nodes().size());
+      for (auto& node : builder.nodes()) {
+        costs.push_back(node->cost());
+      }
+      ranks = upward_ranks(builder.adjacency(), costs);
+    }
+    m_ready_nodes = ready_queue(m_options.policy, std::move(ranks));
+    restore(builder);
+
+    {
+      std::scoped_lock lock {m_speculation_mutex};
+      m_speculation_statistics = {};
+      m_speculating.clear();
+    }
+    if (speculating()) {
+      for (auto& node : builder.nodes()) {
+        node->enable_speculation();
+      }
+    }
+  }
+
+  [[nodiscard]] auto speculating() const -> bool
+  {
+    return m_options.speculation.percentile > 0;
+  }
+
+  /**
+   * @brief Registers a node whose invocation was started, thus it is backed
+   * up once it straggles.
+   */
+  auto track(node_core& node) -> void
+  {
+    auto* state = node.speculation();
+    if (!state) {
+      return;
+    }
+    {
+      std::scoped_lock lock {state->mutex};
+      state->settled = false;
+      state->backed_up = false;
+      state->backup_won = false;
+      state->pending = 1;
+      state->primary_duration.reset();
+    }
+    std::scoped_lock lock {m_speculation_mutex};
+    m_speculating.push_back(node.id());
+  }
+
+  /**
+   * @brief Picks the tracked nodes whose invocations have run longer than
+   * the percentile of their task, as long as `take_slot` grants them an
+   * invocation.
+   *
+   * @return The nodes to back up, and when the next tracked node is due
+   */
+  template<class TakeSlot>
+  auto due_backups(graph::builder_core<executor_type>& builder,
+                   TakeSlot&& take_slot)
+      -> std::pair<std::vector<std::size_t>,
+                   std::optional<std::chrono::steady_clock::time_point>>
+  {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::size_t> due;
+    std::optional<clock::time_point> next;
+    auto now = clock::now();
+    const auto& options = m_options.speculation;
+
+    std::scoped_lock lock {m_speculation_mutex};
+    std::erase_if(
+        m_speculating,
+        [&](std::size_t id)
+        {
+          auto& node = builder.at(id);
+          auto& state = *node.speculation();
+          std::scoped_lock state_lock {state.mutex};
+          if (state.settled || state.backed_up) {
+            return true;
+          }
+          auto& latencies =
+              m_latencies.try_emplace(state.task, options.window)
+                  .first->second;
+          if (latencies.size() < options.min_samples) {
+            return false;
+          }
+          auto deadline = node.started()
+              + std::chrono::duration_cast<clock::duration>(
+                              std::chrono::duration<double, std::milli>(
+                                  options.factor
+                                  * latencies.percentile(options.percentile)));
+          if (deadline > now) {
+            next = next ? std::min(*next, deadline) : deadline;
+            return false;
+          }
+          if (!take_slot()) {
+            return false;
+          }
+          state.backed_up = true;
+          state.pending++;
+          state.backup_started = now;
+          m_speculation_statistics.backups++;
+          due.push_back(id);
+          return true;
+        });
+    return {std::move(due), next};
+  }
+
+  /**
+   * @brief Handles the end of the invocation `attempt` of a node.
+   *
+   * @return Whether the node is done: it succeeded, or it failed and no
+   * other invocation of it is left. Otherwise the invocation is discarded.
+   */
+  auto settle(node_core& node, int attempt, bool failed) -> bool
+  {
+    auto* state = node.speculation();
+    if (!state) {
+      return true;
+    }
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    auto now = std::chrono::steady_clock::now();
+    milliseconds duration {};
+    {
+      std::scoped_lock lock {state->mutex};
+      state->pending--;
+      if (state->settled) {
+        if (attempt == 0 && !failed) {
+          state->primary_duration = milliseconds(now - node.started()).count();
+        }
+        return false;
+      }
+      if (failed && state->pending > 0) {
+        return false;
+      }
+      state->settled = true;
+      if (failed) {
+        return true;
+      }
+      state->backup_won = attempt == 1;
+      duration =
+          now - (attempt == 0 ? node.started() : state->backup_started);
+    }
+    node.accept(attempt);
+    std::scoped_lock lock {m_speculation_mutex};
+    m_latencies.try_emplace(state->task, m_options.speculation.window)
+        .first->second.add(duration.count());
+    if (attempt == 1) {
+      m_speculation_statistics.backups_won++;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Waits for the next invocation to finish, backing up straggling
+   * ones meanwhile.
+   *
+   * @return The id of the invocation, or nothing if a backup became due
+   */
+  auto wait_next(graph::builder_core<executor_type>& builder,
+                 std::size_t& running_nodes) -> std::optional<int>
+  {
+    if (speculating()) {
+      auto [due, next] = due_backups(builder,
+                                     [&]
+                                     {
+                                       if (!may_start(running_nodes)) {
+                                         return false;
+                                       }
+                                       running_nodes++;
+                                       return true;
+                                     });
+      for (auto id : due) {
+        std::optional<scoped_remote_threshold> threshold;
+        if (m_options.remote_threshold) {
+          threshold.emplace(*m_options.remote_threshold);
+        }
+        auto& node = builder.at(id);
+        m_future_node_map[node.run_backup(m_instance)] = {
+            id, 1, node.retain()};
+      }
+      if constexpr (requires {
+                      m_instance.wait_for(std::chrono::milliseconds(0));
+                    })
+      {
+        if (next) {
+          auto res = m_instance.wait_for(*next
+                                         - std::chrono::steady_clock::now());
+          if (!res) {
+            return std::nullopt;
+          }
+          return std::get<0>(*res);
+        }
+      }
+    }
+    return std::get<0>(m_instance.wait_one());
+  }
+
+  /**
+   * @brief Whether the failed invocation `id` is discarded, as the other
+   * invocation of its node has succeeded or is still running.
+   */
+  auto discard_failure(graph::builder_core<executor_type>& builder, int id)
+      -> bool
+  {
+    auto it = m_future_node_map.find(id);
+    if (it == m_future_node_map.end()) {
+      return false;
+    }
+    auto [node_id, attempt, storage] = it->second;
+    if (settle(builder.at(node_id), attempt, true)) {
+      return false;
+    }
+    m_future_node_map.erase(it);
+    return true;
+  }
+
+  /**
+   * @brief Replays the graph with the durations the backed up invocations
+   * took, see `speculation_statistics::makespan_saved`.
+   */
+  auto estimate_savings(graph::builder_core<executor_type>& builder)
+      -> double
+  {
+    auto actual = record();
+    auto unspeculated = actual;
+    for (auto& node : builder.nodes()) {
+      auto* state = node->speculation();
+      if (!state) {
+        continue;
+      }
+      std::scoped_lock lock {state->mutex};
+      if (state->backup_won) {
+        unspeculated[node->id()].duration = state->primary_duration
+            ? *state->primary_duration
+            : std::chrono::duration<double, std::milli>(m_finished
+                                                        - node->started())
+                  .count();
+      }
+    }
+    return simulate(unspeculated, m_options.policy, m_options.max_in_flight)
+        - simulate(actual, m_options.policy, m_options.max_in_flight);
+  }
+
+  /**
+   * @brief Restores the results of the nodes the checkpoint log holds.
+   */
+  auto restore(graph::builder_core<executor_type>& builder) -> void
+  {
+    m_restored_nodes = 0;
+    m_logged_nodes = builder.nodes().size();
+    if (!m_options.checkpoint) {
+      return;
+    }
+    m_options.checkpoint->begin(m_logged_nodes);
+    for (auto& node : builder.nodes()) {
+      if (auto data = m_options.checkpoint->result(node->id())) {
+        node->restore(*data);
+        node->mark_restored();
+        m_restored_nodes++;
+      }
+    }
+  }
+
+  /**
+   * @brief Appends the result of a finished node to the checkpoint log.
+   */
+  auto save(node_core& node) -> void
+  {
+    if (!m_options.checkpoint || node.id() >= m_logged_nodes) {
+      return;
+    }
+    std::string data;
+    if (node.checkpoint(data)) {
+      m_options.checkpoint->append(node.id(), data);
+    }
+  }
+
+  /**
+   * @brief Tags the root span of the graph with the statistics of the result
+   * cache of the instance, if it memoizes tasks, see `result_cache::annotate`.
+   */
+  auto annotate(graph::builder_core<executor_type>& builder) -> void
+  {
+    if constexpr (requires { m_instance.cache(); }) {
+      const auto& cache = m_instance.cache();
+      if (cache && builder.span()) {
+        cache->annotate(*builder.span());
+      }
+    }
+  }
+
+  [[nodiscard]] auto may_start(std::size_t in_flight) const -> bool
+  {
+    return m_options.max_in_flight == 0 || in_flight < m_options.max_in_flight;
+  }
+
+  /**
+   * @brief Runs the graph on the pool. Every job and invocation is counted in
+   * `m_active` from before it is created until after it has created its
+   * successors, thus the graph is done once the count drops to zero.
+   */
+  auto await_all_parallel(graph::builder_core<executor_type>& builder) -> void
+  {
+    m_error = nullptr;
+    m_failed = false;
+    // Scheduled nodes notify their successors right away, so the initial
+    // nodes are collected before any of them is scheduled
+    std::vector<std::size_t> initial_nodes;
+    for (auto& node : builder.nodes()) {
+      if (node->dependency_count() == 0) {
+        initial_nodes.push_back(node->id());
+      }
+    }
+    begin_work();
+    {
+      std::scoped_lock lock {m_ready_mutex};
+      m_in_flight = 0;
+      for (auto id : initial_nodes) {
+        m_ready_nodes.push(id);
+      }
+    }
+    start_ready();
+    end_work();
+    wait_idle_speculating(builder);
+    if (m_options.checkpoint) {
+      m_options.checkpoint->flush();
+    }
+    annotate(builder);
+    m_finished = std::chrono::steady_clock::now();
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+  }
+
+  /**
+   * @brief Waits until the graph is done, backing up straggling invocations
+   * meanwhile. Invocations discarded by speculation are not waited for.
+   */
+  auto wait_idle_speculating(graph::builder_core<executor_type>& builder)
+      -> void
+  {
+    if (!speculating()) {
+      wait_idle();
+      return;
+    }
+    while (true) {
+      auto [due, next] = due_backups(builder,
+                                     [this]
+                                     {
+                                       std::scoped_lock lock {m_ready_mutex};
+                                       if (!may_start(m_in_flight)) {
+                                         return false;
+                                       }
+                                       m_in_flight++;
+                                       return true;
+                                     });
+      for (auto id : due) {
+        begin_work();
+        m_pool->submit([this, id] { start_backup(id); });
+      }
+
+      auto until =
+          std::chrono::steady_clock::now() + speculation_check_interval;
+      if (next && *next < until) {
+        until = *next;
+      }
+      std::unique_lock lock {m_mutex};
+      if (m_idle.wait_until(
+              lock, until, [this] { return m_active.load() == 0; }))
+      {
+        return;
+      }
+    }
+  }
+
+  auto schedule(std::size_t id) -> void
+  {
+    {
+      std::scoped_lock lock {m_ready_mutex};
+      m_ready_nodes.push(id);
+    }
+    start_ready();
+  }
+
+  /**
+   * @brief Starts ready nodes on the pool while further invocations may be
+   * started. Nodes only wait in the queue while others are in flight, whose
+   * completion starts them.
+   */
+  auto start_ready() -> void
+  {
+    std::vector<std::size_t> starting;
+    {
+      std::scoped_lock lock {m_ready_mutex};
+      while (!m_ready_nodes.empty() && may_start(m_in_flight)) {
+        starting.push_back(m_ready_nodes.pop());
+        m_in_flight++;
+      }
+    }
+    for (auto id : starting) {
+      begin_work();
+      m_pool->submit([this, id] { start_node(id); });
+    }
+  }
+
+  auto release_slot() -> void
+  {
+    {
+      std::scoped_lock lock {m_ready_mutex};
+      m_in_flight--;
+    }
+    start_ready();
+  }
+
+  auto start_node(std::size_t id) -> void
+  {
+    auto builder = m_builder.lock();
+    if (builder && !m_failed.load()) {
+      auto& node = builder->at(id);
+      begin_work();
+      try {
+        std::optional<scoped_remote_threshold> threshold;
+        if (m_options.remote_threshold) {
+          threshold.emplace(*m_options.remote_threshold);
+        }
+        bool started = false;
+        if (!node.restored()) {
+          node.mark_started();
+          track(node);
+          started = node.start(
+              m_instance,
+              [this,
+               id,
+               state = node.shared_speculation(),
+               storage = node.retain()](std::exception_ptr error)
+              { on_finished(id, 0, state, std::move(error)); });
+        }
+        if (!started) {
+          end_work();
+          release_slot();
+          m_finished_nodes++;
+          node.propagate_value();
+        }
+      } catch (...) {
+        fail(std::current_exception());
+        end_work();
+        release_slot();
+      }
+    } else {
+      release_slot();
+    }
+    end_work();
+  }
+
+  /**
+   * @brief Starts the backup invocation of a node picked by `due_backups`,
+   * whose slot it holds.
+   */
+  auto start_backup(std::size_t id) -> void
+  {
+    auto builder = m_builder.lock();
+    if (builder && !m_failed.load()) {
+      auto& node = builder->at(id);
+      // One of the two invocations is discarded once the other finishes
+      {
+        std::scoped_lock lock {m_mutex};
+        m_discarded++;
+      }
+      try {
+        std::optional<scoped_remote_threshold> threshold;
+        if (m_options.remote_threshold) {
+          threshold.emplace(*m_options.remote_threshold);
+        }
+        node.start_backup(
+            m_instance,
+            [this,
+             id,
+             state = node.shared_speculation(),
+             storage = node.retain()](std::exception_ptr error)
+            { on_finished(id, 1, state, std::move(error)); });
+      } catch (...) {
+        {
+          std::scoped_lock lock {node.speculation()->mutex};
+          node.speculation()->pending--;
+        }
+        end_discarded();
+        fail(std::current_exception());
+        release_slot();
+      }
+    } else {
+      release_slot();
+    }
+    end_work();
+  }
+
+  // Called on the IO thread, the results are copied on the pool. `state` is
+  // the speculation state of the node, which outlives the graph
+  auto on_finished(std::size_t id,
+                   int attempt,
+                   const std::shared_ptr<speculative_invocation>& state,
+                   std::exception_ptr error) -> void
+  {
+    bool discarded = false;
+    if (auto builder = m_builder.lock()) {
+      auto& node = builder->at(id);
+      discarded = !settle(node, attempt, error != nullptr);
+      if (!discarded) {
+        node.mark_finished();
+      }
+    } else if (state) {
+      discarded = abandon(*state);
+    }
+    if (discarded) {
+      // The node is done with its other invocation
+      release_slot();
+      end_discarded();
+      return;
+    }
+    release_slot();
+    if (error) {
+      fail(std::move(error));
+    } else {
+      begin_work();
+      m_pool->submit(
+          [this, id]
+          {
+            if (auto builder = m_builder.lock()) {
+              auto& node = builder->at(id);
+              save(node);
+              m_finished_nodes++;
+              node.propagate_value();
+            }
+            end_work();
+          });
+    }
+    end_work();
+  }
+
+  /**
+   * @brief Like `settle` for an invocation finishing after its graph is gone,
+   * the first of two invocations is taken as done and the other discarded.
+   *
+   * @return Whether the invocation was discarded
+   */
+  static auto abandon(speculative_invocation& state) -> bool
+  {
+    std::scoped_lock lock {state.mutex};
+    state.pending--;
+    bool discarded = state.settled;
+    state.settled = true;
+    return discarded;
+  }
+
+  auto fail(std::exception_ptr error) -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    if (!m_error) {
+      m_error = std::move(error);
+    }
+    m_failed = true;
+  }
+
+  auto begin_work() -> void
+  {
+    m_active.fetch_add(1);
+  }
+
+  auto end_work() -> void
+  {
+    // Under the lock, a waiter seeing no work left may destroy the executor
+    std::scoped_lock lock {m_mutex};
+    if (m_active.fetch_sub(1) == 1) {
+      m_idle.notify_all();
+    }
+  }
+
+  auto end_discarded() -> void
+  {
+    std::scoped_lock lock {m_mutex};
+    if (--m_discarded == 0) {
+      m_idle.notify_all();
+    }
+  }
+
+  auto wait_idle() -> void
+  {
+    std::unique_lock lock {m_mutex};
+    m_idle.wait(lock, [this] { return m_active.load() == 0; });
+  }
+
   std::weak_ptr<graph::builder_core<executor_type>> m_builder;
+  host_controller_options m_options;
+
+  std::atomic<std::size_t> m_finished_nodes = 0;
+  std::size_t m_restored_nodes = 0;
+  // The nodes built before `await_all`, only these are checkpointed
+  std::size_t m_logged_nodes = 0;
+  ready_queue m_ready_nodes {};
+  std::mutex m_expansion_mutex;
+  // The node and attempt of every invocation in flight in a serial run,
+  // declared before the instance, whose destructor waits for invocations
+  // discarded by speculation to write into `storage`
+  struct invocation
+  {
+    std::size_t node;
+    int attempt;
+    std::shared_ptr<void> storage;
+  };
+  std::unordered_map<int, invocation> m_future_node_map {};
+
+  // Guards the latencies and the nodes which may still be backed up
+  std::mutex m_speculation_mutex;
+  std::unordered_map<std::string, latency_distribution> m_latencies;
+  std::vector<std::size_t> m_speculating;
+  speculation_statistics m_speculation_statistics;
+  // When the last graph was done
+  std::chrono::steady_clock::time_point m_finished;
+
+  // State of a parallel run, the pool outlives the instance whose IO thread
+  // submits to it
+  std::unique_ptr<thread_pool> m_pool;
+  std::atomic<std::size_t> m_active = 0;
+  std::atomic<bool> m_failed = false;
+  std::exception_ptr m_error;
+  std::mutex m_mutex;
+  std::condition_variable m_idle;
+  // Invocations discarded by speculation which are still running, guarded by
+  // `m_mutex`
+  std::size_t m_discarded = 0;
+  // Guards the ready nodes in a parallel run
+  std::mutex m_ready_mutex;
+  std::size_t m_in_flight = 0;
 
-  std::size_t m_finished_nodes = 0;
-  std::vector<std::size_t> m_ready_nodes {};
-  std::unordered_map<int, std::size_t> m_future_node_map {};
   typename Dispatcher::instance m_instance;
   std::shared_ptr<Dispatcher> m_dispatcher;
 };
@@ -39,5 +39,10 @@ public:
   class source_node : public graph::basic_source_node<noop_executor>
   {
   };
+
+  template<class Arg>
+  class expansion_node : public graph::basic_expansion_node<noop_executor, Arg>
+  {
+  };
 };
 }  // namespace cppless::executor
\ No newline at end of file
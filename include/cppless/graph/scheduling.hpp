@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <cppless/graph/adjacency.hpp>
+#include <nlohmann/json.hpp>
+
+namespace cppless::executor
+{
+
+/**
+ * @brief The order in which a graph executor starts ready nodes. It only
+ * matters once more nodes are ready than may be in flight.
+ */
+enum class scheduling_policy
+{
+  // The node which became ready last first
+  lifo,
+  // The node which became ready first first
+  fifo,
+  // The node with the highest upward rank first: the node on the most costly
+  // path to a sink, weighted by the cost hints of the tasks
+  critical_path,
+};
+
+/**
+ * @brief The cost of tasks without a cost hint, in milliseconds.
+ */
+constexpr double default_task_cost = 1;
+
+/**
+ * @brief Computes the upward rank of every node: its own cost plus the
+ * highest rank of its successors, i.e. the cost of the most costly path from
+ * the node to a sink.
+ *
+ * @param successors - The successors of every node
+ * @param costs - The cost of every node
+ */
+inline auto upward_ranks(const graph::adjacency& successors,
+                         const std::vector<double>& costs)
+    -> std::vector<double>
+{
+  auto count = successors.size();
+  // Kahn's algorithm, the ranks are filled in in reverse topological order
+  std::vector<std::size_t> in_degree(count);
+  for (std::size_t id = 0; id < count; id++) {
+    for (auto successor : successors.successors(id)) {
+      in_degree[successor]++;
+    }
+  }
+  std::vector<std::size_t> order;
+  order.reserve(count);
+  for (std::size_t id = 0; id < count; id++) {
+    if (in_degree[id] == 0) {
+      order.push_back(id);
+    }
+  }
+  for (std::size_t i = 0; i < order.size(); i++) {
+    for (auto successor : successors.successors(order[i])) {
+      if (--in_degree[successor] == 0) {
+        order.push_back(successor);
+      }
+    }
+  }
+  if (order.size() != count) {
+    throw std::runtime_error("The graph contains a cycle");
+  }
+
+  std::vector<double> ranks(count);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    double highest = 0;
+    for (auto successor : successors.successors(*it)) {
+      highest = std::max(highest, ranks[successor]);
+    }
+    ranks[*it] = costs[*it] + highest;
+  }
+  return ranks;
+}
+
+inline auto upward_ranks(
+    const std::vector<std::vector<std::size_t>>& successors,
+    const std::vector<double>& costs) -> std::vector<double>
+{
+  return upward_ranks(graph::adjacency(successors), costs);
+}
+
+/**
+ * @brief The nodes ready to be started, ordered by a `scheduling_policy`.
+ */
+class ready_queue
+{
+public:
+  explicit ready_queue(scheduling_policy policy = scheduling_policy::lifo,
+                       std::vector<double> ranks = {})
+      : m_policy(policy)
+      , m_ranks(std::move(ranks))
+  {
+  }
+
+  auto push(std::size_t id) -> void
+  {
+    if (m_policy == scheduling_policy::critical_path) {
+      m_ranked.emplace(m_ranks.at(id), id);
+    } else {
+      m_nodes.push_back(id);
+    }
+  }
+
+  auto pop() -> std::size_t
+  {
+    std::size_t id = 0;
+    switch (m_policy) {
+      case scheduling_policy::lifo:
+        id = m_nodes.back();
+        m_nodes.pop_back();
+        break;
+      case scheduling_policy::fifo:
+        id = m_nodes.front();
+        m_nodes.pop_front();
+        break;
+      case scheduling_policy::critical_path:
+        id = m_ranked.top().second;
+        m_ranked.pop();
+        break;
+    }
+    return id;
+  }
+
+  /**
+   * @brief Sets the rank of a node added while the graph runs.
+   */
+  auto set_rank(std::size_t id, double rank) -> void
+  {
+    if (id >= m_ranks.size()) {
+      m_ranks.resize(id + 1);
+    }
+    m_ranks[id] = rank;
+  }
+
+  [[nodiscard]] auto rank(std::size_t id) const -> double
+  {
+    return id < m_ranks.size() ? m_ranks[id] : 0;
+  }
+
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return m_nodes.empty() && m_ranked.empty();
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_nodes.size() + m_ranked.size();
+  }
+
+private:
+  // Highest rank first, of equal ranks the node created first
+  struct by_rank
+  {
+    auto operator()(const std::pair<double, std::size_t>& a,
+                    const std::pair<double, std::size_t>& b) const -> bool
+    {
+      if (a.first != b.first) {
+        return a.first < b.first;
+      }
+      return a.second > b.second;
+    }
+  };
+
+  scheduling_policy m_policy;
+  std::vector<double> m_ranks;
+  std::deque<std::size_t> m_nodes;
+  std::priority_queue<std::pair<double, std::size_t>,
+                      std::vector<std::pair<double, std::size_t>>,
+                      by_rank>
+      m_ranked;
+};
+
+/**
+ * @brief A node of a graph recorded by an executor, see
+ * `host_controller_executor::record`.
+ */
+struct recorded_node
+{
+  std::size_t id = 0;
+  std::vector<std::size_t> successors;
+  // Whether the node was invoked, e.g. not for source nodes
+  bool invoked = false;
+  // The time from starting the invocation until its result arrived, in
+  // milliseconds
+  double duration = 0;
+  // The cost hint the executor scheduled the node with
+  double cost = 0;
+};
+
+/**
+ * @brief The nodes of a recorded graph, indexed by their id.
+ */
+using recorded_graph = std::vector<recorded_node>;
+
+inline void to_json(nlohmann::json& j, const recorded_node& node)
+{
+  j = nlohmann::json {
+      {"id", node.id},
+      {"successors", node.successors},
+      {"invoked", node.invoked},
+      {"duration", node.duration},
+      {"cost", node.cost},
+  };
+}
+
+inline void from_json(const nlohmann::json& j, recorded_node& node)
+{
+  j.at("id").get_to(node.id);
+  j.at("successors").get_to(node.successors);
+  j.at("invoked").get_to(node.invoked);
+  j.at("duration").get_to(node.duration);
+  j.at("cost").get_to(node.cost);
+}
+
+/**
+ * @brief Replays a recorded graph offline: every invoked node takes its
+ * recorded duration, and ready nodes are started in the order of `policy`
+ * while fewer than `max_in_flight` are running, zero for no limit. Nodes
+ * which were not invoked finish instantly.
+ *
+ * @return The makespan in milliseconds
+ */
+inline auto simulate(const recorded_graph& graph,
+                     scheduling_policy policy,
+                     std::size_t max_in_flight = 0) -> double
+{
+  std::vector<std::vector<std::size_t>> successors(graph.size());
+  std::vector<double> costs(graph.size());
+  std::vector<std::size_t> dependencies(graph.size());
+  for (const auto& node : graph) {
+    successors[node.id] = node.successors;
+    costs[node.id] = node.cost;
+    for (auto successor : node.successors) {
+      dependencies[successor]++;
+    }
+  }
+  ready_queue ready(policy,
+                    policy == scheduling_policy::critical_path
+                        ? upward_ranks(successors, costs)
+                        : std::vector<double> {});
+  for (std::size_t id = 0; id < graph.size(); id++) {
+    if (dependencies[id] == 0) {
+      ready.push(id);
+    }
+  }
+
+  // Finish time and id of the running invocations, earliest first
+  std::priority_queue<std::pair<double, std::size_t>,
+                      std::vector<std::pair<double, std::size_t>>,
+                      std::greater<>>
+      running;
+  double now = 0;
+  auto finish = [&](std::size_t id)
+  {
+    for (auto successor : successors[id]) {
+      if (--dependencies[successor] == 0) {
+        ready.push(successor);
+      }
+    }
+  };
+  while (!ready.empty() || !running.empty()) {
+    while (!ready.empty()
+           && (max_in_flight == 0 || running.size() < max_in_flight))
+    {
+      auto id = ready.pop();
+      if (graph[id].invoked) {
+        running.emplace(now + graph[id].duration, id);
+      } else {
+        finish(id);
+      }
+    }
+    if (running.empty()) {
+      continue;
+    }
+    auto [time, id] = running.top();
+    running.pop();
+    now = time;
+    finish(id);
+  }
+  return now;
+}
+
+}  // namespace cppless::executor
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cppless::executor
+{
+
+struct speculation_options
+{
+  /**
+   * @brief A running invocation of a speculative task, see
+   * `aws::with_speculation`, gets a backup invocation once it has run longer
+   * than `factor` times this percentile of the durations of the finished
+   * invocations of the task. Zero disables speculation.
+   */
+  double percentile = 0;
+  /**
+   * @brief Keeps invocations from being backed up which take only slightly
+   * longer than the percentile, e.g. if the durations hardly vary.
+   */
+  double factor = 1.5;
+  /**
+   * @brief The invocations of a task which have to finish before its
+   * invocations get backups.
+   */
+  std::size_t min_samples = 10;
+  /**
+   * @brief The durations of the most recent invocations of a task which are
+   * considered.
+   */
+  std::size_t window = 1024;
+};
+
+struct speculation_statistics
+{
+  // Backup invocations started
+  std::size_t backups = 0;
+  // Backup invocations which finished before the invocation they backed up
+  std::size_t backups_won = 0;
+  // The makespan of the graph with the durations of the backed up
+  // invocations, minus its actual makespan, both replayed by `simulate`, in
+  // milliseconds. Backed up invocations which are still running count with
+  // their duration until the graph was done, thus this is a lower bound which
+  // tightens as they finish.
+  double makespan_saved = 0;
+};
+
+/**
+ * @brief How often a graph executor waiting for invocations checks whether
+ * one of them is due for a backup, unless one is due earlier.
+ */
+constexpr std::chrono::milliseconds speculation_check_interval {10};
+
+/**
+ * @brief The durations of the most recent invocations of a task.
+ */
+class latency_distribution
+{
+public:
+  explicit latency_distribution(std::size_t window = 1024)
+      : m_window(std::max<std::size_t>(window, 1))
+  {
+  }
+
+  auto add(double duration) -> void
+  {
+    if (m_samples.size() < m_window) {
+      m_samples.push_back(duration);
+    } else {
+      m_samples[m_next] = duration;
+      m_next = (m_next + 1) % m_window;
+    }
+    m_sorted.clear();
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_samples.size();
+  }
+
+  /**
+   * @brief The `p`th percentile of the durations by the nearest rank method,
+   * `p` between 0 and 100.
+   */
+  auto percentile(double p) -> double
+  {
+    if (m_samples.empty()) {
+      return 0;
+    }
+    // Sorted once after every change, speculation asks far more often than
+    // invocations finish
+    if (m_sorted.empty()) {
+      m_sorted = m_samples;
+      std::sort(m_sorted.begin(), m_sorted.end());
+    }
+    auto rank = static_cast<std::size_t>(
+        std::ceil(p / 100 * static_cast<double>(m_sorted.size())));
+    return m_sorted[std::clamp<std::size_t>(rank, 1, m_sorted.size()) - 1];
+  }
+
+private:
+  std::size_t m_window;
+  std::size_t m_next = 0;
+  std::vector<double> m_samples;
+  std::vector<double> m_sorted;
+};
+
+/**
+ * @brief The state of a node whose invocation may be backed up, see
+ * `host_controller_executor::node_core::speculation`.
+ */
+struct speculative_invocation
+{
+  // Identifies the task, whose invocations share a latency distribution
+  std::string task;
+
+  std::mutex mutex;
+  // Whether one of the invocations has delivered the result of the node
+  bool settled = false;
+  bool backed_up = false;
+  bool backup_won = false;
+  // Invocations which have not finished yet
+  int pending = 0;
+  std::chrono::steady_clock::time_point backup_started;
+  // The duration of the first invocation if the backup won and it finished
+  // before the graph was done
+  std::optional<double> primary_duration;
+};
+
+}  // namespace cppless::executor
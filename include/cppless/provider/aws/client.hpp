@@ -5,6 +5,7 @@
 #include <iomanip>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -12,9 +13,13 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/core/ignore_unused.hpp>
 #include <cppless/provider/aws/auth.hpp>
+#include <cppless/provider/aws/signing.hpp>
 #include <cppless/utils/beast/http_request_session.hpp>
+#include <cppless/utils/buffer_chain.hpp>
+#include <cppless/utils/crypto/hex.hpp>
 #include <cppless/utils/tracing.hpp>
 #include <nghttp2/asio_http2_client.h>
+#include <nghttp2/nghttp2.h>
 
 namespace cppless::aws
 {
@@ -87,6 +92,60 @@ public:
     return m_hostname;
   }
 
+  /**
+   * @brief Sends requests to `url`, `http[s]://host[:port]`, instead of the
+   * service's regional endpoint, e.g. to a local emulator.
+   */
+  auto set_endpoint(const std::string& url) -> void
+  {
+    auto scheme_end = url.find("://");
+    auto scheme = url.substr(0, scheme_end);
+    if (scheme_end == std::string::npos
+        || (scheme != "http" && scheme != "https"))
+    {
+      throw std::runtime_error("Invalid endpoint url: " + url);
+    }
+    m_secure = scheme == "https";
+
+    auto authority = url.substr(scheme_end + 3);
+    authority = authority.substr(0, authority.find('/'));
+    auto port_start = authority.rfind(':');
+    if (port_start != std::string::npos) {
+      m_port = authority.substr(port_start + 1);
+      m_hostname = authority.substr(0, port_start);
+    } else {
+      m_port = m_secure ? "443" : "80";
+      m_hostname = authority;
+    }
+  }
+
+  [[nodiscard]] auto port() const -> std::string
+  {
+    return m_port;
+  }
+
+  /**
+   * @brief Whether requests are sent over TLS.
+   */
+  [[nodiscard]] auto secure() const -> bool
+  {
+    return m_secure;
+  }
+
+  /**
+   * @brief The scheme and authority requests are sent to, e.g.
+   * `https://lambda.us-east-1.amazonaws.com`.
+   */
+  [[nodiscard]] auto endpoint_url() const -> std::string
+  {
+    std::string url = m_secure ? "https://" : "http://";
+    url += m_hostname;
+    if (m_port != (m_secure ? "443" : "80")) {
+      url += ":" + m_port;
+    }
+    return url;
+  }
+
   [[nodiscard]] auto region() const -> std::string
   {
     return m_region;
@@ -101,6 +160,8 @@ private:
   std::string m_hostname;
   std::string m_region;
   std::string m_service;
+  std::string m_port = "443";
+  bool m_secure = true;
 };
 
 template<class DerivedRequest, class ResultType, class ErrorType>
@@ -232,45 +293,98 @@ public:
               std::optional<tracing_span_ref> span)
       -> const nghttp2::asio_http2::client::request*
   {
-    boost::ignore_unused(span);
+    auto& request = static_cast<DerivedRequest&>(*this);
 
-    boost::system::error_code ec;
+    auto payload_hash_hex = hex_lower(request.payload_hash());
+    auto auth_header =
+        request.compute_authorization_header(payload_hash_hex, client, key);
+
+    return submit_signed(sess,
+                         client,
+                         payload_hash_hex,
+                         auth_header,
+                         key.security_token(),
+                         span);
+  }
 
+  /**
+   * @brief Submits the request, signing it with a signer created for this
+   * request's method, URL and query string.
+   */
+  auto submit(nghttp2::asio_http2::client::session& sess,
+              const client& client,
+              aws_v4_request_signer& signer,
+              std::optional<tracing_span_ref> span)
+      -> const nghttp2::asio_http2::client::request*
+  {
     auto& request = static_cast<DerivedRequest&>(*this);
 
-    auto payload_hash = request.payload_hash();
-    std::string payload_hash_hex;
-    payload_hash_hex.reserve(payload_hash.size() * 2L);
-    boost::algorithm::hex_lower(payload_hash.begin(),
-                                payload_hash.end(),
-                                std::back_inserter(payload_hash_hex));
+    auto payload_hash_hex = hex_lower(request.payload_hash());
+    const auto& auth_header =
+        signer.authorization_header(request.date(), payload_hash_hex);
 
-    auto auth_header =
-        request.compute_authorization_header(payload_hash_hex, client, key);
+    return submit_signed(sess,
+                         client,
+                         payload_hash_hex,
+                         auth_header,
+                         signer.security_token(),
+                         span);
+  }
 
-    auto full_url = "https://" + client.hostname() + request.canonical_url();
+private:
+  auto submit_signed(nghttp2::asio_http2::client::session& sess,
+                     const client& client,
+                     const std::string& payload_hash_hex,
+                     const std::string& auth_header,
+                     const std::optional<std::string>& security_token,
+                     std::optional<tracing_span_ref> span)
+      -> const nghttp2::asio_http2::client::request*
+  {
+    boost::system::error_code ec;
+
+    auto& request = static_cast<DerivedRequest&>(*this);
+
+    auto full_url = client.endpoint_url() + request.canonical_url();
     auto query_string = request.canonical_query_string();
     if (!query_string.empty()) {
       full_url += "?" + query_string;
     }
 
+    const auto& payload = request.payload();
     nghttp2::asio_http2::header_map headers = {
         {"X-Amz-Date", {request.date(), false}},
         {"X-Amz-Content-Sha256", {payload_hash_hex, false}},
         {"Authorization", {auth_header, true}},
+        {"content-length", {std::to_string(payload.size()), false}},
     };
 
-    auto security_token = key.security_token();
     if (security_token) {
       headers.insert({"X-Amz-Security-Token", {*security_token, true}});
     }
 
+    // The payload segments are handed to nghttp2 frame by frame, so the
+    // request body is never flattened into a single string.
+    auto generator = [reader = buffer_chain_reader {payload}](
+                         uint8_t* buf,
+                         std::size_t len,
+                         uint32_t* data_flags) mutable -> ssize_t
+    {
+      auto n = reader.read(reinterpret_cast<char*>(buf), len);  // NOLINT
+      if (reader.done()) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+      }
+      return static_cast<ssize_t>(n);
+    };
+
     const nghttp2::asio_http2::client::request* sess_req =
         sess.submit(ec,
                     request.http_request_method(),
                     full_url,
-                    request.payload(),
+                    std::move(generator),
                     headers);
+    if (sess_req == nullptr) {
+      return nullptr;
+    }
     sess_req->on_response(
         [&request, span](const nghttp2::asio_http2::client::response& res)
         { request.on_http2_response(res, span); });
@@ -326,7 +440,7 @@ public:
     m_request_session = std::make_shared<beast::http_request_session>(ioc, tls);
     boost::beast::http::request<boost::beast::http::string_body>& req =
         m_request_session->request();
-    req.body() = request.payload();
+    req.body() = request.payload().str();
     req.method(boost::beast::http::string_to_verb(method));
     req.target(target);
 
@@ -12,6 +12,7 @@
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <cppless/provider/aws/client.hpp>
+#include <cppless/utils/buffer_chain.hpp>
 #include <cppless/utils/crypto/hmac.hpp>
 #include <cppless/utils/crypto/wrappers.hpp>
 #include <cppless/utils/time.hpp>
@@ -53,11 +54,24 @@ public:
   {
   }
 
+  base_invocation_request(
+      std::string function_name,
+      std::string qualifier,
+      buffer_chain payload,
+      std::string date = format_aws_date(std::chrono::system_clock::now()))
+      : m_date(std::move(date))
+      , m_function_name(std::move(function_name))
+      , m_qualifier(std::move(qualifier))
+      , m_payload(std::move(payload))
+  {
+  }
+
 private:
   std::string m_date;
   std::string m_function_name;
   std::string m_qualifier;
-  std::string m_payload = {};
+  buffer_chain m_payload = {};
+  std::vector<unsigned char> m_payload_hash;
 
 public:
   auto set_tags(tracing_span_ref span) -> void
@@ -68,6 +82,10 @@ public:
     span.set_tag("payload_size", std::to_string(m_payload.size()));
   }
   [[nodiscard]] auto date() const -> std::string { return m_date; }
+  /**
+   * @brief Updates the signing date, e.g. before the request is retried.
+   */
+  auto set_date(std::string date) -> void { m_date = std::move(date); }
 
   static auto http_request_method() -> std::string { return "POST"; }
 
@@ -85,18 +103,41 @@ public:
     return "Qualifier=" + m_qualifier;
   }
   [[nodiscard]] auto payload_hash() const -> std::vector<unsigned char>
+  {
+    if (!m_payload_hash.empty()) {
+      return m_payload_hash;
+    }
+    return hash(m_payload);
+  }
+
+  /**
+   * @brief Uses `payload_hash` instead of hashing the payload whenever the
+   * request is signed, e.g. to hash it on another thread than the one
+   * submitting the request.
+   */
+  auto set_payload_hash(std::vector<unsigned char> payload_hash) -> void
+  {
+    m_payload_hash = std::move(payload_hash);
+  }
+
+  static auto hash(const buffer_chain& payload) -> std::vector<unsigned char>
   {
     evp_md_ctx ctx;
-    ctx.update({m_payload.begin(), m_payload.end()});
+    for (const auto& segment : payload.segments()) {
+      ctx.update(segment.data, segment.size);
+    }
     return ctx.final();
   }
 
-  [[nodiscard]] auto payload() const -> std::string { return m_payload; }
+  [[nodiscard]] auto payload() const -> const buffer_chain&
+  {
+    return m_payload;
+  }
 };
 
 struct invocation_response
 {
-  std::string body;
+  buffer_chain body;
   std::string request_id;  // x-amzn-RequestId
 } __attribute__((aligned(64)));
 
@@ -104,7 +145,24 @@ struct invocation_error_too_many_requests
 {
 };
 
-using invocation_error = std::variant<int, invocation_error_too_many_requests>;
+/**
+ * @brief The service rejected the invocation, or the function failed
+ * (`X-Amz-Function-Error`).
+ */
+struct invocation_error_status
+{
+  int status_code;
+  std::string body;
+  bool function_error = false;
+};
+
+/**
+ * @brief Either the HTTP/2 error code of a stream which closed without a
+ * response, or an error response.
+ */
+using invocation_error = std::variant<int,
+                                      invocation_error_too_many_requests,
+                                      invocation_error_status>;
 
 class nghttp2_invocation_request
     : public base_invocation_request<nghttp2_request<nghttp2_invocation_request,
@@ -119,34 +177,44 @@ public:
     if (span) {
       set_tags(*span);
     }
-    if (res.status_code() != 200) {
-      auto on_error = [&res, this](const std::vector<unsigned char>& body)
+    auto function_error = res.header().find("x-amz-function-error");
+    if (res.status_code() != 200 || function_error != res.header().end()) {
+      auto on_error = [status_code = res.status_code(),
+                       is_function_error = function_error
+                           != res.header().end(),
+                       this](std::string body)
       {
-        if (res.status_code() == 429) {
+        if (status_code == 429) {
           m_error_callback(invocation_error_too_many_requests {});
           return;
         }
-        std::cerr << "status_code: " << res.status_code() << std::endl;
-        std::cerr << "buffer: " << std::endl;
-        std::cerr << body.data() << std::endl;
+        m_error_callback(invocation_error_status {
+            .status_code = status_code,
+            .body = std::move(body),
+            .function_error = is_function_error,
+        });
       };
 
       res.on_data(
-          [on_error, buffer = std::vector<unsigned char> {}](
-              const uint8_t* data, std::size_t len) mutable
+          [on_error, buffer = std::string {}](const uint8_t* data,
+                                              std::size_t len) mutable
           {
-            buffer.insert(buffer.end(), &data[0], &data[len]);  // NOLINT
+            buffer.append(reinterpret_cast<const char*>(data),  // NOLINT
+                          len);
             if (len == 0) {
-              on_error(buffer);
+              on_error(std::move(buffer));
             }
           });
       return;
     }
 
+    // Drop what an earlier, interrupted attempt received
+    m_result = {};
     res.on_data(
         [this, &res, span](const uint8_t* data, std::size_t len) mutable
         {
-          m_result.insert(m_result.end(), &data[0], &data[len]);  // NOLINT
+          m_result.append(reinterpret_cast<const char*>(data),  // NOLINT
+                          len);
           if (len == 0) {
             auto request_id_it = res.header().find("x-amzn-requestid");
             std::string request_id = request_id_it != res.header().end()
@@ -160,7 +228,7 @@ public:
               span->set_tag("response_date", date);
             }
             m_result_callback({
-                .body = std::string {m_result.begin(), m_result.end()},
+                .body = std::move(m_result),
                 .request_id = request_id,
             });
           }
@@ -168,7 +236,7 @@ public:
   }
 
 private:
-  std::vector<unsigned char> m_result = {};
+  buffer_chain m_result = {};
 };
 
 class beast_invocation_request
@@ -198,7 +266,7 @@ public:
       span->set_tag("response_date", response_date);
     }
     m_result_callback({
-        .body = res.body(),
+        .body = buffer_chain {res.body()},
         .request_id = request_id,
     });
   }
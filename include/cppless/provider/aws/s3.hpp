@@ -11,6 +11,7 @@
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <cppless/provider/aws/client.hpp>
+#include <cppless/utils/buffer_chain.hpp>
 #include <cppless/utils/crypto/hmac.hpp>
 #include <cppless/utils/crypto/wrappers.hpp>
 #include <cppless/utils/time.hpp>
@@ -30,6 +31,15 @@ public:
   }
 };
 
+/**
+ * @brief The status and body of a response other than 200 OK.
+ */
+struct request_error
+{
+  int status_code;
+  std::string body;
+};
+
 template<class Base>
 class base_get_object_request : public Base
 {
@@ -77,45 +87,132 @@ public:
     return empty_string;
   }
 
-  [[nodiscard]] auto payload() const -> std::string
+  [[nodiscard]] auto payload() const -> buffer_chain
   {
-    return "";
+    return {};
   }
 };
 
 class nghttp2_get_object_request
     : public base_get_object_request<
-          nghttp2_request<nghttp2_get_object_request, std::string>>
+          nghttp2_request<nghttp2_get_object_request,
+                          std::string,
+                          request_error>>
 {
 public:
   using base_get_object_request::base_get_object_request;
-  auto on_http2_response(const nghttp2::asio_http2::client::response& res)
-      -> void
+  auto on_http2_response(const nghttp2::asio_http2::client::response& res,
+                         std::optional<tracing_span_ref> /*span*/) -> void
   {
     res.on_data(
-        [this, result = std::vector<unsigned char> {}](const uint8_t* data,
-                                                       std::size_t len) mutable
+        [this,
+         status_code = res.status_code(),
+         result = std::string {}](const uint8_t* data, std::size_t len) mutable
         {
-          result.insert(result.end(), &data[0], &data[len]);  // NOLINT
-          if (len == 0) {
-            m_result_callback(std::string {result.begin(), result.end()});
+          result.append(reinterpret_cast<const char*>(data), len);  // NOLINT
+          if (len != 0) {
+            return;
           }
+          if (status_code != 200) {
+            if (m_error_callback) {
+              m_error_callback({status_code, std::move(result)});
+            }
+            return;
+          }
+          m_result_callback(result);
         });
   }
 };
 
 class beast_get_object_request
     : public base_get_object_request<
-          beast_request<beast_get_object_request, std::string>>
+          beast_request<beast_get_object_request,
+                        std::string,
+                        request_error>>
 {
 public:
   using base_get_object_request::base_get_object_request;
   auto on_http1_response(
-      const boost::beast::http::response<boost::beast::http::string_body>& res)
-      -> void
+      const boost::beast::http::response<boost::beast::http::string_body>& res,
+      std::optional<tracing_span_ref> /*span*/) -> void
   {
     m_result_callback(res.body());
   }
 };
 
+template<class Base>
+class base_put_object_request : public Base
+{
+public:
+  base_put_object_request(
+      std::string key,
+      buffer_chain payload,
+      std::string date = format_aws_date(std::chrono::system_clock::now()))
+      : m_date(std::move(date))
+      , m_key(std::move(key))
+      , m_payload(std::move(payload))
+  {
+  }
+
+private:
+  std::string m_date;
+  std::string m_key;
+  buffer_chain m_payload;
+
+public:
+  [[nodiscard]] auto date() const -> std::string
+  {
+    return m_date;
+  }
+  static auto http_request_method() -> std::string
+  {
+    return "PUT";
+  }
+  [[nodiscard]] auto canonical_url() const -> std::string
+  {
+    return "/" + m_key;
+  }
+  [[nodiscard]] auto canonical_query_string() const -> std::string
+  {
+    return "";
+  }
+  [[nodiscard]] auto query_string() const -> std::string
+  {
+    return "";
+  }
+  [[nodiscard]] auto payload_hash() const -> std::vector<unsigned char>
+  {
+    evp_md_ctx ctx;
+    for (const auto& segment : m_payload.segments()) {
+      ctx.update(segment.data, segment.size);
+    }
+    return ctx.final();
+  }
+
+  [[nodiscard]] auto payload() const -> const buffer_chain&
+  {
+    return m_payload;
+  }
+};
+
+/**
+ * @brief Uploads an object, the result is the ETag of the stored object.
+ */
+class beast_put_object_request
+    : public base_put_object_request<
+          beast_request<beast_put_object_request,
+                        std::string,
+                        request_error>>
+{
+public:
+  using base_put_object_request::base_put_object_request;
+  auto on_http1_response(
+      const boost::beast::http::response<boost::beast::http::string_body>& res,
+      std::optional<tracing_span_ref> /*span*/) -> void
+  {
+    auto etag = res.find(boost::beast::http::field::etag);
+    m_result_callback(etag != res.end() ? std::string {etag->value()} : "");
+  }
+};
+
 }  // namespace cppless::aws::s3
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <cppless/provider/aws/auth.hpp>
+#include <cppless/utils/crypto/hex.hpp>
+#include <cppless/utils/crypto/wrappers.hpp>
+#include <cppless/utils/time.hpp>
+
+namespace cppless::aws
+{
+
+/**
+ * @brief Signs requests that only differ in their timestamp and payload.
+ *
+ * Everything that is constant for a given method, URL and query string is
+ * computed once: the canonical request up to the `x-amz-date` header is
+ * absorbed into a SHA-256 context, and the HMAC context keyed with the
+ * derived key has already consumed the algorithm line. Signing a request
+ * then copies both contexts and streams in the timestamp and the payload
+ * hash only. Authorization headers are additionally cached per second, so
+ * dispatching identical payloads within the same second is a lookup.
+ */
+class aws_v4_request_signer
+{
+public:
+  constexpr static std::size_t max_cached_signatures = 1024;
+
+  aws_v4_request_signer(const std::string& hostname,
+                        const std::string& region,
+                        const std::string& service,
+                        const aws_v4_derived_key& key,
+                        const std::string& method,
+                        const std::string& canonical_url,
+                        const std::string& canonical_query_string,
+                        const std::string& signed_headers = "host;x-amz-date")
+      : m_signing_prefix(key.key())
+      , m_canonical_suffix("\n\n" + signed_headers + "\n")
+      , m_scope_suffix("/" + region + "/" + service + "/aws4_request")
+      , m_credential_prefix("AWS4-HMAC-SHA256 Credential=" + key.id() + "/")
+      , m_signature_prefix(m_scope_suffix + ", SignedHeaders=" + signed_headers
+                           + ", Signature=")
+      , m_security_token(key.security_token())
+  {
+    m_canonical_prefix.update(method + "\n" + canonical_url + "\n"
+                              + canonical_query_string + "\nhost:" + hostname
+                              + "\nx-amz-date:");
+    m_signing_prefix.update("AWS4-HMAC-SHA256\n");
+  }
+
+  /**
+   * @brief Creates a signer for all requests sharing `request`'s method, URL
+   * and query string.
+   */
+  template<class Request, class Client>
+  static auto for_request(const Request& request,
+                          const Client& client,
+                          const aws_v4_derived_key& key)
+      -> aws_v4_request_signer
+  {
+    return aws_v4_request_signer {client.hostname(),
+                                  client.region(),
+                                  client.service(),
+                                  key,
+                                  request.http_request_method(),
+                                  request.canonical_url(),
+                                  request.canonical_query_string(),
+                                  request.signed_headers()};
+  }
+
+  /**
+   * @brief The current time in the `X-Amz-Date` format, only reformatted
+   * when the second changes.
+   */
+  auto date() -> const std::string&
+  {
+    auto now = std::chrono::system_clock::now();
+    auto second = std::chrono::system_clock::to_time_t(now);
+    if (second != m_date_second || m_date.empty()) {
+      m_date_second = second;
+      m_date = format_aws_date(now);
+    }
+    return m_date;
+  }
+
+  [[nodiscard]] auto security_token() const
+      -> const std::optional<std::string>&
+  {
+    return m_security_token;
+  }
+
+  /**
+   * @brief Computes the `Authorization` header of a request sent at
+   * `date_time` with a payload hashing to `payload_hash_hex`.
+   */
+  auto authorization_header(const std::string& date_time,
+                            const std::string& payload_hash_hex)
+      -> const std::string&
+  {
+    if (date_time != m_cache_date) {
+      m_cache.clear();
+      m_cache_date = date_time;
+    } else if (auto it = m_cache.find(payload_hash_hex); it != m_cache.end()) {
+      return it->second;
+    }
+    if (m_cache.size() >= max_cached_signatures) {
+      m_cache.clear();
+    }
+
+    constexpr std::size_t date_length = 8;
+    std::string_view date {date_time.data(), date_length};
+
+    std::array<char, 2 * EVP_MAX_MD_SIZE> hex {};
+
+    evp_md_ctx canonical {m_canonical_prefix};
+    canonical.update(date_time.data(), date_time.size());
+    canonical.update(m_canonical_suffix.data(), m_canonical_suffix.size());
+    canonical.update(payload_hash_hex.data(), payload_hash_hex.size());
+    auto canonical_hash = canonical.final();
+    hex_lower(canonical_hash, hex.data());
+
+    evp_sign_ctx signing {m_signing_prefix};
+    signing.update(date_time.data(), date_time.size());
+    signing.update("\n", 1);
+    signing.update(date.data(), date.size());
+    signing.update(m_scope_suffix.data(), m_scope_suffix.size());
+    signing.update("\n", 1);
+    signing.update(hex.data(), canonical_hash.size() * 2);
+    auto signature = signing.final();
+
+    std::string header;
+    header.reserve(m_credential_prefix.size() + date.size()
+                   + m_signature_prefix.size() + signature.size() * 2);
+    header += m_credential_prefix;
+    header += date;
+    header += m_signature_prefix;
+    auto offset = header.size();
+    header.resize(offset + signature.size() * 2);
+    hex_lower(signature, header.data() + offset);
+
+    return m_cache.insert_or_assign(payload_hash_hex, std::move(header))
+        .first->second;
+  }
+
+private:
+  evp_md_ctx m_canonical_prefix;
+  evp_sign_ctx m_signing_prefix;
+  std::string m_canonical_suffix;
+  std::string m_scope_suffix;
+  std::string m_credential_prefix;
+  std::string m_signature_prefix;
+  std::optional<std::string> m_security_token;
+
+  std::time_t m_date_second = 0;
+  std::string m_date;
+
+  std::string m_cache_date;
+  std::unordered_map<std::string, std::string> m_cache;
+};
+
+}  // namespace cppless::aws
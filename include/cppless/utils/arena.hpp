@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+
+namespace cppless
+{
+
+/**
+ * @brief A bump allocator for objects which live about as long as each other,
+ * e.g. the nodes of a graph. Allocations are placed back to back in growing
+ * chunks and never freed individually; the chunks are released together with
+ * the arena. Allocations may be made from multiple threads.
+ */
+class arena : public std::pmr::memory_resource
+{
+public:
+  explicit arena(std::size_t initial_size = 64UL * 1024)
+      : m_resource(initial_size)
+  {
+  }
+
+  /**
+   * @brief The number of bytes handed out so far.
+   */
+  [[nodiscard]] auto allocated() -> std::size_t
+  {
+    std::scoped_lock lock {m_mutex};
+    return m_allocated;
+  }
+
+private:
+  auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override
+  {
+    std::scoped_lock lock {m_mutex};
+    m_allocated += bytes;
+    return m_resource.allocate(bytes, alignment);
+  }
+
+  auto do_deallocate(void* /*p*/,
+                     std::size_t /*bytes*/,
+                     std::size_t /*alignment*/) -> void override
+  {
+  }
+
+  [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource& other)
+      const noexcept -> bool override
+  {
+    return this == &other;
+  }
+
+  std::mutex m_mutex;
+  std::pmr::monotonic_buffer_resource m_resource;
+  std::size_t m_allocated = 0;
+};
+
+/**
+ * @brief An allocator sharing ownership of its arena, thus objects created
+ * with `std::allocate_shared` keep the arena alive until they are destroyed,
+ * even if they outlive the owner of the arena.
+ */
+template<class T>
+class arena_allocator
+{
+public:
+  using value_type = T;
+
+  explicit arena_allocator(std::shared_ptr<arena> memory)
+      : m_arena(std::move(memory))
+  {
+  }
+
+  template<class U>
+  explicit(false) arena_allocator(const arena_allocator<U>& other)
+      : m_arena(other.memory())
+  {
+  }
+
+  auto allocate(std::size_t n) -> T*
+  {
+    return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  auto deallocate(T* /*p*/, std::size_t /*n*/) noexcept -> void {}
+
+  [[nodiscard]] auto memory() const -> const std::shared_ptr<arena>&
+  {
+    return m_arena;
+  }
+
+  template<class U>
+  auto operator==(const arena_allocator<U>& other) const -> bool
+  {
+    return m_arena == other.memory();
+  }
+
+private:
+  std::shared_ptr<arena> m_arena;
+};
+
+/**
+ * @brief Creates a `T` in `memory`, sharing a single allocation with its
+ * reference count.
+ */
+template<class T, class... Args>
+auto make_shared_in(const std::shared_ptr<arena>& memory, Args&&... args)
+    -> std::shared_ptr<T>
+{
+  return std::allocate_shared<T>(arena_allocator<T>(memory),
+                                 std::forward<Args>(args)...);
+}
+
+}  // namespace cppless
@@ -0,0 +1,782 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cppless/utils/buffer_chain.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define CPPLESS_BASE64_X86
+#  include <immintrin.h>
+#endif
+
+namespace cppless::base64
+{
+
+/**
+ * @brief The block kernels the codec can use. `automatic` selects the widest
+ * one supported by the CPU at runtime.
+ */
+enum class kernel
+{
+  automatic,
+  scalar,
+  sse41,
+  avx2,
+};
+
+constexpr auto encoded_size(std::size_t n) -> std::size_t
+{
+  return 4 * ((n + 2) / 3);
+}
+
+/**
+ * @brief Upper bound of the number of bytes `n` base64 characters decode to.
+ */
+constexpr auto decoded_size(std::size_t n) -> std::size_t
+{
+  return n / 4 * 3 + 2;
+}
+
+namespace detail
+{
+
+constexpr std::string_view alphabet =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr std::uint8_t invalid = 0xff;
+constexpr std::uint8_t padding = 0xfe;
+
+constexpr auto make_decode_table() -> std::array<std::uint8_t, 256>
+{
+  std::array<std::uint8_t, 256> table {};
+  for (auto& entry : table) {
+    entry = invalid;
+  }
+  for (std::size_t i = 0; i < alphabet.size(); i++) {
+    table[static_cast<unsigned char>(alphabet[i])] =
+        static_cast<std::uint8_t>(i);
+  }
+  table['='] = padding;
+  return table;
+}
+
+constexpr std::array<std::uint8_t, 256> decode_table = make_decode_table();
+
+inline auto encode_scalar(char* out, const unsigned char* in, std::size_t n)
+    -> std::size_t
+{
+  std::size_t consumed = 0;
+  for (; consumed + 3 <= n; consumed += 3) {
+    std::uint32_t x = (static_cast<std::uint32_t>(in[consumed]) << 16U)
+        | (static_cast<std::uint32_t>(in[consumed + 1]) << 8U)
+        | in[consumed + 2];
+    *out++ = alphabet[(x >> 18U) & 63U];  // NOLINT
+    *out++ = alphabet[(x >> 12U) & 63U];  // NOLINT
+    *out++ = alphabet[(x >> 6U) & 63U];  // NOLINT
+    *out++ = alphabet[x & 63U];  // NOLINT
+  }
+  return consumed;
+}
+
+[[noreturn]] inline auto throw_invalid() -> void
+{
+  throw std::runtime_error("Invalid base64 input");
+}
+
+// Decodes one group of four characters, of which the last one or two may be
+// padding. Returns the number of bytes written.
+inline auto decode_quad(char* out, const char* in) -> std::size_t
+{
+  std::array<std::uint8_t, 4> v {};
+  for (std::size_t i = 0; i < 4; i++) {
+    v[i] = decode_table[static_cast<unsigned char>(in[i])];  // NOLINT
+  }
+  if ((v[0] | v[1]) >= 64U || v[2] == invalid || v[3] == invalid
+      || (v[2] == padding && v[3] != padding))
+  {
+    throw_invalid();
+  }
+  std::uint32_t x = (static_cast<std::uint32_t>(v[0]) << 18U)
+      | (static_cast<std::uint32_t>(v[1]) << 12U);
+  out[0] = static_cast<char>(x >> 16U);  // NOLINT
+  if (v[2] == padding) {
+    return 1;
+  }
+  x |= static_cast<std::uint32_t>(v[2]) << 6U;
+  out[1] = static_cast<char>((x >> 8U) & 0xffU);  // NOLINT
+  if (v[3] == padding) {
+    return 2;
+  }
+  x |= v[3];
+  out[2] = static_cast<char>(x & 0xffU);  // NOLINT
+  return 3;
+}
+
+#ifdef CPPLESS_BASE64_X86
+
+// Vectorized codec after W. Muła and D. Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions". The encoder reshuffles 12 (24) input
+// bytes into 16 (32) 6-bit indices and translates them with a single pshufb
+// lookup; the decoder validates 16 (32) characters with two nibble lookups
+// and stops at the first block containing a byte outside the alphabet,
+// including padding, leaving it to the scalar code.
+
+// Offsets from 6-bit indices to their characters, selected by the index
+// range each character class occupies.
+__attribute__((target("ssse3,sse4.1"))) inline auto shift_lut_128() -> __m128i
+{
+  return _mm_setr_epi8('a' - 26,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '0' - 52,
+                       '+' - 62,
+                       '/' - 63,
+                       'A',
+                       0,
+                       0);
+}
+
+__attribute__((target("ssse3,sse4.1"))) inline auto encode_sse41(
+    char* out, const unsigned char* in, std::size_t n) -> std::size_t
+{
+  const __m128i shuffle =
+      _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m128i shift_lut = shift_lut_128();
+  std::size_t consumed = 0;
+  // Each iteration loads 16 bytes but only consumes 12
+  for (; consumed + 16 <= n; consumed += 12) {
+    __m128i v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(in + consumed));  // NOLINT
+    v = _mm_shuffle_epi8(v, shuffle);
+    const __m128i t0 = _mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(v, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    __m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    reduced = _mm_or_si128(reduced, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i result =
+        _mm_add_epi8(_mm_shuffle_epi8(shift_lut, reduced), indices);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), result);  // NOLINT
+    out += 16;  // NOLINT
+  }
+  return consumed;
+}
+
+__attribute__((target("avx2"))) inline auto encode_avx2(
+    char* out, const unsigned char* in, std::size_t n) -> std::size_t
+{
+  const __m256i shuffle = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  const __m256i shift_lut = _mm256_broadcastsi128_si256(shift_lut_128());
+  std::size_t consumed = 0;
+  // Each lane loads 16 bytes but only consumes 12
+  for (; consumed + 28 <= n; consumed += 24) {
+    const auto* src = in + consumed;  // NOLINT
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),  // NOLINT
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)),  // NOLINT
+        1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    reduced = _mm256_or_si256(reduced,
+                              _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    const __m256i result =
+        _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, reduced), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);  // NOLINT
+    out += 32;  // NOLINT
+  }
+  return consumed;
+}
+
+// Both decoders store a whole register but only produce 12 (24) bytes per
+// block, so they leave at least 8 (16) characters of input to the scalar
+// code, whose output covers the overhang.
+
+// Character classes by low and high nibble; a character is valid iff the
+// classes of its two nibbles do not intersect.
+__attribute__((target("ssse3,sse4.1"))) inline auto decode_lut_lo() -> __m128i
+{
+  return _mm_setr_epi8(0x15,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x11,
+                       0x13,
+                       0x1A,
+                       0x1B,
+                       0x1B,
+                       0x1B,
+                       0x1A);
+}
+
+__attribute__((target("ssse3,sse4.1"))) inline auto decode_lut_hi() -> __m128i
+{
+  return _mm_setr_epi8(0x10,
+                       0x10,
+                       0x01,
+                       0x02,
+                       0x04,
+                       0x08,
+                       0x04,
+                       0x08,
+                       0x10,
+                       0x10,
+                       0x10,
+                       0x10,
+                       0x10,
+                       0x10,
+                       0x10,
+                       0x10);
+}
+
+__attribute__((target("ssse3,sse4.1"))) inline auto decode_sse41(
+    char* out, const char* in, std::size_t n) -> std::size_t
+{
+  const __m128i lut_lo = decode_lut_lo();
+  const __m128i lut_hi = decode_lut_hi();
+  const __m128i lut_roll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2f);
+  const __m128i pack =
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  std::size_t consumed = 0;
+  for (; consumed + 24 <= n; consumed += 16) {
+    __m128i v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(in + consumed));  // NOLINT
+    const __m128i hi_nibbles =
+        _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(v, mask_2f);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm_testz_si128(lo, hi) == 0) {
+      break;
+    }
+    const __m128i eq_2f = _mm_cmpeq_epi8(v, mask_2f);
+    const __m128i roll =
+        _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    v = _mm_add_epi8(v, roll);
+
+    const __m128i merged =
+        _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    __m128i result = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    result = _mm_shuffle_epi8(result, pack);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), result);  // NOLINT
+    out += 12;  // NOLINT
+  }
+  return consumed;
+}
+
+__attribute__((target("avx2"))) inline auto decode_avx2(char* out,
+                                                        const char* in,
+                                                        std::size_t n)
+    -> std::size_t
+{
+  const __m256i lut_lo = _mm256_broadcastsi128_si256(decode_lut_lo());
+  const __m256i lut_hi = _mm256_broadcastsi128_si256(decode_lut_hi());
+  const __m256i lut_roll = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack = _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+  std::size_t consumed = 0;
+  for (; consumed + 48 <= n; consumed += 32) {
+    __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(in + consumed));  // NOLINT
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(v, mask_2f);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm256_testz_si256(lo, hi) == 0) {
+      break;
+    }
+    const __m256i eq_2f = _mm256_cmpeq_epi8(v, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    v = _mm256_add_epi8(v, roll);
+
+    const __m256i merged =
+        _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    __m256i result = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    result = _mm256_shuffle_epi8(result, pack);
+    result = _mm256_permutevar8x32_epi32(result, lanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);  // NOLINT
+    out += 24;  // NOLINT
+  }
+  return consumed;
+}
+
+#endif
+
+inline auto detect_kernel() -> kernel
+{
+#ifdef CPPLESS_BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return kernel::avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) {
+    return kernel::sse41;
+  }
+#endif
+  return kernel::scalar;
+}
+
+}  // namespace detail
+
+/**
+ * @brief The widest kernel supported by the CPU, detected once.
+ */
+inline auto best_kernel() -> kernel
+{
+  static const kernel k = detail::detect_kernel();
+  return k;
+}
+
+/**
+ * @brief Encodes the longest prefix of `in` that is a multiple of three bytes
+ * long, without padding. Returns the number of input bytes consumed.
+ */
+inline auto encode_blocks(char* out,
+                          const unsigned char* in,
+                          std::size_t n,
+                          kernel k = kernel::automatic) -> std::size_t
+{
+  if (k == kernel::automatic) {
+    k = best_kernel();
+  }
+  std::size_t consumed = 0;
+#ifdef CPPLESS_BASE64_X86
+  if (k == kernel::avx2) {
+    consumed = detail::encode_avx2(out, in, n);
+  } else if (k == kernel::sse41) {
+    consumed = detail::encode_sse41(out, in, n);
+  }
+#endif
+  return consumed
+      + detail::encode_scalar(out + consumed / 3 * 4,  // NOLINT
+                              in + consumed,  // NOLINT
+                              n - consumed);
+}
+
+/**
+ * @brief Decodes `n` characters, a multiple of four, of which only the last
+ * group may contain padding. Returns the number of bytes written.
+ */
+inline auto decode_blocks(char* out,
+                          const char* in,
+                          std::size_t n,
+                          kernel k = kernel::automatic) -> std::size_t
+{
+  if (k == kernel::automatic) {
+    k = best_kernel();
+  }
+  std::size_t consumed = 0;
+#ifdef CPPLESS_BASE64_X86
+  if (k == kernel::avx2) {
+    consumed = detail::decode_avx2(out, in, n);
+  } else if (k == kernel::sse41) {
+    consumed = detail::decode_sse41(out, in, n);
+  }
+#endif
+  std::size_t written = consumed / 4 * 3;
+  for (; consumed < n; consumed += 4) {
+    auto w = detail::decode_quad(out + written, in + consumed);  // NOLINT
+    written += w;
+    if (w < 3 && consumed + 4 < n) {
+      detail::throw_invalid();
+    }
+  }
+  return written;
+}
+
+/**
+ * @brief Incremental encoder, carrying incomplete groups of three bytes over
+ * to the next call.
+ */
+class encoder
+{
+public:
+  explicit encoder(kernel k = kernel::automatic)
+      : m_kernel(k)
+  {
+  }
+
+  /**
+   * @brief The output capacity `update` needs for `n` more input bytes.
+   */
+  [[nodiscard]] auto update_size(std::size_t n) const -> std::size_t
+  {
+    return (m_carry_size + n) / 3 * 4;
+  }
+
+  /**
+   * @brief Encodes `in` into `out`, which has to hold `update_size(n)`
+   * characters, and returns the number of characters written.
+   */
+  auto update(const char* in, std::size_t n, char* out) -> std::size_t
+  {
+    const auto* data = reinterpret_cast<const unsigned char*>(in);  // NOLINT
+    std::size_t written = 0;
+    if (m_carry_size > 0) {
+      while (m_carry_size < 3 && n > 0) {
+        m_carry[m_carry_size++] = *data++;  // NOLINT
+        n--;
+      }
+      if (m_carry_size < 3) {
+        return 0;
+      }
+      written += detail::encode_scalar(out, m_carry.data(), 3) / 3 * 4;
+      m_carry_size = 0;
+    }
+    auto consumed = encode_blocks(out + written, data, n, m_kernel);  // NOLINT
+    written += consumed / 3 * 4;
+    for (; consumed < n; consumed++) {
+      m_carry[m_carry_size++] = data[consumed];  // NOLINT
+    }
+    return written;
+  }
+
+  /**
+   * @brief Encodes the carried bytes with padding into `out`, which has to
+   * hold four characters, and returns the number of characters written.
+   */
+  auto finish(char* out) -> std::size_t
+  {
+    if (m_carry_size == 0) {
+      return 0;
+    }
+    std::uint32_t x = static_cast<std::uint32_t>(m_carry[0]) << 16U;
+    if (m_carry_size == 2) {
+      x |= static_cast<std::uint32_t>(m_carry[1]) << 8U;
+    }
+    out[0] = detail::alphabet[(x >> 18U) & 63U];  // NOLINT
+    out[1] = detail::alphabet[(x >> 12U) & 63U];  // NOLINT
+    out[2] = m_carry_size == 2 ? detail::alphabet[(x >> 6U) & 63U]  // NOLINT
+                               : '=';
+    out[3] = '=';  // NOLINT
+    m_carry_size = 0;
+    return 4;
+  }
+
+private:
+  kernel m_kernel;
+  std::array<unsigned char, 3> m_carry {};
+  std::size_t m_carry_size = 0;
+};
+
+/**
+ * @brief Incremental decoder, carrying incomplete groups of four characters
+ * over to the next call. Throws `std::runtime_error` on invalid input.
+ */
+class decoder
+{
+public:
+  explicit decoder(kernel k = kernel::automatic)
+      : m_kernel(k)
+  {
+  }
+
+  /**
+   * @brief The output capacity `update` needs for `n` more characters.
+   */
+  [[nodiscard]] auto update_size(std::size_t n) const -> std::size_t
+  {
+    return (m_carry_size + n) / 4 * 3;
+  }
+
+  auto update(const char* in, std::size_t n, char* out) -> std::size_t
+  {
+    if (n == 0) {
+      return 0;
+    }
+    if (m_padded) {
+      detail::throw_invalid();
+    }
+    std::size_t written = 0;
+    if (m_carry_size > 0) {
+      while (m_carry_size < 4 && n > 0) {
+        m_carry[m_carry_size++] = *in++;  // NOLINT
+        n--;
+      }
+      if (m_carry_size < 4) {
+        return 0;
+      }
+      written += decode_group(out, m_carry.data(), 4, n > 0);
+      m_carry_size = 0;
+    }
+    auto whole = n / 4 * 4;
+    if (whole > 0) {
+      written += decode_group(out + written, in, whole, whole < n);  // NOLINT
+    }
+    for (auto i = whole; i < n; i++) {
+      m_carry[m_carry_size++] = in[i];  // NOLINT
+    }
+    return written;
+  }
+
+  /**
+   * @brief Decodes the carried characters of unpadded input into `out`,
+   * which has to hold two bytes, and returns the number of bytes written.
+   */
+  auto finish(char* out) -> std::size_t
+  {
+    if (m_carry_size == 0) {
+      return 0;
+    }
+    if (m_carry_size == 1) {
+      detail::throw_invalid();
+    }
+    for (auto i = m_carry_size; i < 4; i++) {
+      m_carry[i] = '=';  // NOLINT
+    }
+    m_carry_size = 0;
+    return decode_group(out, m_carry.data(), 4, false);
+  }
+
+private:
+  auto decode_group(char* out, const char* in, std::size_t n, bool more)
+      -> std::size_t
+  {
+    auto written = decode_blocks(out, in, n, m_kernel);
+    if (written < n / 4 * 3) {
+      if (more) {
+        detail::throw_invalid();
+      }
+      m_padded = true;
+    }
+    return written;
+  }
+
+  kernel m_kernel;
+  std::array<char, 4> m_carry {};
+  std::size_t m_carry_size = 0;
+  bool m_padded = false;
+};
+
+/**
+ * @brief Appends to a string through the `prepare`/`commit` interface of
+ * `buffer_chain`.
+ */
+class string_sink
+{
+public:
+  explicit string_sink(std::string& s)
+      : m_string(s)
+      , m_size(s.size())
+  {
+  }
+
+  auto prepare(std::size_t min_size) -> std::span<char>
+  {
+    if (m_string.size() < m_size + min_size) {
+      m_string.resize(std::max(m_size + min_size, 2 * m_string.size()));
+    }
+    return {m_string.data() + m_size, m_string.size() - m_size};
+  }
+
+  auto commit(std::size_t size) -> void
+  {
+    m_size += size;
+  }
+
+  /**
+   * @brief Trims the string to the committed bytes.
+   */
+  auto finish() -> void
+  {
+    m_string.resize(m_size);
+  }
+
+private:
+  std::string& m_string;
+  std::size_t m_size;
+};
+
+/**
+ * @brief A stream buffer base64 encoding everything written to it into
+ * `Sink`, as the bytes are produced.
+ *
+ * Output is buffered in blocks of a few kilobytes, so the encoder runs over
+ * data that is still in cache. `finish` flushes the buffer and appends the
+ * padding; writes after it start a new encoding.
+ */
+template<class Sink>
+class ostreambuf : public std::streambuf
+{
+public:
+  constexpr static std::size_t buffer_size = 3 * 4096;
+
+  explicit ostreambuf(Sink& sink, kernel k = kernel::automatic)
+      : m_sink(sink)
+      , m_encoder(k)
+  {
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+  }
+
+  ostreambuf(const ostreambuf&) = delete;
+  auto operator=(const ostreambuf&) -> ostreambuf& = delete;
+  ostreambuf(ostreambuf&&) = delete;
+  auto operator=(ostreambuf&&) -> ostreambuf& = delete;
+  ~ostreambuf() override = default;
+
+  auto finish() -> void
+  {
+    flush();
+    auto out = m_sink.prepare(4);
+    m_sink.commit(m_encoder.finish(out.data()));
+  }
+
+protected:
+  auto overflow(int_type ch) -> int_type override
+  {
+    flush();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+  {
+    auto size = static_cast<std::size_t>(n);
+    auto available = static_cast<std::size_t>(epptr() - pptr());
+    if (size <= available) {
+      std::memcpy(pptr(), s, size);
+      pbump(static_cast<int>(size));
+      return n;
+    }
+    // Large writes bypass the buffer
+    flush();
+    encode(s, size);
+    return n;
+  }
+
+  auto sync() -> int override
+  {
+    flush();
+    return 0;
+  }
+
+private:
+  auto flush() -> void
+  {
+    encode(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+  }
+
+  auto encode(const char* data, std::size_t size) -> void
+  {
+    auto required = m_encoder.update_size(size);
+    if (required == 0) {
+      m_encoder.update(data, size, nullptr);
+      return;
+    }
+    auto out = m_sink.prepare(required);
+    m_sink.commit(m_encoder.update(data, size, out.data()));
+  }
+
+  Sink& m_sink;
+  encoder m_encoder;
+  std::array<char, buffer_size> m_buffer {};
+};
+
+/**
+ * @brief A stream buffer decoding base64 input on demand, a few kilobytes at
+ * a time. The input has to outlive the stream buffer.
+ */
+class istreambuf : public std::streambuf
+{
+public:
+  constexpr static std::size_t chunk_size = 4 * 4096;
+
+  explicit istreambuf(std::string_view input, kernel k = kernel::automatic)
+      : m_input {input}
+      , m_decoder(k)
+  {
+  }
+
+  explicit istreambuf(const buffer_chain& input, kernel k = kernel::automatic)
+      : m_decoder(k)
+  {
+    m_input.reserve(input.segments().size());
+    for (const auto& segment : input.segments()) {
+      m_input.emplace_back(segment.data, segment.size);
+    }
+  }
+
+protected:
+  auto underflow() -> int_type override
+  {
+    std::size_t produced = 0;
+    while (produced == 0 && m_index < m_input.size()) {
+      auto segment = m_input[m_index];
+      auto n = std::min(chunk_size, segment.size() - m_offset);
+      produced =
+          m_decoder.update(segment.data() + m_offset, n, m_buffer.data());
+      m_offset += n;
+      if (m_offset == segment.size()) {
+        m_index++;
+        m_offset = 0;
+      }
+    }
+    if (produced == 0 && !m_finished) {
+      m_finished = true;
+      produced = m_decoder.finish(m_buffer.data());
+    }
+    if (produced == 0) {
+      return traits_type::eof();
+    }
+    setg(m_buffer.data(),
+         m_buffer.data(),
+         m_buffer.data() + produced);  // NOLINT
+    return traits_type::to_int_type(*gptr());
+  }
+
+private:
+  std::vector<std::string_view> m_input;
+  std::size_t m_index = 0;
+  std::size_t m_offset = 0;
+  decoder m_decoder;
+  bool m_finished = false;
+  std::array<char, (chunk_size + 4) / 4 * 3> m_buffer {};
+};
+
+}  // namespace cppless::base64
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cppless
+{
+
+/**
+ * @brief A scatter/gather byte sequence made of reference counted blocks.
+ *
+ * Copying a chain shares its blocks instead of their contents. New bytes are
+ * only ever written behind the bytes visible through existing segments, so a
+ * block is never modified once another chain can observe it.
+ */
+class buffer_chain
+{
+public:
+  struct segment
+  {
+    std::shared_ptr<const void> owner;
+    const char* data;
+    std::size_t size;
+  };
+
+  constexpr static std::size_t min_block_size = 4096;
+  constexpr static std::size_t max_block_size = 1024 * 1024;
+
+  buffer_chain() = default;
+
+  /**
+   * @brief Adopts the storage of `data` without copying it.
+   */
+  explicit buffer_chain(std::string data)
+  {
+    append(std::move(data));
+  }
+
+  buffer_chain(const buffer_chain& other)
+      : m_segments(other.m_segments)
+      , m_size(other.m_size)
+  {
+  }
+
+  auto operator=(const buffer_chain& other) -> buffer_chain&
+  {
+    if (this != &other) {
+      m_segments = other.m_segments;
+      m_size = other.m_size;
+      m_tail.reset();
+      m_tail_capacity = 0;
+      m_tail_used = 0;
+      m_tail_is_last = false;
+    }
+    return *this;
+  }
+
+  buffer_chain(buffer_chain&&) noexcept = default;
+  auto operator=(buffer_chain&&) noexcept -> buffer_chain& = default;
+  ~buffer_chain() = default;
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_size;
+  }
+
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return m_size == 0;
+  }
+
+  [[nodiscard]] auto segments() const -> const std::vector<segment>&
+  {
+    return m_segments;
+  }
+
+  /**
+   * @brief Returns a writable region of at least `min_size` contiguous bytes
+   * at the end of the chain. Bytes become part of the chain by calling
+   * `commit`.
+   */
+  auto prepare(std::size_t min_size) -> std::span<char>
+  {
+    if (!m_tail || m_tail_capacity - m_tail_used < min_size) {
+      auto block_size = std::max(min_size, m_next_block_size);
+      m_next_block_size = std::min(m_next_block_size * 2, max_block_size);
+      m_tail = std::shared_ptr<char[]>(new char[block_size]);  // NOLINT
+      m_tail_capacity = block_size;
+      m_tail_used = 0;
+      m_tail_is_last = false;
+    }
+    return {m_tail.get() + m_tail_used, m_tail_capacity - m_tail_used};
+  }
+
+  auto commit(std::size_t size) -> void
+  {
+    if (size == 0) {
+      return;
+    }
+    const char* start = m_tail.get() + m_tail_used;
+    if (m_tail_is_last) {
+      m_segments.back().size += size;
+    } else {
+      m_segments.push_back({m_tail, start, size});
+      m_tail_is_last = true;
+    }
+    m_tail_used += size;
+    m_size += size;
+    copied_bytes() += size;
+  }
+
+  /**
+   * @brief Appends a copy of `size` bytes starting at `data`.
+   */
+  auto append(const char* data, std::size_t size) -> void
+  {
+    while (size > 0) {
+      auto region = prepare(1);
+      auto n = std::min(size, region.size());
+      std::memcpy(region.data(), data, n);
+      commit(n);
+      data += n;  // NOLINT
+      size -= n;
+    }
+  }
+
+  /**
+   * @brief Appends `data`, taking ownership of its storage.
+   */
+  auto append(std::string data) -> void
+  {
+    if (data.empty()) {
+      return;
+    }
+    auto owner = std::make_shared<const std::string>(std::move(data));
+    auto size = owner->size();
+    const char* start = owner->data();
+    m_segments.push_back({std::move(owner), start, size});
+    m_size += size;
+    m_tail_is_last = false;
+  }
+
+  /**
+   * @brief Appends the segments of `other`, sharing their storage.
+   */
+  auto append(const buffer_chain& other) -> void
+  {
+    m_segments.insert(
+        m_segments.end(), other.m_segments.begin(), other.m_segments.end());
+    m_size += other.m_size;
+    m_tail_is_last = false;
+  }
+
+  /**
+   * @brief A chain viewing `length` bytes starting at `offset`, sharing
+   * storage with this chain.
+   */
+  [[nodiscard]] auto subchain(std::size_t offset, std::size_t length) const
+      -> buffer_chain
+  {
+    buffer_chain result;
+    for (const auto& s : m_segments) {
+      if (length == 0) {
+        break;
+      }
+      if (offset >= s.size) {
+        offset -= s.size;
+        continue;
+      }
+      auto n = std::min(length, s.size - offset);
+      result.m_segments.push_back({s.owner, s.data + offset, n});  // NOLINT
+      result.m_size += n;
+      length -= n;
+      offset = 0;
+    }
+    return result;
+  }
+
+  /**
+   * @brief Copies the contents of the chain into a contiguous string.
+   */
+  [[nodiscard]] auto str() const -> std::string
+  {
+    std::string result;
+    result.reserve(m_size);
+    for (const auto& s : m_segments) {
+      result.append(s.data, s.size);
+    }
+    copied_bytes() += m_size;
+    return result;
+  }
+
+  /**
+   * @brief Number of bytes copied into, or out of, buffer chains on the
+   * calling thread.
+   */
+  static auto copied_bytes() -> std::size_t&
+  {
+    thread_local std::size_t bytes = 0;
+    return bytes;
+  }
+
+private:
+  std::vector<segment> m_segments;
+  std::size_t m_size = 0;
+
+  std::shared_ptr<char[]> m_tail;
+  std::size_t m_tail_capacity = 0;
+  std::size_t m_tail_used = 0;
+  bool m_tail_is_last = false;
+  std::size_t m_next_block_size = min_block_size;
+};
+
+/**
+ * @brief Reads the contents of a chain sequentially, e.g. to feed them into
+ * HTTP/2 DATA frames.
+ */
+class buffer_chain_reader
+{
+public:
+  explicit buffer_chain_reader(buffer_chain chain)
+      : m_chain(std::move(chain))
+  {
+  }
+
+  /**
+   * @brief Copies up to `size` bytes to `out` and returns the number of bytes
+   * copied.
+   */
+  auto read(char* out, std::size_t size) -> std::size_t
+  {
+    std::size_t read = 0;
+    const auto& segments = m_chain.segments();
+    while (read < size && m_index < segments.size()) {
+      const auto& s = segments[m_index];
+      auto n = std::min(size - read, s.size - m_offset);
+      std::memcpy(out + read, s.data + m_offset, n);  // NOLINT
+      read += n;
+      m_offset += n;
+      if (m_offset == s.size) {
+        m_index++;
+        m_offset = 0;
+      }
+    }
+    buffer_chain::copied_bytes() += read;
+    return read;
+  }
+
+  [[nodiscard]] auto done() const -> bool
+  {
+    return m_index == m_chain.segments().size();
+  }
+
+private:
+  buffer_chain m_chain;
+  std::size_t m_index = 0;
+  std::size_t m_offset = 0;
+};
+
+/**
+ * @brief A stream buffer appending everything written to it to a chain.
+ */
+class buffer_chain_ostreambuf : public std::streambuf
+{
+public:
+  explicit buffer_chain_ostreambuf(buffer_chain& chain)
+      : m_chain(chain)
+  {
+  }
+
+  buffer_chain_ostreambuf(const buffer_chain_ostreambuf&) = delete;
+  auto operator=(const buffer_chain_ostreambuf&)
+      -> buffer_chain_ostreambuf& = delete;
+  buffer_chain_ostreambuf(buffer_chain_ostreambuf&&) = delete;
+  auto operator=(buffer_chain_ostreambuf&&)
+      -> buffer_chain_ostreambuf& = delete;
+
+  ~buffer_chain_ostreambuf() override
+  {
+    commit();
+  }
+
+protected:
+  auto overflow(int_type ch) -> int_type override
+  {
+    commit();
+    auto region = m_chain.prepare(1);
+    setp(region.data(), region.data() + region.size());  // NOLINT
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+  {
+    auto remaining = static_cast<std::size_t>(n);
+    while (remaining > 0) {
+      auto available = static_cast<std::size_t>(epptr() - pptr());
+      if (available == 0) {
+        overflow(traits_type::eof());
+        continue;
+      }
+      auto k = std::min(remaining, available);
+      std::memcpy(pptr(), s, k);
+      pbump(static_cast<int>(k));
+      s += k;  // NOLINT
+      remaining -= k;
+    }
+    return n;
+  }
+
+  auto sync() -> int override
+  {
+    commit();
+    return 0;
+  }
+
+private:
+  auto commit() -> void
+  {
+    if (pbase() == nullptr) {
+      return;
+    }
+    m_chain.commit(static_cast<std::size_t>(pptr() - pbase()));
+    setp(pptr(), epptr());
+  }
+
+  buffer_chain& m_chain;
+};
+
+/**
+ * @brief A stream buffer reading directly from the segments of a chain.
+ */
+class buffer_chain_istreambuf : public std::streambuf
+{
+public:
+  explicit buffer_chain_istreambuf(const buffer_chain& chain)
+      : m_chain(chain)
+  {
+  }
+
+protected:
+  auto underflow() -> int_type override
+  {
+    const auto& segments = m_chain.segments();
+    while (m_index < segments.size()) {
+      const auto& s = segments[m_index++];
+      if (s.size == 0) {
+        continue;
+      }
+      auto* begin = const_cast<char*>(s.data);  // NOLINT
+      setg(begin, begin, begin + s.size);  // NOLINT
+      return traits_type::to_int_type(*gptr());
+    }
+    return traits_type::eof();
+  }
+
+  auto xsgetn(char* s, std::streamsize n) -> std::streamsize override
+  {
+    std::streamsize read = 0;
+    while (read < n) {
+      if (gptr() == egptr()
+          && traits_type::eq_int_type(underflow(), traits_type::eof()))
+      {
+        break;
+      }
+      auto k = std::min(n - read, static_cast<std::streamsize>(egptr() - gptr()));
+      std::memcpy(s + read, gptr(), static_cast<std::size_t>(k));  // NOLINT
+      gbump(static_cast<int>(k));
+      read += k;
+    }
+    return read;
+  }
+
+private:
+  const buffer_chain& m_chain;
+  std::size_t m_index = 0;
+};
+
+}  // namespace cppless
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <tuple>
+#include <vector>
 
 #include <cereal/cereal.hpp>
 #include <cereal/types/tuple.hpp>
+#include <cereal/types/vector.hpp>
 
 template<class Task, class... Args>
 class task_data
@@ -23,4 +26,75 @@ public:
 private:
   Task& m_task;
   std::tuple<Args...>& m_args;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief The request of a Lambda invocation: either a single `task_data`, or a
+ * batch of argument tuples which share one context and are run by `threads`
+ * threads within the same invocation.
+ *
+ * Like `task_data`, it only references its members, so deserializing into it
+ * populates the referenced context and arguments. Which of the two argument
+ * members is used is determined by the sender.
+ */
+template<class Task, class... Args>
+class invocation_payload
+{
+public:
+  using batch_args = std::vector<std::tuple<Args...>>;
+
+  invocation_payload(Task& task, std::tuple<Args...>& args)
+      : m_task(task)
+      , m_args(&args)
+  {
+  }
+
+  invocation_payload(Task& task, batch_args& batch, std::uint32_t& threads)
+      : m_batched(true)
+      , m_task(task)
+      , m_batch(&batch)
+      , m_threads(&threads)
+  {
+  }
+
+  invocation_payload(Task& task,
+                     std::tuple<Args...>& args,
+                     batch_args& batch,
+                     std::uint32_t& threads)
+      : m_task(task)
+      , m_args(&args)
+      , m_batch(&batch)
+      , m_threads(&threads)
+  {
+  }
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(cereal::make_nvp("batched", m_batched));
+    if (m_batched) {
+      ar(cereal::make_nvp("context", m_task),
+         cereal::make_nvp("args", *m_batch),
+         cereal::make_nvp("threads", *m_threads));
+    } else {
+      ar(cereal::make_nvp("context", m_task),
+         cereal::make_nvp("args", *m_args));
+    }
+  }
+
+  [[nodiscard]] auto batched() const -> bool
+  {
+    return m_batched;
+  }
+
+private:
+  bool m_batched = false;
+  Task& m_task;
+  std::tuple<Args...>* m_args = nullptr;
+  batch_args* m_batch = nullptr;
+  std::uint32_t* m_threads = nullptr;
+};
+
+template<class Task, class... Args>
+invocation_payload(Task&, std::vector<std::tuple<Args...>>&, std::uint32_t&)
+    -> invocation_payload<Task, Args...>;
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <lz4.h>
+#include <zstd.h>
+
+namespace cppless::compression
+{
+
+/**
+ * @brief How a payload is compressed, recorded in its first byte.
+ */
+enum class codec : std::uint8_t
+{
+  none = 0,
+  lz4 = 1,
+  zstd = 2,
+};
+
+/**
+ * @brief When payloads are compressed and with which codec. Archives take the
+ * options as a type, thus they are static members.
+ */
+struct default_options
+{
+  // Smaller payloads are not worth a codec
+  constexpr static std::size_t min_size = 4096;
+  // From this size on, zstd is chosen over lz4: its better ratio saves more
+  // time on the wire than it costs to compress
+  constexpr static std::size_t zstd_min_size = 256 * 1024;
+  constexpr static int zstd_level = 3;
+  // Payloads whose sampled bytes carry more bits of entropy per byte are
+  // taken as compressed already, e.g. images
+  constexpr static double max_entropy = 7.5;
+  // Bytes sampled to estimate the entropy
+  constexpr static std::size_t probe_size = 16 * 1024;
+  // Larger sizes in a header are taken as corrupt rather than allocated
+  constexpr static std::size_t max_size = std::size_t {1} << 30U;
+};
+
+/**
+ * @brief The Shannon entropy of `data` in bits per byte, estimated from up to
+ * `probe_size` bytes sampled in chunks evenly spread over it.
+ */
+inline auto entropy(std::string_view data, std::size_t probe_size) -> double
+{
+  if (data.empty()) {
+    return 0;
+  }
+  constexpr std::size_t chunks = 16;
+  auto chunk_size = std::max<std::size_t>(probe_size / chunks, 1);
+  auto stride = std::max(data.size() / chunks, chunk_size);
+
+  std::array<std::size_t, 256> histogram {};
+  std::size_t sampled = 0;
+  for (std::size_t offset = 0; offset < data.size() && sampled < probe_size;
+       offset += stride)
+  {
+    auto chunk = data.substr(offset, chunk_size);
+    for (char c : chunk) {
+      histogram[static_cast<unsigned char>(c)]++;
+    }
+    sampled += chunk.size();
+  }
+
+  double bits = 0;
+  for (auto count : histogram) {
+    if (count > 0) {
+      auto p = static_cast<double>(count) / static_cast<double>(sampled);
+      bits -= p * std::log2(p);
+    }
+  }
+  return bits;
+}
+
+/**
+ * @brief The codec for `data`: none for small or incompressible payloads, lz4
+ * for medium ones and zstd for large ones.
+ */
+template<class Options = default_options>
+auto choose(std::string_view data) -> codec
+{
+  if (data.size() < Options::min_size) {
+    return codec::none;
+  }
+  if (entropy(data, Options::probe_size) > Options::max_entropy) {
+    return codec::none;
+  }
+  if (data.size() >= Options::zstd_min_size) {
+    return codec::zstd;
+  }
+  return codec::lz4;
+}
+
+namespace detail
+{
+inline auto append_varint(std::string& out, std::uint64_t value) -> void
+{
+  do {
+    auto byte = static_cast<std::uint8_t>(value & 0x7fU);
+    value >>= 7U;
+    if (value != 0) {
+      byte |= 0x80U;
+    }
+    out.push_back(static_cast<char>(byte));
+  } while (value != 0);
+}
+
+inline auto read_varint(std::string_view& in) -> std::uint64_t
+{
+  std::uint64_t value = 0;
+  for (unsigned int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    auto byte = static_cast<std::uint8_t>(in.front());
+    in.remove_prefix(1);
+    value |= static_cast<std::uint64_t>(byte & 0x7fU) << shift;
+    if ((byte & 0x80U) == 0) {
+      return value;
+    }
+  }
+  throw std::runtime_error("Invalid compressed payload header");
+}
+
+// Contexts are reused by the calls of a thread
+inline auto zstd_compression_context() -> ZSTD_CCtx*
+{
+  thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx {
+      ZSTD_createCCtx(), &ZSTD_freeCCtx};
+  return ctx.get();
+}
+
+inline auto zstd_decompression_context() -> ZSTD_DCtx*
+{
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx {
+      ZSTD_createDCtx(), &ZSTD_freeDCtx};
+  return ctx.get();
+}
+}  // namespace detail
+
+/**
+ * @brief Compresses `data` with `c` behind a header of the codec and, unless
+ * it is `none`, the size of `data` as a varint. Falls back to `none` if the
+ * codec does not make `data` smaller.
+ */
+template<class Options = default_options>
+auto compress(std::string_view data, codec c) -> std::string
+{
+  std::string out;
+  if (c == codec::lz4
+      && data.size() > static_cast<std::size_t>(LZ4_MAX_INPUT_SIZE))
+  {
+    c = codec::zstd;
+  }
+  if (c != codec::none) {
+    out.push_back(static_cast<char>(c));
+    detail::append_varint(out, data.size());
+    auto header = out.size();
+
+    std::size_t size = 0;
+    if (c == codec::lz4) {
+      out.resize(header
+                 + static_cast<std::size_t>(
+                     LZ4_compressBound(static_cast<int>(data.size()))));
+      size = static_cast<std::size_t>(
+          LZ4_compress_default(data.data(),
+                               out.data() + header,
+                               static_cast<int>(data.size()),
+                               static_cast<int>(out.size() - header)));
+    } else {
+      out.resize(header + ZSTD_compressBound(data.size()));
+      size = ZSTD_compressCCtx(detail::zstd_compression_context(),
+                               out.data() + header,
+                               out.size() - header,
+                               data.data(),
+                               data.size(),
+                               Options::zstd_level);
+      if (ZSTD_isError(size) != 0U) {
+        size = 0;
+      }
+    }
+    if (size > 0 && header + size < data.size() + 1) {
+      out.resize(header + size);
+      return out;
+    }
+    out.clear();
+  }
+  out.reserve(data.size() + 1);
+  out.push_back(static_cast<char>(codec::none));
+  out.append(data);
+  return out;
+}
+
+/**
+ * @brief Compresses `data` with the codec `choose` picks for it.
+ */
+template<class Options = default_options>
+auto compress(std::string_view data) -> std::string
+{
+  return compress<Options>(data, choose<Options>(data));
+}
+
+/**
+ * @brief The codec recorded in the header of a compressed payload.
+ */
+inline auto codec_of(std::string_view compressed) -> codec
+{
+  if (compressed.empty()
+      || static_cast<std::uint8_t>(compressed[0])
+          > static_cast<std::uint8_t>(codec::zstd))
+  {
+    throw std::runtime_error("Invalid compressed payload header");
+  }
+  return static_cast<codec>(compressed[0]);
+}
+
+/**
+ * @brief Restores what `compress` was given. Throws `std::runtime_error` for
+ * corrupt input.
+ */
+template<class Options = default_options>
+auto decompress(std::string_view compressed) -> std::string
+{
+  auto c = codec_of(compressed);
+  compressed.remove_prefix(1);
+  if (c == codec::none) {
+    return std::string {compressed};
+  }
+
+  auto size = detail::read_varint(compressed);
+  if (size > Options::max_size) {
+    throw std::runtime_error("Compressed payload too large");
+  }
+  std::string out;
+  out.resize(static_cast<std::size_t>(size));
+  bool valid = false;
+  if (c == codec::lz4) {
+    auto written = LZ4_decompress_safe(compressed.data(),
+                                       out.data(),
+                                       static_cast<int>(compressed.size()),
+                                       static_cast<int>(out.size()));
+    valid = written >= 0 && static_cast<std::uint64_t>(written) == size;
+  } else {
+    auto written = ZSTD_decompressDCtx(detail::zstd_decompression_context(),
+                                       out.data(),
+                                       out.size(),
+                                       compressed.data(),
+                                       compressed.size());
+    valid = ZSTD_isError(written) == 0U && written == size;
+  }
+  if (!valid) {
+    throw std::runtime_error("Corrupt compressed payload");
+  }
+  return out;
+}
+
+}  // namespace cppless::compression
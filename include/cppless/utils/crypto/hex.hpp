@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace cppless
+{
+
+// Writes `2 * data.size()` lower case hex characters to `out`.
+inline auto hex_lower(std::span<const unsigned char> data, char* out) -> void
+{
+  constexpr static char digits[] = "0123456789abcdef";  // NOLINT
+  for (auto byte : data) {
+    *out++ = digits[byte >> 4U];  // NOLINT
+    *out++ = digits[byte & 0x0fU];  // NOLINT
+  }
+}
+
+inline auto hex_lower(std::span<const unsigned char> data) -> std::string
+{
+  std::string result(data.size() * 2, '\0');
+  hex_lower(data, result.data());
+  return result;
+}
+
+}  // namespace cppless
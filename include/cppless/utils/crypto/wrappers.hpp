@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <memory>
 #include <span>
@@ -84,6 +85,35 @@ public:
     EVP_DigestInit(m_ctx.get(), EVP_sha256());
   }
 
+  // Copies the running digest state, so a context that already absorbed a
+  // common prefix can be reused as a starting point.
+  evp_sign_ctx(const evp_sign_ctx& other)
+      : m_ctx(EVP_MD_CTX_create())
+  {
+    EVP_MD_CTX_copy_ex(m_ctx.get(), other.m_ctx.get());
+  }
+
+  auto operator=(const evp_sign_ctx& other) -> evp_sign_ctx&
+  {
+    if (this != &other) {
+      // A moved-from context has none left to copy into
+      if (!m_ctx) {
+        m_ctx.reset(EVP_MD_CTX_create());
+      }
+      EVP_MD_CTX_copy_ex(m_ctx.get(), other.m_ctx.get());
+    }
+    return *this;
+  }
+
+  evp_sign_ctx(evp_sign_ctx&&) noexcept = default;
+  auto operator=(evp_sign_ctx&&) noexcept -> evp_sign_ctx& = default;
+  ~evp_sign_ctx() = default;
+
+  auto update(const void* data, std::size_t size) -> void
+  {
+    EVP_DigestSignUpdate(m_ctx.get(), data, size);
+  }
+
   auto update(const std::span<unsigned char>& t) -> void
   {
     EVP_DigestSignUpdate(m_ctx.get(), t.data(), t.size());
@@ -130,6 +160,33 @@ public:
     EVP_DigestInit(m_ctx.get(), EVP_sha256());
   }
 
+  evp_md_ctx(const evp_md_ctx& other)
+      : m_ctx(EVP_MD_CTX_create())
+  {
+    EVP_MD_CTX_copy_ex(m_ctx.get(), other.m_ctx.get());
+  }
+
+  auto operator=(const evp_md_ctx& other) -> evp_md_ctx&
+  {
+    if (this != &other) {
+      // A moved-from context has none left to copy into
+      if (!m_ctx) {
+        m_ctx.reset(EVP_MD_CTX_create());
+      }
+      EVP_MD_CTX_copy_ex(m_ctx.get(), other.m_ctx.get());
+    }
+    return *this;
+  }
+
+  evp_md_ctx(evp_md_ctx&&) noexcept = default;
+  auto operator=(evp_md_ctx&&) noexcept -> evp_md_ctx& = default;
+  ~evp_md_ctx() = default;
+
+  auto update(const void* data, std::size_t size) -> void
+  {
+    EVP_DigestUpdate(m_ctx.get(), data, size);
+  }
+
   auto update(const std::span<unsigned char>& t) -> void
   {
     EVP_DigestUpdate(m_ctx.get(), t.data(), t.size());
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <cereal/cereal.hpp>
+
+namespace cppless
+{
+
+/**
+ * @brief A binary cereal archive appending to a contiguous buffer instead of
+ * writing through a stream. Sizes are written as varints. Vectors and arrays
+ * of plain elements, see `detail::bulk_copyable`, and spans of trivially
+ * copyable elements are copied in bulk.
+ *
+ * The layout of trivially copyable types is taken as is, thus both ends have
+ * to be built by the same compiler for the same target, as the host and its
+ * functions are.
+ */
+class fast_binary_output_archive
+    : public cereal::OutputArchive<fast_binary_output_archive,
+                                   cereal::AllowEmptyClassElision>
+{
+public:
+  fast_binary_output_archive()
+      : OutputArchive(this)
+  {
+  }
+
+  /**
+   * @brief Writes the buffer to `stream` when the archive is destroyed, e.g.
+   * for dispatchers constructing their archives from streams.
+   */
+  explicit fast_binary_output_archive(std::ostream& stream)
+      : OutputArchive(this)
+      , m_stream(&stream)
+  {
+  }
+
+  fast_binary_output_archive(const fast_binary_output_archive&) = delete;
+  auto operator=(const fast_binary_output_archive&)
+      -> fast_binary_output_archive& = delete;
+  fast_binary_output_archive(fast_binary_output_archive&&) = delete;
+  auto operator=(fast_binary_output_archive&&)
+      -> fast_binary_output_archive& = delete;
+
+  ~fast_binary_output_archive() noexcept
+  {
+    if (m_stream == nullptr) {
+      return;
+    }
+    try {
+      m_stream->write(m_buffer.data(),
+                      static_cast<std::streamsize>(m_buffer.size()));
+    } catch (...) {
+      // Left to the failure state of the stream
+    }
+  }
+
+  auto save_binary(const void* data, std::size_t size) -> void
+  {
+    m_buffer.append(static_cast<const char*>(data), size);
+  }
+
+  /**
+   * @brief Writes `value` in LEB128, seven bits per byte.
+   */
+  auto save_varint(std::uint64_t value) -> void
+  {
+    std::array<char, 10> bytes {};
+    std::size_t size = 0;
+    do {
+      auto byte = static_cast<std::uint8_t>(value & 0x7fU);
+      value >>= 7U;
+      if (value != 0) {
+        byte |= 0x80U;
+      }
+      bytes[size++] = static_cast<char>(byte);
+    } while (value != 0);
+    m_buffer.append(bytes.data(), size);
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_buffer.size();
+  }
+
+  /**
+   * @brief Moves the bytes written so far out of the archive.
+   */
+  auto take() -> std::string
+  {
+    return std::move(m_buffer);
+  }
+
+private:
+  std::string m_buffer;
+  std::ostream* m_stream = nullptr;
+};
+
+/**
+ * @brief Reads what `fast_binary_output_archive` wrote from a contiguous
+ * buffer.
+ */
+class fast_binary_input_archive
+    : public cereal::InputArchive<fast_binary_input_archive,
+                                  cereal::AllowEmptyClassElision>
+{
+public:
+  /**
+   * @brief Reads from `data`, which has to outlive the archive.
+   */
+  explicit fast_binary_input_archive(std::string_view data)
+      : InputArchive(this)
+      , m_data(data)
+  {
+  }
+
+  /**
+   * @brief Reads `stream` to its end first.
+   */
+  explicit fast_binary_input_archive(std::istream& stream)
+      : InputArchive(this)
+      , m_owned(std::istreambuf_iterator<char>(stream),
+                std::istreambuf_iterator<char>())
+      , m_data(m_owned)
+  {
+  }
+
+  fast_binary_input_archive(const fast_binary_input_archive&) = delete;
+  auto operator=(const fast_binary_input_archive&)
+      -> fast_binary_input_archive& = delete;
+  fast_binary_input_archive(fast_binary_input_archive&&) = delete;
+  auto operator=(fast_binary_input_archive&&)
+      -> fast_binary_input_archive& = delete;
+  ~fast_binary_input_archive() noexcept = default;
+
+  auto load_binary(void* data, std::size_t size) -> void
+  {
+    if (size > m_data.size()) {
+      throw cereal::Exception("Failed to read " + std::to_string(size)
+                              + " bytes, only "
+                              + std::to_string(m_data.size()) + " are left");
+    }
+    if (size > 0) {
+      std::memcpy(data, m_data.data(), size);
+    }
+    m_data.remove_prefix(size);
+  }
+
+  auto load_varint() -> std::uint64_t
+  {
+    std::uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+      if (m_data.empty()) {
+        throw cereal::Exception("Truncated varint");
+      }
+      auto byte = static_cast<std::uint8_t>(m_data.front());
+      m_data.remove_prefix(1);
+      value |= static_cast<std::uint64_t>(byte & 0x7fU) << shift;
+      if ((byte & 0x80U) == 0) {
+        return value;
+      }
+    }
+    throw cereal::Exception("Varint longer than 64 bits");
+  }
+
+  /**
+   * @brief A size read from the archive, checked against the bytes left so
+   * that a corrupt size fails instead of allocating.
+   */
+  auto load_size(std::size_t element_size) -> std::size_t
+  {
+    auto size = load_varint();
+    if (element_size > 0 && size > m_data.size() / element_size) {
+      throw cereal::Exception("Size " + std::to_string(size)
+                              + " exceeds the input");
+    }
+    return static_cast<std::size_t>(size);
+  }
+
+private:
+  std::string m_owned;
+  std::string_view m_data;
+};
+
+namespace detail
+{
+/**
+ * @brief Whether cereal finds serialization functions for `T`, of the type
+ * itself or found through argument dependent lookup.
+ */
+template<class T,
+         class Out = fast_binary_output_archive,
+         class In = fast_binary_input_archive>
+constexpr bool has_serialization_functions =
+    cereal::traits::count_output_serializers<T, Out>::value > 0
+    || cereal::traits::count_input_serializers<T, In>::value > 0;
+
+/**
+ * @brief Elements the fast archives copy in bulk. Arithmetic ones are
+ * already copied in bulk through `cereal::BinaryData` by cereal itself. Types
+ * with serialization functions of their own are written by them. Types with
+ * padding need such functions, as their padding bytes are indeterminate and
+ * would tell equal payloads apart, e.g. for memoization.
+ */
+template<class T>
+concept bulk_copyable = std::is_trivially_copyable_v<T>
+    && std::has_unique_object_representations_v<T>
+    && std::is_default_constructible_v<T> && !std::is_arithmetic_v<T>
+    && !has_serialization_functions<T>;
+}  // namespace detail
+
+// Found by cereal through argument dependent lookup on the archives
+
+template<class T>
+  requires std::is_arithmetic_v<T>
+auto save(fast_binary_output_archive& ar, const T& t) -> void
+{
+  ar.save_binary(std::addressof(t), sizeof(t));
+}
+
+template<class T>
+  requires std::is_arithmetic_v<T>
+auto load(fast_binary_input_archive& ar, T& t) -> void
+{
+  ar.load_binary(std::addressof(t), sizeof(t));
+}
+
+template<class T>
+auto serialize(fast_binary_output_archive& ar, cereal::NameValuePair<T>& t)
+    -> void
+{
+  ar(t.value);
+}
+
+template<class T>
+auto serialize(fast_binary_input_archive& ar, cereal::NameValuePair<T>& t)
+    -> void
+{
+  ar(t.value);
+}
+
+template<class T>
+auto save(fast_binary_output_archive& ar, const cereal::SizeTag<T>& tag)
+    -> void
+{
+  ar.save_varint(static_cast<std::uint64_t>(tag.size));
+}
+
+template<class T>
+auto load(fast_binary_input_archive& ar, cereal::SizeTag<T>& tag) -> void
+{
+  tag.size = static_cast<std::remove_reference_t<T>>(ar.load_varint());
+}
+
+template<class T>
+auto save(fast_binary_output_archive& ar, const cereal::BinaryData<T>& data)
+    -> void
+{
+  ar.save_binary(data.data, static_cast<std::size_t>(data.size));
+}
+
+template<class T>
+auto load(fast_binary_input_archive& ar, cereal::BinaryData<T>& data) -> void
+{
+  ar.load_binary(data.data, static_cast<std::size_t>(data.size));
+}
+
+template<detail::bulk_copyable T, class A>
+auto save(fast_binary_output_archive& ar, const std::vector<T, A>& vector)
+    -> void
+{
+  ar.save_varint(vector.size());
+  ar.save_binary(vector.data(), vector.size() * sizeof(T));
+}
+
+template<detail::bulk_copyable T, class A>
+auto load(fast_binary_input_archive& ar, std::vector<T, A>& vector) -> void
+{
+  vector.resize(ar.load_size(sizeof(T)));
+  ar.load_binary(vector.data(), vector.size() * sizeof(T));
+}
+
+// cereal serializes arrays of non-arithmetic elements with `serialize`
+template<detail::bulk_copyable T, std::size_t N>
+auto serialize(fast_binary_output_archive& ar, std::array<T, N>& array)
+    -> void
+{
+  ar.save_binary(array.data(), sizeof(array));
+}
+
+template<detail::bulk_copyable T, std::size_t N>
+auto serialize(fast_binary_input_archive& ar, std::array<T, N>& array)
+    -> void
+{
+  ar.load_binary(array.data(), sizeof(array));
+}
+
+/**
+ * @brief Spans are written like vectors, e.g. to send part of a buffer.
+ */
+template<class T, std::size_t Extent>
+  requires std::is_trivially_copyable_v<T>
+auto save(fast_binary_output_archive& ar, const std::span<T, Extent>& span)
+    -> void
+{
+  ar.save_varint(span.size());
+  ar.save_binary(span.data(), span.size_bytes());
+}
+
+/**
+ * @brief Reads into the elements a span views, which have to be as many as
+ * were written.
+ */
+template<class T, std::size_t Extent>
+  requires(std::is_trivially_copyable_v<T> && !std::is_const_v<T>)
+auto load(fast_binary_input_archive& ar, std::span<T, Extent>& span) -> void
+{
+  if (ar.load_size(sizeof(T)) != span.size()) {
+    throw cereal::Exception("Span size does not match the input");
+  }
+  ar.load_binary(span.data(), span.size_bytes());
+}
+
+}  // namespace cppless
+
+CEREAL_REGISTER_ARCHIVE(cppless::fast_binary_output_archive)
+CEREAL_REGISTER_ARCHIVE(cppless::fast_binary_input_archive)
+CEREAL_SETUP_ARCHIVE_TRAITS(cppless::fast_binary_input_archive,
+                            cppless::fast_binary_output_archive)
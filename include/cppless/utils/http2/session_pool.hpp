@@ -0,0 +1,498 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <compare>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <nghttp2/asio_http2_client.h>
+#include <nghttp2/nghttp2.h>
+
+namespace cppless::http2
+{
+
+struct session_pool_options
+{
+  /**
+   * @brief Upper bound on the number of open connections.
+   */
+  std::size_t max_sessions = 16;
+  /**
+   * @brief Streams opened on a connection before another one is used. The
+   * asio client does not expose the server's SETTINGS_MAX_CONCURRENT_STREAMS,
+   * so the limit of a connection is lowered whenever the server refuses a
+   * stream.
+   */
+  std::size_t max_concurrent_streams = 100;
+  /**
+   * @brief Connections without streams for longer than this are closed,
+   * down to `min_sessions`.
+   */
+  std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(30);
+  std::size_t min_sessions = 1;
+  /**
+   * @brief Consecutive failed connection attempts after which pending
+   * requests are failed.
+   */
+  int max_connect_attempts = 3;
+  /**
+   * @brief Connect over TLS, or speak cleartext HTTP/2 with prior knowledge,
+   * e.g. to a local emulator.
+   */
+  bool tls = true;
+
+  auto operator<=>(const session_pool_options&) const = default;
+};
+
+/**
+ * @brief A pool of HTTP/2 connections to a single host, growing and shrinking
+ * with the number of streams in flight.
+ *
+ * Connections are opened lazily, requests go to the least loaded connected
+ * session with a free stream slot, and requests which do not fit are queued
+ * until a stream closes or a new connection is established. Sessions which
+ * stop accepting streams, e.g. after a GOAWAY, are drained and replaced.
+ *
+ * The pool owns the io_service all of its sessions run on. It is not thread
+ * safe: every user has to drive it from the same thread.
+ */
+class session_pool
+{
+public:
+  using session = ::nghttp2::asio_http2::client::session;
+  using request = ::nghttp2::asio_http2::client::request;
+  using submit_cb = std::function<const request*(session&)>;
+  using close_cb = std::function<void(uint32_t)>;
+  using error_cb = std::function<void(const boost::system::error_code&)>;
+
+  session_pool(std::string host,
+               std::string service,
+               session_pool_options options = {})
+      : m_tls(boost::asio::ssl::context::sslv23)
+      , m_host(std::move(host))
+      , m_service(std::move(service))
+      , m_options(options)
+  {
+    boost::system::error_code ec;
+    m_tls.set_default_verify_paths();
+    ::nghttp2::asio_http2::client::configure_tls_context(ec, m_tls);
+  }
+
+  // Sessions keep pointers to the pool
+  session_pool(const session_pool&) = delete;
+  auto operator=(const session_pool&) -> session_pool& = delete;
+  session_pool(session_pool&&) = delete;
+  auto operator=(session_pool&&) -> session_pool& = delete;
+
+  ~session_pool()
+  {
+    m_stopping = true;
+    m_idle_timer.cancel();
+    for (auto& e : m_sessions) {
+      if (e.sess) {
+        e.sess->shutdown();
+      }
+    }
+    m_io_service.run();
+    for (auto& e : m_sessions) {
+      e.sess.reset();
+    }
+  }
+
+  /**
+   * @brief The pool for `host`, `service` and `options` of the calling
+   * thread, created on first use and shared until its last user releases it.
+   */
+  static auto shared(const std::string& host,
+                     const std::string& service,
+                     session_pool_options options = {})
+      -> std::shared_ptr<session_pool>
+  {
+    static std::mutex mutex;
+    static std::map<std::tuple<std::thread::id,
+                               std::string,
+                               std::string,
+                               session_pool_options>,
+                    std::weak_ptr<session_pool>>
+        pools;
+
+    std::lock_guard lock {mutex};
+    // Threads come and go, their released pools would pile up otherwise
+    std::erase_if(pools, [](const auto& p) { return p.second.expired(); });
+    auto& weak = pools[{std::this_thread::get_id(), host, service, options}];
+    auto pool = weak.lock();
+    if (!pool) {
+      pool = std::make_shared<session_pool>(host, service, options);
+      weak = pool;
+    }
+    return pool;
+  }
+
+  auto io_service() -> boost::asio::io_service&
+  {
+    return m_io_service;
+  }
+
+  /**
+   * @brief Runs at most one handler, blocking until one is ready.
+   */
+  auto run_one() -> std::size_t
+  {
+    // The io_service stops whenever it runs out of work, e.g. after the last
+    // session was closed
+    if (m_io_service.stopped()) {
+      m_io_service.restart();
+    }
+    return m_io_service.run_one();
+  }
+
+  /**
+   * @brief Runs at most one handler, blocking until one is ready or
+   * `deadline` has passed.
+   */
+  auto run_one_until(std::chrono::steady_clock::time_point deadline)
+      -> std::size_t
+  {
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+      return run_one();
+    }
+    if (m_io_service.stopped()) {
+      m_io_service.restart();
+    }
+    return m_io_service.run_one_until(deadline);
+  }
+
+  /**
+   * @brief Calls `submit` with a session as soon as one has a free stream
+   * slot. `submit` returns the submitted request, or `nullptr` if the session
+   * rejected it.
+   *
+   * `on_close` receives the HTTP/2 error code once the stream is closed.
+   * Streams the server refused without processing them are submitted again
+   * instead.
+   */
+  auto submit(submit_cb submit, close_cb on_close = {}) -> void
+  {
+    m_pending.push_back({std::move(submit), std::move(on_close)});
+    dispatch();
+  }
+
+  /**
+   * @brief Called for every connection error.
+   */
+  auto on_error(error_cb callback) -> void
+  {
+    m_error_callback = std::move(callback);
+  }
+
+  /**
+   * @brief The number of connected or connecting sessions.
+   */
+  [[nodiscard]] auto sessions() const -> std::size_t
+  {
+    return static_cast<std::size_t>(
+        std::count_if(m_sessions.begin(),
+                      m_sessions.end(),
+                      [](const entry& e)
+                      {
+                        return e.st == state::connecting
+                            || e.st == state::ready;
+                      }));
+  }
+
+  [[nodiscard]] auto in_flight() const -> std::size_t
+  {
+    return m_in_flight;
+  }
+
+  [[nodiscard]] auto pending() const -> std::size_t
+  {
+    return m_pending.size();
+  }
+
+private:
+  enum class state
+  {
+    connecting,
+    ready,
+    // Finishes its streams but does not accept new ones
+    draining,
+    closed,
+  };
+
+  struct entry
+  {
+    std::unique_ptr<session> sess;
+    state st = state::connecting;
+    std::size_t in_flight = 0;
+    std::size_t max_streams = 0;
+    std::chrono::steady_clock::time_point idle_since;
+  };
+
+  struct work
+  {
+    submit_cb submit;
+    close_cb on_close;
+  };
+
+  auto dispatch() -> void
+  {
+    if (m_stopping) {
+      return;
+    }
+    // Closing streams call back into dispatch
+    if (m_dispatching) {
+      m_dispatch_again = true;
+      return;
+    }
+    m_dispatching = true;
+    do {
+      m_dispatch_again = false;
+      reap();
+      assign();
+    } while (m_dispatch_again);
+    m_dispatching = false;
+  }
+
+  auto assign() -> void
+  {
+    while (!m_pending.empty()) {
+      entry* best = nullptr;
+      for (auto& e : m_sessions) {
+        if (e.st == state::ready && e.in_flight < e.max_streams
+            && (best == nullptr || e.in_flight < best->in_flight))
+        {
+          best = &e;
+        }
+      }
+      if (best == nullptr) {
+        grow();
+        return;
+      }
+      auto w = std::move(m_pending.front());
+      m_pending.pop_front();
+      start(*best, std::move(w));
+    }
+  }
+
+  auto start(entry& e, work w) -> void
+  {
+    const request* req = w.submit(*e.sess);
+    if (req == nullptr) {
+      // The session no longer accepts streams, e.g. after a GOAWAY
+      e.st = state::draining;
+      m_pending.push_front(std::move(w));
+      if (e.in_flight == 0) {
+        close(e);
+      }
+      return;
+    }
+    e.in_flight++;
+    m_in_flight++;
+    req->on_close(
+        [this, &e, w = std::move(w)](uint32_t error_code) mutable
+        {
+          if (m_stopping) {
+            // The sessions are being destroyed, nothing is dispatched
+            e.in_flight--;
+            m_in_flight--;
+            if (w.on_close) {
+              w.on_close(error_code);
+            }
+            return;
+          }
+          // Closing or reaping the session destroys this callback, thus the
+          // stream is settled outside of it, like session errors are
+          m_io_service.post(
+              [this, &e, w = std::move(w), error_code]() mutable
+              { settle(e, std::move(w), error_code); });
+        });
+  }
+
+  // The entry is not reaped before, it still counts the stream as in flight
+  auto settle(entry& e, work w, uint32_t error_code) -> void
+  {
+    e.in_flight--;
+    m_in_flight--;
+    if (e.in_flight == 0) {
+      e.idle_since = std::chrono::steady_clock::now();
+    }
+    if (error_code == NGHTTP2_REFUSED_STREAM && !m_stopping) {
+      // The server allows fewer concurrent streams than assumed
+      e.max_streams = std::max<std::size_t>(1, e.in_flight);
+      m_pending.push_front(std::move(w));
+    } else if (w.on_close) {
+      w.on_close(error_code);
+    }
+    if (e.st == state::draining && e.in_flight == 0) {
+      close(e);
+    }
+    dispatch();
+  }
+
+  // Opens another session if the pending requests do not fit into the
+  // sessions which are still connecting.
+  auto grow() -> void
+  {
+    std::size_t connecting_capacity = 0;
+    std::size_t open = 0;
+    for (const auto& e : m_sessions) {
+      if (e.st == state::connecting) {
+        connecting_capacity += e.max_streams;
+      }
+      if (e.st != state::closed) {
+        open++;
+      }
+    }
+    if (m_pending.size() > connecting_capacity
+        && open < m_options.max_sessions)
+    {
+      connect();
+    }
+  }
+
+  auto connect() -> void
+  {
+    auto& e = m_sessions.emplace_back();
+    e.max_streams = m_options.max_concurrent_streams;
+    e.sess = m_options.tls
+        ? std::make_unique<session>(m_io_service, m_tls, m_host, m_service)
+        : std::make_unique<session>(m_io_service, m_host, m_service);
+    e.sess->on_connect(
+        [this, &e](const auto& /*endpoint*/)
+        {
+          e.st = state::ready;
+          e.idle_since = std::chrono::steady_clock::now();
+          m_connect_failures = 0;
+          dispatch();
+        });
+    e.sess->on_error(
+        [this, &e](const boost::system::error_code& ec)
+        {
+          if (e.st == state::connecting) {
+            m_connect_failures++;
+          }
+          e.st = state::closed;
+          if (m_error_callback) {
+            m_error_callback(ec);
+          } else {
+            std::cerr << "HTTP/2 session error: " << ec.message()
+                      << std::endl;
+          }
+          if (m_connect_failures >= m_options.max_connect_attempts) {
+            m_connect_failures = 0;
+            fail_pending();
+          }
+          // Sessions must not be destroyed from within their own callbacks
+          m_io_service.post([this] { dispatch(); });
+        });
+  }
+
+  auto close(entry& e) -> void
+  {
+    e.st = state::closed;
+    if (e.sess) {
+      e.sess->shutdown();
+    }
+  }
+
+  // Closes idle sessions and releases closed ones. Destroying a session
+  // closes its remaining streams, which still refer to their entry, so
+  // entries are only erased once they have no streams left.
+  auto reap() -> void
+  {
+    auto now = std::chrono::steady_clock::now();
+    auto ready = static_cast<std::size_t>(
+        std::count_if(m_sessions.begin(),
+                      m_sessions.end(),
+                      [](const entry& e) { return e.st == state::ready; }));
+    auto next_idle = std::chrono::steady_clock::time_point::max();
+    for (auto& e : m_sessions) {
+      if (e.st == state::ready && e.in_flight == 0 && m_pending.empty()
+          && ready > m_options.min_sessions)
+      {
+        if (now - e.idle_since >= m_options.idle_timeout) {
+          close(e);
+          ready--;
+        } else {
+          next_idle =
+              std::min(next_idle, e.idle_since + m_options.idle_timeout);
+        }
+      }
+      if (e.st == state::closed && e.sess) {
+        e.sess.reset();
+      }
+    }
+    m_sessions.remove_if([](const entry& e)
+                         { return e.st == state::closed && e.in_flight == 0; });
+    if (ready > m_options.min_sessions) {
+      schedule_reap(next_idle);
+    }
+  }
+
+  // Reaps again at `deadline` unless an earlier reap is scheduled already, so
+  // that idle sessions are closed even if nothing is dispatched anymore.
+  auto schedule_reap(std::chrono::steady_clock::time_point deadline) -> void
+  {
+    if (m_stopping || deadline >= m_idle_deadline) {
+      return;
+    }
+    m_idle_deadline = deadline;
+    m_idle_timer.expires_at(deadline);
+    m_idle_timer.async_wait(
+        [this](const boost::system::error_code& ec)
+        {
+          // Cancelled, or rescheduled to an earlier deadline
+          if (ec) {
+            return;
+          }
+          m_idle_deadline = std::chrono::steady_clock::time_point::max();
+          dispatch();
+        });
+  }
+
+  auto fail_pending() -> void
+  {
+    auto pending = std::move(m_pending);
+    m_pending.clear();
+    for (auto& w : pending) {
+      if (w.on_close) {
+        w.on_close(NGHTTP2_CONNECT_ERROR);
+      }
+    }
+  }
+
+  boost::asio::io_service m_io_service;
+  boost::asio::ssl::context m_tls;
+  std::string m_host;
+  std::string m_service;
+  session_pool_options m_options;
+
+  // A list keeps entries in place, session callbacks refer to them
+  std::list<entry> m_sessions;
+  std::deque<work> m_pending;
+  std::size_t m_in_flight = 0;
+  int m_connect_failures = 0;
+  bool m_dispatching = false;
+  bool m_dispatch_again = false;
+  bool m_stopping = false;
+  error_cb m_error_callback;
+  boost::asio::steady_timer m_idle_timer {m_io_service};
+  std::chrono::steady_clock::time_point m_idle_deadline =
+      std::chrono::steady_clock::time_point::max();
+};
+
+}  // namespace cppless::http2
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/asio/ssl.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <cppless/provider/aws/s3.hpp>
+#include <cppless/utils/beast/http_request_session.hpp>
+
+namespace cppless
+{
+
+/**
+ * @brief A store for objects too large to be passed through the payloads of
+ * invocations, shared by the host and the functions it invokes.
+ */
+class object_store
+{
+public:
+  object_store() = default;
+  object_store(const object_store&) = delete;
+  auto operator=(const object_store&) -> object_store& = delete;
+  object_store(object_store&&) = delete;
+  auto operator=(object_store&&) -> object_store& = delete;
+  virtual ~object_store() = default;
+
+  virtual auto put(const std::string& key, const std::string& data)
+      -> void = 0;
+  /**
+   * @brief Returns the object stored under `key`, throws if there is none.
+   */
+  virtual auto get(const std::string& key) -> std::string = 0;
+
+  /**
+   * @brief A key no other object was stored under.
+   */
+  static auto unique_key() -> std::string
+  {
+    thread_local boost::uuids::random_generator generator;
+    return "cppless-" + boost::uuids::to_string(generator());
+  }
+};
+
+/**
+ * @brief Stores objects as files in a directory, e.g. for functions run by
+ * the local dispatcher or by `cppless_server` on the same machine.
+ */
+class file_object_store : public object_store
+{
+public:
+  explicit file_object_store(std::filesystem::path directory)
+      : m_directory(std::move(directory))
+  {
+    std::filesystem::create_directories(m_directory);
+  }
+
+  auto put(const std::string& key, const std::string& data) -> void override
+  {
+    // Readers never see a partially written object
+    auto path = m_directory / key;
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      out.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!out) {
+        throw std::runtime_error("Could not write object " + key);
+      }
+    }
+    std::filesystem::rename(temporary, path);
+  }
+
+  auto get(const std::string& key) -> std::string override
+  {
+    std::ifstream in(m_directory / key, std::ios::binary);
+    if (!in) {
+      throw std::runtime_error("No object " + key);
+    }
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+  }
+
+private:
+  std::filesystem::path m_directory;
+};
+
+/**
+ * @brief Stores objects in an S3 bucket, every call is a blocking request of
+ * its own.
+ */
+class s3_object_store : public object_store
+{
+public:
+  s3_object_store(aws::s3::client client,
+                  aws::aws_v4_derived_key key,
+                  std::string prefix = "")
+      : m_client(std::move(client))
+      , m_key(std::move(key))
+      , m_prefix(std::move(prefix))
+      , m_tls(boost::asio::ssl::context::tlsv12_client)
+  {
+    m_tls.set_default_verify_paths();
+  }
+
+  auto put(const std::string& key, const std::string& data) -> void override
+  {
+    aws::s3::beast_put_object_request req {m_prefix + key, buffer_chain {data}};
+    request(req, "put");
+  }
+
+  auto get(const std::string& key) -> std::string override
+  {
+    aws::s3::beast_get_object_request req {m_prefix + key};
+    return request(req, "get");
+  }
+
+private:
+  template<class Request>
+  auto request(Request& req, const std::string& operation) -> std::string
+  {
+    boost::asio::io_context ioc;
+    beast::resolver_session resolver(ioc);
+    resolver.run(m_client.hostname(), m_client.port());
+
+    std::optional<std::string> result;
+    req.on_result([&result](const std::string& r) { result = r; });
+    req.submit(resolver, ioc, m_tls, m_client, m_key);
+    ioc.run();
+    if (!result) {
+      throw std::runtime_error("S3 " + operation + " request failed");
+    }
+    return std::move(*result);
+  }
+
+  aws::s3::client m_client;
+  aws::aws_v4_derived_key m_key;
+  std::string m_prefix;
+  boost::asio::ssl::context m_tls;
+};
+
+namespace detail
+{
+
+inline auto default_object_store_slot() -> std::shared_ptr<object_store>&
+{
+  static std::shared_ptr<object_store> store;
+  return store;
+}
+
+inline auto default_object_store_mutex() -> std::mutex&
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Counts the calls of `set_default_object_store`
+inline auto default_object_store_generation() -> std::uint64_t&
+{
+  static std::uint64_t generation = 0;
+  return generation;
+}
+
+/**
+ * @brief Creates the store described by `CPPLESS_OBJECT_STORE`: either
+ * `s3://<bucket>[/<prefix>]`, or a directory, optionally as a `file://` URL.
+ */
+inline auto object_store_from_env() -> std::shared_ptr<object_store>
+{
+  auto* location_env = std::getenv("CPPLESS_OBJECT_STORE");  // NOLINT
+  if (location_env == nullptr) {
+    throw std::runtime_error(
+        "No object store configured, set CPPLESS_OBJECT_STORE");
+  }
+  std::string location {location_env};
+  if (location.starts_with("s3://")) {
+    auto path = location.substr(5);
+    auto slash = path.find('/');
+    auto bucket = path.substr(0, slash);
+    auto prefix = slash == std::string::npos ? "" : path.substr(slash + 1);
+    if (!prefix.empty() && !prefix.ends_with('/')) {
+      prefix += '/';
+    }
+    aws::s3::client client {bucket};
+    auto* endpoint_env = std::getenv("AWS_ENDPOINT_URL_S3");  // NOLINT
+    if (endpoint_env != nullptr) {
+      client.set_endpoint(endpoint_env);
+    }
+    auto key = client.create_derived_key_from_env();
+    return std::make_shared<s3_object_store>(
+        std::move(client), std::move(key), std::move(prefix));
+  }
+  if (location.starts_with("file://")) {
+    location = location.substr(7);
+  }
+  return std::make_shared<file_object_store>(location);
+}
+
+/**
+ * @brief The default store, created unless one was set, and its generation,
+ * which tells stores apart that were set one after another.
+ */
+inline auto current_object_store()
+    -> std::pair<std::shared_ptr<object_store>, std::uint64_t>
+{
+  std::scoped_lock lock {default_object_store_mutex()};
+  auto& store = default_object_store_slot();
+  if (!store) {
+    store = object_store_from_env();
+  }
+  return {store, default_object_store_generation()};
+}
+
+}  // namespace detail
+
+/**
+ * @brief Replaces the store returned by `default_object_store`.
+ */
+inline auto set_default_object_store(std::shared_ptr<object_store> store)
+    -> void
+{
+  std::scoped_lock lock {detail::default_object_store_mutex()};
+  detail::default_object_store_slot() = std::move(store);
+  detail::default_object_store_generation()++;
+}
+
+/**
+ * @brief The store `remote` values are kept in. Unless one was set, it is
+ * created on first use from `CPPLESS_OBJECT_STORE`, which thus has to be set
+ * in the environment of the host and of the functions alike.
+ */
+inline auto default_object_store() -> object_store&
+{
+  return *detail::current_object_store().first;
+}
+
+}  // namespace cppless
@@ -0,0 +1,676 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace cppless
+{
+
+/**
+ * @brief Requests and responses exchanged with pooled workers are framed by
+ * their length as a native 64 bit integer.
+ */
+using frame_size = std::uint64_t;
+
+/**
+ * @brief Reads one frame from `fd`, blocking. Returns false if the stream
+ * ended before the next frame.
+ */
+inline auto read_frame(int fd, std::string& frame) -> bool
+{
+  auto read_fully = [fd](char* data, std::size_t size) -> std::size_t
+  {
+    std::size_t done = 0;
+    while (done < size) {
+      auto n = ::read(fd, data + done, size - done);  // NOLINT
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    return done;
+  };
+
+  frame_size size = 0;
+  auto header = read_fully(reinterpret_cast<char*>(&size),  // NOLINT
+                           sizeof(size));
+  if (header == 0) {
+    return false;
+  }
+  frame.resize(size);
+  if (header != sizeof(size) || read_fully(frame.data(), size) != size) {
+    throw std::runtime_error("Truncated frame");
+  }
+  return true;
+}
+
+/**
+ * @brief Writes `frame` to `fd`, blocking.
+ */
+inline auto write_frame(int fd, std::string_view frame) -> void
+{
+  frame_size size = frame.size();
+  std::array<iovec, 2> iov = {
+      iovec {&size, sizeof(size)},
+      iovec {const_cast<char*>(frame.data()), frame.size()},  // NOLINT
+  };
+  std::size_t remaining = sizeof(size) + frame.size();
+  auto* vec = iov.data();
+  int count = 2;
+  while (remaining > 0) {
+    auto n = ::writev(fd, vec, count);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw std::runtime_error("Failed to write frame");
+    }
+    remaining -= static_cast<std::size_t>(n);
+    auto written = static_cast<std::size_t>(n);
+    while (count > 0 && written >= vec->iov_len) {
+      written -= vec->iov_len;
+      vec++;  // NOLINT
+      count--;
+    }
+    if (count > 0) {
+      vec->iov_base = static_cast<char*>(vec->iov_base) + written;  // NOLINT
+      vec->iov_len -= written;
+    }
+  }
+}
+
+struct process_pool_options
+{
+  /**
+   * @brief Resident workers per executable.
+   */
+  std::size_t max_workers = std::max(1U, std::thread::hardware_concurrency());
+  /**
+   * @brief Threads multiplexing the pipes of all workers.
+   */
+  std::size_t io_threads = 1;
+};
+
+/**
+ * @brief Keeps worker processes resident and feeds them a stream of
+ * length-prefixed requests over their stdin, reading the responses from their
+ * stdout.
+ *
+ * Workers are started on demand, up to `max_workers` per executable, and
+ * requests which do not find an idle worker are queued. The pipes are
+ * multiplexed with epoll by a fixed number of IO threads, which also reap
+ * exited workers. Callbacks run on the IO threads.
+ */
+class process_pool
+{
+public:
+  using response_cb = std::function<void(std::string)>;
+  using error_cb = std::function<void(const std::string&)>;
+
+  /**
+   * @brief `args` are passed to every worker after the executable name.
+   */
+  explicit process_pool(std::vector<std::string> args = {},
+                        process_pool_options options = {})
+      : m_args(std::move(args))
+      , m_options(options)
+  {
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, m_options.io_threads);
+         i++)
+    {
+      m_io_threads.push_back(std::make_unique<io_thread>(*this));
+    }
+  }
+
+  process_pool(const process_pool&) = delete;
+  auto operator=(const process_pool&) -> process_pool& = delete;
+  process_pool(process_pool&&) = delete;
+  auto operator=(process_pool&&) -> process_pool& = delete;
+
+  /**
+   * @brief Closes the stdin of every worker and waits for them to exit.
+   * Queued requests are failed.
+   */
+  ~process_pool()
+  {
+    std::deque<job> pending;
+    {
+      std::lock_guard lock {m_mutex};
+      m_stopping = true;
+      for (auto& [executable, state] : m_executables) {
+        for (auto& j : state.pending) {
+          pending.push_back(std::move(j));
+        }
+        state.pending.clear();
+      }
+    }
+    for (auto& j : pending) {
+      j.on_error("Process pool shut down");
+    }
+    for (auto& t : m_io_threads) {
+      t->stop();
+    }
+    m_io_threads.clear();
+  }
+
+  auto submit(const std::string& executable,
+              std::string request,
+              response_cb on_response,
+              error_cb on_error) -> void
+  {
+    job j {std::move(request), std::move(on_response), std::move(on_error)};
+    std::shared_ptr<worker> w;
+    {
+      std::lock_guard lock {m_mutex};
+      auto& state = m_executables[executable];
+      if (!state.idle.empty()) {
+        w = state.idle.back();
+        state.idle.pop_back();
+      } else if (state.workers < m_options.max_workers) {
+        try {
+          w = spawn(executable);
+        } catch (const std::exception& e) {
+          j.on_error(e.what());
+          return;
+        }
+        state.workers++;
+      } else {
+        state.pending.push_back(std::move(j));
+        return;
+      }
+    }
+    w->owner->post(w, std::move(j));
+  }
+
+  /**
+   * @brief The number of workers started so far.
+   */
+  [[nodiscard]] auto spawned() const -> std::size_t
+  {
+    std::lock_guard lock {m_mutex};
+    return m_spawned;
+  }
+
+private:
+  class io_thread;
+
+  struct job
+  {
+    std::string request;
+    response_cb on_response;
+    error_cb on_error;
+  };
+
+  struct worker
+  {
+    pid_t pid = -1;
+    // The write end of the worker's stdin and the read end of its stdout
+    int in_fd = -1;
+    int out_fd = -1;
+    std::string executable;
+    io_thread* owner = nullptr;
+
+    // Only accessed by the owning IO thread
+    bool registered = false;
+    bool writing = false;
+    bool dead = false;
+    std::optional<job> current;
+    frame_size request_size = 0;
+    std::size_t written = 0;
+    frame_size response_size = 0;
+    std::size_t header_read = 0;
+    std::string response;
+    std::size_t body_read = 0;
+  };
+
+  struct executable_state
+  {
+    std::vector<std::shared_ptr<worker>> idle;
+    std::deque<job> pending;
+    std::size_t workers = 0;
+  };
+
+  /**
+   * @brief Multiplexes the pipes of the workers assigned to it.
+   */
+  class io_thread
+  {
+  public:
+    explicit io_thread(process_pool& pool)
+        : m_pool(pool)
+        , m_epoll_fd(::epoll_create1(EPOLL_CLOEXEC))
+        , m_event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    {
+      if (m_epoll_fd < 0 || m_event_fd < 0) {
+        throw std::runtime_error("Failed to create epoll instance");
+      }
+      epoll_event ev {};
+      ev.events = EPOLLIN;
+      ev.data.fd = m_event_fd;
+      ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_event_fd, &ev);
+      m_thread = std::thread([this] { run(); });
+    }
+
+    io_thread(const io_thread&) = delete;
+    auto operator=(const io_thread&) -> io_thread& = delete;
+    io_thread(io_thread&&) = delete;
+    auto operator=(io_thread&&) -> io_thread& = delete;
+
+    ~io_thread()
+    {
+      ::close(m_epoll_fd);
+      ::close(m_event_fd);
+    }
+
+    auto post(std::shared_ptr<worker> w, job j) -> void
+    {
+      {
+        std::lock_guard lock {m_inbox_mutex};
+        m_inbox.emplace_back(std::move(w), std::move(j));
+      }
+      wake();
+    }
+
+    auto stop() -> void
+    {
+      {
+        std::lock_guard lock {m_inbox_mutex};
+        m_stopping = true;
+      }
+      wake();
+      m_thread.join();
+    }
+
+  private:
+    auto wake() -> void
+    {
+      std::uint64_t one = 1;
+      [[maybe_unused]] auto n = ::write(m_event_fd, &one, sizeof(one));
+    }
+
+    auto run() -> void
+    {
+      // Requests are only written by this thread. A worker which exits must
+      // not kill the host with SIGPIPE, writing fails with EPIPE instead.
+      // The disposition of the process is left to the application.
+      sigset_t pipe;
+      sigemptyset(&pipe);
+      sigaddset(&pipe, SIGPIPE);
+      ::pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+
+      constexpr int max_events = 64;
+      std::array<epoll_event, max_events> events {};
+      bool stopping = false;
+      for (;;) {
+        if (stopping && m_workers.empty()) {
+          return;
+        }
+        int n = ::epoll_wait(m_epoll_fd, events.data(), max_events, -1);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        for (int i = 0; i < n; i++) {
+          auto fd = events[i].data.fd;  // NOLINT
+          if (fd == m_event_fd) {
+            std::uint64_t count = 0;
+            [[maybe_unused]] auto r = ::read(m_event_fd, &count, sizeof(count));
+            stopping = drain_inbox() || stopping;
+            continue;
+          }
+          auto it = m_workers.find(fd);
+          if (it == m_workers.end()) {
+            continue;
+          }
+          auto w = it->second;
+          if (fd == w->in_fd) {
+            write_request(w);
+          } else {
+            read_response(w);
+          }
+        }
+      }
+    }
+
+    // Returns whether the pool is stopping
+    auto drain_inbox() -> bool
+    {
+      std::vector<std::pair<std::shared_ptr<worker>, job>> inbox;
+      bool stopping = false;
+      {
+        std::lock_guard lock {m_inbox_mutex};
+        inbox.swap(m_inbox);
+        stopping = m_stopping;
+      }
+      for (auto& [w, j] : inbox) {
+        if (w->dead) {
+          j.on_error("Worker exited");
+          continue;
+        }
+        if (!w->registered) {
+          w->registered = true;
+          m_workers[w->out_fd] = w;
+          epoll_event ev {};
+          ev.events = EPOLLIN;
+          ev.data.fd = w->out_fd;
+          ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, w->out_fd, &ev);
+        }
+        start(w, std::move(j));
+      }
+      if (stopping) {
+        // Workers exit once their stdin is closed, their stdout is then
+        // closed as well
+        for (auto& [fd, w] : m_workers) {
+          if (fd == w->out_fd && w->in_fd >= 0 && !w->current) {
+            ::close(w->in_fd);
+            w->in_fd = -1;
+          }
+        }
+      }
+      return stopping;
+    }
+
+    auto start(const std::shared_ptr<worker>& w, job j) -> void
+    {
+      w->request_size = j.request.size();
+      w->written = 0;
+      w->header_read = 0;
+      w->body_read = 0;
+      w->response.clear();
+      w->current = std::move(j);
+      write_request(w);
+    }
+
+    auto write_request(const std::shared_ptr<worker>& w) -> void
+    {
+      constexpr std::size_t header_size = sizeof(frame_size);
+      const auto& request = w->current->request;
+      auto total = header_size + request.size();
+      while (w->written < total) {
+        std::array<iovec, 2> iov {};
+        int count = 0;
+        if (w->written < header_size) {
+          iov[count++] = {
+              reinterpret_cast<char*>(&w->request_size)  // NOLINT
+                  + w->written,
+              header_size - w->written};
+          iov[count++] = {const_cast<char*>(request.data()),  // NOLINT
+                          request.size()};
+        } else {
+          auto offset = w->written - header_size;
+          iov[count++] = {
+              const_cast<char*>(request.data()) + offset,  // NOLINT
+              request.size() - offset};
+        }
+        auto n = ::writev(w->in_fd, iov.data(), count);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+          if (!w->writing) {
+            w->writing = true;
+            m_workers[w->in_fd] = w;
+            epoll_event ev {};
+            ev.events = EPOLLOUT;
+            ev.data.fd = w->in_fd;
+            ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, w->in_fd, &ev);
+          }
+          return;
+        }
+        if (n < 0) {
+          // The worker exited, which is handled once its stdout is closed
+          break;
+        }
+        w->written += static_cast<std::size_t>(n);
+      }
+      if (w->writing) {
+        w->writing = false;
+        ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, w->in_fd, nullptr);
+        m_workers.erase(w->in_fd);
+      }
+      // The request is not needed anymore
+      w->current->request = {};
+    }
+
+    auto read_response(const std::shared_ptr<worker>& w) -> void
+    {
+      constexpr std::size_t header_size = sizeof(frame_size);
+      for (;;) {
+        ssize_t n = 0;
+        if (w->header_read < header_size) {
+          n = ::read(w->out_fd,
+                     reinterpret_cast<char*>(&w->response_size)  // NOLINT
+                         + w->header_read,
+                     header_size - w->header_read);
+          if (n > 0) {
+            w->header_read += static_cast<std::size_t>(n);
+            if (w->header_read == header_size) {
+              w->response.resize(w->response_size);
+            }
+          }
+        } else if (w->body_read < w->response_size) {
+          n = ::read(w->out_fd,
+                     w->response.data() + w->body_read,
+                     w->response_size - w->body_read);
+          if (n > 0) {
+            w->body_read += static_cast<std::size_t>(n);
+          }
+        }
+        if (w->header_read == header_size && w->body_read == w->response_size)
+        {
+          finish(w);
+          return;
+        }
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+          return;
+        }
+        if (n <= 0) {
+          exited(w);
+          return;
+        }
+      }
+    }
+
+    auto finish(const std::shared_ptr<worker>& w) -> void
+    {
+      if (!w->current) {
+        // Output without a request, the protocol is out of sync
+        ::kill(w->pid, SIGKILL);
+        return;
+      }
+      auto done = std::move(*w->current);
+      w->current.reset();
+      auto response = std::move(w->response);
+      w->header_read = 0;
+      w->body_read = 0;
+
+      std::optional<job> next;
+      bool stopping = false;
+      {
+        std::lock_guard lock {m_pool.m_mutex};
+        auto& state = m_pool.m_executables[w->executable];
+        stopping = m_pool.m_stopping;
+        if (!state.pending.empty()) {
+          next = std::move(state.pending.front());
+          state.pending.pop_front();
+        } else if (!stopping) {
+          state.idle.push_back(w);
+        }
+      }
+      if (next) {
+        start(w, std::move(*next));
+      } else if (stopping) {
+        ::close(w->in_fd);
+        w->in_fd = -1;
+      }
+      done.on_response(std::move(response));
+    }
+
+    auto exited(const std::shared_ptr<worker>& w) -> void
+    {
+      w->dead = true;
+      ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, w->out_fd, nullptr);
+      m_workers.erase(w->out_fd);
+      if (w->writing) {
+        ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, w->in_fd, nullptr);
+        m_workers.erase(w->in_fd);
+      }
+      ::close(w->out_fd);
+      if (w->in_fd >= 0) {
+        ::close(w->in_fd);
+      }
+      int status = 0;
+      ::waitpid(w->pid, &status, 0);
+
+      std::optional<job> replacement;
+      std::shared_ptr<worker> spawned;
+      std::string spawn_error;
+      {
+        std::lock_guard lock {m_pool.m_mutex};
+        auto& state = m_pool.m_executables[w->executable];
+        std::erase(state.idle, w);
+        state.workers--;
+        // Queued requests would otherwise wait for a worker forever
+        if (!state.pending.empty() && !m_pool.m_stopping) {
+          replacement = std::move(state.pending.front());
+          state.pending.pop_front();
+          try {
+            spawned = m_pool.spawn(w->executable);
+            state.workers++;
+          } catch (const std::exception& e) {
+            spawn_error = e.what();
+          }
+        }
+      }
+      if (w->current) {
+        auto failed = std::move(*w->current);
+        w->current.reset();
+        std::string reason;
+        if (WIFSIGNALED(status)) {  // NOLINT
+          reason = "Worker killed by signal "
+              + std::to_string(WTERMSIG(status));  // NOLINT
+        } else {
+          reason = "Worker exited with status "
+              + std::to_string(WEXITSTATUS(status));  // NOLINT
+        }
+        failed.on_error(reason);
+      }
+      if (replacement) {
+        if (spawned) {
+          spawned->owner->post(spawned, std::move(*replacement));
+        } else {
+          replacement->on_error(spawn_error);
+        }
+      }
+    }
+
+    process_pool& m_pool;
+    int m_epoll_fd;
+    int m_event_fd;
+    std::thread m_thread;
+
+    std::mutex m_inbox_mutex;
+    std::vector<std::pair<std::shared_ptr<worker>, job>> m_inbox;
+    bool m_stopping = false;
+
+    // Registered pipe -> worker, only accessed by this thread
+    std::unordered_map<int, std::shared_ptr<worker>> m_workers;
+  };
+
+  // Requires a lock on `m_mutex`
+  auto spawn(const std::string& executable) -> std::shared_ptr<worker>
+  {
+    std::array<int, 2> to_child {};
+    std::array<int, 2> from_child {};
+    if (::pipe2(to_child.data(), O_CLOEXEC) != 0) {
+      throw std::runtime_error("Could not create parent->child pipe");
+    }
+    if (::pipe2(from_child.data(), O_CLOEXEC) != 0) {
+      ::close(to_child[0]);
+      ::close(to_child[1]);
+      throw std::runtime_error("Could not create child->parent pipe");
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, to_child[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, from_child[1], STDOUT_FILENO);
+
+    std::vector<char*> argv;
+    std::string path = executable;
+    argv.push_back(path.data());
+    for (auto& arg : m_args) {
+      argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    std::array<char*, 1> envp = {nullptr};
+
+    pid_t pid = -1;
+    int res = posix_spawn(
+        &pid, path.c_str(), &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(to_child[0]);
+    ::close(from_child[1]);
+    if (res != 0) {
+      ::close(to_child[1]);
+      ::close(from_child[0]);
+      throw std::runtime_error("Failed to start " + executable + ": "
+                               + std::strerror(res));  // NOLINT
+    }
+
+    ::fcntl(to_child[1], F_SETFL, O_NONBLOCK);
+    ::fcntl(from_child[0], F_SETFL, O_NONBLOCK);
+
+    auto w = std::make_shared<worker>();
+    w->pid = pid;
+    w->in_fd = to_child[1];
+    w->out_fd = from_child[0];
+    w->executable = executable;
+    w->owner = m_io_threads[m_next_io_thread++ % m_io_threads.size()].get();
+    m_spawned++;
+    return w;
+  }
+
+  std::vector<std::string> m_args;
+  process_pool_options m_options;
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, executable_state> m_executables;
+  std::size_t m_next_io_thread = 0;
+  std::size_t m_spawned = 0;
+  bool m_stopping = false;
+
+  std::vector<std::unique_ptr<io_thread>> m_io_threads;
+};
+
+}  // namespace cppless
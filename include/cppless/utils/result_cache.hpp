@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/algorithm/hex.hpp>
+#include <cppless/utils/crypto/wrappers.hpp>
+#include <cppless/utils/object_store.hpp>
+#include <cppless/utils/tracing.hpp>
+
+namespace cppless
+{
+
+struct result_cache_options
+{
+  /**
+   * @brief The bytes of results kept in memory, the least recently used ones
+   * are evicted beyond it.
+   */
+  std::size_t capacity = 64UL << 20U;
+  /**
+   * @brief Keeps every result, e.g. a `file_object_store` to reuse results
+   * across runs of the host. It is written by the thread delivering a
+   * result, thus should be fast to write to.
+   */
+  std::shared_ptr<object_store> store;
+};
+
+struct result_cache_statistics
+{
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  // Results evicted from memory, they may still be in the store
+  std::size_t evictions = 0;
+
+  [[nodiscard]] auto hit_rate() const -> double
+  {
+    auto lookups = hits + misses;
+    return lookups == 0 ? 0
+                        : static_cast<double>(hits)
+            / static_cast<double>(lookups);
+  }
+};
+
+/**
+ * @brief Results of tasks addressed by their content, see `key`: an LRU
+ * cache in memory, backed by an optional store. Shared by the threads of a
+ * dispatcher instance.
+ */
+class result_cache
+{
+public:
+  explicit result_cache(result_cache_options options = {})
+      : m_options(std::move(options))
+  {
+  }
+
+  /**
+   * @brief The key of the invocation of the task `identifier` with a payload
+   * hashing to `payload_hash`, e.g. as computed for signing the request.
+   */
+  static auto key(const std::string& identifier,
+                  std::span<const unsigned char> payload_hash) -> std::string
+  {
+    evp_md_ctx ctx;
+    ctx.update(identifier);
+    ctx.update(payload_hash.data(), payload_hash.size());
+    auto digest = ctx.final();
+
+    std::string key = "cppless-result-";
+    boost::algorithm::hex_lower(digest, std::back_inserter(key));
+    return key;
+  }
+
+  /**
+   * @brief The result stored under `key`, looked up in memory first, then in
+   * the store. Counts as a hit or a miss.
+   */
+  auto get(const std::string& key) -> std::optional<std::string>
+  {
+    {
+      std::scoped_lock lock {m_mutex};
+      auto it = m_index.find(key);
+      if (it != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        m_statistics.hits++;
+        return it->second->second;
+      }
+    }
+
+    std::optional<std::string> value;
+    if (m_options.store) {
+      try {
+        value = m_options.store->get(key);
+      } catch (const std::exception&) {
+        // Not stored, or unreachable, either way the task is invoked
+      }
+    }
+
+    std::scoped_lock lock {m_mutex};
+    if (!value) {
+      m_statistics.misses++;
+      return std::nullopt;
+    }
+    m_statistics.hits++;
+    insert(key, *value);
+    return value;
+  }
+
+  /**
+   * @brief Stores `value` under `key`, in memory and in the store.
+   */
+  auto put(const std::string& key, const std::string& value) -> void
+  {
+    if (m_options.store) {
+      try {
+        m_options.store->put(key, value);
+      } catch (const std::exception&) {
+        // The result is only kept in memory then
+      }
+    }
+    std::scoped_lock lock {m_mutex};
+    insert(key, value);
+  }
+
+  [[nodiscard]] auto statistics() -> result_cache_statistics
+  {
+    std::scoped_lock lock {m_mutex};
+    return m_statistics;
+  }
+
+  /**
+   * @brief Tags `span` with the hits, misses and hit rate so far, e.g. the
+   * root span of a graph once it is done.
+   */
+  auto annotate(tracing_span_ref span) -> void
+  {
+    auto statistics = this->statistics();
+    span.set_tag("cache_hits", std::to_string(statistics.hits));
+    span.set_tag("cache_misses", std::to_string(statistics.misses));
+    span.set_tag("cache_hit_rate", std::to_string(statistics.hit_rate()));
+  }
+
+private:
+  // Called with the mutex held
+  auto insert(const std::string& key, const std::string& value) -> void
+  {
+    // Would evict everything else
+    if (value.size() > m_options.capacity) {
+      return;
+    }
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      m_size -= it->second->second.size();
+      m_entries.erase(it->second);
+      m_index.erase(it);
+    }
+    m_entries.emplace_front(key, value);
+    m_index[key] = m_entries.begin();
+    m_size += value.size();
+
+    while (m_size > m_options.capacity) {
+      auto& last = m_entries.back();
+      m_size -= last.second.size();
+      m_index.erase(last.first);
+      m_entries.pop_back();
+      m_statistics.evictions++;
+    }
+  }
+
+  result_cache_options m_options;
+
+  std::mutex m_mutex;
+  // Most recently used first
+  std::list<std::pair<std::string, std::string>> m_entries;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, std::string>>::iterator>
+      m_index;
+  std::size_t m_size = 0;
+  result_cache_statistics m_statistics;
+};
+
+}  // namespace cppless
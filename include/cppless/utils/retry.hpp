@@ -0,0 +1,476 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace cppless
+{
+
+struct retry_options
+{
+  /**
+   * @brief Retries of a single task before it fails terminally, unless the
+   * task configures its own budget.
+   */
+  unsigned int max_retries = 8;
+  std::chrono::milliseconds base_delay {25};
+  std::chrono::milliseconds max_delay {5000};
+};
+
+/**
+ * @brief Exponential backoff with full jitter: a delay drawn uniformly from
+ * [0, min(max_delay, base_delay * 2^attempt)], so that throttled clients do
+ * not retry in lockstep. A zero base delay retries right away.
+ */
+template<class Rng>
+auto backoff_delay(const retry_options& options, unsigned int attempt, Rng& rng)
+    -> std::chrono::nanoseconds
+{
+  using std::chrono::nanoseconds;
+  constexpr unsigned int max_shift = 30;
+  auto base = std::chrono::duration_cast<nanoseconds>(options.base_delay);
+  auto cap = std::chrono::duration_cast<nanoseconds>(options.max_delay);
+  if (base.count() <= 0 || cap.count() <= 0) {
+    return nanoseconds::zero();
+  }
+  auto shift = std::min(attempt, max_shift);
+  auto ceiling = cap.count();
+  // Shifting further would overflow, the cap is smaller anyway
+  if (base.count() <= (std::numeric_limits<nanoseconds::rep>::max() >> shift))
+  {
+    ceiling = std::min(ceiling, base.count() << shift);
+  }
+  std::uniform_int_distribution<nanoseconds::rep> distribution(0, ceiling);
+  return nanoseconds {distribution(rng)};
+}
+
+/**
+ * @brief Limits the rate of events to `rate` per second, allowing bursts of
+ * up to `burst` events. A non-positive rate disables the limit.
+ */
+class token_bucket
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit token_bucket(double rate = 0, double burst = 1)
+      : m_rate(rate)
+      , m_burst(std::max(burst, 1.0))
+      , m_tokens(m_burst)
+      , m_last(clock::now())
+  {
+  }
+
+  auto try_acquire(clock::time_point now) -> bool
+  {
+    if (m_rate <= 0) {
+      return true;
+    }
+    refill(now);
+    if (m_tokens < 1) {
+      return false;
+    }
+    m_tokens -= 1;
+    return true;
+  }
+
+  /**
+   * @brief The time until the next token becomes available.
+   */
+  [[nodiscard]] auto wait_time(clock::time_point now) const -> clock::duration
+  {
+    if (m_rate <= 0) {
+      return clock::duration::zero();
+    }
+    auto elapsed = std::chrono::duration<double>(now - m_last).count();
+    auto tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+    if (tokens >= 1) {
+      return clock::duration::zero();
+    }
+    return std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>((1 - tokens) / m_rate));
+  }
+
+private:
+  auto refill(clock::time_point now) -> void
+  {
+    auto elapsed = std::chrono::duration<double>(now - m_last).count();
+    m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+    m_last = now;
+  }
+
+  double m_rate;
+  double m_burst;
+  double m_tokens;
+  clock::time_point m_last;
+};
+
+struct admission_options
+{
+  /**
+   * @brief Invocations in flight before the service first throttled, by
+   * default the concurrency limit of a fresh AWS account.
+   */
+  double initial_limit = 1000;
+  double min_limit = 1;
+  double max_limit = 4096;
+  /**
+   * @brief Factor the concurrency limit is multiplied with when the service
+   * throttles.
+   */
+  double decrease_factor = 0.5;
+  /**
+   * @brief Invocations started per second, 0 for no limit.
+   */
+  double rate = 0;
+  double burst = 100;
+};
+
+/**
+ * @brief Client-side admission control: an AIMD limit on the number of
+ * invocations in flight, and a token bucket on the rate they start at.
+ *
+ * The limit grows by one per window of successful invocations and is cut
+ * multiplicatively on throttling, at most once per window: a throttled
+ * invocation only lowers the limit if it was admitted after the previous
+ * decrease.
+ */
+class admission_controller
+{
+public:
+  using clock = std::chrono::steady_clock;
+  using ticket = std::uint64_t;
+
+  explicit admission_controller(admission_options options = {})
+      : m_options(options)
+      , m_limit(std::clamp(
+            options.initial_limit, options.min_limit, options.max_limit))
+      , m_bucket(options.rate, options.burst)
+  {
+  }
+
+  auto try_admit(clock::time_point now) -> std::optional<ticket>
+  {
+    if (static_cast<double>(m_in_flight) >= std::floor(m_limit)
+        || !m_bucket.try_acquire(now))
+    {
+      return std::nullopt;
+    }
+    m_in_flight++;
+    return m_next_ticket++;
+  }
+
+  /**
+   * @brief The time until the rate limit admits the next invocation; zero if
+   * admission waits for an invocation to finish instead.
+   */
+  [[nodiscard]] auto wait_time(clock::time_point now) const -> clock::duration
+  {
+    if (static_cast<double>(m_in_flight) >= std::floor(m_limit)) {
+      return clock::duration::zero();
+    }
+    return m_bucket.wait_time(now);
+  }
+
+  auto on_success(ticket /*t*/) -> void
+  {
+    m_in_flight--;
+    m_limit = std::min(m_options.max_limit, m_limit + 1 / m_limit);
+  }
+
+  auto on_throttled(ticket t) -> void
+  {
+    m_in_flight--;
+    if (t >= m_window_start) {
+      m_limit =
+          std::max(m_options.min_limit, m_limit * m_options.decrease_factor);
+      m_window_start = m_next_ticket;
+    }
+  }
+
+  auto on_failure(ticket /*t*/) -> void
+  {
+    m_in_flight--;
+  }
+
+  [[nodiscard]] auto limit() const -> double
+  {
+    return m_limit;
+  }
+
+  [[nodiscard]] auto in_flight() const -> std::size_t
+  {
+    return m_in_flight;
+  }
+
+private:
+  admission_options m_options;
+  double m_limit;
+  token_bucket m_bucket;
+  std::size_t m_in_flight = 0;
+  ticket m_next_ticket = 0;
+  ticket m_window_start = 0;
+};
+
+/**
+ * @brief Schedules invocation attempts on an io_context: attempts start once
+ * the admission controller lets them, throttled and failed attempts are
+ * retried after a jittered exponential backoff, and tasks which exhaust their
+ * retry budget are reported as failed.
+ *
+ * Every attempt has to report exactly one outcome through `succeeded`,
+ * `throttled` or `failed`. Reports for tasks without an attempt in flight are
+ * ignored, e.g. a stream error after the response was handled.
+ */
+class retry_scheduler
+{
+public:
+  using clock = std::chrono::steady_clock;
+  using attempt_cb = std::function<void()>;
+  using failure_cb = std::function<void(int, const std::string&)>;
+
+  explicit retry_scheduler(boost::asio::io_context& io_context,
+                           admission_options admission = {},
+                           retry_options retry = {})
+      : m_io_context(io_context)
+      , m_admission(admission)
+      , m_options(retry)
+      , m_admission_timer(io_context)
+      , m_rng(std::random_device {}())
+  {
+  }
+
+  retry_scheduler(const retry_scheduler&) = delete;
+  auto operator=(const retry_scheduler&) -> retry_scheduler& = delete;
+  retry_scheduler(retry_scheduler&&) = delete;
+  auto operator=(retry_scheduler&&) -> retry_scheduler& = delete;
+  ~retry_scheduler()
+  {
+    // The io_context outlives the scheduler, cancelled handlers return
+    // without touching it
+    m_admission_timer.cancel();
+    for (auto& [id, t] : m_tasks) {
+      if (t.backoff) {
+        t.backoff->cancel();
+      }
+    }
+  }
+
+  /**
+   * @brief Runs `attempt` as soon as it is admitted, and again for every
+   * retry.
+   */
+  auto submit(int id,
+              attempt_cb attempt,
+              std::optional<unsigned int> max_retries = std::nullopt) -> void
+  {
+    auto& t = m_tasks[id];
+    t.attempt = std::move(attempt);
+    t.retries_left = max_retries.value_or(m_options.max_retries);
+    t.st = state::queued;
+    m_queue.push_back(id);
+    admit();
+  }
+
+  auto succeeded(int id) -> void
+  {
+    auto* t = attempting(id);
+    if (t == nullptr) {
+      return;
+    }
+    m_admission.on_success(t->ticket);
+    m_tasks.erase(id);
+    admit();
+  }
+
+  /**
+   * @brief The service rejected the attempt because of throttling.
+   */
+  auto throttled(int id) -> void
+  {
+    auto* t = attempting(id);
+    if (t == nullptr) {
+      return;
+    }
+    m_throttled++;
+    m_admission.on_throttled(t->ticket);
+    retry(id, *t, "Invocation throttled");
+  }
+
+  auto failed(int id, const std::string& message, bool retryable) -> void
+  {
+    auto* t = attempting(id);
+    if (t == nullptr) {
+      return;
+    }
+    m_admission.on_failure(t->ticket);
+    if (retryable) {
+      retry(id, *t, message);
+    } else {
+      fail(id, message);
+    }
+  }
+
+  /**
+   * @brief Called with the id of every task that failed terminally.
+   */
+  auto on_failure(failure_cb callback) -> void
+  {
+    m_failure_callback = std::move(callback);
+  }
+
+  /**
+   * @brief The number of tasks which have neither succeeded nor failed.
+   */
+  [[nodiscard]] auto active() const -> std::size_t
+  {
+    return m_tasks.size();
+  }
+
+  [[nodiscard]] auto attempts() const -> std::size_t
+  {
+    return m_attempts;
+  }
+
+  [[nodiscard]] auto throttled_attempts() const -> std::size_t
+  {
+    return m_throttled;
+  }
+
+  [[nodiscard]] auto admission() const -> const admission_controller&
+  {
+    return m_admission;
+  }
+
+private:
+  enum class state
+  {
+    queued,
+    attempting,
+    backing_off,
+  };
+
+  struct task
+  {
+    attempt_cb attempt;
+    unsigned int retries_left = 0;
+    unsigned int attempts = 0;
+    admission_controller::ticket ticket = 0;
+    state st = state::queued;
+    // Armed while backing off
+    std::shared_ptr<boost::asio::steady_timer> backoff;
+  };
+
+  auto attempting(int id) -> task*
+  {
+    auto it = m_tasks.find(id);
+    if (it == m_tasks.end() || it->second.st != state::attempting) {
+      return nullptr;
+    }
+    return &it->second;
+  }
+
+  auto admit() -> void
+  {
+    while (!m_queue.empty()) {
+      auto now = clock::now();
+      auto ticket = m_admission.try_admit(now);
+      if (!ticket) {
+        auto wait = m_admission.wait_time(now);
+        if (wait > clock::duration::zero() && !m_admission_timer_armed) {
+          m_admission_timer_armed = true;
+          m_admission_timer.expires_after(wait);
+          m_admission_timer.async_wait(
+              [this](const boost::system::error_code& ec)
+              {
+                if (ec == boost::asio::error::operation_aborted) {
+                  return;
+                }
+                m_admission_timer_armed = false;
+                admit();
+              });
+        }
+        return;
+      }
+      auto id = m_queue.front();
+      m_queue.pop_front();
+      auto& t = m_tasks[id];
+      t.st = state::attempting;
+      t.ticket = *ticket;
+      t.attempts++;
+      m_attempts++;
+      // The attempt may report its outcome synchronously
+      auto attempt = t.attempt;
+      attempt();
+    }
+  }
+
+  auto retry(int id, task& t, const std::string& message) -> void
+  {
+    if (t.retries_left == 0) {
+      fail(id, message);
+      return;
+    }
+    t.retries_left--;
+    t.st = state::backing_off;
+    auto timer = std::make_shared<boost::asio::steady_timer>(m_io_context);
+    timer->expires_after(backoff_delay(m_options, t.attempts - 1, m_rng));
+    t.backoff = timer;
+    timer->async_wait(
+        [this, id, timer](const boost::system::error_code& ec)
+        {
+          if (ec == boost::asio::error::operation_aborted) {
+            return;
+          }
+          auto& waiting = m_tasks[id];
+          waiting.backoff.reset();
+          waiting.st = state::queued;
+          m_queue.push_back(id);
+          admit();
+        });
+    admit();
+  }
+
+  auto fail(int id, const std::string& message) -> void
+  {
+    auto attempts = m_tasks[id].attempts;
+    m_tasks.erase(id);
+    if (m_failure_callback) {
+      m_failure_callback(id,
+                         message + " after " + std::to_string(attempts)
+                             + " attempts");
+    }
+    admit();
+  }
+
+  boost::asio::io_context& m_io_context;
+  admission_controller m_admission;
+  retry_options m_options;
+
+  std::unordered_map<int, task> m_tasks;
+  std::deque<int> m_queue;
+  boost::asio::steady_timer m_admission_timer;
+  bool m_admission_timer_armed = false;
+  std::mt19937_64 m_rng;
+
+  std::size_t m_attempts = 0;
+  std::size_t m_throttled = 0;
+  failure_cb m_failure_callback;
+};
+
+}  // namespace cppless
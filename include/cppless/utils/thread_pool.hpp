@@ -0,0 +1,393 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cppless
+{
+
+/**
+ * @brief A work-stealing thread pool. Every worker owns a deque of jobs: it
+ * pushes and pops jobs at the back and steals from the front of the deques of
+ * other workers when its own runs dry. Threads outside of the pool submit
+ * their jobs to a shared deque.
+ *
+ * Threads waiting for their jobs to complete run other jobs in the meantime,
+ * so `parallel_for` and `parallel_reduce` may be nested.
+ */
+class thread_pool
+{
+public:
+  using job = std::function<void()>;
+
+  /**
+   * @brief Creates a pool with a parallelism of `threads`, the calling thread
+   * included, thus starting `threads - 1` workers. Zero uses all hardware
+   * threads.
+   */
+  explicit thread_pool(unsigned int threads = 0)
+  {
+    if (threads == 0) {
+      threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    // The last deque is shared by threads outside of the pool
+    for (unsigned int i = 0; i < threads; i++) {
+      m_queues.push_back(std::make_unique<job_queue>());
+    }
+    for (unsigned int i = 0; i + 1 < threads; i++) {
+      m_workers.emplace_back([this, i] { run(i); });
+    }
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  auto operator=(const thread_pool&) -> thread_pool& = delete;
+  thread_pool(thread_pool&&) = delete;
+  auto operator=(thread_pool&&) -> thread_pool& = delete;
+
+  ~thread_pool()
+  {
+    {
+      std::scoped_lock lock(m_sleep_mutex);
+      m_stopping = true;
+    }
+    m_sleep_cv.notify_all();
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  /**
+   * @brief The parallelism of the pool, the calling thread included.
+   */
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return m_workers.size() + 1;
+  }
+
+  /**
+   * @brief Runs `j` on a worker, or on a thread waiting in `parallel_for` or
+   * `parallel_reduce`. `j` must not throw. A pool without workers runs `j`
+   * right away on the calling thread.
+   */
+  auto submit(job j) -> void
+  {
+    if (m_workers.empty()) {
+      j();
+      return;
+    }
+    push(std::move(j));
+  }
+
+  /**
+   * @brief Calls `body(i)` for every `i` in `[begin, end)`. The range is split
+   * into chunks of `grain` indices, by default about four per thread.
+   * Exceptions thrown by `body` are rethrown once all chunks have finished.
+   */
+  template<class Body>
+  auto parallel_for(std::size_t begin,
+                    std::size_t end,
+                    Body&& body,
+                    std::size_t grain = 0) -> void
+  {
+    chunked(begin,
+            end,
+            grain,
+            [&body](std::size_t /*chunk*/, std::size_t from, std::size_t to)
+            {
+              for (auto i = from; i < to; i++) {
+                body(i);
+              }
+            });
+  }
+
+  /**
+   * @brief Combines `map(i)` for every `i` in `[begin, end)` with `reduce`,
+   * starting from `identity`. The partial results of the chunks are combined
+   * in order, thus the result does not depend on the schedule even if
+   * `reduce` is not associative, e.g. for floating point sums.
+   */
+  template<class T, class Map, class Reduce>
+  auto parallel_reduce(std::size_t begin,
+                       std::size_t end,
+                       T identity,
+                       Map&& map,
+                       Reduce&& reduce,
+                       std::size_t grain = 0) -> T
+  {
+    std::vector<T> partials;
+    chunked(begin,
+            end,
+            grain,
+            [&](std::size_t chunk, std::size_t from, std::size_t to)
+            {
+              T partial = identity;
+              for (auto i = from; i < to; i++) {
+                partial = reduce(std::move(partial), map(i));
+              }
+              partials[chunk] = std::move(partial);
+            },
+            [&](std::size_t chunks) { partials.resize(chunks, identity); });
+    T result = std::move(identity);
+    for (auto& partial : partials) {
+      result = reduce(std::move(result), std::move(partial));
+    }
+    return result;
+  }
+
+  /**
+   * @brief Sets the parallelism of the pool returned by `default_pool`. Has
+   * no effect once the default pool was created.
+   */
+  static auto set_default_threads(unsigned int threads) -> void
+  {
+    default_threads() = threads;
+  }
+
+  /**
+   * @brief The pool used by `cppless::parallel_for` and
+   * `cppless::parallel_reduce`. It runs everything on the calling thread
+   * unless a parallelism was configured, e.g. with `aws::with_threads`.
+   */
+  static auto default_pool() -> thread_pool&
+  {
+    static thread_pool pool(default_threads());
+    return pool;
+  }
+
+private:
+  struct job_queue
+  {
+    std::mutex mutex;
+    std::deque<job> jobs;
+  };
+
+  // The progress of one call of `chunked`
+  struct chunked_state
+  {
+    explicit chunked_state(std::size_t chunks)
+        : remaining(chunks)
+    {
+    }
+
+    std::atomic<std::size_t> remaining;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+  };
+
+  static auto default_threads() -> unsigned int&
+  {
+    static unsigned int threads = 1;
+    return threads;
+  }
+
+  // The index of the deque owned by the current thread
+  auto own_queue() const -> std::size_t
+  {
+    return current_pool() == this ? current_index() : m_queues.size() - 1;
+  }
+
+  static auto current_pool() -> const thread_pool*&
+  {
+    thread_local const thread_pool* pool = nullptr;
+    return pool;
+  }
+
+  static auto current_index() -> std::size_t&
+  {
+    thread_local std::size_t index = 0;
+    return index;
+  }
+
+  auto push(job j) -> void
+  {
+    auto& queue = *m_queues[own_queue()];
+    {
+      std::scoped_lock lock(queue.mutex);
+      queue.jobs.push_back(std::move(j));
+    }
+    m_pending.fetch_add(1);
+    if (m_sleeping.load() > 0) {
+      std::scoped_lock lock(m_sleep_mutex);
+      m_sleep_cv.notify_one();
+    }
+  }
+
+  auto try_run_one() -> bool
+  {
+    auto own = own_queue();
+    std::optional<job> j;
+    {
+      auto& queue = *m_queues[own];
+      std::scoped_lock lock(queue.mutex);
+      if (!queue.jobs.empty()) {
+        j = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+      }
+    }
+    for (std::size_t offset = 1; !j && offset < m_queues.size(); offset++) {
+      auto& victim = *m_queues[(own + offset) % m_queues.size()];
+      std::scoped_lock lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        j = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+      }
+    }
+    if (!j) {
+      return false;
+    }
+    m_pending.fetch_sub(1);
+    (*j)();
+    return true;
+  }
+
+  auto run(std::size_t index) -> void
+  {
+    current_pool() = this;
+    current_index() = index;
+    for (;;) {
+      if (try_run_one()) {
+        continue;
+      }
+      std::unique_lock lock(m_sleep_mutex);
+      m_sleeping.fetch_add(1);
+      m_sleep_cv.wait(lock,
+                      [this] { return m_stopping || m_pending.load() > 0; });
+      m_sleeping.fetch_sub(1);
+      if (m_stopping) {
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief Runs `fn(chunk, from, to)` for the chunks of `[begin, end)` on the
+   * pool, `prepare(chunks)` is called with the number of chunks beforehand.
+   */
+  template<class Fn, class Prepare = void (*)(std::size_t)>
+  auto chunked(
+      std::size_t begin,
+      std::size_t end,
+      std::size_t grain,
+      Fn&& fn,
+      Prepare&& prepare = [](std::size_t /*chunks*/) {}) -> void
+  {
+    if (end <= begin) {
+      prepare(0);
+      return;
+    }
+    auto count = end - begin;
+    if (grain == 0) {
+      grain = std::max<std::size_t>(1, count / (size() * 4));
+    }
+    auto chunks = (count + grain - 1) / grain;
+    prepare(chunks);
+    if (chunks == 1 || size() == 1) {
+      for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+        auto from = begin + chunk * grain;
+        fn(chunk, from, std::min(end, from + grain));
+      }
+      return;
+    }
+
+    // Shared with the jobs, which may still finish the last chunk once the
+    // calling thread saw it done and returned
+    auto state = std::make_shared<chunked_state>(chunks);
+    auto run_chunk = [this, state, &fn, begin, end, grain](std::size_t chunk)
+    {
+      auto from = begin + chunk * grain;
+      try {
+        fn(chunk, from, std::min(end, from + grain));
+      } catch (...) {
+        std::scoped_lock lock(state->error_mutex);
+        if (!state->error) {
+          state->error = std::current_exception();
+        }
+      }
+      if (state->remaining.fetch_sub(1) == 1) {
+        // Wakes the thread waiting for the chunks
+        std::scoped_lock lock(m_sleep_mutex);
+        m_sleep_cv.notify_all();
+      }
+    };
+    // The calling thread takes the first chunk itself
+    for (std::size_t chunk = chunks - 1; chunk > 0; chunk--) {
+      push([run_chunk, chunk] { run_chunk(chunk); });
+    }
+    run_chunk(0);
+    // Runs other jobs while chunks are left, and sleeps like a worker while
+    // there are none, e.g. while the last chunks run on other threads
+    while (state->remaining.load() > 0) {
+      if (try_run_one()) {
+        continue;
+      }
+      std::unique_lock lock(m_sleep_mutex);
+      m_sleeping.fetch_add(1);
+      m_sleep_cv.wait(lock,
+                      [&]
+                      {
+                        return state->remaining.load() == 0
+                            || m_pending.load() > 0;
+                      });
+      m_sleeping.fetch_sub(1);
+    }
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
+  }
+
+  std::vector<std::unique_ptr<job_queue>> m_queues;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<std::size_t> m_pending = 0;
+  std::atomic<std::size_t> m_sleeping = 0;
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_sleep_cv;
+  bool m_stopping = false;
+};
+
+/**
+ * @brief Calls `body(i)` for every `i` in `[begin, end)` on the default pool.
+ */
+template<class Body>
+auto parallel_for(std::size_t begin,
+                  std::size_t end,
+                  Body&& body,
+                  std::size_t grain = 0) -> void
+{
+  thread_pool::default_pool().parallel_for(
+      begin, end, std::forward<Body>(body), grain);
+}
+
+/**
+ * @brief Combines `map(i)` for every `i` in `[begin, end)` with `reduce` on
+ * the default pool.
+ */
+template<class T, class Map, class Reduce>
+auto parallel_reduce(std::size_t begin,
+                     std::size_t end,
+                     T identity,
+                     Map&& map,
+                     Reduce&& reduce,
+                     std::size_t grain = 0) -> T
+{
+  return thread_pool::default_pool().parallel_reduce(
+      begin,
+      end,
+      std::move(identity),
+      std::forward<Map>(map),
+      std::forward<Reduce>(reduce),
+      grain);
+}
+
+}  // namespace cppless
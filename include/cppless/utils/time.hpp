@@ -1,8 +1,7 @@
 #pragma once
 
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <ctime>
 #include <string>
 
 // YYYYMMDD'T'HHMMSS'Z'
@@ -10,18 +9,27 @@ inline auto format_aws_date(const std::chrono::system_clock::time_point& tp)
     -> std::string
 {
   std::time_t time = std::chrono::system_clock::to_time_t(tp);
-  tm gm_tm = *gmtime(&time);  // NOLINT
+  tm gm_tm {};
+  gmtime_r(&time, &gm_tm);
 
-  std::stringstream ss;
   const auto tm_start_year = 1900;
-  ss << std::setw(4) << std::setfill('0') << gm_tm.tm_year + tm_start_year;
-  ss << std::setw(2) << std::setfill('0') << gm_tm.tm_mon + 1;
-  ss << std::setw(2) << std::setfill('0') << gm_tm.tm_mday;
-  ss << 'T';
-  ss << std::setw(2) << std::setfill('0') << gm_tm.tm_hour;
-  ss << std::setw(2) << std::setfill('0') << gm_tm.tm_min;
-  ss << std::setw(2) << std::setfill('0') << gm_tm.tm_sec;
-  ss << 'Z';
+  std::string result(16, '\0');  // NOLINT
+  auto put = [&result](std::size_t pos, int value, int width)
+  {
+    for (int i = width - 1; i >= 0; --i) {
+      result[pos + static_cast<std::size_t>(i)] =
+          static_cast<char>('0' + value % 10);  // NOLINT
+      value /= 10;  // NOLINT
+    }
+  };
+  put(0, gm_tm.tm_year + tm_start_year, 4);
+  put(4, gm_tm.tm_mon + 1, 2);
+  put(6, gm_tm.tm_mday, 2);
+  result[8] = 'T';
+  put(9, gm_tm.tm_hour, 2);  // NOLINT
+  put(11, gm_tm.tm_min, 2);  // NOLINT
+  put(13, gm_tm.tm_sec, 2);  // NOLINT
+  result[15] = 'Z';  // NOLINT
 
-  return ss.str();
-}
\ No newline at end of file
+  return result;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "./batch.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/string.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/utils/cereal.hpp>
+
+namespace
+{
+
+struct offset_task
+{
+  int offset = 0;
+
+  auto operator()(int x, const std::string& s) const -> int
+  {
+    if (x < 0) {
+      throw std::runtime_error("negative argument");
+    }
+    return offset + x + static_cast<int>(s.size());
+  }
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(offset);
+  }
+};
+
+}  // namespace
+
+void batch_tests()
+{
+  using namespace boost::ut;
+
+  "invocation_payload"_test = []
+  {
+    should("round trip a single invocation") = []
+    {
+      offset_task sent {7};
+      std::tuple<int, std::string> args {3, "ab"};
+      invocation_payload single {sent, args};
+      auto payload = cppless::binary_archive::serialize(single);
+
+      offset_task received;
+      std::tuple<int, std::string> received_args;
+      std::vector<std::tuple<int, std::string>> received_batch;
+      std::uint32_t threads = 0;
+      invocation_payload<offset_task, int, std::string> target {
+          received, received_args, received_batch, threads};
+      cppless::binary_archive::deserialize(payload, target);
+
+      expect(!target.batched());
+      expect(received.offset == 7_i);
+      expect(received_args == args);
+      expect(received_batch.empty());
+    };
+
+    should("round trip a batch with its thread count") = []
+    {
+      offset_task sent {7};
+      std::vector<std::tuple<int, std::string>> batch {{1, "a"}, {2, "bb"}};
+      std::uint32_t threads = 4;
+      invocation_payload payload_data {sent, batch, threads};
+      auto payload = cppless::binary_archive::serialize(payload_data);
+
+      offset_task received;
+      std::tuple<int, std::string> received_args;
+      std::vector<std::tuple<int, std::string>> received_batch;
+      std::uint32_t received_threads = 0;
+      invocation_payload<offset_task, int, std::string> target {
+          received, received_args, received_batch, received_threads};
+      cppless::binary_archive::deserialize(payload, target);
+
+      expect(target.batched());
+      expect(received.offset == 7_i);
+      expect(received_batch == batch);
+      expect(received_threads == 4_ul);
+    };
+  };
+
+  "apply_batch"_test = []
+  {
+    should("return the results in the order of the arguments") = []
+    {
+      offset_task task {100};
+      std::vector<std::tuple<int, std::string>> batch;
+      for (int i = 0; i < 1000; i++) {
+        batch.emplace_back(i, std::string(static_cast<std::size_t>(i % 3), 'x'));
+      }
+      for (unsigned int threads : {1U, 3U, 8U}) {
+        auto results = cppless::apply_batch<int>(task, batch, threads);
+        expect(results.size() == 1000_ul);
+        bool ordered = true;
+        for (int i = 0; i < 1000; i++) {
+          ordered = ordered && results[i] == 100 + i + i % 3;
+        }
+        expect(ordered);
+      }
+    };
+
+    should("rethrow exceptions of the tasks") = []
+    {
+      offset_task task {0};
+      std::vector<std::tuple<int, std::string>> batch {
+          {1, ""}, {-1, ""}, {2, ""}, {3, ""}};
+      bool thrown = false;
+      try {
+        cppless::apply_batch<int>(task, batch, 2);
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      expect(thrown);
+    };
+  };
+}
@@ -0,0 +1 @@
+void batch_tests();
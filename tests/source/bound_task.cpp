@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "./bound_task.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/memory.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/sendable.hpp>
+#include <cppless/utils/cereal.hpp>
+#include <cppless/utils/fast_archive.hpp>
+
+namespace
+{
+// A class whose version cereal records the first time an archive sees it
+struct versioned
+{
+  std::uint32_t value = 0;
+
+  template<class Archive>
+  void serialize(Archive& ar, const std::uint32_t /*version*/)
+  {
+    ar(value);
+  }
+};
+}  // namespace
+
+CEREAL_CLASS_VERSION(versioned, 1);
+
+namespace
+{
+template<class RequestArchive>
+struct archive_dispatcher
+{
+  using request_input_archive = typename RequestArchive::input_archive;
+  using request_output_archive = typename RequestArchive::output_archive;
+};
+
+// Stands in for a lambda task, serializing `Captures` as its context
+template<class Dispatcher, class Captures>
+class captures_task : public cppless::task_base<Dispatcher>
+{
+  using output_archive = typename Dispatcher::request_output_archive;
+
+public:
+  explicit captures_task(Captures captures)
+      : m_captures(std::move(captures))
+  {
+  }
+
+  auto serialize(output_archive& ar) -> void override
+  {
+    ar(m_captures);
+  }
+
+  auto identifier() -> std::string override
+  {
+    return "captures_task";
+  }
+
+  auto target_type() const -> const std::type_info& override
+  {
+    return typeid(Captures);
+  }
+
+  auto target() -> void* override
+  {
+    return &m_captures;
+  }
+
+private:
+  Captures m_captures;
+};
+
+/**
+ * Serializes the payload of an invocation with `args` once with a bound and
+ * once with an unbound task of `captures`. Returns both payloads and whether
+ * the bound task copied its serialized captures.
+ */
+template<class RequestArchive, class Captures, class... Args>
+auto payloads(const Captures& captures, std::tuple<Args...> args)
+    -> std::tuple<std::string, std::string, bool>
+{
+  using dispatcher = archive_dispatcher<RequestArchive>;
+  using task_type = cppless::task<dispatcher, int(Args...)>;
+  auto make_task = [&]
+  {
+    return task_type {
+        std::make_unique<captures_task<dispatcher, Captures>>(captures)};
+  };
+
+  auto bound = cppless::bind_task(make_task());
+  auto unbound = make_task();
+  invocation_payload bound_payload {bound, args};
+  invocation_payload unbound_payload {unbound, args};
+  return {RequestArchive::serialize(bound_payload),
+          RequestArchive::serialize(unbound_payload),
+          bound.replays_captures()};
+}
+
+template<class RequestArchive>
+auto archive_tests(const char* name) -> void
+{
+  using namespace boost::ut;
+
+  should(std::string {"serialize bound tasks like unbound ones, "} + name) = []
+  {
+    std::tuple<std::vector<int>, std::string> captures {
+        std::vector<int>(100, 7), "captured"};
+    auto [bound, unbound, replayed] = payloads<RequestArchive>(
+        captures, std::tuple<int, std::string> {3, "argument"});
+    expect(replayed);
+    expect(bound == unbound);
+  };
+
+  should(std::string {"serialize stateful captures on every dispatch, "}
+         + name) = []
+  {
+    // The arguments share the version and the pointee of the captures,
+    // which are encoded once per payload
+    auto pointee = std::make_shared<int>(5);
+    std::tuple<versioned, std::shared_ptr<int>> captures {{1}, pointee};
+    auto [bound, unbound, replayed] = payloads<RequestArchive>(
+        captures,
+        std::tuple<versioned, std::shared_ptr<int>> {{2}, pointee});
+    expect(!replayed);
+    expect(bound == unbound);
+  };
+}
+}  // namespace
+
+void bound_task_tests()
+{
+  using namespace boost::ut;
+
+  "bound_task"_test = []
+  {
+    archive_tests<cppless::binary_archive>("binary_archive");
+    archive_tests<cppless::json_binary_archive>("json_binary_archive");
+    archive_tests<cppless::fast_binary_archive>("fast_binary_archive");
+  };
+}
@@ -0,0 +1 @@
+void bound_task_tests();
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "./checkpoint.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/graph/checkpoint.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void checkpoint_tests()
+{
+  using namespace boost::ut;
+  using cppless::executor::checkpoint_log;
+
+  "checkpoint"_test = []
+  {
+    auto path = std::filesystem::temp_directory_path() / "cppless-checkpoint";
+    std::filesystem::remove(path);
+
+    should("restore the results logged before the log was reopened") = [&]
+    {
+      {
+        checkpoint_log log {path};
+        log.begin(4);
+        log.append(0, "zero");
+        log.append(2, "two");
+      }
+      checkpoint_log log {path};
+      expect(log.size() == 2_ul);
+      expect(log.result(0) == "zero");
+      expect(log.result(2) == "two");
+      expect(!log.result(1).has_value());
+      std::filesystem::remove(path);
+    };
+
+    should("drop a record torn by a crash") = [&]
+    {
+      {
+        checkpoint_log log {path};
+        log.begin(4);
+        log.append(0, "zero");
+        log.append(1, "one");
+      }
+      std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+      {
+        checkpoint_log log {path};
+        expect(log.size() == 1_ul);
+        // Appended after the last complete record
+        log.append(3, "three");
+      }
+      checkpoint_log log {path};
+      expect(log.size() == 2_ul);
+      expect(log.result(3) == "three");
+      std::filesystem::remove(path);
+    };
+
+    should("reject a log written for a different graph") = [&]
+    {
+      {
+        checkpoint_log log {path};
+        log.begin(4);
+      }
+      checkpoint_log log {path};
+      expect(throws<std::runtime_error>([&] { log.begin(5); }));
+      std::filesystem::remove(path);
+    };
+
+    should("keep the results flushed before the host was killed") = [&]
+    {
+      auto pid = ::fork();
+      if (pid == 0) {
+        checkpoint_log log {path, std::chrono::milliseconds(0)};
+        log.begin(4);
+        log.append(0, "zero");
+        log.append(1, "one");
+        ::raise(SIGKILL);
+      }
+      int status = 0;
+      ::waitpid(pid, &status, 0);
+      expect(WIFSIGNALED(status));
+
+      checkpoint_log log {path};
+      expect(log.size() == 2_ul);
+      expect(log.result(1) == "one");
+      std::filesystem::remove(path);
+    };
+
+    should("write a buffered record without a later append") = [&]
+    {
+      auto pid = ::fork();
+      if (pid == 0) {
+        checkpoint_log log {path, std::chrono::milliseconds(10)};
+        log.begin(4);
+        auto written = std::filesystem::file_size(path);
+        log.append(0, "zero");
+        // Killed once the record is on disk, or after the deadline if it is
+        // never written
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::filesystem::file_size(path) == written
+               && std::chrono::steady_clock::now() < deadline)
+        {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ::raise(SIGKILL);
+      }
+      ::waitpid(pid, nullptr, 0);
+
+      checkpoint_log log {path};
+      expect(log.result(0) == "zero");
+      std::filesystem::remove(path);
+    };
+  };
+}
@@ -0,0 +1 @@
+void checkpoint_tests();
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./compression.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/compressed.hpp>
+#include <cppless/utils/compression.hpp>
+
+namespace
+{
+auto random_bytes(std::size_t size) -> std::string
+{
+  std::mt19937 generator {42};
+  std::uniform_int_distribution<int> distribution {0, 255};
+  std::string bytes(size, '\0');
+  for (auto& c : bytes) {
+    c = static_cast<char>(distribution(generator));
+  }
+  return bytes;
+}
+
+auto repetitive_bytes(std::size_t size) -> std::string
+{
+  std::string bytes;
+  bytes.reserve(size);
+  while (bytes.size() < size) {
+    bytes += "cppless compresses repetitive payloads ";
+  }
+  bytes.resize(size);
+  return bytes;
+}
+}  // namespace
+
+void compression_tests()
+{
+  using namespace boost::ut;
+  namespace compression = cppless::compression;
+
+  "compression"_test = []()
+  {
+    should("be invertible with every codec") = []
+    {
+      auto data = repetitive_bytes(100000);
+      for (auto c : {compression::codec::none,
+                     compression::codec::lz4,
+                     compression::codec::zstd})
+      {
+        auto compressed = compression::compress(data, c);
+        expect(compression::codec_of(compressed) == c);
+        expect(compression::decompress(compressed) == data);
+      }
+    };
+
+    should("leave small payloads uncompressed") = []
+    {
+      auto data = repetitive_bytes(100);
+      expect(compression::choose(data) == compression::codec::none);
+      expect(compression::compress(data).size() == data.size() + 1);
+    };
+
+    should("leave incompressible payloads uncompressed") = []
+    {
+      auto data = random_bytes(100000);
+      expect(compression::entropy(data, 16 * 1024) > 7.5);
+      expect(compression::choose(data) == compression::codec::none);
+      // Forcing a codec falls back to none as well
+      auto compressed = compression::compress(data, compression::codec::lz4);
+      expect(compression::codec_of(compressed) == compression::codec::none);
+      expect(compression::decompress(compressed) == data);
+    };
+
+    should("choose the codec by size") = []
+    {
+      expect(compression::choose(repetitive_bytes(8 * 1024))
+             == compression::codec::lz4);
+      expect(compression::choose(repetitive_bytes(1024 * 1024))
+             == compression::codec::zstd);
+
+      auto data = std::string(1024 * 1024, '\0');
+      auto compressed = compression::compress(data);
+      expect(compressed.size() < data.size() / 100);
+      expect(compression::decompress(compressed) == data);
+    };
+
+    should("reject corrupt payloads") = []
+    {
+      auto data = repetitive_bytes(100000);
+      expect(throws([] { compression::decompress(""); }));
+      expect(throws([] { compression::decompress(std::string(1, '\x07')); }));
+
+      for (auto c : {compression::codec::lz4, compression::codec::zstd}) {
+        auto compressed = compression::compress(data, c);
+        auto truncated = compressed.substr(0, compressed.size() / 2);
+        expect(throws([&] { compression::decompress(truncated); }));
+
+        // A size in the header larger than any payload
+        std::string oversized(1, static_cast<char>(c));
+        oversized += std::string(9, '\xff');
+        oversized += '\x01';
+        expect(throws([&] { compression::decompress(oversized); }));
+      }
+    };
+  };
+
+  "compressed_archive"_test = []()
+  {
+    should("be invertible") = []
+    {
+      std::vector<unsigned int> something(100000, 7);
+      auto encoded = cppless::compressed_archive<>::serialize(something);
+      expect(encoded.size() < something.size());
+
+      std::vector<unsigned int> decoded;
+      cppless::compressed_archive<>::deserialize(encoded, decoded);
+      expect(something == decoded);
+
+      cppless::buffer_chain chain;
+      chain.append(encoded.substr(0, 3));
+      chain.append(encoded.substr(3));
+      std::vector<unsigned int> decoded_chain;
+      cppless::compressed_archive<>::deserialize(chain, decoded_chain);
+      expect(something == decoded_chain);
+    };
+
+    should("wrap the cereal binary archive") = []
+    {
+      using archive = cppless::compressed_archive<cppless::binary_archive>;
+      std::vector<unsigned int> something(100000, 7);
+      std::vector<unsigned int> decoded;
+      archive::deserialize(archive::serialize(something), decoded);
+      expect(something == decoded);
+    };
+
+    should("encode as a JSON string") = []
+    {
+      std::vector<unsigned int> something(100000, 7);
+      auto encoded = cppless::json_compressed_archive<>::serialize(something);
+      expect(encoded.starts_with("\""));
+      expect(encoded.ends_with("\""));
+
+      std::vector<unsigned int> decoded;
+      cppless::json_compressed_archive<>::deserialize(encoded, decoded);
+      expect(something == decoded);
+    };
+  };
+}
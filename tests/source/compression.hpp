@@ -0,0 +1 @@
+void compression_tests();
\ No newline at end of file
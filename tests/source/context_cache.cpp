@@ -0,0 +1,106 @@
+#include <array>
+#include <string>
+
+#include "./context_cache.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/sendable.hpp>
+#include <cppless/utils/fast_archive.hpp>
+#include <cppless/utils/uninitialized.hpp>
+
+namespace
+{
+// Stands in for the captures of a lambda, counting how often they are
+// deserialized
+struct scene
+{
+  std::array<int, 4> values;
+
+  static inline int deserializations = 0;
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(values);
+    if constexpr (Archive::is_loading::value) {
+      deserializations++;
+    }
+  }
+
+  auto operator()(int i) const -> int
+  {
+    return values.at(static_cast<std::size_t>(i));
+  }
+};
+
+// The context of an invocation as the host encodes it
+auto encode(const scene& s) -> std::string
+{
+  cppless::fast_binary_output_archive oar;
+  oar(cppless::fast_binary_archive::serialize(s));
+  return oar.take();
+}
+
+template<class Receivable>
+struct received
+{
+  cppless::uninitialized_data<Receivable> u;
+
+  explicit received(const std::string& payload)
+  {
+    cppless::fast_binary_input_archive iar(payload);
+    iar(u.m_self);
+  }
+};
+}  // namespace
+
+void context_cache_tests()
+{
+  using namespace boost::ut;
+
+  "context_cache"_test = []()
+  {
+    should("reuse contexts with equal captures") = []
+    {
+      using receivable = cppless::cached_receivable<scene, 4>;
+      scene::deserializations = 0;
+      auto payload = encode(scene {{1, 2, 3, 4}});
+
+      received<receivable> cold {payload};
+      expect(!cold.u.m_self.cache_hit());
+      expect(cold.u.m_self(2) == 3_i);
+
+      received<receivable> warm {payload};
+      expect(warm.u.m_self.cache_hit());
+      expect(warm.u.m_self(3) == 4_i);
+      expect(scene::deserializations == 1_i);
+
+      received<receivable> other {encode(scene {{5, 6, 7, 8}})};
+      expect(!other.u.m_self.cache_hit());
+      expect(other.u.m_self(0) == 5_i);
+      expect(scene::deserializations == 2_i);
+    };
+
+    should("evict the least recently used contexts") = []
+    {
+      // A distinct instantiation, thus a cache of its own
+      struct tag_scene : scene
+      {
+      };
+      using receivable = cppless::cached_receivable<tag_scene, 1>;
+      scene::deserializations = 0;
+      auto a = encode(scene {{1, 1, 1, 1}});
+      auto b = encode(scene {{2, 2, 2, 2}});
+
+      received<receivable> {a};
+      received<receivable> {b};
+      received<receivable> again {a};
+      expect(!again.u.m_self.cache_hit());
+      expect(again.u.m_self(0) == 1_i);
+      expect(scene::deserializations == 3_i);
+    };
+  };
+}
@@ -0,0 +1 @@
+void context_cache_tests();
\ No newline at end of file
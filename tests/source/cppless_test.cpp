@@ -1,10 +1,40 @@
+#include "./batch.hpp"
+#include "./bound_task.hpp"
+#include "./checkpoint.hpp"
+#include "./compression.hpp"
+#include "./context_cache.hpp"
+#include "./fast_archive.hpp"
+#include "./fusion.hpp"
 #include "./json_serialization.hpp"
+#include "./remote.hpp"
+#include "./result_cache.hpp"
+#include "./retry.hpp"
+#include "./scheduling.hpp"
+#include "./shared.hpp"
+#include "./speculation.hpp"
 #include "./tail_apply.hpp"
+#include "./task_future.hpp"
+#include "./thread_pool.hpp"
 
 auto main() -> int
 {
   json_serialization_tests();
   tail_apply_tests();
+  retry_tests();
+  batch_tests();
+  thread_pool_tests();
+  task_future_tests();
+  remote_tests();
+  fusion_tests();
+  scheduling_tests();
+  checkpoint_tests();
+  speculation_tests();
+  result_cache_tests();
+  fast_archive_tests();
+  compression_tests();
+  shared_tests();
+  context_cache_tests();
+  bound_task_tests();
 
   return 0;
 }
\ No newline at end of file
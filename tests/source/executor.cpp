@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "./executor.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cppless/dispatcher/local.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+namespace
+{
+using dispatcher = cppless::local_dispatcher<cereal::BinaryInputArchive,
+                                             cereal::BinaryOutputArchive>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+template<class T>
+using sender = cppless::graph::sender<executor, T>;
+
+// Milliseconds since the epoch, comparable between the processes running the
+// nodes
+auto now_ms() -> long
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+auto parallel(std::size_t max_in_flight = 0)
+    -> cppless::executor::host_controller_options
+{
+  cppless::executor::host_controller_options options;
+  options.threads = 4;
+  options.max_in_flight = max_in_flight;
+  return options;
+}
+}  // namespace
+
+void executor_tests(const std::string& self)
+{
+  using namespace boost::ut;
+  using cppless::execution::expand, cppless::execution::schedule,
+      cppless::execution::then;
+
+  auto local = std::make_shared<dispatcher>(
+      self, cppless::local_dispatcher_options {.pooled = true});
+
+  "parallel executor"_test = [&]
+  {
+    should("join the branches of diamonds") = [&]
+    {
+      cppless::graph::builder<executor> builder {
+          std::nullopt, local, parallel()};
+      const int diamonds = 8;
+      auto start = schedule(builder);
+      std::vector<std::shared_ptr<sender<int>>> joins;
+      for (int i = 0; i < diamonds; i++) {
+        auto top = then(start, [i]() { return i; });
+        auto left = then(top, [](int x) { return x + 1; });
+        auto right = then(top, [](int x) { return 10 * x; });
+        joins.push_back(then(left, right, [](int l, int r) { return l + r; }));
+      }
+      builder.await_all();
+
+      for (int i = 0; i < diamonds; i++) {
+        expect(joins[static_cast<std::size_t>(i)]->future().value()
+               == 11 * i + 1);
+      }
+      // The source node and four nodes per diamond
+      expect(builder.core()->executor()->finished_nodes()
+             == static_cast<std::size_t>(1 + 4 * diamonds));
+    };
+
+    should("keep at most max_in_flight invocations running") = [&]
+    {
+      cppless::graph::builder<executor> builder {
+          std::nullopt, local, parallel(1)};
+      auto start = schedule(builder);
+      std::vector<std::shared_ptr<sender<std::tuple<long, long>>>> spans;
+      for (int i = 0; i < 4; i++) {
+        spans.push_back(then(start,
+                             []()
+                             {
+                               auto begin = now_ms();
+                               std::this_thread::sleep_for(
+                                   std::chrono::milliseconds(50));
+                               return std::tuple {begin, now_ms()};
+                             }));
+      }
+      builder.await_all();
+
+      std::vector<std::tuple<long, long>> intervals;
+      for (auto& span : spans) {
+        intervals.push_back(span->future().value());
+      }
+      std::sort(intervals.begin(), intervals.end());
+      for (std::size_t i = 1; i < intervals.size(); i++) {
+        expect(std::get<0>(intervals[i]) >= std::get<1>(intervals[i - 1]));
+      }
+    };
+
+    should("fail with the error of a node, without running its successors") =
+        [&]
+    {
+      cppless::graph::builder<executor> builder {
+          std::nullopt, local, parallel()};
+      auto start = schedule(builder);
+      auto failing =
+          then(start, []() -> int { throw std::runtime_error("failed"); });
+      then(failing, [](int x) { return x + 1; });
+      then(start, []() { return 2; });
+
+      expect(throws([&] { builder.await_all(); }));
+      // At most the source node and the independent node
+      expect(builder.core()->executor()->finished_nodes() <= 2_ul);
+    };
+  };
+
+  "expansion"_test = [&]
+  {
+    for (auto [mode, options] :
+         {std::pair {"serial", cppless::executor::host_controller_options {}},
+          std::pair {"parallel", parallel()}})
+    {
+      should(std::string {"run the nodes added while running, "} + mode) =
+          [&, options = options]
+      {
+        cppless::graph::builder<executor> builder {
+            std::nullopt, local, options};
+        auto start = schedule(builder);
+        auto count = then(start, []() { return 3; });
+        std::vector<std::shared_ptr<sender<int>>> leaves;
+        // Every child is expanded in turn, adding a leaf depending on its
+        // result
+        auto expanded = expand(
+            count,
+            [&](auto node, const int& children)
+            {
+              for (int i = 1; i <= children; i++) {
+                auto child = then(node, [i]() { return i * i; });
+                expand(child,
+                       [&](auto child_node, const int& value)
+                       {
+                         auto leaf = then(child_node,
+                                          [value]() { return value + 1; });
+                         leaves.push_back(leaf);
+                       });
+              }
+            });
+        auto after = then(expanded, []() { return 1; });
+        builder.await_all();
+
+        expect(after->future().value() == 1_i);
+        expect(leaves.size() == 3_ul);
+        std::vector<int> values;
+        for (auto& leaf : leaves) {
+          values.push_back(leaf->future().value());
+        }
+        std::sort(values.begin(), values.end());
+        expect(values == std::vector<int> {2, 5, 10});
+        // The source node, the counting node, its expansion, and a child, its
+        // expansion and a leaf per child
+        expect(builder.core()->node_count() == 12_ul);
+      };
+    }
+  };
+}
@@ -0,0 +1,3 @@
+#include <string>
+
+void executor_tests(const std::string& self);
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "./executor_checkpoint.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cppless/dispatcher/local.hpp>
+#include <cppless/graph/checkpoint.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+using dispatcher = cppless::local_dispatcher<cereal::BinaryInputArchive,
+                                             cereal::BinaryOutputArchive>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+using cppless::executor::checkpoint_log;
+
+const int chain_length = 10;
+const int blocking_step = 5;
+
+/**
+ * Runs a chain of nodes counting up, logging their results to `log_path`.
+ * The node `blocking_step` creates `marker` the first time it runs and then
+ * waits until its host is gone. Returns the result of the last node and the
+ * number of nodes restored from the log.
+ */
+auto run_chain(const std::string& self,
+               const std::filesystem::path& log_path,
+               const std::string& marker) -> std::tuple<int, std::size_t>
+{
+  using cppless::execution::schedule, cppless::execution::then;
+  auto local = std::make_shared<dispatcher>(self);
+  cppless::executor::host_controller_options options;
+  options.checkpoint =
+      std::make_shared<checkpoint_log>(log_path, std::chrono::milliseconds(0));
+  cppless::graph::builder<executor> builder {std::nullopt, local, options};
+
+  std::shared_ptr<cppless::graph::sender<executor, int>> step =
+      then(schedule(builder), []() { return 0; });
+  for (int i = 1; i < chain_length; i++) {
+    step = then(step,
+                [marker, block = i == blocking_step](int x)
+                {
+                  int fd = block ? ::open(marker.c_str(),  // NOLINT
+                                          O_CREAT | O_EXCL | O_WRONLY,
+                                          0644)
+                                 : -1;
+                  if (fd >= 0) {
+                    ::close(fd);
+                    auto host = ::getppid();
+                    while (::getppid() == host) {
+                      std::this_thread::sleep_for(
+                          std::chrono::milliseconds(10));
+                    }
+                  }
+                  return x + 1;
+                });
+  }
+  builder.await_all();
+  return {step->future().value(),
+          builder.core()->executor()->restored_nodes()};
+}
+}  // namespace
+
+void executor_checkpoint_tests(const std::string& self)
+{
+  using namespace boost::ut;
+  using cppless::execution::schedule, cppless::execution::then;
+
+  auto local = std::make_shared<dispatcher>(
+      self, cppless::local_dispatcher_options {.pooled = true});
+  auto path =
+      std::filesystem::temp_directory_path() / "cppless-executor-checkpoint";
+
+  "executor checkpoint"_test = [&]
+  {
+    for (auto threads : {1U, 4U}) {
+      should("restore logged results without invoking the nodes, threads = "
+             + std::to_string(threads)) = [&, threads]
+      {
+        std::filesystem::remove(path);
+        cppless::executor::host_controller_options options;
+        options.threads = threads;
+        {
+          options.checkpoint = std::make_shared<checkpoint_log>(path);
+          cppless::graph::builder<executor> builder {
+              std::nullopt, local, options};
+          auto first = then(schedule(builder), []() { return 1; });
+          auto second = then(first, [](int x) { return x + 1; });
+          builder.await_all();
+          expect(second->future().value() == 2_i);
+          expect(builder.core()->executor()->restored_nodes() == 0_ul);
+          options.checkpoint.reset();
+        }
+        {
+          // Both task nodes were saved, the source node has no result
+          checkpoint_log log {path};
+          expect(log.size() == 2_ul);
+        }
+        options.checkpoint = std::make_shared<checkpoint_log>(path);
+        cppless::graph::builder<executor> builder {
+            std::nullopt, local, options};
+        auto first = then(schedule(builder),
+                          []() -> int
+                          { throw std::runtime_error("invoked"); });
+        auto second = then(first,
+                           [](int /*x*/) -> int
+                           { throw std::runtime_error("invoked"); });
+        builder.await_all();
+        expect(first->future().value() == 1_i);
+        expect(second->future().value() == 2_i);
+        expect(builder.core()->executor()->restored_nodes() == 2_ul);
+        std::filesystem::remove(path);
+      };
+    }
+
+    should("resume a graph after its host was killed") = [&]
+    {
+      std::filesystem::remove(path);
+      auto marker = path.string() + ".marker";
+      std::filesystem::remove(marker);
+
+      auto pid = ::fork();
+      if (pid == 0) {
+        run_chain(self, path, marker);
+        std::_Exit(0);
+      }
+      // The blocking node starts once the results of all nodes before it are
+      // on disk, as the log is written through
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(30);
+      while (!std::filesystem::exists(marker)
+             && std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      ::kill(pid, SIGKILL);
+      ::waitpid(pid, nullptr, 0);
+      expect(std::filesystem::exists(marker));
+
+      auto [result, restored] = run_chain(self, path, marker);
+      expect(result == chain_length - 1);
+      expect(restored == static_cast<std::size_t>(blocking_step));
+      std::filesystem::remove(path);
+      std::filesystem::remove(marker);
+    };
+  };
+}
@@ -0,0 +1,231 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "./executor_speculation.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cppless/dispatcher/local.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+using dispatcher = cppless::local_dispatcher<cereal::BinaryInputArchive,
+                                             cereal::BinaryOutputArchive>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+using builder_type = cppless::graph::builder<executor>;
+
+struct speculative_config
+{
+  constexpr static bool speculative = true;
+};
+
+// The steps before the slow one provide the samples of the latency
+// distribution, thus only the slow step may be backed up
+const int samples = 4;
+
+/**
+ * How the two invocations of the slow step behave: the first invocation to
+ * start is the primary one, the other its backup.
+ */
+struct attempts
+{
+  int primary_ms;
+  bool primary_fails;
+  int backup_ms;
+  bool backup_fails;
+};
+
+auto options(unsigned int threads)
+    -> cppless::executor::host_controller_options
+{
+  cppless::executor::host_controller_options options;
+  options.threads = threads;
+  options.speculation.percentile = 50;
+  options.speculation.factor = 2;
+  options.speculation.min_samples = samples;
+  return options;
+}
+
+/**
+ * Builds a chain of speculative steps counting up, whose last step is slow
+ * as described by `plan`. The primary invocation of the slow step creates
+ * `marker` when it starts, and `marker` with the suffix ".done" once it has
+ * slept.
+ *
+ * @return The last step, whose result is `samples + 1`
+ */
+auto build_chain(builder_type& builder,
+                 const attempts& plan,
+                 const std::string& marker)
+    -> std::shared_ptr<cppless::graph::sender<executor, int>>
+{
+  using cppless::execution::schedule, cppless::execution::then;
+  auto step = [marker,
+               primary_ms = plan.primary_ms,
+               primary_fails = plan.primary_fails,
+               backup_ms = plan.backup_ms,
+               backup_fails = plan.backup_fails](int x) -> int
+  {
+    if (x < samples) {
+      return x + 1;
+    }
+    int fd = ::open(  // NOLINT
+        marker.c_str(),
+        O_CREAT | O_EXCL | O_WRONLY,
+        0644);
+    bool primary = fd >= 0;
+    if (primary) {
+      ::close(fd);
+    }
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(primary ? primary_ms : backup_ms));
+    if (primary) {
+      std::ofstream done {marker + ".done"};
+    }
+    if (primary ? primary_fails : backup_fails) {
+      throw std::runtime_error("The invocation failed");
+    }
+    return x + 1;
+  };
+
+  std::shared_ptr<cppless::graph::sender<executor, int>> last =
+      then(schedule(builder), []() { return 0; });
+  for (int i = 0; i <= samples; i++) {
+    last = then<speculative_config>(last, step);
+  }
+  return last;
+}
+}  // namespace
+
+void executor_speculation_tests(const std::string& self)
+{
+  using namespace boost::ut;
+
+  // The backup needs a worker of its own while the primary invocation sleeps
+  auto local = std::make_shared<dispatcher>(
+      self,
+      cppless::local_dispatcher_options {.pooled = true,
+                                         .pool = {.max_workers = 4}});
+  auto marker =
+      (std::filesystem::temp_directory_path() / "cppless-speculation")
+          .string();
+  auto done = marker + ".done";
+  auto reset = [&]
+  {
+    std::filesystem::remove(marker);
+    std::filesystem::remove(done);
+  };
+
+  "executor speculation"_test = [&]
+  {
+    for (auto [mode, threads] :
+         {std::pair {"serial", 1U}, std::pair {"parallel", 4U}})
+    {
+      should(std::string {"deliver the result of a backup winning, "} + mode) =
+          [&, threads = threads]
+      {
+        reset();
+        builder_type builder {std::nullopt, local, options(threads)};
+        auto last = build_chain(builder, {1000, false, 0, false}, marker);
+        builder.await_all();
+
+        expect(last->future().value() == samples + 1);
+        auto statistics = builder.core()->executor()->speculation();
+        expect(statistics.backups == 1_ul);
+        expect(statistics.backups_won == 1_ul);
+        // The primary invocation counts until the graph was done
+        expect(statistics.makespan_saved >= 0._d);
+        expect(!std::filesystem::exists(done));
+      };
+
+      should(std::string {"discard a failure of the primary invocation, "}
+             + mode) = [&, threads = threads]
+      {
+        reset();
+        builder_type builder {std::nullopt, local, options(threads)};
+        auto last = build_chain(builder, {300, true, 600, false}, marker);
+        builder.await_all();
+
+        expect(last->future().value() == samples + 1);
+        auto statistics = builder.core()->executor()->speculation();
+        expect(statistics.backups == 1_ul);
+        expect(statistics.backups_won == 1_ul);
+      };
+
+      should(std::string {"discard a failure of the backup, "} + mode) =
+          [&, threads = threads]
+      {
+        reset();
+        builder_type builder {std::nullopt, local, options(threads)};
+        auto last = build_chain(builder, {300, false, 0, true}, marker);
+        builder.await_all();
+
+        expect(last->future().value() == samples + 1);
+        auto statistics = builder.core()->executor()->speculation();
+        expect(statistics.backups == 1_ul);
+        expect(statistics.backups_won == 0_ul);
+      };
+
+      should(std::string {"fail once both invocations failed, "} + mode) =
+          [&, threads = threads]
+      {
+        reset();
+        builder_type builder {std::nullopt, local, options(threads)};
+        build_chain(builder, {200, true, 400, true}, marker);
+        expect(throws([&] { builder.await_all(); }));
+        expect(builder.core()->executor()->speculation().backups == 1_ul);
+      };
+
+      should(std::string {"destroy a graph before its discarded invocation "
+                          "returned, "}
+             + mode) = [&, threads = threads]
+      {
+        reset();
+        {
+          builder_type builder {std::nullopt, local, options(threads)};
+          auto last = build_chain(builder, {1000, false, 0, false}, marker);
+          builder.await_all();
+          expect(last->future().value() == samples + 1);
+          expect(!std::filesystem::exists(done));
+        }
+        // The executor waited for the discarded invocation
+        expect(std::filesystem::exists(done));
+      };
+    }
+
+    should("count the time saved once the primary invocation finished") = [&]
+    {
+      reset();
+      builder_type builder {std::nullopt, local, options(4)};
+      build_chain(builder, {1000, false, 0, false}, marker);
+      builder.await_all();
+
+      auto exec = builder.core()->executor();
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (exec->speculation().makespan_saved < 500
+             && std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      // The primary invocation took a second, the backup a few milliseconds
+      expect(exec->speculation().makespan_saved >= 500._d);
+      expect(exec->speculation().makespan_saved < 1000._d);
+    };
+    reset();
+  };
+}
@@ -0,0 +1,228 @@
+#include <array>
+#include <cstdint>
+#include <span>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "./fast_archive.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/common.hpp>
+
+namespace
+{
+struct point
+{
+  float x;
+  float y;
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(x, y);
+  }
+
+  auto operator==(const point& other) const -> bool = default;
+};
+
+// Copied in bulk, as it has neither padding nor serialization functions
+struct pixel
+{
+  std::uint8_t r;
+  std::uint8_t g;
+  std::uint8_t b;
+  std::uint8_t a;
+
+  auto operator==(const pixel& other) const -> bool = default;
+};
+
+// Trivially copyable, but the padding after `tag` is indeterminate
+struct padded
+{
+  std::uint8_t tag;
+  std::uint32_t value;
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(tag, value);
+  }
+
+  auto operator==(const padded& other) const -> bool = default;
+};
+
+// Trivially copyable without padding, but only `x` is serialized
+struct normalized
+{
+  float x;
+  float cached_norm;
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(x);
+  }
+};
+
+struct labelled
+{
+  std::string label;
+  std::vector<point> points;
+
+  template<class Archive>
+  void serialize(Archive& ar)
+  {
+    ar(label, points);
+  }
+
+  auto operator==(const labelled& other) const -> bool = default;
+};
+}  // namespace
+
+void fast_archive_tests()
+{
+  using namespace boost::ut;
+  using cppless::fast_binary_archive;
+
+  "fast_binary_archive"_test = []()
+  {
+    should("be invertible") = []
+    {
+      std::tuple<labelled, std::array<point, 2>, std::vector<unsigned int>>
+          something {{"shape", {{1, 2}, {3, 4}}}, {{{5, 6}, {7, 8}}}, {}};
+      for (unsigned int i = 0; i < 10000; i++) {
+        std::get<2>(something).push_back(i);
+      }
+      auto encoded = fast_binary_archive::serialize(something);
+
+      decltype(something) decoded;
+      fast_binary_archive::deserialize(encoded, decoded);
+      expect(something == decoded);
+
+      cppless::buffer_chain chain;
+      chain.append(encoded.substr(0, 7));
+      chain.append(encoded.substr(7));
+      decltype(something) decoded_chain;
+      fast_binary_archive::deserialize(chain, decoded_chain);
+      expect(something == decoded_chain);
+    };
+
+    should("copy trivially copyable elements in bulk") = []
+    {
+      std::vector<pixel> pixels(1000, pixel {1, 2, 3, 4});
+      auto encoded = fast_binary_archive::serialize(pixels);
+      // A two byte varint for the size, then the elements as they are laid
+      // out in memory
+      expect(encoded.size() == 2 + sizeof(pixel) * pixels.size());
+
+      std::vector<pixel> decoded;
+      fast_binary_archive::deserialize(encoded, decoded);
+      expect(decoded == pixels);
+
+      std::array<pixel, 3> row {{{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}}};
+      auto encoded_row = fast_binary_archive::serialize(row);
+      expect(encoded_row.size() == sizeof(row));
+      decltype(row) decoded_row {};
+      fast_binary_archive::deserialize(encoded_row, decoded_row);
+      expect(decoded_row == row);
+    };
+
+    should("write padded elements with their serialize") = []
+    {
+      static_assert(!cppless::detail::bulk_copyable<padded>);
+      std::vector<padded> values(10, padded {1, 2});
+      auto encoded = fast_binary_archive::serialize(values);
+      // The varint for the size, then the members without the padding
+      expect(encoded.size()
+             == 1 + (sizeof(std::uint8_t) + sizeof(std::uint32_t)) * 10);
+
+      std::vector<padded> decoded;
+      fast_binary_archive::deserialize(encoded, decoded);
+      expect(decoded == values);
+    };
+
+    should("prefer the serialize of an element to copying it") = []
+    {
+      static_assert(!cppless::detail::bulk_copyable<normalized>);
+      std::vector<normalized> values(10, normalized {3, 5});
+      expect(fast_binary_archive::serialize(values).size()
+             == 1 + sizeof(float) * 10);
+
+      std::array<normalized, 2> pair {{{1, 2}, {3, 4}}};
+      auto encoded = fast_binary_archive::serialize(pair);
+      expect(encoded.size() == 2 * sizeof(float));
+      std::array<normalized, 2> decoded {};
+      fast_binary_archive::deserialize(encoded, decoded);
+      expect(decoded[1].x == 3._f);
+      expect(decoded[1].cached_norm == 0._f);
+    };
+
+    should("encode sizes as varints") = []
+    {
+      expect(fast_binary_archive::serialize(std::string(5, 'a')).size()
+             == 6_ul);
+      expect(fast_binary_archive::serialize(std::string(300, 'a')).size()
+             == 302_ul);
+    };
+
+    should("read spans of the written size") = []
+    {
+      std::vector<int> values {1, 2, 3};
+      auto encoded = fast_binary_archive::serialize(std::span {values});
+
+      std::vector<int> decoded(3);
+      std::span<int> target {decoded};
+      fast_binary_archive::deserialize(encoded, target);
+      expect(values == decoded);
+
+      std::vector<int> too_small(2);
+      std::span<int> small_target {too_small};
+      expect(throws(
+          [&] { fast_binary_archive::deserialize(encoded, small_target); }));
+    };
+
+    should("reject truncated input") = []
+    {
+      auto encoded = fast_binary_archive::serialize(std::vector<point>(10));
+      encoded.resize(encoded.size() - 1);
+      std::vector<point> decoded;
+      expect(throws([&] { fast_binary_archive::deserialize(encoded, decoded); }));
+    };
+
+    should("work through streams") = []
+    {
+      std::stringstream stream;
+      {
+        cppless::fast_binary_output_archive oar(stream);
+        oar(labelled {"streamed", {{1, 1}}});
+      }
+      labelled decoded;
+      {
+        cppless::fast_binary_input_archive iar(stream);
+        iar(decoded);
+      }
+      expect(decoded == labelled {"streamed", {{1, 1}}});
+    };
+  };
+
+  "json_fast_binary_archive"_test = []()
+  {
+    should("be invertible") = []
+    {
+      labelled something {"shape", std::vector<point>(100, point {1, 2})};
+      auto encoded = cppless::json_fast_binary_archive::serialize(something);
+      expect(encoded.starts_with("\""));
+      expect(encoded.ends_with("\""));
+
+      labelled decoded;
+      cppless::json_fast_binary_archive::deserialize(encoded, decoded);
+      expect(something == decoded);
+    };
+  };
+}
@@ -0,0 +1 @@
+void fast_archive_tests();
\ No newline at end of file
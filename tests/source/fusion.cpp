@@ -0,0 +1,80 @@
+#include <tuple>
+#include <vector>
+
+#include "./fusion.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/graph/fusion.hpp>
+
+namespace
+{
+// Fused tasks never create the tasks of their stages
+struct no_factory
+{
+};
+}  // namespace
+
+void fusion_tests()
+{
+  using namespace boost::ut;
+  using cppless::graph::fused_input;
+  using cppless::graph::fused_lambda;
+  using cppless::graph::fused_stage;
+  using cppless::graph::fused_task;
+
+  "fusion"_test = []
+  {
+    should("run a chain in order") = []
+    {
+      auto seven = [] { return 7; };
+      auto add = [k = 3](int x) { return x + k; };
+      auto twice = [](int x) { return 2 * x; };
+      using stage = fused_stage<
+          no_factory,
+          decltype(twice),
+          fused_stage<no_factory,
+                      decltype(add),
+                      fused_stage<no_factory,
+                                  decltype(seven),
+                                  fused_input<void>>>>;
+
+      fused_task<stage> task {
+          {fused_lambda {twice},
+           {fused_lambda {add}, {fused_lambda {seven}, {}}}}};
+      expect(task() == 20_i);
+    };
+
+    should("pass the inputs of a fan-in in the order of the senders") = []
+    {
+      std::vector<int> order;
+      auto left = [&order](int x)
+      {
+        order.push_back(0);
+        return x;
+      };
+      auto right = [&order](int x, int y)
+      {
+        order.push_back(1);
+        return x * y;
+      };
+      auto sub = [](int a, int b, int c) { return a - b - c; };
+      using stage =
+          fused_stage<no_factory,
+                      decltype(sub),
+                      fused_stage<no_factory, decltype(left), fused_input<int>>,
+                      fused_input<int>,
+                      fused_stage<no_factory,
+                                  decltype(right),
+                                  fused_input<int>,
+                                  fused_input<int>>>;
+
+      fused_task<stage> task {{fused_lambda {sub},
+                               {fused_lambda {left}, {}},
+                               {},
+                               {fused_lambda {right}, {}, {}}}};
+      // 10 - 3 - 4 * 2
+      expect(task(10, 3, 4, 2) == -1_i);
+      expect(order == std::vector<int> {0, 1});
+    };
+  };
+}
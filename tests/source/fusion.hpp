@@ -0,0 +1 @@
+void fusion_tests();
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "./graph_fusion.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cppless/dispatcher/local.hpp>
+#include <cppless/graph/execution.hpp>
+#include <cppless/graph/fusion.hpp>
+#include <cppless/graph/graph.hpp>
+#include <cppless/graph/host_controller_executor.hpp>
+
+namespace
+{
+using dispatcher = cppless::local_dispatcher<cereal::BinaryInputArchive,
+                                             cereal::BinaryOutputArchive>;
+using executor = cppless::executor::host_controller_executor<dispatcher>;
+
+// Opts the tasks of the nodes into fusion, like `aws::with_fusion`
+struct fusable_config
+{
+  constexpr static bool fusable = true;
+};
+
+template<class Builder>
+auto successors(Builder& builder, std::size_t id) -> std::vector<std::size_t>
+{
+  auto edges = builder.core()->adjacency();
+  auto ids = edges.successors(id);
+  return {ids.begin(), ids.end()};
+}
+}  // namespace
+
+void graph_fusion_tests(const std::string& self)
+{
+  using namespace boost::ut;
+  using cppless::execution::schedule, cppless::execution::then;
+
+  auto local = std::make_shared<dispatcher>(
+      self, cppless::local_dispatcher_options {.pooled = true});
+
+  "graph fusion"_test = [&]
+  {
+    should("leave nodes of tasks without with_fusion alone") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto last = then(then(start, []() { return 7; }),
+                       [](int x) { return 2 * x; });
+
+      expect(builder.fuse() == 0_ul);
+      builder.await_all();
+      expect(last->future().value() == 14_i);
+    };
+
+    should("fuse a chain and move the slot of its input") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto seven = then<fusable_config>(start, []() { return 7; });
+      auto add = then<fusable_config>(seven, [k = 3](int x) { return x + k; });
+      auto twice = then<fusable_config>(add, [](int x) { return 2 * x; });
+      auto seven_id = seven->id();
+      auto add_id = add->id();
+      seven.reset();
+      add.reset();
+
+      expect(builder.fuse() == 2_ul);
+      auto fused_id = builder.core()->node_count() - 1;
+      expect(builder.core()->is_fused(seven_id));
+      expect(builder.core()->is_fused(add_id));
+      expect(builder.core()->is_fused(twice->id()));
+      // The empty slot of the first stage now belongs to the fused node
+      expect(successors(builder, start->id())
+             == std::vector<std::size_t> {fused_id});
+
+      builder.await_all();
+      expect(twice->future().value() == 20_i);
+    };
+
+    should("fuse the direct predecessors only if an input is observed") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto seven = then<fusable_config>(start, []() { return 7; });
+      auto three = then<fusable_config>(start, []() { return 3; });
+      auto add = then<fusable_config>(
+          seven, three, [](int x, int y) { return x + y; });
+      auto twice = then<fusable_config>(add, [](int x) { return 2 * x; });
+      auto add_id = add->id();
+      add.reset();
+
+      expect(builder.fuse() == 1_ul);
+      auto fused_id = builder.core()->node_count() - 1;
+      expect(builder.core()->is_fused(add_id));
+      expect(!builder.core()->is_fused(seven->id()));
+      expect(!builder.core()->is_fused(three->id()));
+      // The typed slots of both arguments were moved to the fused node
+      expect(successors(builder, seven->id())
+             == std::vector<std::size_t> {fused_id});
+      expect(successors(builder, three->id())
+             == std::vector<std::size_t> {fused_id});
+
+      builder.await_all();
+      expect(seven->future().value() == 7_i);
+      expect(twice->future().value() == 20_i);
+    };
+
+    should("deliver results through futures shared with the fused node") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto first = then<fusable_config>(start, []() { return 5; });
+      auto second = then<fusable_config>(first, [](int x) { return x + 1; });
+      auto third = then<fusable_config>(second, [](int x) { return 3 * x; });
+      auto first_id = first->id();
+      auto second_id = second->id();
+      auto observed = second->future();
+      first.reset();
+      second.reset();
+
+      // The future of the second node is observed, thus only the first two
+      // nodes are fused, with the fused node sharing the future
+      expect(builder.fuse() == 1_ul);
+      expect(builder.core()->is_fused(first_id));
+      expect(builder.core()->is_fused(second_id));
+      expect(!builder.core()->is_fused(third->id()));
+
+      builder.await_all();
+      expect(observed.value() == 6_i);
+      expect(third->future().value() == 18_i);
+    };
+
+    should("not fuse nodes referenced outside of the graph") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto first = then<fusable_config>(start, []() { return 5; });
+      auto second = then<fusable_config>(first, [](int x) { return x + 1; });
+
+      expect(builder.fuse() == 0_ul);
+      builder.await_all();
+      expect(first->future().value() == 5_i);
+      expect(second->future().value() == 6_i);
+    };
+
+    should("not fuse nodes fanning out") = [&]
+    {
+      cppless::graph::builder<executor> builder {std::nullopt, local};
+      auto start = schedule(builder);
+      auto first = then<fusable_config>(start, []() { return 5; });
+      auto left = then<fusable_config>(first, [](int x) { return x + 1; });
+      auto right = then<fusable_config>(first, [](int x) { return x * 2; });
+      auto first_id = first->id();
+      first.reset();
+
+      expect(builder.fuse() == 0_ul);
+      expect(!builder.core()->is_fused(first_id));
+      builder.await_all();
+      expect(left->future().value() == 6_i);
+      expect(right->future().value() == 10_i);
+    };
+  };
+}
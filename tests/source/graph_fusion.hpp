@@ -0,0 +1,3 @@
+#include <string>
+
+void graph_fusion_tests(const std::string& self);
@@ -0,0 +1,20 @@
+#include <string>
+#include <vector>
+
+#include "./executor.hpp"
+#include "./executor_checkpoint.hpp"
+#include "./executor_speculation.hpp"
+#include "./graph_fusion.hpp"
+
+// The nodes of the graphs run as alternative entry points of this executable,
+// on the local dispatcher
+__attribute((weak)) auto main(int argc, char* argv[]) -> int
+{
+  std::vector<std::string> args {argv, argv + argc};
+  executor_tests(args[0]);
+  executor_checkpoint_tests(args[0]);
+  executor_speculation_tests(args[0]);
+  graph_fusion_tests(args[0]);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "./remote.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/remote.hpp>
+#include <cppless/utils/object_store.hpp>
+
+void remote_tests()
+{
+  using namespace boost::ut;
+
+  "remote"_test = []
+  {
+    auto directory =
+        std::filesystem::temp_directory_path() / "cppless-remote-test";
+    std::filesystem::remove_all(directory);
+    cppless::set_default_object_store(
+        std::make_shared<cppless::file_object_store>(directory));
+    auto stored_objects = [&directory]
+    {
+      return std::distance(std::filesystem::directory_iterator(directory),
+                           std::filesystem::directory_iterator());
+    };
+
+    std::vector<int> large(1000);
+    std::iota(large.begin(), large.end(), 0);
+
+    should("be passed inline by default") = [&]
+    {
+      cppless::remote<std::vector<int>> r {large};
+      auto data = cppless::binary_archive::serialize(r);
+      cppless::remote<std::vector<int>> received;
+      cppless::binary_archive::deserialize(data, received);
+      expect(!received.stored());
+      expect(received.get() == large);
+      expect(stored_objects() == 0_l);
+    };
+
+    should("be passed by reference above the threshold") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::remote<std::vector<int>> r {large};
+      std::tuple<cppless::remote<std::vector<int>>,
+                 cppless::remote<std::vector<int>>>
+          fan_out {r, r};
+      auto data = cppless::json_binary_archive::serialize(fan_out);
+      expect(data.size() < 1000_ul);
+      expect(r.stored());
+      expect(stored_objects() == 1_l);
+
+      std::tuple<cppless::remote<std::vector<int>>,
+                 cppless::remote<std::vector<int>>>
+          received;
+      cppless::json_binary_archive::deserialize(data, received);
+      expect(std::get<0>(received).stored());
+      expect(std::get<0>(received).get() == large);
+      expect(std::get<1>(received).get() == large);
+    };
+
+    should("keep small values inline") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::remote<std::vector<int>> r {std::vector<int> {1, 2, 3}};
+      auto data = cppless::binary_archive::serialize(r);
+      cppless::remote<std::vector<int>> received;
+      cppless::binary_archive::deserialize(data, received);
+      expect(!received.stored());
+      expect(received.get() == std::vector<int> {1, 2, 3});
+    };
+
+    should("fail for missing objects") = [&]
+    {
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::remote<std::vector<int>> r {large};
+      auto data = cppless::binary_archive::serialize(r);
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      cppless::remote<std::vector<int>> received;
+      cppless::binary_archive::deserialize(data, received);
+      expect(throws<std::runtime_error>([&] { received.get(); }));
+    };
+
+    std::filesystem::remove_all(directory);
+    cppless::set_default_object_store(nullptr);
+  };
+}
@@ -0,0 +1 @@
+void remote_tests();
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./result_cache.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/utils/result_cache.hpp>
+
+void result_cache_tests()
+{
+  using namespace boost::ut;
+  using cppless::result_cache;
+
+  "result_cache"_test = []
+  {
+    should("key results by task and payload") = []
+    {
+      std::vector<unsigned char> payload {1, 2, 3};
+      std::vector<unsigned char> other {1, 2, 4};
+      auto key = result_cache::key("task", payload);
+      expect(key == result_cache::key("task", payload));
+      expect(key != result_cache::key("task", other));
+      expect(key != result_cache::key("other", payload));
+    };
+
+    should("evict the least recently used results") = []
+    {
+      result_cache cache {{.capacity = 8}};
+      cache.put("a", "aaa");
+      cache.put("b", "bbb");
+      expect(cache.get("a") == std::string("aaa"));
+      cache.put("c", "ccc");
+      expect(!cache.get("b").has_value());
+      expect(cache.get("a") == std::string("aaa"));
+      expect(cache.get("c") == std::string("ccc"));
+      // Larger than the whole cache
+      cache.put("d", "ddddddddd");
+      expect(!cache.get("d").has_value());
+
+      auto statistics = cache.statistics();
+      expect(statistics.hits == 3_ul);
+      expect(statistics.misses == 2_ul);
+      expect(statistics.evictions == 1_ul);
+      expect(statistics.hit_rate() == 0.6_d);
+    };
+
+    should("find results kept by the store of an earlier cache") = []
+    {
+      auto directory =
+          std::filesystem::temp_directory_path() / "cppless-result-cache";
+      std::filesystem::remove_all(directory);
+      auto store = std::make_shared<cppless::file_object_store>(directory);
+      {
+        result_cache cache {{.store = store}};
+        cache.put("key", "result");
+      }
+      result_cache cache {{.store = store}};
+      expect(cache.get("key") == std::string("result"));
+      expect(!cache.get("missing").has_value());
+      expect(cache.statistics().hits == 1_ul);
+      std::filesystem::remove_all(directory);
+    };
+  };
+}
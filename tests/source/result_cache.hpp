@@ -0,0 +1 @@
+void result_cache_tests();
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "./retry.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/ut.hpp>
+#include <cppless/utils/retry.hpp>
+
+namespace
+{
+
+// Stands in for the Lambda invoke endpoint: runs up to `capacity`
+// invocations at once and throttles everything beyond that.
+class fake_endpoint
+{
+public:
+  fake_endpoint(boost::asio::io_context& io_context, std::size_t capacity)
+      : m_io_context(io_context)
+      , m_capacity(capacity)
+  {
+  }
+
+  auto invoke(std::function<void(bool)> done) -> void
+  {
+    bool admitted = m_running < m_capacity;
+    auto timer = std::make_shared<boost::asio::steady_timer>(m_io_context);
+    if (admitted) {
+      m_running++;
+      timer->expires_after(std::chrono::milliseconds(2));
+    } else {
+      timer->expires_after(std::chrono::microseconds(200));
+    }
+    timer->async_wait(
+        [this, timer, admitted, done = std::move(done)](
+            const boost::system::error_code& /*ec*/)
+        {
+          if (admitted) {
+            m_running--;
+          }
+          done(admitted);
+        });
+  }
+
+private:
+  boost::asio::io_context& m_io_context;
+  std::size_t m_capacity;
+  std::size_t m_running = 0;
+};
+
+struct run_result
+{
+  std::size_t succeeded = 0;
+  std::size_t failed = 0;
+  std::size_t attempts = 0;
+};
+
+auto run(std::size_t tasks,
+         std::size_t capacity,
+         cppless::admission_options admission,
+         cppless::retry_options retry) -> run_result
+{
+  boost::asio::io_context io_context;
+  fake_endpoint endpoint(io_context, capacity);
+  cppless::retry_scheduler scheduler(io_context, admission, retry);
+
+  run_result result;
+  scheduler.on_failure([&](int /*id*/, const std::string& /*message*/)
+                       { result.failed++; });
+  for (int id = 0; id < static_cast<int>(tasks); id++) {
+    scheduler.submit(id,
+                     [&, id]
+                     {
+                       endpoint.invoke(
+                           [&, id](bool ok)
+                           {
+                             if (ok) {
+                               result.succeeded++;
+                               scheduler.succeeded(id);
+                             } else {
+                               scheduler.throttled(id);
+                             }
+                           });
+                     });
+  }
+  io_context.run();
+  result.attempts = scheduler.attempts();
+  return result;
+}
+
+}  // namespace
+
+void retry_tests()
+{
+  using namespace boost::ut;
+
+  "backoff_delay"_test = []
+  {
+    should("stay below the capped exponential bound") = []
+    {
+      cppless::retry_options options {.max_retries = 8,
+                                      .base_delay = std::chrono::milliseconds(10),
+                                      .max_delay = std::chrono::milliseconds(50)};
+      std::mt19937_64 rng(42);
+      for (unsigned int attempt = 0; attempt < 64; attempt++) {
+        auto bound = std::min<std::chrono::nanoseconds>(
+            std::chrono::milliseconds(10) * (1ULL << std::min(attempt, 10U)),
+            std::chrono::milliseconds(50));
+        auto delay = cppless::backoff_delay(options, attempt, rng);
+        expect(delay >= std::chrono::nanoseconds::zero() && delay <= bound);
+      }
+    };
+
+    should("retry right away without a base delay") = []
+    {
+      cppless::retry_options options;
+      options.base_delay = std::chrono::milliseconds(0);
+      options.max_delay = std::chrono::milliseconds(20);
+      std::mt19937_64 rng(42);
+      for (unsigned int attempt = 0; attempt < 64; attempt++) {
+        expect(cppless::backoff_delay(options, attempt, rng)
+               == std::chrono::nanoseconds::zero());
+      }
+    };
+
+    should("cap delays whose exponential bound overflows") = []
+    {
+      cppless::retry_options options;
+      options.base_delay = std::chrono::hours(24);
+      options.max_delay = std::chrono::milliseconds(50);
+      std::mt19937_64 rng(42);
+      for (unsigned int attempt = 0; attempt < 64; attempt++) {
+        auto delay = cppless::backoff_delay(options, attempt, rng);
+        expect(delay >= std::chrono::nanoseconds::zero()
+               && delay <= std::chrono::milliseconds(50));
+      }
+    };
+  };
+
+  "token_bucket"_test = []
+  {
+    should("allow bursts and refill at the configured rate") = []
+    {
+      cppless::token_bucket bucket(10, 2);
+      auto now = std::chrono::steady_clock::now();
+      expect(bucket.try_acquire(now));
+      expect(bucket.try_acquire(now));
+      expect(!bucket.try_acquire(now));
+      expect(bucket.wait_time(now) > std::chrono::milliseconds(90));
+      expect(bucket.try_acquire(now + std::chrono::milliseconds(100)));
+    };
+  };
+
+  "admission_controller"_test = []
+  {
+    should("halve the limit once per window of throttled invocations") = []
+    {
+      cppless::admission_controller controller(
+          {.initial_limit = 8, .min_limit = 1, .max_limit = 64});
+      auto now = std::chrono::steady_clock::now();
+      auto first = controller.try_admit(now);
+      auto second = controller.try_admit(now);
+      controller.on_throttled(*first);
+      controller.on_throttled(*second);
+      expect(controller.limit() == 4.0);
+
+      auto third = controller.try_admit(now);
+      controller.on_throttled(*third);
+      expect(controller.limit() == 2.0);
+      expect(controller.in_flight() == 0_ul);
+    };
+  };
+
+  "retry_scheduler"_test = []
+  {
+    should("finish every task against a throttling endpoint") = []
+    {
+      constexpr std::size_t tasks = 200;
+      constexpr std::size_t capacity = 8;
+      cppless::retry_options retry {.max_retries = 64,
+                                    .base_delay = std::chrono::milliseconds(1),
+                                    .max_delay = std::chrono::milliseconds(20)};
+
+      auto adaptive = run(tasks, capacity, {.initial_limit = 64}, retry);
+
+      // Retries every throttled invocation right away
+      cppless::retry_options immediate = retry;
+      immediate.base_delay = std::chrono::milliseconds(0);
+      immediate.max_retries = 100000;
+      auto naive = run(tasks,
+                       capacity,
+                       {.initial_limit = 64,
+                        .min_limit = 64,
+                        .max_limit = 64,
+                        .decrease_factor = 1},
+                       immediate);
+
+      expect(adaptive.succeeded == tasks);
+      expect(adaptive.failed == 0_ul);
+      expect(naive.succeeded == tasks);
+
+      auto adaptive_goodput = static_cast<double>(adaptive.succeeded)
+          / static_cast<double>(adaptive.attempts);
+      auto naive_goodput = static_cast<double>(naive.succeeded)
+          / static_cast<double>(naive.attempts);
+      expect(adaptive_goodput > naive_goodput);
+    };
+
+    should("fail tasks which exhaust their retry budget") = []
+    {
+      cppless::retry_options retry {.max_retries = 3,
+                                    .base_delay = std::chrono::milliseconds(0),
+                                    .max_delay = std::chrono::milliseconds(0)};
+      auto result = run(10, 0, {}, retry);
+
+      expect(result.succeeded == 0_ul);
+      expect(result.failed == 10_ul);
+      expect(result.attempts == 40_ul);
+    };
+  };
+}
@@ -0,0 +1 @@
+void retry_tests();
\ No newline at end of file
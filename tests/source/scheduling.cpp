@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "./scheduling.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/graph/scheduling.hpp>
+
+void scheduling_tests()
+{
+  using namespace boost::ut;
+  using cppless::executor::ready_queue;
+  using cppless::executor::recorded_graph;
+  using cppless::executor::scheduling_policy;
+
+  "scheduling"_test = []
+  {
+    should("rank nodes by their most costly path to a sink") = []
+    {
+      // 0 -> 1 -> 3, 0 -> 2 -> 3
+      auto ranks = cppless::executor::upward_ranks({{1, 2}, {3}, {3}, {}},
+                                                   {1, 5, 2, 1});
+      expect(ranks == std::vector<double> {7, 6, 3, 1});
+    };
+
+    should("store the successors of every node contiguously") = []
+    {
+      cppless::graph::adjacency edges {{{1, 2}, {}, {0}}};
+      expect(edges.size() == 3_ul);
+      expect(edges.edge_count() == 3_ul);
+      expect(edges.successors(0).size() == 2_ul);
+      expect(edges.successors(0)[1] == 2_ul);
+      expect(edges.successors(1).empty());
+      expect(edges.successors(2)[0] == 0_ul);
+    };
+
+    should("reject cyclic graphs") = []
+    {
+      expect(throws<std::runtime_error>(
+          [] { cppless::executor::upward_ranks({{1}, {0}}, {1, 1}); }));
+    };
+
+    should("pop ready nodes in the order of the policy") = []
+    {
+      auto drain = [](ready_queue queue)
+      {
+        for (std::size_t id : {0, 1, 2}) {
+          queue.push(id);
+        }
+        std::vector<std::size_t> order;
+        while (!queue.empty()) {
+          order.push_back(queue.pop());
+        }
+        return order;
+      };
+      using order = std::vector<std::size_t>;
+      expect(drain(ready_queue {scheduling_policy::lifo}) == order {2, 1, 0});
+      expect(drain(ready_queue {scheduling_policy::fifo}) == order {0, 1, 2});
+      expect(drain(ready_queue {scheduling_policy::critical_path, {1, 3, 1}})
+             == order {1, 0, 2});
+    };
+
+    should("rank nodes added while the graph runs") = []
+    {
+      ready_queue queue {scheduling_policy::critical_path, {2, 1}};
+      queue.set_rank(3, 4);
+      expect(queue.rank(3) == 4.0_d);
+      expect(queue.rank(2) == 0.0_d);
+      for (std::size_t id : {0, 1, 3}) {
+        queue.push(id);
+      }
+      expect(queue.pop() == 3_ul);
+      expect(queue.pop() == 0_ul);
+    };
+
+    should("start the critical path first under a concurrency cap") = []
+    {
+      // A source with two short and one long successor
+      recorded_graph graph {
+          {0, {1, 2, 3}, false, 0, 0},
+          {1, {}, true, 1, 1},
+          {2, {}, true, 1, 1},
+          {3, {}, true, 10, 10},
+      };
+      using cppless::executor::simulate;
+      expect(simulate(graph, scheduling_policy::fifo) == 10.0_d);
+      expect(simulate(graph, scheduling_policy::fifo, 2) == 11.0_d);
+      expect(simulate(graph, scheduling_policy::critical_path, 2) == 10.0_d);
+    };
+  };
+}
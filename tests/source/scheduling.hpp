@@ -0,0 +1 @@
+void scheduling_tests();
\ No newline at end of file
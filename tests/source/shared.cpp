@@ -0,0 +1,153 @@
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "./shared.hpp"
+
+#include <boost/ut.hpp>
+#include <cereal/types/vector.hpp>
+#include <cppless/dispatcher/common.hpp>
+#include <cppless/dispatcher/shared.hpp>
+#include <cppless/utils/object_store.hpp>
+
+void shared_tests()
+{
+  using namespace boost::ut;
+
+  "shared"_test = []
+  {
+    auto directory =
+        std::filesystem::temp_directory_path() / "cppless-shared-test";
+    std::filesystem::remove_all(directory);
+    cppless::set_default_object_store(
+        std::make_shared<cppless::file_object_store>(directory));
+    auto stored_objects = [&directory]
+    {
+      return std::distance(std::filesystem::directory_iterator(directory),
+                           std::filesystem::directory_iterator());
+    };
+    auto clear_store = [&directory]
+    {
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+    };
+    auto large = [](int first)
+    {
+      std::vector<int> values(1000);
+      std::iota(values.begin(), values.end(), first);
+      return values;
+    };
+
+    should("be passed inline by default") = [&]
+    {
+      cppless::shared<std::vector<int>> s {large(0)};
+      auto data = cppless::binary_archive::serialize(s);
+      cppless::shared<std::vector<int>> received;
+      cppless::binary_archive::deserialize(data, received);
+      expect(!received.stored());
+      expect(received.get() == large(0));
+      expect(stored_objects() == 0_l);
+    };
+
+    should("store equal values once") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::shared<std::vector<int>> a {large(1)};
+      cppless::shared<std::vector<int>> b {large(1)};
+      std::tuple<cppless::shared<std::vector<int>>,
+                 cppless::shared<std::vector<int>>,
+                 cppless::shared<std::vector<int>>>
+          captures {a, a, b};
+      auto data = cppless::json_binary_archive::serialize(captures);
+      expect(data.size() < 1000_ul);
+      expect(a.stored() && b.stored());
+      expect(stored_objects() == 1_l);
+
+      cppless::shared<std::vector<int>> c {large(2)};
+      cppless::binary_archive::serialize(c);
+      expect(stored_objects() == 2_l);
+
+      decltype(captures) received;
+      cppless::json_binary_archive::deserialize(data, received);
+      expect(std::get<0>(received).get() == large(1));
+      expect(std::get<2>(received).get() == large(1));
+    };
+
+    should("store values again once the default store changed") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      clear_store();
+      cppless::shared<std::vector<int>> a {large(5)};
+      cppless::binary_archive::serialize(a);
+      expect(stored_objects() == 1_l);
+
+      auto other = directory.string() + "-other";
+      std::filesystem::remove_all(other);
+      cppless::set_default_object_store(
+          std::make_shared<cppless::file_object_store>(other));
+      auto objects_in_other = [&other]
+      {
+        return std::distance(std::filesystem::directory_iterator(other),
+                             std::filesystem::directory_iterator());
+      };
+      // An instance keyed already stores its value in the new store too
+      auto data = cppless::binary_archive::serialize(a);
+      expect(objects_in_other() == 1_l);
+      cppless::shared<std::vector<int>> b {large(5)};
+      cppless::binary_archive::serialize(b);
+      expect(objects_in_other() == 1_l);
+
+      cppless::shared<std::vector<int>> received;
+      cppless::binary_archive::deserialize(data, received);
+      expect(received.stored());
+      expect(received.get() == large(5));
+
+      std::filesystem::remove_all(other);
+      cppless::set_default_object_store(
+          std::make_shared<cppless::file_object_store>(directory));
+    };
+
+    should("keep fetched values in the process") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::shared<std::vector<int>> s {large(3)};
+      auto data = cppless::binary_archive::serialize(s);
+
+      cppless::shared<std::vector<int>> first;
+      cppless::binary_archive::deserialize(data, first);
+      expect(first.get() == large(3));
+
+      // A warm invocation neither fetches nor deserializes the value again
+      clear_store();
+      cppless::shared<std::vector<int>> second;
+      cppless::binary_archive::deserialize(data, second);
+      expect(second.get() == large(3));
+      expect(&second.get() == &first.get());
+    };
+
+    should("fetch values again once evicted") = [&]
+    {
+      cppless::scoped_remote_threshold threshold {64};
+      cppless::set_shared_cache_capacity(0);
+      cppless::shared<std::vector<int>> s {large(4)};
+      auto data = cppless::binary_archive::serialize(s);
+
+      cppless::shared<std::vector<int>> first;
+      cppless::binary_archive::deserialize(data, first);
+      expect(first.get() == large(4));
+
+      clear_store();
+      cppless::shared<std::vector<int>> second;
+      cppless::binary_archive::deserialize(data, second);
+      expect(throws<std::runtime_error>([&] { second.get(); }));
+      cppless::set_shared_cache_capacity(256UL << 20U);
+    };
+
+    std::filesystem::remove_all(directory);
+    cppless::set_default_object_store(nullptr);
+  };
+}
@@ -0,0 +1 @@
+void shared_tests();
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "./speculation.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/graph/speculation.hpp>
+
+void speculation_tests()
+{
+  using namespace boost::ut;
+  using cppless::executor::latency_distribution;
+
+  "speculation"_test = []
+  {
+    should("compute percentiles by the nearest rank") = []
+    {
+      latency_distribution latencies;
+      expect(latencies.percentile(50) == 0_d);
+      for (int duration = 10; duration >= 1; duration--) {
+        latencies.add(duration);
+      }
+      expect(latencies.size() == 10_ul);
+      expect(latencies.percentile(50) == 5_d);
+      expect(latencies.percentile(90) == 9_d);
+      expect(latencies.percentile(100) == 10_d);
+      expect(latencies.percentile(0) == 1_d);
+    };
+
+    should("only keep the most recent durations") = []
+    {
+      latency_distribution latencies {3};
+      for (int duration : {100, 100, 100, 1, 2, 3}) {
+        latencies.add(duration);
+      }
+      expect(latencies.size() == 3_ul);
+      expect(latencies.percentile(100) == 3_d);
+      latencies.add(4);
+      expect(latencies.percentile(0) == 2_d);
+    };
+  };
+}
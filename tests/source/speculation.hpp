@@ -0,0 +1 @@
+void speculation_tests();
\ No newline at end of file
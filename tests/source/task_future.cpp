@@ -0,0 +1,368 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "./task_future.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/ut.hpp>
+#include <cppless/dispatcher/aws-lambda.hpp>
+#include <cppless/dispatcher/coroutine.hpp>
+#include <cppless/dispatcher/task_future.hpp>
+#include <nghttp2/asio_http2_server.h>
+
+namespace
+{
+using state = cppless::detail::future_state<int>;
+
+// Runs eagerly and never suspends at the end, enough to co_await a future
+struct detached
+{
+  struct promise_type
+  {
+    auto get_return_object() -> detached
+    {
+      return {};
+    }
+    auto initial_suspend() -> std::suspend_never
+    {
+      return {};
+    }
+    auto final_suspend() noexcept -> std::suspend_never
+    {
+      return {};
+    }
+    auto return_void() -> void {}
+    auto unhandled_exception() -> void
+    {
+      std::terminate();
+    }
+  };
+};
+
+auto add(cppless::task_future<int> a, cppless::task_future<int> b, int& sum)
+    -> detached
+{
+  int x = co_await a;
+  int y = co_await b;
+  sum = x + y;
+}
+auto square(cppless::task_future<int> f) -> cppless::coroutine<int>
+{
+  int x = co_await f;
+  co_return x * x;
+}
+
+auto fail() -> cppless::coroutine<int>
+{
+  throw std::runtime_error("failed");
+  co_return 0;
+}
+
+auto sum_of_squares(cppless::task_future<int> a, cppless::task_future<int> b)
+    -> cppless::coroutine<int>
+{
+  auto x = cppless::spawn(square(a));
+  auto y = cppless::spawn(square(b));
+  co_return co_await x + co_await y;
+}
+
+// Returns its first argument after sleeping for the second one, in
+// milliseconds, and fails for negative values
+struct sleep_task
+{
+  using res = int;
+  using args = std::tuple<int, int>;
+
+  template<class Archive>
+  void serialize(Archive& /*ar*/)
+  {
+  }
+
+  [[nodiscard]] auto identifier() const -> std::string
+  {
+    return "sleep_task";
+  }
+
+  [[nodiscard]] auto max_retries() const -> std::optional<unsigned int>
+  {
+    return 0;
+  }
+};
+
+/**
+ * Serves the Lambda invoke API for `sleep_task` on a local port over
+ * cleartext HTTP/2, the responses are delayed by timers of the server.
+ */
+class fake_lambda
+{
+public:
+  using request = nghttp2::asio_http2::server::request;
+  using response = nghttp2::asio_http2::server::response;
+
+  fake_lambda()
+  {
+    m_server.num_threads(1);
+    m_server.handle("/", &fake_lambda::invoke);
+    boost::system::error_code ec;
+    if (m_server.listen_and_serve(ec, "127.0.0.1", "0", true)) {
+      throw std::runtime_error("Could not listen: " + ec.message());
+    }
+  }
+
+  fake_lambda(const fake_lambda&) = delete;
+  auto operator=(const fake_lambda&) -> fake_lambda& = delete;
+  fake_lambda(fake_lambda&&) = delete;
+  auto operator=(fake_lambda&&) -> fake_lambda& = delete;
+
+  ~fake_lambda()
+  {
+    m_server.stop();
+    m_server.join();
+  }
+
+  [[nodiscard]] auto endpoint() const -> std::string
+  {
+    return "http://127.0.0.1:" + std::to_string(m_server.ports().front());
+  }
+
+private:
+  static auto invoke(const request& req, const response& res) -> void
+  {
+    auto alive = std::make_shared<bool>(true);
+    res.on_close([alive](uint32_t /*error_code*/) { *alive = false; });
+    req.on_data(
+        [&res, alive, body = std::string {}](const uint8_t* data,
+                                             std::size_t len) mutable
+        {
+          if (len > 0) {
+            body.append(reinterpret_cast<const char*>(data),  // NOLINT
+                        len);
+            return;
+          }
+          sleep_task task;
+          sleep_task::args args;
+          invocation_payload<sleep_task, int, int> payload {task, args};
+          cppless::json_binary_archive::deserialize(body, payload);
+          auto [value, delay] = args;
+
+          auto timer = std::make_shared<boost::asio::steady_timer>(
+              res.io_service(), std::chrono::milliseconds(delay));
+          timer->async_wait(
+              [&res, alive, timer, value = value](
+                  const boost::system::error_code& /*error*/)
+              {
+                if (!*alive) {
+                  return;
+                }
+                if (value < 0) {
+                  res.write_head(
+                      200, {{"x-amz-function-error", {"Unhandled", false}}});
+                  res.end("negative value");
+                  return;
+                }
+                std::tuple<int, execution_statistics> result {
+                    value, execution_statistics {"fake", false}};
+                res.write_head(200);
+                res.end(cppless::json_binary_archive::serialize(result));
+              });
+        });
+  }
+
+  nghttp2::asio_http2::server::http2 m_server;
+};
+
+auto make_dispatcher(const fake_lambda& lambda)
+    -> cppless::aws_lambda_nghttp2_dispatcher<>
+{
+  cppless::aws::lambda::client client {"us-east-1"};
+  client.set_endpoint(lambda.endpoint());
+  auto key = client.create_derived_key("id", "secret");
+  return cppless::aws_lambda_nghttp2_dispatcher<> {client, key};
+}
+}  // namespace
+
+void task_future_tests()
+{
+  using namespace boost::ut;
+
+  "task_future"_test = []
+  {
+    should("chain continuations") = []
+    {
+      auto s = std::make_shared<state>();
+      cppless::task_future<int> f {s};
+      auto g = f.then([](int& v) { return v * 2; })
+                   .then([](int v) { return std::to_string(v); });
+      expect(!g.ready());
+      s->value = 21;
+      s->complete();
+      expect(g.ready());
+      expect(g.get() == "42");
+    };
+
+    should("pass errors on") = []
+    {
+      auto s = std::make_shared<state>();
+      cppless::task_future<int> f {s};
+      bool called = false;
+      auto g = f.then(
+          [&called](int& v)
+          {
+            called = true;
+            return v;
+          });
+      s->complete(std::make_exception_ptr(std::runtime_error("failed")));
+      expect(throws<std::runtime_error>([&g] { g.get(); }));
+      expect(!called);
+    };
+
+    should("resume awaiting coroutines") = []
+    {
+      auto a = std::make_shared<state>();
+      auto b = std::make_shared<state>();
+      int sum = 0;
+      add(cppless::task_future<int> {a}, cppless::task_future<int> {b}, sum);
+      b->value = 2;
+      b->complete();
+      std::thread completer(
+          [a]
+          {
+            a->value = 40;
+            a->complete();
+          });
+      completer.join();
+      expect(sum == 42_i);
+    };
+
+    should("time out") = []
+    {
+      cppless::task_future<int> f {std::make_shared<state>()};
+      expect(!f.wait_for(std::chrono::milliseconds(1)));
+    };
+  };
+
+  "coroutine"_test = []
+  {
+    should("run subtrees concurrently") = []
+    {
+      auto a = std::make_shared<state>();
+      auto b = std::make_shared<state>();
+      auto f = cppless::spawn(sum_of_squares(cppless::task_future<int> {a},
+                                             cppless::task_future<int> {b}));
+      b->value = 4;
+      b->complete();
+      expect(!f.ready());
+      a->value = 3;
+      a->complete();
+      expect(f.ready());
+      expect(f.get() == 25_i);
+    };
+
+    should("propagate exceptions") = []
+    {
+      auto f = cppless::spawn(fail());
+      expect(throws<std::runtime_error>([&f] { f.get(); }));
+    };
+  };
+
+  "aws_lambda_nghttp2_dispatcher_instance"_test = []
+  {
+    fake_lambda lambda;
+    auto dispatcher = make_dispatcher(lambda);
+    sleep_task task;
+
+    should("wait for any of the given tasks") = [&]
+    {
+      auto instance = dispatcher.create_instance();
+      std::array<int, 3> results {};
+      int slow = instance.dispatch_impl(task, results[0], {1, 300});
+      int fast = instance.dispatch_impl(task, results[1], {2, 50});
+      int first = instance.dispatch_impl(task, results[2], {3, 0});
+
+      // `first` finishes before either of them, but is left to later waits
+      std::array<int, 2> any {slow, fast};
+      expect(std::get<0>(instance.wait_any(any)) == fast);
+      expect(results[1] == 2_i);
+
+      std::array<int, 2> all {slow, first};
+      expect(instance.wait_all(all).size() == 2_ul);
+      expect(results[0] == 1_i);
+      expect(results[2] == 3_i);
+    };
+
+    should("report failures after all tasks finished") = [&]
+    {
+      auto instance = dispatcher.create_instance();
+      std::array<int, 2> results {};
+      int failing = instance.dispatch_impl(task, results[0], {-1, 0});
+      int slow = instance.dispatch_impl(task, results[1], {5, 100});
+
+      std::array<int, 2> all {failing, slow};
+      try {
+        instance.wait_all(all);
+        expect(false) << "the failure was not reported";
+      } catch (const cppless::invocation_failed& error) {
+        expect(error.id() == failing);
+      }
+      expect(results[1] == 5_i);
+    };
+
+    should("give up waiting after the timeout") = [&]
+    {
+      auto instance = dispatcher.create_instance();
+      int result = 0;
+      int id = instance.dispatch_impl(task, result, {7, 300});
+      expect(!instance.wait_for(std::chrono::milliseconds(20)).has_value());
+      auto finished = instance.wait_for(std::chrono::seconds(10));
+      expect(finished.has_value());
+      expect(std::get<0>(*finished) == id);
+      expect(result == 7_i);
+    };
+
+    should("complete tasks on the IO thread of a background instance") = [&]
+    {
+      auto instance = dispatcher.create_instance(cppless::io_mode::background);
+      int result = 0;
+      std::atomic<bool> completed = false;
+      std::thread::id completing_thread;
+      std::exception_ptr completion_error;
+      instance.dispatch_impl(task,
+                             result,
+                             {8, 0},
+                             std::nullopt,
+                             [&](std::exception_ptr error)
+                             {
+                               completing_thread = std::this_thread::get_id();
+                               completion_error = std::move(error);
+                               completed = true;
+                             });
+      auto future = instance.dispatch_async_impl(task, {9, 0});
+
+      // Nothing waits on the instance, the IO thread delivers the results
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while ((!completed || !future.ready())
+             && std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      expect(completed.load());
+      expect(completing_thread != std::this_thread::get_id());
+      expect(completion_error == nullptr);
+      expect(result == 8_i);
+      expect(future.ready());
+      expect(future.get() == 9_i);
+    };
+  };
+}
@@ -0,0 +1 @@
+void task_future_tests();
\ No newline at end of file
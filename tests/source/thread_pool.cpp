@@ -0,0 +1,123 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "./thread_pool.hpp"
+
+#include <boost/ut.hpp>
+#include <cppless/utils/thread_pool.hpp>
+
+void thread_pool_tests()
+{
+  using namespace boost::ut;
+
+  "thread_pool"_test = []
+  {
+    should("visit every index exactly once") = []
+    {
+      cppless::thread_pool pool(4);
+      std::vector<std::atomic<int>> visits(10000);
+      pool.parallel_for(0, visits.size(), [&](std::size_t i) { visits[i]++; });
+      bool once = true;
+      for (auto& v : visits) {
+        once = once && v.load() == 1;
+      }
+      expect(once);
+    };
+
+    should("reduce deterministically") = []
+    {
+      cppless::thread_pool pool(4);
+      auto harmonic = [&pool]
+      {
+        return pool.parallel_reduce(
+            1,
+            100000,
+            0.0,
+            [](std::size_t i) { return 1.0 / static_cast<double>(i); },
+            std::plus<>());
+      };
+      auto first = harmonic();
+      expect(first > 12.0 && first < 12.1);
+      expect(harmonic() == first);
+    };
+
+    should("run nested loops") = []
+    {
+      cppless::thread_pool pool(3);
+      std::atomic<int> count = 0;
+      pool.parallel_for(
+          0,
+          32,
+          [&](std::size_t /*i*/)
+          { pool.parallel_for(0, 32, [&](std::size_t /*j*/) { count++; }); });
+      expect(count.load() == 1024_i);
+    };
+
+    should("run submitted jobs without workers") = []
+    {
+      cppless::thread_pool pool(1);
+      bool ran = false;
+      pool.submit([&ran] { ran = true; });
+      expect(ran);
+    };
+
+    should("run submitted jobs on a worker") = []
+    {
+      cppless::thread_pool pool(2);
+      std::mutex mutex;
+      std::condition_variable cv;
+      bool ran = false;
+      pool.submit(
+          [&]
+          {
+            std::scoped_lock lock(mutex);
+            ran = true;
+            cv.notify_one();
+          });
+      std::unique_lock lock(mutex);
+      expect(cv.wait_for(lock, std::chrono::seconds(10), [&] { return ran; }));
+    };
+
+    should("wait for chunks running on other threads") = []
+    {
+      cppless::thread_pool pool(4);
+      std::atomic<int> count = 0;
+      pool.parallel_for(
+          0,
+          4,
+          [&](std::size_t /*i*/)
+          {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            count++;
+          },
+          1);
+      expect(count.load() == 4_i);
+    };
+
+    should("rethrow exceptions of the body") = []
+    {
+      cppless::thread_pool pool(4);
+      bool thrown = false;
+      try {
+        pool.parallel_for(0,
+                          1000,
+                          [](std::size_t i)
+                          {
+                            if (i == 500) {
+                              throw std::runtime_error("failed");
+                            }
+                          });
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+      expect(thrown);
+    };
+  };
+}
@@ -0,0 +1 @@
+void thread_pool_tests();
\ No newline at end of file
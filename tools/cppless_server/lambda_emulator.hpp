@@ -0,0 +1,862 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <cppless/utils/base64.hpp>
+#include <cppless/utils/crypto/hex.hpp>
+#include <cppless/utils/crypto/wrappers.hpp>
+#include <nlohmann/json.hpp>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;  // NOLINT
+
+namespace cppless::emulator
+{
+
+/**
+ * @brief An entry point listed in the meta file of an executable built with
+ * `-falt-entry`.
+ */
+struct function_entry
+{
+  // The name `task_function_name` invokes the function with
+  std::string name;
+  std::filesystem::path executable;
+  std::string identifier;
+  unsigned long memory = 0;
+  unsigned long timeout = 0;
+  unsigned long ephemeral_storage = 0;
+  // Modifiers changing what the function does, see `variant_keys`
+  std::vector<std::pair<std::string, unsigned long>> variant;
+};
+
+/**
+ * @brief The user_meta keys of the modifiers which are part of a function's
+ * name, in the order `meta_serializer::identifier` appends them.
+ */
+inline const std::array<std::string, 3> variant_keys {
+    "threads", "context_cache", "remote_threshold"};
+
+namespace detail
+{
+
+using meta_value = std::variant<unsigned long, std::string>;
+
+inline auto read_big_endian(std::istream& is, int bytes) -> unsigned long
+{
+  unsigned long value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value = (value << 8) | static_cast<unsigned char>(is.get());  // NOLINT
+  }
+  return value;
+}
+
+// Decodes a value written by `cppless::serialize`, see
+// tools/packagerpy/encoding.py. Nested arrays and maps are skipped.
+inline auto decode_meta_value(std::istream& is) -> meta_value
+{
+  auto tag = is.get();
+  switch (tag) {
+    case 0x00:
+      return read_big_endian(is, 4);
+    case 0x01:
+      return read_big_endian(is, 8);
+    case 0x02: {
+      std::string s(read_big_endian(is, 4), '\0');
+      is.read(s.data(), static_cast<std::streamsize>(s.size()));
+      return s;
+    }
+    case 0x03: {
+      auto n = read_big_endian(is, 4);
+      for (unsigned long i = 0; i < n; i++) {
+        decode_meta_value(is);
+      }
+      return 0UL;
+    }
+    case 0x04: {
+      auto n = read_big_endian(is, 4);
+      for (unsigned long i = 0; i < 2 * n; i++) {
+        decode_meta_value(is);
+      }
+      return 0UL;
+    }
+    default:
+      throw std::runtime_error("Invalid user_meta encoding");
+  }
+}
+
+inline auto decode_user_meta(const std::string& encoded)
+    -> std::map<std::string, meta_value>
+{
+  base64::istreambuf buf(encoded);
+  std::istream is(&buf);
+  if (is.get() != 0x04) {
+    throw std::runtime_error("user_meta is not a map");
+  }
+  std::map<std::string, meta_value> result;
+  auto n = read_big_endian(is, 4);
+  for (unsigned long i = 0; i < n; i++) {
+    auto key = decode_meta_value(is);
+    auto value = decode_meta_value(is);
+    result[std::get<std::string>(key)] = std::move(value);
+  }
+  return result;
+}
+
+}  // namespace detail
+
+/**
+ * @brief The name `task_function_name` derives for a task, the target name
+ * followed by a hash of the identifier and the configuration.
+ */
+inline auto function_name(const std::string& target_name,
+                          const function_entry& entry) -> std::string
+{
+  std::stringstream ss;
+  ss << entry.identifier << "#" << entry.ephemeral_storage << "#"
+     << entry.memory << "#" << entry.timeout;
+  for (const auto& [key, value] : entry.variant) {
+    ss << "#" << key << "=" << value;
+  }
+  evp_md_ctx ctx;
+  ctx.update(ss.str());
+  return target_name + "-" + hex_lower(ctx.final()).substr(0, 8);
+}
+
+/**
+ * @brief Reads the entry points of `executable` from the `.json` meta file
+ * next to it. The target name defaults to the executable's name, which is
+ * what `TARGET_NAME` is set to by `aws_lambda_target`.
+ */
+inline auto load_meta(const std::filesystem::path& executable,
+                      std::string target_name = "")
+    -> std::vector<function_entry>
+{
+  if (target_name.empty()) {
+    target_name = executable.filename().string();
+  }
+  auto meta_path = executable;
+  meta_path.replace_extension(".json");
+  std::ifstream ifs(meta_path);
+  if (ifs.fail()) {
+    throw std::runtime_error("Could not open " + meta_path.string());
+  }
+  auto meta = nlohmann::json::parse(ifs);
+
+  std::vector<function_entry> entries;
+  for (const auto& entry_point : meta["entry_points"]) {
+    auto user_meta =
+        detail::decode_user_meta(entry_point["user_meta"].get<std::string>());
+    function_entry entry {
+        .executable = executable.parent_path()
+            / entry_point["filename"].get<std::string>(),
+        .identifier = std::get<std::string>(user_meta.at("identifier")),
+        .memory = std::get<unsigned long>(user_meta.at("memory")),
+        .timeout = std::get<unsigned long>(user_meta.at("timeout")),
+        .ephemeral_storage =
+            std::get<unsigned long>(user_meta.at("ephemeral_storage")),
+    };
+    for (const auto& key : variant_keys) {
+      if (auto it = user_meta.find(key); it != user_meta.end()) {
+        entry.variant.emplace_back(key, std::get<unsigned long>(it->second));
+      }
+    }
+    entry.name = function_name(target_name, entry);
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+struct emulator_options
+{
+  /**
+   * @brief Workers started per function before the first invocation.
+   */
+  std::size_t min_workers = 0;
+  /**
+   * @brief Concurrent invocations per function, further invocations are
+   * throttled with a 429 like a function with reserved concurrency.
+   */
+  std::size_t max_workers = 64;
+  /**
+   * @brief Consecutive workers exiting before their first invocation after
+   * which queued invocations are failed.
+   */
+  int max_failed_starts = 3;
+};
+
+struct invocation_result
+{
+  int status_code = 200;
+  std::string body;
+  std::string request_id;
+  // Sent with `X-Amz-Function-Error`
+  bool function_error = false;
+};
+
+using completion_cb = std::function<void(invocation_result)>;
+
+struct function_stats
+{
+  std::size_t invocations = 0;
+  std::size_t cold_starts = 0;
+  std::size_t warm_starts = 0;
+  std::size_t throttled = 0;
+  std::size_t errors = 0;
+  std::size_t workers = 0;
+};
+
+namespace http = boost::beast::http;
+
+/**
+ * @brief Runs the invocations of one function on a pool of worker processes,
+ * each of which talks to its own runtime API endpoint.
+ *
+ * Workers are started on demand up to `max_workers` and kept warm after their
+ * first invocation. Not thread safe, every call has to happen on the
+ * io_context the pool was created with.
+ */
+class function_pool
+{
+public:
+  function_pool(boost::asio::io_context& io_context,
+                function_entry entry,
+                emulator_options options)
+      : m_io_context(io_context)
+      , m_entry(std::move(entry))
+      , m_options(options)
+  {
+  }
+
+  function_pool(const function_pool&) = delete;
+  auto operator=(const function_pool&) -> function_pool& = delete;
+  function_pool(function_pool&&) = delete;
+  auto operator=(function_pool&&) -> function_pool& = delete;
+
+  ~function_pool()
+  {
+    shutdown();
+  }
+
+  auto entry() const -> const function_entry&
+  {
+    return m_entry;
+  }
+
+  auto prewarm() -> void
+  {
+    while (m_workers.size() < m_options.min_workers) {
+      spawn();
+    }
+  }
+
+  auto invoke(std::string payload, completion_cb done) -> void
+  {
+    if (m_queue.size() + busy() >= m_options.max_workers) {
+      m_stats.throttled++;
+      done({
+          .status_code = 429,
+          .body = R"({"Reason":"ReservedFunctionConcurrentInvocationLimitExceeded","Type":"User","message":"Rate Exceeded."})",
+      });
+      return;
+    }
+    m_stats.invocations++;
+    m_queue.push_back({
+        .id = boost::uuids::to_string(m_uuid_generator()),
+        .payload = std::move(payload),
+        .done = std::move(done),
+    });
+    schedule();
+  }
+
+  /**
+   * @brief Handles the exit of a child process, returns false if it was not
+   * one of this pool's workers.
+   */
+  auto on_exit(pid_t pid, int status) -> bool
+  {
+    auto it = std::find_if(m_workers.begin(),
+                           m_workers.end(),
+                           [pid](const auto& w) { return w->pid == pid; });
+    if (it == m_workers.end()) {
+      return false;
+    }
+    auto w = *it;
+    m_workers.erase(it);
+    w->exited = true;
+    w->acceptor.close();
+    w->waiting = nullptr;
+    w->deadline.cancel();
+
+    if (w->current) {
+      std::string message;
+      if (w->timed_out) {
+        message = "Task timed out after " + std::to_string(m_entry.timeout)
+            + ".00 seconds";
+      } else if (WIFEXITED(status)) {  // NOLINT
+        message = "Runtime exited with error: exit status "
+            + std::to_string(WEXITSTATUS(status));  // NOLINT
+      } else {
+        message = "Runtime exited with error: signal "
+            + std::to_string(WTERMSIG(status));  // NOLINT
+      }
+      fail(*w->current, "Runtime.ExitError", message);
+      w->current.reset();
+    }
+    if (!w->warm) {
+      m_failed_starts++;
+    }
+    if (m_failed_starts >= m_options.max_failed_starts) {
+      m_failed_starts = 0;
+      auto queue = std::move(m_queue);
+      m_queue.clear();
+      for (auto& inv : queue) {
+        fail(inv, "Runtime.ExitError", "Runtime failed to start");
+      }
+    }
+    schedule();
+    return true;
+  }
+
+  auto stats() const -> function_stats
+  {
+    auto s = m_stats;
+    s.workers = m_workers.size();
+    return s;
+  }
+
+  auto shutdown() -> void
+  {
+    for (auto& w : m_workers) {
+      ::kill(w->pid, SIGTERM);
+      w->acceptor.close();
+      w->waiting = nullptr;
+    }
+  }
+
+private:
+  struct invocation
+  {
+    std::string id;
+    std::string payload;
+    completion_cb done;
+  };
+
+  struct worker
+  {
+    explicit worker(boost::asio::io_context& io_context)
+        : acceptor(io_context)
+        , deadline(io_context)
+    {
+    }
+
+    pid_t pid = -1;
+    boost::asio::ip::tcp::acceptor acceptor;
+    boost::asio::steady_timer deadline;
+    // Set while the runtime waits in `invocation/next`
+    std::function<void(const invocation&)> waiting;
+    std::optional<invocation> current;
+    bool warm = false;
+    bool timed_out = false;
+    bool exited = false;
+  };
+
+  class runtime_connection;
+
+  auto busy() const -> std::size_t
+  {
+    return static_cast<std::size_t>(
+        std::count_if(m_workers.begin(),
+                      m_workers.end(),
+                      [](const auto& w) { return w->current.has_value(); }));
+  }
+
+  // Hands queued invocations to waiting workers and starts new workers for
+  // the ones left over.
+  auto schedule() -> void
+  {
+    for (auto& w : m_workers) {
+      if (m_queue.empty()) {
+        return;
+      }
+      if (w->waiting && !w->current) {
+        auto inv = std::move(m_queue.front());
+        m_queue.pop_front();
+        deliver(w, std::move(inv));
+      }
+    }
+    std::size_t starting = static_cast<std::size_t>(
+        std::count_if(m_workers.begin(),
+                      m_workers.end(),
+                      [](const auto& w) { return !w->waiting && !w->current; }));
+    while (m_queue.size() > starting && m_workers.size() < m_options.max_workers)
+    {
+      try {
+        spawn();
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        auto queue = std::move(m_queue);
+        m_queue.clear();
+        for (auto& inv : queue) {
+          fail(inv, "Runtime.ExitError", e.what());
+        }
+        return;
+      }
+      starting++;
+    }
+  }
+
+  auto deliver(const std::shared_ptr<worker>& w, invocation inv) -> void
+  {
+    if (w->warm) {
+      m_stats.warm_starts++;
+    } else {
+      m_stats.cold_starts++;
+      w->warm = true;
+      m_failed_starts = 0;
+    }
+    auto waiting = std::move(w->waiting);
+    w->waiting = nullptr;
+    w->current = std::move(inv);
+    w->deadline.expires_after(std::chrono::seconds(m_entry.timeout));
+    w->deadline.async_wait(
+        [w](const boost::system::error_code& ec)
+        {
+          if (!ec && !w->exited) {
+            w->timed_out = true;
+            ::kill(w->pid, SIGKILL);
+          }
+        });
+    waiting(*w->current);
+  }
+
+  auto complete(worker& w,
+                const std::string& id,
+                std::string body,
+                bool function_error) -> bool
+  {
+    if (!w.current || w.current->id != id) {
+      return false;
+    }
+    w.deadline.cancel();
+    if (function_error) {
+      m_stats.errors++;
+    }
+    auto done = std::move(w.current->done);
+    w.current.reset();
+    done({
+        .status_code = 200,
+        .body = std::move(body),
+        .request_id = id,
+        .function_error = function_error,
+    });
+    return true;
+  }
+
+  auto fail(invocation& inv,
+            const std::string& type,
+            const std::string& message) -> void
+  {
+    m_stats.errors++;
+    nlohmann::json body = {{"errorType", type}, {"errorMessage", message}};
+    inv.done({
+        .status_code = 200,
+        .body = body.dump(),
+        .request_id = inv.id,
+        .function_error = true,
+    });
+  }
+
+  auto spawn() -> void
+  {
+    auto w = std::make_shared<worker>(m_io_context);
+    boost::asio::ip::tcp::endpoint endpoint(
+        boost::asio::ip::make_address("127.0.0.1"), 0);
+    w->acceptor.open(endpoint.protocol());
+    w->acceptor.bind(endpoint);
+    w->acceptor.listen();
+    // Workers must not inherit each other's runtime API sockets
+    ::fcntl(w->acceptor.native_handle(), F_SETFD, FD_CLOEXEC);
+    auto port = w->acceptor.local_endpoint().port();
+
+    std::vector<std::string> env_strings = {
+        "AWS_LAMBDA_RUNTIME_API=127.0.0.1:" + std::to_string(port),
+        "AWS_LAMBDA_FUNCTION_NAME=" + m_entry.name,
+        "AWS_LAMBDA_FUNCTION_VERSION=$LATEST",
+        "AWS_LAMBDA_FUNCTION_MEMORY_SIZE=" + std::to_string(m_entry.memory),
+        "_HANDLER=" + m_entry.name,
+    };
+    std::vector<char*> envp;
+    for (auto& s : env_strings) {
+      envp.push_back(s.data());
+    }
+    for (char** e = environ; *e != nullptr; e++) {  // NOLINT
+      envp.push_back(*e);
+    }
+    envp.push_back(nullptr);
+
+    auto executable = m_entry.executable.string();
+    std::string handler = m_entry.name;
+    std::array<char*, 3> argv = {executable.data(), handler.data(), nullptr};
+    if (posix_spawn(&w->pid,
+                    executable.c_str(),
+                    nullptr,
+                    nullptr,
+                    argv.data(),
+                    envp.data())
+        != 0)
+    {
+      throw std::runtime_error("Failed to start " + executable);
+    }
+    m_workers.push_back(w);
+    accept(w);
+  }
+
+  auto accept(const std::shared_ptr<worker>& w) -> void;
+
+  boost::asio::io_context& m_io_context;
+  function_entry m_entry;
+  emulator_options m_options;
+
+  std::list<std::shared_ptr<worker>> m_workers;
+  std::deque<invocation> m_queue;
+  boost::uuids::random_generator m_uuid_generator;
+  function_stats m_stats;
+  int m_failed_starts = 0;
+};
+
+/**
+ * @brief A connection of a worker to its runtime API endpoint,
+ * https://docs.aws.amazon.com/lambda/latest/dg/runtimes-api.html
+ */
+class function_pool::runtime_connection
+    : public std::enable_shared_from_this<runtime_connection>
+{
+public:
+  runtime_connection(function_pool& pool,
+                     std::shared_ptr<worker> w,
+                     boost::asio::ip::tcp::socket socket)
+      : m_pool(pool)
+      , m_worker(std::move(w))
+      , m_stream(std::move(socket))
+  {
+  }
+
+  auto read() -> void
+  {
+    m_request = {};
+    http::async_read(m_stream,
+                     m_buffer,
+                     m_request,
+                     [self = shared_from_this()](
+                         const boost::system::error_code& ec, std::size_t)
+                     {
+                       if (!ec) {
+                         self->handle();
+                       }
+                     });
+  }
+
+private:
+  auto handle() -> void
+  {
+    constexpr std::string_view prefix = "/2018-06-01/runtime/";
+    std::string target {m_request.target()};
+    if (!target.starts_with(prefix)) {
+      reply(http::status::not_found, "");
+      return;
+    }
+    auto path = target.substr(prefix.size());
+    auto& w = *m_worker;
+
+    if (path == "invocation/next") {
+      w.waiting = [self = shared_from_this()](const invocation& inv)
+      { self->reply_invocation(inv); };
+      m_pool.schedule();
+      return;
+    }
+
+    constexpr std::string_view invocation_prefix = "invocation/";
+    constexpr std::string_view response_suffix = "/response";
+    constexpr std::string_view error_suffix = "/error";
+    if (path.starts_with(invocation_prefix) && path.ends_with(response_suffix))
+    {
+      auto id = path.substr(invocation_prefix.size(),
+                            path.size() - invocation_prefix.size()
+                                - response_suffix.size());
+      bool ok = m_pool.complete(w, id, std::move(m_request.body()), false);
+      reply(ok ? http::status::accepted : http::status::bad_request, "{}");
+      return;
+    }
+    if (path.starts_with(invocation_prefix) && path.ends_with(error_suffix)) {
+      auto id = path.substr(invocation_prefix.size(),
+                            path.size() - invocation_prefix.size()
+                                - error_suffix.size());
+      bool ok = m_pool.complete(w, id, std::move(m_request.body()), true);
+      reply(ok ? http::status::accepted : http::status::bad_request, "{}");
+      return;
+    }
+    if (path == "init/error") {
+      std::cerr << m_pool.m_entry.name
+                << " failed to initialize: " << m_request.body() << std::endl;
+      reply(http::status::accepted, "{}");
+      return;
+    }
+    reply(http::status::not_found, "");
+  }
+
+  auto reply_invocation(const invocation& inv) -> void
+  {
+    auto deadline = std::chrono::duration_cast<std::chrono::milliseconds>(
+        (std::chrono::system_clock::now()
+         + std::chrono::seconds(m_pool.m_entry.timeout))
+            .time_since_epoch());
+    auto response = std::make_shared<http::response<http::string_body>>(
+        http::status::ok, m_request.version());
+    response->set("Lambda-Runtime-Aws-Request-Id", inv.id);
+    response->set("Lambda-Runtime-Deadline-Ms",
+                  std::to_string(deadline.count()));
+    response->set(
+        "Lambda-Runtime-Invoked-Function-Arn",
+        "arn:aws:lambda:local:000000000000:function:" + m_pool.m_entry.name);
+    response->set("Lambda-Runtime-Trace-Id", "Root=" + inv.id);
+    response->set(http::field::content_type, "application/json");
+    response->body() = inv.payload;
+    write(response);
+  }
+
+  auto reply(http::status status, std::string body) -> void
+  {
+    auto response = std::make_shared<http::response<http::string_body>>(
+        status, m_request.version());
+    response->set(http::field::content_type, "application/json");
+    response->body() = std::move(body);
+    write(response);
+  }
+
+  auto write(const std::shared_ptr<http::response<http::string_body>>& response)
+      -> void
+  {
+    response->keep_alive(m_request.keep_alive());
+    response->prepare_payload();
+    http::async_write(m_stream,
+                      *response,
+                      [self = shared_from_this(), response](
+                          const boost::system::error_code& ec, std::size_t)
+                      {
+                        if (!ec) {
+                          self->read();
+                        }
+                      });
+  }
+
+  function_pool& m_pool;
+  std::shared_ptr<worker> m_worker;
+  boost::beast::tcp_stream m_stream;
+  boost::beast::flat_buffer m_buffer;
+  http::request<http::string_body> m_request;
+};
+
+inline auto function_pool::accept(const std::shared_ptr<worker>& w) -> void
+{
+  w->acceptor.async_accept(
+      [this, w](const boost::system::error_code& ec,
+                boost::asio::ip::tcp::socket socket)
+      {
+        if (ec || w->exited) {
+          return;
+        }
+        ::fcntl(socket.native_handle(), F_SETFD, FD_CLOEXEC);
+        std::make_shared<runtime_connection>(*this, w, std::move(socket))
+            ->read();
+        accept(w);
+      });
+}
+
+/**
+ * @brief Emulates the Lambda invoke API for the entry points of local
+ * executables, running each function in its own pool of warm workers.
+ *
+ * The pools run on a thread of their own, `invoke` may be called from any
+ * thread and calls `done` on the emulator thread.
+ */
+class lambda_emulator
+{
+public:
+  explicit lambda_emulator(emulator_options options = {})
+      : m_options(options)
+      , m_signals(m_io_context, SIGCHLD)
+      , m_work(boost::asio::make_work_guard(m_io_context))
+  {
+  }
+
+  lambda_emulator(const lambda_emulator&) = delete;
+  auto operator=(const lambda_emulator&) -> lambda_emulator& = delete;
+  lambda_emulator(lambda_emulator&&) = delete;
+  auto operator=(lambda_emulator&&) -> lambda_emulator& = delete;
+
+  ~lambda_emulator()
+  {
+    stop();
+  }
+
+  /**
+   * @brief Registers the entry points of `executable`, returns their
+   * function names.
+   */
+  auto add_executable(const std::filesystem::path& executable,
+                      const std::string& target_name = "")
+      -> std::vector<std::string>
+  {
+    std::vector<std::string> names;
+    for (auto& entry : load_meta(executable, target_name)) {
+      names.push_back(entry.name);
+      auto name = entry.name;
+      m_pools.emplace(std::piecewise_construct,
+                      std::forward_as_tuple(name),
+                      std::forward_as_tuple(
+                          m_io_context, std::move(entry), m_options));
+    }
+    return names;
+  }
+
+  auto start() -> void
+  {
+    wait_for_children();
+    boost::asio::post(m_io_context,
+                      [this]
+                      {
+                        for (auto& [name, pool] : m_pools) {
+                          pool.prewarm();
+                        }
+                      });
+    m_thread = std::thread([this] { m_io_context.run(); });
+  }
+
+  auto stop() -> void
+  {
+    if (!m_thread.joinable()) {
+      return;
+    }
+    boost::asio::post(m_io_context,
+                      [this]
+                      {
+                        for (auto& [name, pool] : m_pools) {
+                          pool.shutdown();
+                        }
+                        m_signals.cancel();
+                        m_work.reset();
+                        m_io_context.stop();
+                      });
+    m_thread.join();
+  }
+
+  auto invoke(const std::string& function_name,
+              std::string payload,
+              completion_cb done) -> void
+  {
+    boost::asio::post(
+        m_io_context,
+        [this,
+         function_name,
+         payload = std::move(payload),
+         done = std::move(done)]() mutable
+        {
+          auto it = m_pools.find(function_name);
+          if (it == m_pools.end()) {
+            nlohmann::json body = {
+                {"Type", "User"},
+                {"message", "Function not found: " + function_name}};
+            done({.status_code = 404, .body = body.dump()});
+            return;
+          }
+          it->second.invoke(std::move(payload), std::move(done));
+        });
+  }
+
+  /**
+   * @brief Calls `done` on the emulator thread with the statistics of every
+   * function as JSON.
+   */
+  auto stats(std::function<void(std::string)> done) -> void
+  {
+    boost::asio::post(m_io_context,
+                      [this, done = std::move(done)]
+                      {
+                        nlohmann::json result = nlohmann::json::object();
+                        for (const auto& [name, pool] : m_pools) {
+                          auto s = pool.stats();
+                          result[name] = {
+                              {"identifier", pool.entry().identifier},
+                              {"invocations", s.invocations},
+                              {"cold_starts", s.cold_starts},
+                              {"warm_starts", s.warm_starts},
+                              {"throttled", s.throttled},
+                              {"errors", s.errors},
+                              {"workers", s.workers},
+                          };
+                        }
+                        done(result.dump(2));
+                      });
+  }
+
+private:
+  auto wait_for_children() -> void
+  {
+    m_signals.async_wait(
+        [this](const boost::system::error_code& ec, int /*signal*/)
+        {
+          if (ec) {
+            return;
+          }
+          int status = 0;
+          pid_t pid = 0;
+          while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+            for (auto& [name, pool] : m_pools) {
+              if (pool.on_exit(pid, status)) {
+                break;
+              }
+            }
+          }
+          wait_for_children();
+        });
+  }
+
+  emulator_options m_options;
+  boost::asio::io_context m_io_context;
+  boost::asio::signal_set m_signals;
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      m_work;
+  std::map<std::string, function_pool> m_pools;
+  std::thread m_thread;
+};
+
+}  // namespace cppless::emulator
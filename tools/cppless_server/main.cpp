@@ -7,7 +7,7 @@
 #include <unordered_map>
 #include <utility>
 
-#include <boost/container/small_vector.hpp>
+#include <argparse/argparse.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
@@ -16,8 +16,10 @@
 #include <nghttp2/asio_http2_server.h>
 #include <sys/stat.h>
 
+#include "lambda_emulator.hpp"
+#include "router.hpp"
+
 const int status_ok = 200;
-const int status_not_found = 404;
 const int status_method_not_allowed = 405;
 
 class temporary_file
@@ -159,158 +161,150 @@ private:
   EOFCallback m_cb;
 };
 
-class router
+// Serves the Lambda invoke API from `emulator`, point the dispatcher at it
+// with AWS_ENDPOINT_URL_LAMBDA=http://<host>:<port>
+auto add_emulator_handlers(router& r, cppless::emulator::lambda_emulator& emulator)
+    -> void
 {
-public:
-  using request_cb =
-      std::function<void(const nghttp2::asio_http2::server::request&,
-                         const nghttp2::asio_http2::server::response&,
-                         const std::vector<std::string>& dynamic_segments)>;
-
-  router() = default;
-
-  auto operator()(const nghttp2::asio_http2::server::request& req,
-                  const nghttp2::asio_http2::server::response& res) -> void
-  {
-    std::filesystem::path path(req.uri().path,
-                               std::filesystem::path::format::generic_format);
-    if (path.empty()) {
-      return;
-    }
-    std::vector<std::string> segments(++path.begin(), path.end());
-    std::vector<std::string> dynamic_segments;
-    std::string& last_segment = segments.back();
-    node* current_node = &m_nodes[0];
-    size_t index = 0;
-    for (std::string& p : segments) {
-      bool last = index++ == segments.size() - 1;
-      if (last) {
-        break;
-      }
-
-      bool found = false;
-      for (const auto& child : current_node->m_children) {
-        if (child.first == p) {
-          current_node = &m_nodes[child.second];
-          found = true;
-          break;
-        }
-      }
-      if (found) {
-        continue;
-      }
-
-      if (current_node->m_wildcard_child > 0) {
-        dynamic_segments.push_back(p);
-        current_node = &m_nodes[current_node->m_wildcard_child];
-        continue;
-      }
-
-      current_node = nullptr;
-    }
-
-    if (current_node != nullptr) {
-      if (last_segment.empty() && current_node->m_collection_callback) {
-        current_node->m_collection_callback(req, res, dynamic_segments);
-        return;
-      }
-      for (const auto& child : current_node->m_element_callbacks) {
-        if (child.first == last_segment) {
-          child.second(req, res, dynamic_segments);
-          return;
-        }
-      }
-      if (current_node->m_wildcard_callback) {
-        dynamic_segments.push_back(last_segment);
-        current_node->m_wildcard_callback(req, res, dynamic_segments);
-        return;
-      }
-    }
-
-    res.write_head(status_not_found);
-    res.end("Not Found");
-  }
+  using nghttp2::asio_http2::header_map,
+      nghttp2::asio_http2::server::request,
+      nghttp2::asio_http2::server::response;
 
-  auto add_handler(const std::string& pattern, const request_cb& cb) -> void
+  auto invocations_cb =
+      [&emulator](const request& req,
+                  const response& res,
+                  const std::vector<std::string>& dynamic_segments)
   {
-    std::filesystem::path path(pattern,
-                               std::filesystem::path::format::generic_format);
-    if (path.empty()) {
+    if (req.method() != "POST") {
+      res.write_head(status_method_not_allowed, {{"Allow", {"POST", false}}});
+      res.end();
       return;
     }
-    std::vector<std::string> segments(++path.begin(), path.end());
-    std::string& last_segment = segments.back();
-    node* current_node = &m_nodes[0];
-    size_t index = 0;
-    for (std::string& p : segments) {
-      bool last = index++ == segments.size() - 1;
-      if (last) {
-        break;
-      }
-
-      if (p.starts_with(":")) {
-        if (current_node->m_wildcard_child > 0) {
-          current_node = &m_nodes[current_node->m_wildcard_child];
-        } else {
-          current_node->m_wildcard_child = m_nodes.size();
-          current_node = &m_nodes.emplace_back();
-        }
-      } else {
-        bool found = false;
-        for (const auto& child : current_node->m_children) {
-          if (child.first == p) {
-            current_node = &m_nodes[child.second];
-            found = true;
-            break;
+    // The stream may be closed by the client before the function returns
+    auto alive = std::make_shared<bool>(true);
+    res.on_close([alive](uint32_t /*error_code*/) { *alive = false; });
+
+    req.on_data(
+        [&emulator,
+         &res,
+         alive,
+         function_name = dynamic_segments[0],
+         payload = std::string {}](const uint8_t* data, std::size_t len) mutable
+        {
+          if (len > 0) {
+            payload.append(reinterpret_cast<const char*>(data),  // NOLINT
+                           len);
+            return;
           }
-        }
-
-        if (!found) {
-          current_node->m_children.emplace_back(p, m_nodes.size());
-          current_node = &m_nodes.emplace_back();
-        }
-      }
-    }
-
-    if (last_segment.empty()) {
-      current_node->m_collection_callback = cb;
-    } else if (last_segment.starts_with(":")) {
-      current_node->m_wildcard_callback = cb;
-    } else {
-      current_node->m_element_callbacks.emplace_back(
-          std::make_pair(last_segment, cb));
-    }
-  }
+          emulator.invoke(
+              function_name,
+              std::move(payload),
+              [&res, alive](cppless::emulator::invocation_result result)
+              {
+                res.io_service().post(
+                    [&res, alive, result = std::move(result)]() mutable
+                    {
+                      if (!*alive) {
+                        return;
+                      }
+                      header_map headers {
+                          {"content-type", {"application/json", false}},
+                          {"x-amzn-requestid", {result.request_id, false}},
+                      };
+                      if (result.function_error) {
+                        headers.insert(
+                            {"x-amz-function-error", {"Unhandled", false}});
+                      }
+                      res.write_head(result.status_code, headers);
+                      res.end(std::move(result.body));
+                    });
+              });
+        });
+  };
+  r.add_handler("/2015-03-31/functions/:function_name/invocations",
+                invocations_cb);
 
-private:
-  class node
+  auto stats_cb = [&emulator](const request& /*req*/,
+                              const response& res,
+                              const std::vector<std::string>& /*segments*/)
   {
-  public:
-    constexpr static int n = 8;
-
-    node() = default;
-
-    // Default copy constructor and assignment operator are fine.
-    node(const node&) = default;
-    auto operator=(const node&) -> node& = default;
-
-    boost::container::small_vector<std::pair<std::string, size_t>, n>
-        m_children;
-    size_t m_wildcard_child = 0;
-    boost::container::small_vector<std::pair<std::string, request_cb>, n>
-        m_element_callbacks;
-    request_cb m_wildcard_callback = nullptr;
-    request_cb m_collection_callback = nullptr;
+    auto alive = std::make_shared<bool>(true);
+    res.on_close([alive](uint32_t /*error_code*/) { *alive = false; });
+    emulator.stats(
+        [&res, alive](std::string stats)
+        {
+          res.io_service().post(
+              [&res, alive, stats = std::move(stats)]() mutable
+              {
+                if (!*alive) {
+                  return;
+                }
+                res.write_head(status_ok,
+                               {{"content-type", {"application/json", false}}});
+                res.end(std::move(stats));
+              });
+        });
   };
+  r.add_handler("/stats", stats_cb);
+}
 
-  std::vector<node> m_nodes {node()};
-};
-
-auto main(int /*argc*/, char* /*argv*/[]) -> int
+auto main(int argc, char* argv[]) -> int
 {
   using nghttp2::asio_http2::server::http2,
       nghttp2::asio_http2::server::request,
       nghttp2::asio_http2::server::response;
+
+  argparse::ArgumentParser program("cppless_server");
+  program.add_argument("executables")
+      .help("Executables built with -falt-entry whose entry points are "
+            "served through the Lambda invoke API")
+      .remaining();
+  program.add_argument("--host").default_value(std::string {"localhost"});
+  program.add_argument("--port").default_value(std::string {"3000"});
+  program.add_argument("--threads")
+      .help("Threads serving HTTP/2 connections")
+      .default_value(4)
+      .scan<'i', int>();
+  program.add_argument("--target-name")
+      .help("The TARGET_NAME the executables were built with, defaults to "
+            "their file names")
+      .default_value(std::string {""});
+  program.add_argument("--min-workers")
+      .help("Warm workers started per function")
+      .default_value(0)
+      .scan<'i', int>();
+  program.add_argument("--max-workers")
+      .help("Concurrent invocations per function before throttling")
+      .default_value(64)
+      .scan<'i', int>();
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::runtime_error& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  std::vector<std::string> executables;
+  try {
+    executables = program.get<std::vector<std::string>>("executables");
+  } catch (const std::logic_error&) {
+    // No executables given
+  }
+
+  cppless::emulator::lambda_emulator emulator({
+      .min_workers = static_cast<std::size_t>(program.get<int>("--min-workers")),
+      .max_workers = static_cast<std::size_t>(program.get<int>("--max-workers")),
+  });
+  for (const auto& executable : executables) {
+    for (const auto& name : emulator.add_executable(
+             executable, program.get<std::string>("--target-name")))
+    {
+      std::cout << "Serving " << name << " from " << executable << std::endl;
+    }
+  }
+
   boost::system::error_code ec;
   http2 server;
 
@@ -364,10 +358,18 @@ auto main(int /*argc*/, char* /*argv*/[]) -> int
   };
   r.add_handler("/functions/:function_id", fn_element_cb);
 
+  if (!executables.empty()) {
+    add_emulator_handlers(r, emulator);
+    emulator.start();
+  }
+
   server.handle("/", r);
 
-  server.num_threads(4);
-  if (server.listen_and_serve(ec, "localhost", "3000")) {
+  server.num_threads(static_cast<std::size_t>(program.get<int>("--threads")));
+  if (server.listen_and_serve(ec,
+                              program.get<std::string>("--host"),
+                              program.get<std::string>("--port")))
+  {
     std::cerr << "error: " << ec.message() << std::endl;
   }
 }
\ No newline at end of file
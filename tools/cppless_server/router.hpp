@@ -0,0 +1,159 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/container/small_vector.hpp>
+#include <nghttp2/asio_http2_server.h>
+
+const int status_not_found = 404;
+
+class router
+{
+public:
+  using request_cb =
+      std::function<void(const nghttp2::asio_http2::server::request&,
+                         const nghttp2::asio_http2::server::response&,
+                         const std::vector<std::string>& dynamic_segments)>;
+
+  router() = default;
+
+  auto operator()(const nghttp2::asio_http2::server::request& req,
+                  const nghttp2::asio_http2::server::response& res) -> void
+  {
+    std::filesystem::path path(req.uri().path,
+                               std::filesystem::path::format::generic_format);
+    if (path.empty()) {
+      return;
+    }
+    std::vector<std::string> segments(++path.begin(), path.end());
+    std::vector<std::string> dynamic_segments;
+    std::string& last_segment = segments.back();
+    node* current_node = &m_nodes[0];
+    size_t index = 0;
+    for (std::string& p : segments) {
+      bool last = index++ == segments.size() - 1;
+      if (last) {
+        break;
+      }
+
+      bool found = false;
+      for (const auto& child : current_node->m_children) {
+        if (child.first == p) {
+          current_node = &m_nodes[child.second];
+          found = true;
+          break;
+        }
+      }
+      if (found) {
+        continue;
+      }
+
+      if (current_node->m_wildcard_child > 0) {
+        dynamic_segments.push_back(p);
+        current_node = &m_nodes[current_node->m_wildcard_child];
+        continue;
+      }
+
+      current_node = nullptr;
+    }
+
+    if (current_node != nullptr) {
+      if (last_segment.empty() && current_node->m_collection_callback) {
+        current_node->m_collection_callback(req, res, dynamic_segments);
+        return;
+      }
+      for (const auto& child : current_node->m_element_callbacks) {
+        if (child.first == last_segment) {
+          child.second(req, res, dynamic_segments);
+          return;
+        }
+      }
+      if (current_node->m_wildcard_callback) {
+        dynamic_segments.push_back(last_segment);
+        current_node->m_wildcard_callback(req, res, dynamic_segments);
+        return;
+      }
+    }
+
+    res.write_head(status_not_found);
+    res.end("Not Found");
+  }
+
+  auto add_handler(const std::string& pattern, const request_cb& cb) -> void
+  {
+    std::filesystem::path path(pattern,
+                               std::filesystem::path::format::generic_format);
+    if (path.empty()) {
+      return;
+    }
+    std::vector<std::string> segments(++path.begin(), path.end());
+    std::string& last_segment = segments.back();
+    node* current_node = &m_nodes[0];
+    size_t index = 0;
+    for (std::string& p : segments) {
+      bool last = index++ == segments.size() - 1;
+      if (last) {
+        break;
+      }
+
+      if (p.starts_with(":")) {
+        if (current_node->m_wildcard_child > 0) {
+          current_node = &m_nodes[current_node->m_wildcard_child];
+        } else {
+          current_node->m_wildcard_child = m_nodes.size();
+          current_node = &m_nodes.emplace_back();
+        }
+      } else {
+        bool found = false;
+        for (const auto& child : current_node->m_children) {
+          if (child.first == p) {
+            current_node = &m_nodes[child.second];
+            found = true;
+            break;
+          }
+        }
+
+        if (!found) {
+          current_node->m_children.emplace_back(p, m_nodes.size());
+          current_node = &m_nodes.emplace_back();
+        }
+      }
+    }
+
+    if (last_segment.empty()) {
+      current_node->m_collection_callback = cb;
+    } else if (last_segment.starts_with(":")) {
+      current_node->m_wildcard_callback = cb;
+    } else {
+      current_node->m_element_callbacks.emplace_back(
+          std::make_pair(last_segment, cb));
+    }
+  }
+
+private:
+  class node
+  {
+  public:
+    constexpr static int n = 8;
+
+    node() = default;
+
+    // Default copy constructor and assignment operator are fine.
+    node(const node&) = default;
+    auto operator=(const node&) -> node& = default;
+
+    boost::container::small_vector<std::pair<std::string, size_t>, n>
+        m_children;
+    size_t m_wildcard_child = 0;
+    boost::container::small_vector<std::pair<std::string, request_cb>, n>
+        m_element_callbacks;
+    request_cb m_wildcard_callback = nullptr;
+    request_cb m_collection_callback = nullptr;
+  };
+
+  std::vector<node> m_nodes {node()};
+};
@@ -479,6 +479,11 @@ def handle_entry_point(
         hash.update(str(memory).encode("utf-8"))
         hash.update("#".encode("utf-8"))
         hash.update(str(timeout).encode("utf-8"))
+        # Modifiers changing what the function does, in the order
+        # meta_serializer::identifier appends them
+        for key in ("threads", "context_cache", "remote_threshold"):
+            if key in user_meta:
+                hash.update(f"#{key}={user_meta[key]}".encode("utf-8"))
 
         # hash & hex encode the function name to avoid issues with special characters
         function_name = target_name + "-" + hash.digest().hex()[:8] + "-" + architecture